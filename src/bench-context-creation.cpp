@@ -0,0 +1,164 @@
+/*
+
+  CONTEXT CREATION BENCHMARK
+  ===========================
+
+  Times each step of `create_tmp_context()` and
+  `create_main_context()` (window, `GetDC()`,
+  `ChoosePixelFormat()`, `SetPixelFormat()`, `wglCreateContext()`,
+  the proc lookup, `wglCreateContextAttribsARB()`, ...) over N
+  iterations, and the first `make_context_current()` and the
+  destroy functions. We create the contexts exactly like
+  `create_shared_context()` does, with `GlContext::timer` set.
+
+  The steps that are timed are the ones of the `GlContext`
+  backend this was built with: WGL on Windows, EGL on Linux (see
+  _gl-context-egl.cpp_), so the same benchmark also runs against
+  Mesa's llvmpipe.
+
+  The very first context of a process loads the driver, which
+  takes a lot longer; we print it and leave it out of the
+  stats. Prints min, median, p99, mean and max per step and
+  writes the same to a JSON file.
+
+    bench-context-creation [num_iterations] [json_path]
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <gl-context.h>
+#include <gl-sync.h>
+#include <step-timer.h>
+
+/* ----------------------------------------------------------- */
+
+static uint32_t num_iterations = 200;
+static const char* json_path = "bench-context-creation.json";
+
+#if defined(_WIN32)
+static const char* backend_name = "wgl";
+#else
+static const char* backend_name = "egl";
+#endif
+
+/* ----------------------------------------------------------- */
+
+static int run_iteration(StepTimer& timer);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  if (narg > 1) {
+    num_iterations = (uint32_t)atoi(arg[1]);
+  }
+
+  if (narg > 2) {
+    json_path = arg[2];
+  }
+
+  if (0 == num_iterations) {
+    printf("Usage: %s [num_iterations] [json_path] (exiting).\n", arg[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  printf("! Benchmarking context creation (%s), %u iterations.\n", backend_name, num_iterations);
+
+  StepTimer timer;
+  timer.name = backend_name;
+
+  /* The first context loads the driver. */
+  uint64_t t0 = gpu_sync_now_ns();
+  if (0 != run_iteration(timer)) {
+    printf("Failed to create the first context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  uint64_t t1 = gpu_sync_now_ns();
+  printf("- The first context took %.3f ms; not included below.\n", (t1 - t0) / 1e6);
+
+  timer.reset();
+
+  for (uint32_t i = 0; i < num_iterations; ++i) {
+    if (0 != run_iteration(timer)) {
+      printf("Failed to run iteration %u. (exiting).\n", i);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  timer.print();
+
+  StepTimer* timers[] = { &timer };
+  if (0 != step_timer_write_json(json_path, timers, 1)) {
+    printf("Failed to write the results. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- Wrote `%s`.\n", json_path);
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+/* Does what `create_shared_context()` does, plus the first make current and the cleanup. */
+static int run_iteration(StepTimer& timer) {
+
+  GlContext tmp;
+  GlContext main;
+  uint64_t create_start = 0;
+  int r = 0;
+
+  tmp.timer = &timer;
+  main.timer = &timer;
+
+  create_start = gpu_sync_now_ns();
+
+  timer.begin();
+  if (0 != create_tmp_context(tmp)) {
+    printf("Failed to create the tmp context.\n");
+    return -1;
+  }
+
+  timer.begin();
+  if (0 != create_main_context(tmp, main)) {
+    printf("Failed to create the main context.\n");
+    destroy_tmp_context(tmp);
+    return -2;
+  }
+
+  timer.begin();
+  if (0 != destroy_tmp_context(tmp)) {
+    printf("Failed to destroy the tmp context.\n");
+    r = -3;
+  }
+
+  timer.lap("destroy tmp");
+  timer.add("total create", gpu_sync_now_ns() - create_start);
+
+  timer.begin();
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current.\n");
+    r = -4;
+  }
+
+  timer.lap("make current");
+
+  if (0 != release_current_context()) {
+    printf("Failed to release the main context.\n");
+    r = -5;
+  }
+
+  timer.begin();
+  if (0 != destroy_main_context(main)) {
+    printf("Failed to destroy the main context.\n");
+    r = -6;
+  }
+
+  timer.lap("destroy main");
+
+  return r;
+}
+
+/* ----------------------------------------------------------- */
@@ -0,0 +1,419 @@
+/*
+
+  MAKE CURRENT BENCHMARK
+  =======================
+
+  We hop contexts between threads (workers, the command list
+  replay, ...). This measures what making a context current and
+  releasing it costs in the three ways we can organise that:
+
+  - same thread: one thread switches between `num_contexts`
+    contexts; times the switch (making the next one current
+    releases the previous one).
+
+  - thread per context: `num_contexts` threads each make their
+    own context current, do a job and release it again, all at
+    the same time; times the make current and release.
+
+  - migrating: one context is passed around `num_contexts`
+    threads; a thread makes it current, does a job, releases it
+    and wakes the next thread. Times the make current, release
+    and the hand-off (from the release until the next thread
+    runs).
+
+  The job uploads `job_size` bytes into a buffer and clears the
+  surface, so the context has pending commands when it's
+  released. Each scenario runs three times:
+
+  - flush: a `glFlush()` before every release / switch;
+  - implicit: no `glFlush()`, the driver flushes when the context
+    is released;
+  - none: contexts created with `CONTEXT_RELEASE_NONE` (see
+    `gl-context.h`), nothing is flushed on release.
+
+  Prints the stats and a histogram per step and writes both to
+  a JSON file.
+
+    bench-make-current [num_iterations] [json_path]
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include <gl-context.h>
+#include <gl-resource.h>
+#include <gl-sync.h>
+#include <step-timer.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_contexts = 4;
+static const uint32_t num_warmup = 20;
+static const GLsizeiptr job_size = 64 * 1024;
+static uint32_t num_iterations = 2000;
+static const char* json_path = "bench-make-current.json";
+
+/* ----------------------------------------------------------- */
+
+struct ContextSet {
+  GlContext contexts[num_contexts];            /* All share with the first one. */
+  GLuint buffer = 0;
+};
+
+struct Scenario {
+  const char* name;
+  ContextSet* set;
+  bool is_flushing;
+  int (*run)(StepTimer& timer, ContextSet& set, bool is_flushing);
+};
+
+/* ----------------------------------------------------------- */
+
+static ContextSet flush_set;
+static ContextSet none_set;
+static std::vector<uint8_t> job_data(job_size, 0x3C);
+
+/* ----------------------------------------------------------- */
+
+static int create_context_set(ContextSet& set, ContextRelease release);
+static int destroy_context_set(ContextSet& set);
+static int run_same_thread(StepTimer& timer, ContextSet& set, bool is_flushing);
+static int run_thread_per_context(StepTimer& timer, ContextSet& set, bool is_flushing);
+static int run_migrating(StepTimer& timer, ContextSet& set, bool is_flushing);
+static void run_job(GLuint buffer);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  if (narg > 1) {
+    num_iterations = (uint32_t)atoi(arg[1]);
+  }
+
+  if (narg > 2) {
+    json_path = arg[2];
+  }
+
+  if (num_iterations <= num_warmup) {
+    printf("Usage: %s [num_iterations > %u] [json_path] (exiting).\n", arg[0], num_warmup);
+    exit(EXIT_FAILURE);
+  }
+
+  printf("! Benchmarking make current, %u contexts, %u iterations.\n", num_contexts, num_iterations);
+
+  if (0 != create_context_set(flush_set, CONTEXT_RELEASE_FLUSH)) {
+    printf("Failed to create the contexts. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != create_context_set(none_set, CONTEXT_RELEASE_NONE)) {
+    printf("Failed to create the contexts with release behaviour none. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (CONTEXT_RELEASE_NONE != none_set.contexts[0].release) {
+    printf("- Release behaviour none isn't supported; the `none` results are the same as `implicit`.\n");
+  }
+
+  Scenario scenarios[] = {
+    { "same thread, flush", &flush_set, true, run_same_thread },
+    { "same thread, implicit", &flush_set, false, run_same_thread },
+    { "same thread, none", &none_set, false, run_same_thread },
+    { "thread per context, flush", &flush_set, true, run_thread_per_context },
+    { "thread per context, implicit", &flush_set, false, run_thread_per_context },
+    { "thread per context, none", &none_set, false, run_thread_per_context },
+    { "migrating, flush", &flush_set, true, run_migrating },
+    { "migrating, implicit", &flush_set, false, run_migrating },
+    { "migrating, none", &none_set, false, run_migrating },
+  };
+
+  const size_t num_scenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+  StepTimer timers[num_scenarios];
+  StepTimer* timer_ptrs[num_scenarios];
+
+  for (size_t i = 0; i < num_scenarios; ++i) {
+
+    timers[i].name = scenarios[i].name;
+    timer_ptrs[i] = &timers[i];
+
+    if (0 != scenarios[i].run(timers[i], *scenarios[i].set, scenarios[i].is_flushing)) {
+      printf("Failed to run `%s`. (exiting).\n", scenarios[i].name);
+      exit(EXIT_FAILURE);
+    }
+
+    timers[i].print();
+    timers[i].print_histograms();
+  }
+
+  if (0 != step_timer_write_json(json_path, timer_ptrs, num_scenarios)) {
+    printf("Failed to write the results. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* Cleanup */
+  if (0 != destroy_context_set(flush_set)
+      || 0 != destroy_context_set(none_set))
+    {
+      printf("Failed to destroy the contexts. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+  printf("- Wrote `%s`.\n", json_path);
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+/* All contexts share with the first one, like our workers do. */
+static int create_context_set(ContextSet& set, ContextRelease release) {
+
+  for (uint32_t i = 0; i < num_contexts; ++i) {
+
+    set.contexts[i].release = release;
+
+    if (0 != create_shared_context((0 == i) ? nullptr : &set.contexts[0], set.contexts[i])) {
+      printf("Failed to create context %u.\n", i);
+      return -1;
+    }
+  }
+
+  if (0 != make_context_current(set.contexts[0])) {
+    printf("Failed to make the first context current.\n");
+    return -2;
+  }
+
+  if (0 != gl_create_buffer(job_size, nullptr, GL_DYNAMIC_STORAGE_BIT, set.buffer)) {
+    printf("Failed to create the job buffer.\n");
+    return -3;
+  }
+
+  /* What the driver actually gave us. */
+  GLint behavior = GL_CONTEXT_RELEASE_BEHAVIOR_FLUSH;
+  glGetIntegerv(GL_CONTEXT_RELEASE_BEHAVIOR, &behavior);
+  printf("- Created %u contexts, GL_CONTEXT_RELEASE_BEHAVIOR: %s.\n",
+         num_contexts,
+         (GL_NONE == behavior) ? "GL_NONE" : "GL_CONTEXT_RELEASE_BEHAVIOR_FLUSH");
+
+  glFinish();
+
+  if (0 != release_current_context()) {
+    printf("Failed to release the first context.\n");
+    return -4;
+  }
+
+  return 0;
+}
+
+static int destroy_context_set(ContextSet& set) {
+
+  int r = 0;
+
+  if (0 == make_context_current(set.contexts[0])) {
+    glDeleteBuffers(1, &set.buffer);
+    set.buffer = 0;
+    release_current_context();
+  }
+
+  for (uint32_t i = num_contexts; i > 0; --i) {
+    if (0 != destroy_main_context(set.contexts[i - 1])) {
+      printf("Failed to destroy context %u.\n", i - 1);
+      r = -1;
+    }
+  }
+
+  return r;
+}
+
+static int run_same_thread(StepTimer& timer, ContextSet& set, bool is_flushing) {
+
+  for (uint32_t i = 0; i < num_iterations; ++i) {
+
+    if (num_warmup == i) {
+      timer.reset();
+    }
+
+    timer.begin();
+
+    if (true == is_flushing && 0 != i) {
+      glFlush();
+    }
+
+    if (0 != make_context_current(set.contexts[i % num_contexts])) {
+      printf("Failed to switch to context %u.\n", i % num_contexts);
+      return -1;
+    }
+
+    timer.lap("switch");
+
+    run_job(set.buffer);
+  }
+
+  if (0 != release_current_context()) {
+    printf("Failed to release the last context.\n");
+    return -2;
+  }
+
+  return 0;
+}
+
+static int run_thread_per_context(StepTimer& timer, ContextSet& set, bool is_flushing) {
+
+  StepTimer thread_timers[num_contexts];
+  std::thread threads[num_contexts];
+  std::atomic<int> result(0);
+  std::atomic<uint32_t> num_ready(0);
+
+  for (uint32_t t = 0; t < num_contexts; ++t) {
+
+    threads[t] = std::thread([&, t]() {
+
+      StepTimer& thread_timer = thread_timers[t];
+
+      /* Start at the same time so the threads contend. */
+      num_ready++;
+      while (num_ready.load() < num_contexts) {
+        std::this_thread::yield();
+      }
+
+      for (uint32_t i = 0; i < num_iterations; ++i) {
+
+        if (num_warmup == i) {
+          thread_timer.reset();
+        }
+
+        thread_timer.begin();
+
+        if (0 != make_context_current(set.contexts[t])) {
+          printf("Failed to make context %u current.\n", t);
+          result = -1;
+          return;
+        }
+
+        thread_timer.lap("make current");
+
+        run_job(set.buffer);
+
+        thread_timer.begin();
+
+        if (true == is_flushing) {
+          glFlush();
+        }
+
+        if (0 != release_current_context()) {
+          printf("Failed to release context %u.\n", t);
+          result = -2;
+          return;
+        }
+
+        thread_timer.lap("release");
+      }
+    });
+  }
+
+  for (uint32_t t = 0; t < num_contexts; ++t) {
+    threads[t].join();
+    timer.append(thread_timers[t]);
+  }
+
+  return result.load();
+}
+
+static int run_migrating(StepTimer& timer, ContextSet& set, bool is_flushing) {
+
+  StepTimer thread_timers[num_contexts];
+  std::thread threads[num_contexts];
+  std::mutex mutex;
+  std::condition_variable cond;
+  uint32_t turn = 0;                           /* Protected by `mutex`; the iteration that runs next. */
+  uint64_t released_ns = 0;                    /* Protected by `mutex`. */
+  std::atomic<int> result(0);
+
+  for (uint32_t t = 0; t < num_contexts; ++t) {
+
+    threads[t] = std::thread([&, t]() {
+
+      StepTimer& thread_timer = thread_timers[t];
+
+      /* Thread `t` runs the iterations `t`, `t + num_contexts`, ... */
+      for (uint32_t i = t; i < num_iterations; i += num_contexts) {
+
+        uint64_t hand_off_ns = 0;
+
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cond.wait(lock, [&]() { return turn == i || 0 != result.load(); });
+          hand_off_ns = gpu_sync_now_ns() - released_ns;
+        }
+
+        if (0 != result.load()) {
+          return;
+        }
+
+        if (i >= num_warmup && 0 != i) {
+          thread_timer.add("hand-off", hand_off_ns);
+        }
+
+        thread_timer.begin();
+
+        if (0 != make_context_current(set.contexts[0])) {
+          printf("Failed to make the migrating context current.\n");
+          result = -1;
+        }
+
+        if (i >= num_warmup) {
+          thread_timer.lap("make current");
+        }
+
+        if (0 == result.load()) {
+          run_job(set.buffer);
+        }
+
+        thread_timer.begin();
+
+        if (true == is_flushing) {
+          glFlush();
+        }
+
+        if (0 != release_current_context()) {
+          printf("Failed to release the migrating context.\n");
+          result = -2;
+        }
+
+        if (i >= num_warmup) {
+          thread_timer.lap("release");
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          turn = i + 1;
+          released_ns = gpu_sync_now_ns();
+        }
+
+        cond.notify_all();
+      }
+    });
+  }
+
+  for (uint32_t t = 0; t < num_contexts; ++t) {
+    threads[t].join();
+    timer.append(thread_timers[t]);
+  }
+
+  return result.load();
+}
+
+/* ----------------------------------------------------------- */
+
+static void run_job(GLuint buffer) {
+  gl_upload_buffer(buffer, 0, job_size, job_data.data());
+  glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
+/* ----------------------------------------------------------- */
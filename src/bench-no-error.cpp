@@ -0,0 +1,314 @@
+/*
+
+  NO ERROR BENCHMARK
+  ===================
+
+  Measures how much of the CPU time of a draw call goes into the
+  validation that the driver does. We create a context in each
+  `ContextMode` (see `gl-context.h`): default, debug and no-error,
+  and submit the same draw call heavy frames with each of them.
+  Every draw changes the program, vertex array, texture and a
+  uniform and draws one triangle that covers a 16 x 16
+  framebuffer, so the time is spent in the driver and not in
+  rasterization.
+
+  We time the submission of a frame (the CPU side of the draw
+  calls), the `glFinish()` after it and the same state changes
+  without the draws; software rasterizers like llvmpipe do a lot
+  of work per draw, which hides the validation. The modes take
+  turns, one frame each, so they run under the same conditions.
+  We also check which flags the driver actually gave us
+  (`GL_CONTEXT_FLAGS`); a driver that doesn't support no-error
+  contexts gives us a default one.
+
+    bench-no-error [num_frames] [json_path]
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <gl-context.h>
+#include <gl-resource.h>
+#include <gl-sync.h>
+#include <step-timer.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_draws = 2000;
+static const uint32_t num_warmup = 5;
+static const GLsizei fb_size = 16;
+static uint32_t num_frames = 60;
+static const char* json_path = "bench-no-error.json";
+
+/* ----------------------------------------------------------- */
+
+static const char* fs_a = ""
+  "#version 330\n"
+  "uniform vec4 u_color;\n"
+  "uniform sampler2D u_tex;\n"
+  "layout(location = 0) out vec4 fragcolor;\n"
+  "void main() {\n"
+  "  fragcolor = u_color * texture(u_tex, vec2(0.5));\n"
+  "}\n";
+
+static const char* fs_b = ""
+  "#version 330\n"
+  "uniform vec4 u_color;\n"
+  "uniform sampler2D u_tex;\n"
+  "layout(location = 0) out vec4 fragcolor;\n"
+  "void main() {\n"
+  "  fragcolor = u_color + texture(u_tex, vec2(0.5));\n"
+  "}\n";
+
+/* ----------------------------------------------------------- */
+
+struct Mode {
+  const char* name = nullptr;
+  ContextMode mode = CONTEXT_MODE_DEFAULT;
+  GLint expected_flag = 0;                     /* The `GL_CONTEXT_FLAGS` bit we expect. */
+  GlContext ctx;
+  StepTimer timer;
+  GLuint progs[2] = { 0, 0 };                  /* Two of everything, so each draw changes the state. */
+  GLint u_colors[2] = { -1, -1 };
+  GLuint vaos[2] = { 0, 0 };
+  GLuint textures[2] = { 0, 0 };
+  GLuint tex = 0;
+  GLuint fbo = 0;
+};
+
+/* ----------------------------------------------------------- */
+
+static int setup_mode(Mode& mode);
+static int run_frame(Mode& mode);
+static int cleanup_mode(Mode& mode);
+static void change_state(Mode& mode, uint32_t i);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  if (narg > 1) {
+    num_frames = (uint32_t)atoi(arg[1]);
+  }
+
+  if (narg > 2) {
+    json_path = arg[2];
+  }
+
+  if (num_frames <= num_warmup) {
+    printf("Usage: %s [num_frames > %u] [json_path] (exiting).\n", arg[0], num_warmup);
+    exit(EXIT_FAILURE);
+  }
+
+  printf("! Benchmarking the validation overhead, %u frames of %u draws.\n", num_frames, num_draws);
+
+  Mode modes[3];
+  modes[0].name = "default";
+  modes[0].mode = CONTEXT_MODE_DEFAULT;
+  modes[0].expected_flag = 0;
+  modes[1].name = "debug";
+  modes[1].mode = CONTEXT_MODE_DEBUG;
+  modes[1].expected_flag = GL_CONTEXT_FLAG_DEBUG_BIT;
+  modes[2].name = "no-error";
+  modes[2].mode = CONTEXT_MODE_NO_ERROR;
+  modes[2].expected_flag = GL_CONTEXT_FLAG_NO_ERROR_BIT;
+
+  const size_t num_modes = sizeof(modes) / sizeof(modes[0]);
+  StepTimer* timers[num_modes];
+  double submit_ms[num_modes] = { 0 };
+  double state_ms[num_modes] = { 0 };
+  TimerStats stats;
+
+  for (size_t i = 0; i < num_modes; ++i) {
+
+    timers[i] = &modes[i].timer;
+    modes[i].timer.name = modes[i].name;
+
+    if (0 != setup_mode(modes[i])) {
+      printf("Failed to setup the `%s` mode. (exiting).\n", modes[i].name);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* We alternate between the modes each frame, so they all see the same CPU clock and load. */
+  for (uint32_t frame = 0; frame < num_frames; ++frame) {
+    for (size_t i = 0; i < num_modes; ++i) {
+
+      if (num_warmup == frame) {
+        modes[i].timer.reset();
+      }
+
+      if (0 != run_frame(modes[i])) {
+        printf("Failed to run a frame in the `%s` mode. (exiting).\n", modes[i].name);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < num_modes; ++i) {
+
+    modes[i].timer.print();
+
+    step_timer_get_stats(modes[i].timer.find("submit")->samples, stats);
+    submit_ms[i] = stats.median_ns / 1e6;
+    printf("  %.1f ns per draw (median),", stats.median_ns / (double)num_draws);
+
+    step_timer_get_stats(modes[i].timer.find("state")->samples, stats);
+    state_ms[i] = stats.median_ns / 1e6;
+    printf(" %.1f ns per state change.\n", stats.median_ns / (double)num_draws);
+  }
+
+  printf("- Median submit time: default %.3f ms, debug %.3f ms (%+.1f%%), no-error %.3f ms (%+.1f%%).\n",
+         submit_ms[0],
+         submit_ms[1],
+         100.0 * (submit_ms[1] - submit_ms[0]) / submit_ms[0],
+         submit_ms[2],
+         100.0 * (submit_ms[2] - submit_ms[0]) / submit_ms[0]);
+
+  printf("- Median state time: default %.3f ms, debug %.3f ms (%+.1f%%), no-error %.3f ms (%+.1f%%).\n",
+         state_ms[0],
+         state_ms[1],
+         100.0 * (state_ms[1] - state_ms[0]) / state_ms[0],
+         state_ms[2],
+         100.0 * (state_ms[2] - state_ms[0]) / state_ms[0]);
+
+  if (0 != step_timer_write_json(json_path, timers, num_modes)) {
+    printf("Failed to write the results. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (size_t i = 0; i < num_modes; ++i) {
+    if (0 != cleanup_mode(modes[i])) {
+      printf("Failed to cleanup the `%s` mode. (exiting).\n", modes[i].name);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  printf("- Wrote `%s`.\n", json_path);
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static int setup_mode(Mode& mode) {
+
+  mode.ctx.mode = mode.mode;
+
+  if (0 != create_shared_context(nullptr, mode.ctx)) {
+    printf("Failed to create the context.\n");
+    return -1;
+  }
+
+  if (0 != make_context_current(mode.ctx)) {
+    printf("Failed to make the context current.\n");
+    return -2;
+  }
+
+  GLint flags = 0;
+  glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+
+  printf("- %s: GL_CONTEXT_FLAGS: 0x%02X%s\n",
+         mode.name,
+         flags,
+         (0 != mode.expected_flag && 0 == (flags & mode.expected_flag)) ? ", the driver ignored the requested mode." : ".");
+
+  uint32_t pixels[2] = { 0xFF8080FFu, 0xFFFF8080u };
+
+  mode.progs[0] = create_program(fullscreen_vs, fs_a);
+  mode.progs[1] = create_program(fullscreen_vs, fs_b);
+  if (0 == mode.progs[0] || 0 == mode.progs[1]) {
+    printf("Failed to create the programs.\n");
+    return -3;
+  }
+
+  for (uint32_t i = 0; i < 2; ++i) {
+    mode.u_colors[i] = glGetUniformLocation(mode.progs[i], "u_color");
+    gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1, 0, mode.textures[i]);
+    gl_upload_texture(GL_TEXTURE_2D, mode.textures[i], 0, 0, 0, 0, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[i]);
+  }
+
+  glGenVertexArrays(2, mode.vaos);
+  gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, fb_size, fb_size, 0, mode.tex);
+  gl_create_framebuffer(mode.fbo);
+  gl_attach_texture(mode.fbo, GL_COLOR_ATTACHMENT0, mode.tex, 0);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, mode.fbo);
+  glViewport(0, 0, fb_size, fb_size);
+  glActiveTexture(GL_TEXTURE0);
+
+  return 0;
+}
+
+/* Each frame draws `num_draws` times and then does the same state changes again, without the draws. */
+static int run_frame(Mode& mode) {
+
+  if (0 != make_context_current(mode.ctx)) {
+    printf("Failed to make the context current.\n");
+    return -1;
+  }
+
+  StepTimer& timer = mode.timer;
+  timer.begin();
+
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  for (uint32_t i = 0; i < num_draws; ++i) {
+    change_state(mode, i);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+  }
+
+  timer.lap("submit");
+
+  glFinish();
+
+  timer.lap("finish");
+
+  for (uint32_t i = 0; i < num_draws; ++i) {
+    change_state(mode, i);
+  }
+
+  timer.lap("state");
+
+  GLenum err = glGetError();
+  if (CONTEXT_MODE_NO_ERROR != mode.mode && GL_NO_ERROR != err) {
+    printf("- %s: the frame caused GL error 0x%04X.\n", mode.name, err);
+    return -2;
+  }
+
+  return 0;
+}
+
+static int cleanup_mode(Mode& mode) {
+
+  if (0 != make_context_current(mode.ctx)) {
+    printf("Failed to make the context current.\n");
+    return -1;
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &mode.fbo);
+  glDeleteTextures(1, &mode.tex);
+  glDeleteTextures(2, mode.textures);
+  glDeleteVertexArrays(2, mode.vaos);
+  glDeleteProgram(mode.progs[0]);
+  glDeleteProgram(mode.progs[1]);
+
+  if (0 != destroy_main_context(mode.ctx)) {
+    printf("Failed to destroy the context.\n");
+    return -2;
+  }
+
+  return 0;
+}
+
+static void change_state(Mode& mode, uint32_t i) {
+  uint32_t p = i & 1;
+  glUseProgram(mode.progs[p]);
+  glBindVertexArray(mode.vaos[(i >> 1) & 1]);
+  glBindTexture(GL_TEXTURE_2D, mode.textures[(i >> 2) & 1]);
+  glUniform4f(mode.u_colors[p], (i % 17) / 17.0f, (i % 13) / 13.0f, 0.5f, 1.0f);
+}
+
+/* ----------------------------------------------------------- */
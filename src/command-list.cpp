@@ -0,0 +1,709 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <future>
+#include <command-list.h>
+
+/* ------------------------------------------------------------- */
+
+/* The packed arguments that follow a `CommandHeader`. */
+
+struct CmdRect          { GLint x; GLint y; GLsizei width; GLsizei height; };
+struct CmdColor         { GLfloat r; GLfloat g; GLfloat b; GLfloat a; };
+struct CmdBitfield      { GLbitfield mask; };
+struct CmdEnum          { GLenum value; };
+struct CmdEnum2         { GLenum a; GLenum b; };
+struct CmdName          { GLuint name; };
+struct CmdBind          { GLenum target; GLuint name; };
+struct CmdBindBase      { GLenum target; GLuint index; GLuint buffer; };
+struct CmdBindRange     { GLenum target; GLuint index; GLuint buffer; GLintptr offset; GLsizeiptr size; };
+struct CmdBufferData    { GLenum target; GLintptr offset; GLsizeiptr size; };             /* Followed by `size` bytes. */
+struct CmdUniformInt    { GLint location; GLint v; };
+struct CmdUniformFloat  { GLint location; GLfloat v; };
+struct CmdUniformVec4   { GLint location; GLfloat v[4]; };
+struct CmdUniformMatrix { GLint location; GLsizei count; GLboolean transpose; };         /* Followed by `count * 16` floats. */
+struct CmdDrawArrays    { GLenum mode; GLint first; GLsizei count; GLsizei instances; };
+struct CmdDrawElements  { GLenum mode; GLsizei count; GLenum type; GLsizei instances; uintptr_t offset; };
+
+/* ------------------------------------------------------------- */
+
+/* `CommandHeader::size` is 32 bits; leave room for the header, the arguments and the padding. */
+static const uint64_t max_data_size = 0xFFFFFFFFull - 256;
+
+/* ------------------------------------------------------------- */
+
+static uint32_t align8(size_t n) {
+  return (uint32_t)((n + 7) & ~(size_t)7);
+}
+
+/* ------------------------------------------------------------- */
+
+CommandArena::~CommandArena() {
+
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    free(chunks[i].data);
+  }
+
+  chunks.clear();
+  curr = 0;
+}
+
+void* CommandArena::alloc(uint32_t nbytes) {
+
+  nbytes = align8(nbytes);
+
+  /* Find a chunk (starting at the current one) with enough space. */
+  while (curr < chunks.size()) {
+    Chunk& chunk = chunks[curr];
+    if ((uint64_t)chunk.used + nbytes <= chunk.capacity) {
+      void* ptr = chunk.data + chunk.used;
+      chunk.used += nbytes;
+      return ptr;
+    }
+    if (curr + 1 == chunks.size()) {
+      break;
+    }
+    curr++;
+  }
+
+  /* Out of space; big allocations get their own chunk. */
+  Chunk chunk = {};
+  chunk.capacity = (nbytes > chunk_size) ? nbytes : chunk_size;
+  chunk.data = (uint8_t*)malloc(chunk.capacity);
+  if (nullptr == chunk.data) {
+    printf("Failed to allocate a command arena chunk.\n");
+    return nullptr;
+  }
+
+  chunk.used = nbytes;
+  chunks.push_back(chunk);
+  curr = chunks.size() - 1;
+
+  return chunks.back().data;
+}
+
+void CommandArena::reset() {
+
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    chunks[i].used = 0;
+  }
+
+  curr = 0;
+}
+
+size_t CommandArena::size() const {
+
+  size_t total = 0;
+
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    total += chunks[i].used;
+  }
+
+  return total;
+}
+
+/* ------------------------------------------------------------- */
+
+void* CommandList::push(CommandId id, uint32_t nbytes) {
+
+  uint32_t size = align8(sizeof(CommandHeader) + nbytes);
+  uint8_t* ptr = (uint8_t*)arena.alloc(size);
+  if (nullptr == ptr) {
+    return nullptr;
+  }
+
+  CommandHeader* header = (CommandHeader*)ptr;
+  header->id = id;
+  header->size = size;
+  num_commands++;
+
+  return ptr + sizeof(CommandHeader);
+}
+
+void CommandList::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  CmdRect* cmd = (CmdRect*)push(CMD_VIEWPORT, sizeof(CmdRect));
+  if (nullptr != cmd) {
+    *cmd = { x, y, width, height };
+  }
+}
+
+void CommandList::scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+  CmdRect* cmd = (CmdRect*)push(CMD_SCISSOR, sizeof(CmdRect));
+  if (nullptr != cmd) {
+    *cmd = { x, y, width, height };
+  }
+}
+
+void CommandList::clear_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+  CmdColor* cmd = (CmdColor*)push(CMD_CLEAR_COLOR, sizeof(CmdColor));
+  if (nullptr != cmd) {
+    *cmd = { r, g, b, a };
+  }
+}
+
+void CommandList::clear(GLbitfield mask) {
+  CmdBitfield* cmd = (CmdBitfield*)push(CMD_CLEAR, sizeof(CmdBitfield));
+  if (nullptr != cmd) {
+    cmd->mask = mask;
+  }
+}
+
+void CommandList::enable(GLenum cap) {
+  CmdEnum* cmd = (CmdEnum*)push(CMD_ENABLE, sizeof(CmdEnum));
+  if (nullptr != cmd) {
+    cmd->value = cap;
+  }
+}
+
+void CommandList::disable(GLenum cap) {
+  CmdEnum* cmd = (CmdEnum*)push(CMD_DISABLE, sizeof(CmdEnum));
+  if (nullptr != cmd) {
+    cmd->value = cap;
+  }
+}
+
+void CommandList::blend_func(GLenum src, GLenum dst) {
+  CmdEnum2* cmd = (CmdEnum2*)push(CMD_BLEND_FUNC, sizeof(CmdEnum2));
+  if (nullptr != cmd) {
+    *cmd = { src, dst };
+  }
+}
+
+void CommandList::depth_func(GLenum func) {
+  CmdEnum* cmd = (CmdEnum*)push(CMD_DEPTH_FUNC, sizeof(CmdEnum));
+  if (nullptr != cmd) {
+    cmd->value = func;
+  }
+}
+
+void CommandList::use_program(GLuint program) {
+  CmdName* cmd = (CmdName*)push(CMD_USE_PROGRAM, sizeof(CmdName));
+  if (nullptr != cmd) {
+    cmd->name = program;
+  }
+}
+
+void CommandList::bind_vertex_array(GLuint vao) {
+  CmdName* cmd = (CmdName*)push(CMD_BIND_VERTEX_ARRAY, sizeof(CmdName));
+  if (nullptr != cmd) {
+    cmd->name = vao;
+  }
+}
+
+void CommandList::bind_buffer(GLenum target, GLuint buffer) {
+  CmdBind* cmd = (CmdBind*)push(CMD_BIND_BUFFER, sizeof(CmdBind));
+  if (nullptr != cmd) {
+    *cmd = { target, buffer };
+  }
+}
+
+void CommandList::bind_buffer_base(GLenum target, GLuint index, GLuint buffer) {
+  CmdBindBase* cmd = (CmdBindBase*)push(CMD_BIND_BUFFER_BASE, sizeof(CmdBindBase));
+  if (nullptr != cmd) {
+    *cmd = { target, index, buffer };
+  }
+}
+
+void CommandList::bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+  CmdBindRange* cmd = (CmdBindRange*)push(CMD_BIND_BUFFER_RANGE, sizeof(CmdBindRange));
+  if (nullptr != cmd) {
+    *cmd = { target, index, buffer, offset, size };
+  }
+}
+
+void CommandList::buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+
+  if (nullptr == data || size <= 0) {
+    printf("Cannot record `buffer_sub_data()`, no data given.\n");
+    return;
+  }
+
+  if ((uint64_t)size > max_data_size) {
+    printf("Cannot record `buffer_sub_data()`, %lld bytes doesn't fit in a command.\n", (long long)size);
+    return;
+  }
+
+  CmdBufferData* cmd = (CmdBufferData*)push(CMD_BUFFER_SUB_DATA, align8(sizeof(CmdBufferData)) + (uint32_t)size);
+  if (nullptr == cmd) {
+    return;
+  }
+
+  *cmd = { target, offset, size };
+  memcpy((uint8_t*)cmd + align8(sizeof(CmdBufferData)), data, size);
+}
+
+void CommandList::active_texture(GLenum unit) {
+  CmdEnum* cmd = (CmdEnum*)push(CMD_ACTIVE_TEXTURE, sizeof(CmdEnum));
+  if (nullptr != cmd) {
+    cmd->value = unit;
+  }
+}
+
+void CommandList::bind_texture(GLenum target, GLuint texture) {
+  CmdBind* cmd = (CmdBind*)push(CMD_BIND_TEXTURE, sizeof(CmdBind));
+  if (nullptr != cmd) {
+    *cmd = { target, texture };
+  }
+}
+
+void CommandList::uniform_1i(GLint location, GLint v) {
+  CmdUniformInt* cmd = (CmdUniformInt*)push(CMD_UNIFORM_1I, sizeof(CmdUniformInt));
+  if (nullptr != cmd) {
+    *cmd = { location, v };
+  }
+}
+
+void CommandList::uniform_1f(GLint location, GLfloat v) {
+  CmdUniformFloat* cmd = (CmdUniformFloat*)push(CMD_UNIFORM_1F, sizeof(CmdUniformFloat));
+  if (nullptr != cmd) {
+    *cmd = { location, v };
+  }
+}
+
+void CommandList::uniform_4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w) {
+  CmdUniformVec4* cmd = (CmdUniformVec4*)push(CMD_UNIFORM_4F, sizeof(CmdUniformVec4));
+  if (nullptr != cmd) {
+    cmd->location = location;
+    cmd->v[0] = x;
+    cmd->v[1] = y;
+    cmd->v[2] = z;
+    cmd->v[3] = w;
+  }
+}
+
+void CommandList::uniform_matrix_4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+
+  if (nullptr == value || count <= 0) {
+    printf("Cannot record `uniform_matrix_4fv()`, no values given.\n");
+    return;
+  }
+
+  if ((uint64_t)count * 16 * sizeof(GLfloat) > max_data_size) {
+    printf("Cannot record `uniform_matrix_4fv()`, %d matrices don't fit in a command.\n", (int)count);
+    return;
+  }
+
+  uint32_t nbytes = (uint32_t)count * 16 * sizeof(GLfloat);
+  CmdUniformMatrix* cmd = (CmdUniformMatrix*)push(CMD_UNIFORM_MATRIX_4FV, align8(sizeof(CmdUniformMatrix)) + nbytes);
+  if (nullptr == cmd) {
+    return;
+  }
+
+  *cmd = { location, count, transpose };
+  memcpy((uint8_t*)cmd + align8(sizeof(CmdUniformMatrix)), value, nbytes);
+}
+
+void CommandList::draw_arrays(GLenum mode, GLint first, GLsizei count) {
+  CmdDrawArrays* cmd = (CmdDrawArrays*)push(CMD_DRAW_ARRAYS, sizeof(CmdDrawArrays));
+  if (nullptr != cmd) {
+    *cmd = { mode, first, count, 1 };
+  }
+}
+
+void CommandList::draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+  CmdDrawArrays* cmd = (CmdDrawArrays*)push(CMD_DRAW_ARRAYS_INSTANCED, sizeof(CmdDrawArrays));
+  if (nullptr != cmd) {
+    *cmd = { mode, first, count, instances };
+  }
+}
+
+void CommandList::draw_elements(GLenum mode, GLsizei count, GLenum type, uintptr_t offset) {
+  CmdDrawElements* cmd = (CmdDrawElements*)push(CMD_DRAW_ELEMENTS, sizeof(CmdDrawElements));
+  if (nullptr != cmd) {
+    *cmd = { mode, count, type, 1, offset };
+  }
+}
+
+void CommandList::draw_elements_instanced(GLenum mode, GLsizei count, GLenum type, uintptr_t offset, GLsizei instances) {
+  CmdDrawElements* cmd = (CmdDrawElements*)push(CMD_DRAW_ELEMENTS_INSTANCED, sizeof(CmdDrawElements));
+  if (nullptr != cmd) {
+    *cmd = { mode, count, type, instances, offset };
+  }
+}
+
+void CommandList::flush() {
+  push(CMD_FLUSH, 0);
+}
+
+void CommandList::reset() {
+  arena.reset();
+  num_commands = 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int execute_command_list(const CommandList& list) {
+
+  const CommandArena& arena = list.arena;
+
+  for (size_t i = 0; i < arena.chunks.size(); ++i) {
+
+    const uint8_t* ptr = arena.chunks[i].data;
+    const uint8_t* end = ptr + arena.chunks[i].used;
+
+    while (ptr < end) {
+
+      const CommandHeader* header = (const CommandHeader*)ptr;
+      const void* args = ptr + sizeof(CommandHeader);
+
+      switch (header->id) {
+
+        case CMD_VIEWPORT: {
+          const CmdRect* cmd = (const CmdRect*)args;
+          glViewport(cmd->x, cmd->y, cmd->width, cmd->height);
+          break;
+        }
+        case CMD_SCISSOR: {
+          const CmdRect* cmd = (const CmdRect*)args;
+          glScissor(cmd->x, cmd->y, cmd->width, cmd->height);
+          break;
+        }
+        case CMD_CLEAR_COLOR: {
+          const CmdColor* cmd = (const CmdColor*)args;
+          glClearColor(cmd->r, cmd->g, cmd->b, cmd->a);
+          break;
+        }
+        case CMD_CLEAR: {
+          glClear(((const CmdBitfield*)args)->mask);
+          break;
+        }
+        case CMD_ENABLE: {
+          glEnable(((const CmdEnum*)args)->value);
+          break;
+        }
+        case CMD_DISABLE: {
+          glDisable(((const CmdEnum*)args)->value);
+          break;
+        }
+        case CMD_BLEND_FUNC: {
+          const CmdEnum2* cmd = (const CmdEnum2*)args;
+          glBlendFunc(cmd->a, cmd->b);
+          break;
+        }
+        case CMD_DEPTH_FUNC: {
+          glDepthFunc(((const CmdEnum*)args)->value);
+          break;
+        }
+        case CMD_USE_PROGRAM: {
+          glUseProgram(((const CmdName*)args)->name);
+          break;
+        }
+        case CMD_BIND_VERTEX_ARRAY: {
+          glBindVertexArray(((const CmdName*)args)->name);
+          break;
+        }
+        case CMD_BIND_BUFFER: {
+          const CmdBind* cmd = (const CmdBind*)args;
+          glBindBuffer(cmd->target, cmd->name);
+          break;
+        }
+        case CMD_BIND_BUFFER_BASE: {
+          const CmdBindBase* cmd = (const CmdBindBase*)args;
+          glBindBufferBase(cmd->target, cmd->index, cmd->buffer);
+          break;
+        }
+        case CMD_BIND_BUFFER_RANGE: {
+          const CmdBindRange* cmd = (const CmdBindRange*)args;
+          glBindBufferRange(cmd->target, cmd->index, cmd->buffer, cmd->offset, cmd->size);
+          break;
+        }
+        case CMD_BUFFER_SUB_DATA: {
+          const CmdBufferData* cmd = (const CmdBufferData*)args;
+          glBufferSubData(cmd->target, cmd->offset, cmd->size, (const uint8_t*)cmd + align8(sizeof(CmdBufferData)));
+          break;
+        }
+        case CMD_ACTIVE_TEXTURE: {
+          glActiveTexture(((const CmdEnum*)args)->value);
+          break;
+        }
+        case CMD_BIND_TEXTURE: {
+          const CmdBind* cmd = (const CmdBind*)args;
+          glBindTexture(cmd->target, cmd->name);
+          break;
+        }
+        case CMD_UNIFORM_1I: {
+          const CmdUniformInt* cmd = (const CmdUniformInt*)args;
+          glUniform1i(cmd->location, cmd->v);
+          break;
+        }
+        case CMD_UNIFORM_1F: {
+          const CmdUniformFloat* cmd = (const CmdUniformFloat*)args;
+          glUniform1f(cmd->location, cmd->v);
+          break;
+        }
+        case CMD_UNIFORM_4F: {
+          const CmdUniformVec4* cmd = (const CmdUniformVec4*)args;
+          glUniform4f(cmd->location, cmd->v[0], cmd->v[1], cmd->v[2], cmd->v[3]);
+          break;
+        }
+        case CMD_UNIFORM_MATRIX_4FV: {
+          const CmdUniformMatrix* cmd = (const CmdUniformMatrix*)args;
+          glUniformMatrix4fv(cmd->location, cmd->count, cmd->transpose, (const GLfloat*)((const uint8_t*)cmd + align8(sizeof(CmdUniformMatrix))));
+          break;
+        }
+        case CMD_DRAW_ARRAYS: {
+          const CmdDrawArrays* cmd = (const CmdDrawArrays*)args;
+          glDrawArrays(cmd->mode, cmd->first, cmd->count);
+          break;
+        }
+        case CMD_DRAW_ARRAYS_INSTANCED: {
+          const CmdDrawArrays* cmd = (const CmdDrawArrays*)args;
+          glDrawArraysInstanced(cmd->mode, cmd->first, cmd->count, cmd->instances);
+          break;
+        }
+        case CMD_DRAW_ELEMENTS: {
+          const CmdDrawElements* cmd = (const CmdDrawElements*)args;
+          glDrawElements(cmd->mode, cmd->count, cmd->type, (const void*)cmd->offset);
+          break;
+        }
+        case CMD_DRAW_ELEMENTS_INSTANCED: {
+          const CmdDrawElements* cmd = (const CmdDrawElements*)args;
+          glDrawElementsInstanced(cmd->mode, cmd->count, cmd->type, (const void*)cmd->offset, cmd->instances);
+          break;
+        }
+        case CMD_FLUSH: {
+          glFlush();
+          break;
+        }
+        default: {
+          printf("Unhandled command id: %u, stopping execution of this list.\n", header->id);
+          return -1;
+        }
+      }
+
+      ptr += header->size;
+    }
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+CommandQueue::~CommandQueue() {
+  shutdown();
+}
+
+int CommandQueue::init(uint32_t num_recorders, uint32_t num_buffers) {
+
+  if (nullptr != slots) {
+    printf("Cannot initialize the command queue, already initialized.\n");
+    return -1;
+  }
+
+  if (0 == num_recorders || 0 == num_buffers) {
+    printf("Cannot initialize the command queue, `num_recorders` and `num_buffers` must be > 0.\n");
+    return -2;
+  }
+
+  num_slots = num_recorders * num_buffers;
+  slots = new CommandSlot[num_slots];
+
+  for (uint32_t i = 0; i < num_slots; ++i) {
+    slots[i].list.index = i;
+  }
+
+  next_submit = 0;
+  next_execute = 0;
+
+  return 0;
+}
+
+int CommandQueue::shutdown() {
+
+  if (nullptr != slots) {
+    delete[] slots;
+  }
+
+  slots = nullptr;
+  num_slots = 0;
+
+  return 0;
+}
+
+CommandList* CommandQueue::acquire(bool wait) {
+
+  if (nullptr == slots) {
+    printf("Cannot acquire a command list, not initialized.\n");
+    return nullptr;
+  }
+
+  while (true) {
+
+    for (uint32_t i = 0; i < num_slots; ++i) {
+      uint32_t expected = CMD_SLOT_FREE;
+      if (slots[i].state.compare_exchange_strong(expected, CMD_SLOT_RECORDING, std::memory_order_acquire)) {
+        return &slots[i].list;
+      }
+    }
+
+    if (false == wait) {
+      return nullptr;
+    }
+
+    /* All lists are in flight; the executor is behind. */
+    std::this_thread::yield();
+  }
+}
+
+int CommandQueue::submit(CommandList* list) {
+
+  if (nullptr == list || list->index >= num_slots) {
+    printf("Cannot submit, invalid command list.\n");
+    return -1;
+  }
+
+  CommandSlot& slot = slots[list->index];
+  if (CMD_SLOT_RECORDING != slot.state.load(std::memory_order_relaxed)) {
+    printf("Cannot submit, the command list wasn't acquired.\n");
+    return -2;
+  }
+
+  slot.seq = next_submit.fetch_add(1, std::memory_order_relaxed);
+  slot.state.store(CMD_SLOT_READY, std::memory_order_release);
+
+  return 0;
+}
+
+CommandList* CommandQueue::pop() {
+
+  if (nullptr == slots) {
+    return nullptr;
+  }
+
+  /*
+     We only return the list with the next sequence number; when
+     a recorder has taken a sequence number but didn't publish
+     its list yet we wait for it so the submit order is kept.
+  */
+  for (uint32_t i = 0; i < num_slots; ++i) {
+    CommandSlot& slot = slots[i];
+    if (CMD_SLOT_READY != slot.state.load(std::memory_order_acquire)) {
+      continue;
+    }
+    if (slot.seq != next_execute) {
+      continue;
+    }
+    slot.state.store(CMD_SLOT_EXECUTING, std::memory_order_relaxed);
+    next_execute++;
+    return &slot.list;
+  }
+
+  return nullptr;
+}
+
+int CommandQueue::release(CommandList* list) {
+
+  if (nullptr == list || list->index >= num_slots) {
+    printf("Cannot release, invalid command list.\n");
+    return -1;
+  }
+
+  list->reset();
+  slots[list->index].state.store(CMD_SLOT_FREE, std::memory_order_release);
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int CommandExecutor::start(GlContext* shared, CommandQueue* q) {
+
+  if (true == is_running) {
+    printf("Cannot start the command executor, already running.\n");
+    return -1;
+  }
+
+  if (nullptr == q || nullptr == q->slots) {
+    printf("Cannot start the command executor, invalid queue.\n");
+    return -2;
+  }
+
+  queue = q;
+  num_lists = 0;
+  num_commands = 0;
+  num_bytes = 0;
+  is_running = true;
+
+  /* The thread reports back once it created its context. */
+  std::promise<int> created;
+  std::future<int> result = created.get_future();
+
+  thread = std::thread([this, shared, &created]() {
+
+    if (0 != create_shared_context(shared, ctx)) {
+      created.set_value(-1);
+      return;
+    }
+
+    if (0 != make_context_current(ctx)) {
+      destroy_main_context(ctx);
+      created.set_value(-2);
+      return;
+    }
+
+    created.set_value(0);
+
+    uint32_t num_idle = 0;
+
+    while (true) {
+
+      CommandList* list = queue->pop();
+      if (nullptr != list) {
+        num_lists++;
+        num_commands += list->num_commands;
+        num_bytes += list->arena.size();
+        execute_command_list(*list);
+        queue->release(list);
+        num_idle = 0;
+        continue;
+      }
+
+      /* Only stop when everything that was submitted has been executed. */
+      if (false == is_running.load(std::memory_order_acquire)
+          && queue->next_execute == queue->next_submit.load(std::memory_order_acquire)) {
+        break;
+      }
+
+      /* Nothing to do: spin a bit, then back off. */
+      num_idle++;
+      if (num_idle < 64) {
+        std::this_thread::yield();
+      }
+      else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+
+    if (0 != destroy_main_context(ctx)) {
+      printf("Failed to cleanly destroy the command executor context.\n");
+    }
+  });
+
+  int r = result.get();
+  if (0 != r) {
+    printf("Failed to create the command executor context.\n");
+    is_running = false;
+    thread.join();
+    return -3;
+  }
+
+  return 0;
+}
+
+int CommandExecutor::stop() {
+
+  if (false == thread.joinable()) {
+    printf("Cannot stop the command executor, not started.\n");
+    return -1;
+  }
+
+  is_running.store(false, std::memory_order_release);
+  thread.join();
+  queue = nullptr;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
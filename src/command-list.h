@@ -0,0 +1,212 @@
+/*
+
+  COMMAND LISTS
+  ==============
+
+  Filament records its commands on one thread and executes them
+  on a driver thread that owns the GL context. This is the same
+  idea, stripped down to what we need:
+
+  - `CommandList`: a compact stream of commands that is stored
+    in an arena (`CommandArena`). Each command is a
+    `CommandHeader` with a `CommandId` (our own enum, which
+    `execute_command_list()` maps to the GL call) and the size
+    of the command, followed by the packed arguments. Data that
+    is passed by pointer (e.g. uniform matrices) is copied into
+    the arena so the caller can reuse its memory directly after
+    recording. A command that doesn't fit in the 32 bit size
+    isn't recorded.
+
+  - `CommandQueue`: one pool of `num_recorders * num_buffers`
+    command lists that all recording threads share. A recording
+    thread acquires any free list, records into it and submits
+    it; lists don't belong to a thread. With `num_buffers` set
+    to 2 or 3 there are enough lists for every recording thread
+    to record the next list(s) while the previous ones are
+    being executed. The handoff between the recording threads
+    and the executor is lock free; every slot has an atomic
+    state and lists are executed in the order they were
+    submitted.
+
+  - `CommandExecutor`: a thread that creates a context, which
+    shares with the context you pass into `start()`, and
+    replays the submitted lists. This is the only thread that
+    makes GL calls; the recording threads never need a context.
+
+  Because the executor creates a shared context in its own
+  thread, the context you pass into `start()` must not be
+  current in any thread until `start()` returns.
+
+ */
+#ifndef COMMAND_LIST_H
+#define COMMAND_LIST_H
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gl-context.h>
+
+/* ----------------------------------------------------------- */
+
+enum CommandId {
+  CMD_NONE = 0,
+  CMD_VIEWPORT,                 /* glViewport */
+  CMD_SCISSOR,                  /* glScissor */
+  CMD_CLEAR_COLOR,              /* glClearColor */
+  CMD_CLEAR,                    /* glClear */
+  CMD_ENABLE,                   /* glEnable */
+  CMD_DISABLE,                  /* glDisable */
+  CMD_BLEND_FUNC,               /* glBlendFunc */
+  CMD_DEPTH_FUNC,               /* glDepthFunc */
+  CMD_USE_PROGRAM,              /* glUseProgram */
+  CMD_BIND_VERTEX_ARRAY,        /* glBindVertexArray */
+  CMD_BIND_BUFFER,              /* glBindBuffer */
+  CMD_BIND_BUFFER_BASE,         /* glBindBufferBase */
+  CMD_BIND_BUFFER_RANGE,        /* glBindBufferRange */
+  CMD_BUFFER_SUB_DATA,          /* glBufferSubData */
+  CMD_ACTIVE_TEXTURE,           /* glActiveTexture */
+  CMD_BIND_TEXTURE,             /* glBindTexture */
+  CMD_UNIFORM_1I,               /* glUniform1i */
+  CMD_UNIFORM_1F,               /* glUniform1f */
+  CMD_UNIFORM_4F,               /* glUniform4f */
+  CMD_UNIFORM_MATRIX_4FV,       /* glUniformMatrix4fv */
+  CMD_DRAW_ARRAYS,              /* glDrawArrays */
+  CMD_DRAW_ARRAYS_INSTANCED,    /* glDrawArraysInstanced */
+  CMD_DRAW_ELEMENTS,            /* glDrawElements */
+  CMD_DRAW_ELEMENTS_INSTANCED,  /* glDrawElementsInstanced */
+  CMD_FLUSH,                    /* glFlush */
+  CMD_COUNT
+};
+
+/* ----------------------------------------------------------- */
+
+struct CommandHeader {
+  uint32_t id;                  /* One of the `CommandId` values. */
+  uint32_t size;                /* The size of the header + arguments + padding; used to jump to the next command. */
+};
+
+/* ----------------------------------------------------------- */
+
+class CommandArena {
+public:
+  struct Chunk {
+    uint8_t* data;
+    uint32_t capacity;
+    uint32_t used;
+  };
+
+public:
+  CommandArena() = default;
+  CommandArena(const CommandArena&) = delete;
+  CommandArena& operator=(const CommandArena&) = delete;
+  ~CommandArena();
+  void* alloc(uint32_t nbytes);  /* Returns 8-byte aligned memory; an allocation never spans two chunks. */
+  void reset();                  /* Rewinds all chunks, but keeps the memory around for the next recording. */
+  size_t size() const;           /* The number of bytes that have been allocated since the last reset. */
+
+public:
+  std::vector<Chunk> chunks;
+  size_t curr = 0;               /* Index of the chunk we're allocating from. */
+  uint32_t chunk_size = 64 * 1024;
+};
+
+/* ----------------------------------------------------------- */
+
+class CommandList {
+public:
+  void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+  void scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+  void clear_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+  void clear(GLbitfield mask);
+  void enable(GLenum cap);
+  void disable(GLenum cap);
+  void blend_func(GLenum src, GLenum dst);
+  void depth_func(GLenum func);
+  void use_program(GLuint program);
+  void bind_vertex_array(GLuint vao);
+  void bind_buffer(GLenum target, GLuint buffer);
+  void bind_buffer_base(GLenum target, GLuint index, GLuint buffer);
+  void bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+  void buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size, const void* data); /* `data` is copied. */
+  void active_texture(GLenum unit);
+  void bind_texture(GLenum target, GLuint texture);
+  void uniform_1i(GLint location, GLint v);
+  void uniform_1f(GLint location, GLfloat v);
+  void uniform_4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+  void uniform_matrix_4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value); /* `value` is copied. */
+  void draw_arrays(GLenum mode, GLint first, GLsizei count);
+  void draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei instances);
+  void draw_elements(GLenum mode, GLsizei count, GLenum type, uintptr_t offset);
+  void draw_elements_instanced(GLenum mode, GLsizei count, GLenum type, uintptr_t offset, GLsizei instances);
+  void flush();
+  void reset();
+
+public:
+  CommandArena arena;
+  uint32_t num_commands = 0;
+  uint32_t index = 0;            /* The slot in the `CommandQueue`, set by the queue. */
+
+private:
+  void* push(CommandId id, uint32_t nbytes);
+};
+
+/* ----------------------------------------------------------- */
+
+int execute_command_list(const CommandList& list); /* Replays all commands; a context must be current. */
+
+/* ----------------------------------------------------------- */
+
+enum CommandSlotState {
+  CMD_SLOT_FREE = 0,
+  CMD_SLOT_RECORDING,
+  CMD_SLOT_READY,
+  CMD_SLOT_EXECUTING,
+};
+
+struct CommandSlot {
+  std::atomic<uint32_t> state{CMD_SLOT_FREE};
+  uint64_t seq = 0;               /* Submit order; written before `state` becomes `CMD_SLOT_READY`. */
+  CommandList list;
+};
+
+class CommandQueue {
+public:
+  CommandQueue() = default;
+  CommandQueue(const CommandQueue&) = delete;
+  CommandQueue& operator=(const CommandQueue&) = delete;
+  ~CommandQueue();
+  int init(uint32_t num_recorders, uint32_t num_buffers); /* Creates `num_recorders * num_buffers` shared lists; `num_buffers` is 2 for double, 3 for triple buffering. */
+  int shutdown();
+  CommandList* acquire(bool wait = true);  /* Recording thread: returns a free list or nullptr when `wait` is false and all lists are in use. */
+  int submit(CommandList* list);            /* Recording thread: hands the list over to the executor. */
+  CommandList* pop();                       /* Executor: returns the next list in submit order or nullptr. */
+  int release(CommandList* list);           /* Executor: marks the list as free again. */
+
+public:
+  CommandSlot* slots = nullptr;
+  uint32_t num_slots = 0;
+  std::atomic<uint64_t> next_submit{0};
+  uint64_t next_execute = 0;                /* Only touched by the executor. */
+};
+
+/* ----------------------------------------------------------- */
+
+class CommandExecutor {
+public:
+  int start(GlContext* shared, CommandQueue* queue);
+  int stop(); /* Executes the lists that were already submitted, destroys the context and joins the thread. */
+
+public:
+  GlContext ctx;
+  CommandQueue* queue = nullptr;
+  std::thread thread;
+  std::atomic<bool> is_running{false};
+  uint64_t num_lists = 0;         /* Stats; only read these after `stop()`. */
+  uint64_t num_commands = 0;
+  uint64_t num_bytes = 0;
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,580 @@
+#include <stdio.h>
+#include <thread>
+#include <utility>
+#include <gl-buffer-arena.h>
+#include <gl-resource.h>
+#include <gl-deletion-queue.h>
+#include <gl-worker.h>
+
+/* ------------------------------------------------------------- */
+
+#define DEFRAG_IDLE 0
+#define DEFRAG_COPYING 1
+#define DEFRAG_COPIED 2
+#define DEFRAG_FAILED -1
+
+/* ------------------------------------------------------------- */
+
+int BufferArena::init(const BufferArenaSettings& cfg, DeletionQueue* dq) {
+
+  if (false == pages.empty() || 0 != frame_buffer) {
+    printf("Cannot initialize the buffer arena, already initialized.\n");
+    return -1;
+  }
+
+  if (0 == GLAD_GL_VERSION_4_4 && 0 == GLAD_GL_ARB_buffer_storage) {
+    printf("Cannot initialize the buffer arena, immutable buffer storage isn't supported.\n");
+    return -2;
+  }
+
+  if (0 == cfg.page_size || 0 == cfg.alignment || cfg.page_size < cfg.alignment) {
+    printf("Cannot initialize the buffer arena, invalid page size or alignment.\n");
+    return -3;
+  }
+
+  settings = cfg;
+  deletions = dq;
+  frame_index = 0;
+  frame_offset = 0;
+  is_in_frame = false;
+  num_defrags = 0;
+  bytes_moved = 0;
+
+  if (0 != settings.frame_size && 0 != settings.num_frames) {
+
+    settings.frame_size = ((settings.frame_size + settings.alignment - 1) / settings.alignment) * settings.alignment;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr total = (GLsizeiptr)(settings.frame_size * settings.num_frames);
+
+    if (0 != gl_create_buffer(total, nullptr, flags, frame_buffer)
+        || 0 != gl_map_buffer(frame_buffer, 0, total, flags, (void**)&frame_ptr))
+      {
+        printf("Cannot initialize the buffer arena, failed to map the frame buffer.\n");
+        glDeleteBuffers(1, &frame_buffer);
+        frame_buffer = 0;
+        frame_ptr = nullptr;
+        return -4;
+      }
+
+    frame_fences.assign(settings.num_frames, nullptr);
+  }
+
+  if (0 != create_page(settings.page_size)) {
+    printf("Cannot initialize the buffer arena, failed to create the first page.\n");
+    shutdown();
+    return -5;
+  }
+
+  return 0;
+}
+
+int BufferArena::shutdown() {
+
+  /* The worker still reads from the page; wait for it. */
+  while (DEFRAG_COPYING == defrag.state.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+
+  if (DEFRAG_IDLE != defrag.state.load(std::memory_order_acquire)) {
+    update();
+  }
+
+  for (size_t i = 0; i < pages.size(); ++i) {
+    delete_buffer(pages[i]->buffer);
+    pages[i]->allocator.shutdown();
+    delete pages[i];
+  }
+
+  if (0 != frame_buffer) {
+    gl_unmap_buffer(frame_buffer);
+    delete_buffer(frame_buffer);
+  }
+
+  for (size_t i = 0; i < frame_fences.size(); ++i) {
+    if (nullptr != frame_fences[i]) {
+      glDeleteSync(frame_fences[i]);
+    }
+  }
+
+  pages.clear();
+  allocations.clear();
+  free_handles.clear();
+  frame_fences.clear();
+  frame_buffer = 0;
+  frame_ptr = nullptr;
+  is_in_frame = false;
+  deletions = nullptr;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int BufferArena::alloc(uint64_t size, ArenaHandle& handle) {
+
+  handle = 0;
+
+  if (true == pages.empty()) {
+    printf("Cannot allocate, the buffer arena isn't initialized.\n");
+    return -1;
+  }
+
+  if (0 == size) {
+    printf("Cannot allocate, invalid size.\n");
+    return -2;
+  }
+
+  RangeAllocation range;
+  uint32_t page = RANGE_NONE;
+
+  for (size_t i = 0; i < pages.size(); ++i) {
+    if (false == pages[i]->is_defragmenting && 0 == pages[i]->allocator.alloc(size, range)) {
+      page = (uint32_t)i;
+      break;
+    }
+  }
+
+  if (RANGE_NONE == page) {
+
+    /* Larger than a page? Then it gets a page of its own. */
+    uint64_t page_size = settings.page_size;
+    if (size > page_size) {
+      page_size = ((size + settings.alignment - 1) / settings.alignment) * settings.alignment;
+    }
+
+    if (0 != create_page(page_size)) {
+      printf("Cannot allocate, failed to create a new page.\n");
+      return -3;
+    }
+
+    page = (uint32_t)(pages.size() - 1);
+
+    if (0 != pages[page]->allocator.alloc(size, range)) {
+      printf("Cannot allocate, failed to allocate from a new page (this shouldn't happen).\n");
+      return -4;
+    }
+  }
+
+  size_t dx = 0;
+  if (false == free_handles.empty()) {
+    dx = free_handles.back() - 1;
+    free_handles.pop_back();
+  }
+  else {
+    dx = allocations.size();
+    allocations.push_back(ArenaAllocation());
+  }
+
+  ArenaAllocation& allocation = allocations[dx];
+  allocation.page = page;
+  allocation.block = range.block;
+  allocation.offset = range.offset;
+  allocation.size = size;
+  allocation.is_used = true;
+
+  handle = (ArenaHandle)(dx + 1);
+
+  return 0;
+}
+
+int BufferArena::free(ArenaHandle handle) {
+
+  ArenaAllocation* allocation = get_allocation(handle);
+  if (nullptr == allocation) {
+    printf("Cannot free, invalid handle: %u.\n", handle);
+    return -1;
+  }
+
+  ArenaPage* page = pages[allocation->page];
+
+  if (true == page->is_defragmenting) {
+    defrag.pending_frees.push_back(handle);
+    return 0;
+  }
+
+  if (0 != page->allocator.free(allocation->block)) {
+    printf("Cannot free, the allocator rejected the block.\n");
+    return -2;
+  }
+
+  *allocation = ArenaAllocation();
+  free_handles.push_back(handle);
+
+  return 0;
+}
+
+int BufferArena::upload(ArenaHandle handle, const void* data, uint64_t size, uint64_t offset) {
+
+  ArenaAllocation* allocation = get_allocation(handle);
+  if (nullptr == allocation) {
+    printf("Cannot upload, invalid handle: %u.\n", handle);
+    return -1;
+  }
+
+  if (nullptr == data || offset + size > allocation->size) {
+    printf("Cannot upload, no data or the range is out of bounds.\n");
+    return -2;
+  }
+
+  if (0 == (settings.storage_flags & GL_DYNAMIC_STORAGE_BIT)) {
+    printf("Cannot upload, the pages aren't created with GL_DYNAMIC_STORAGE_BIT.\n");
+    return -3;
+  }
+
+  ArenaPage* page = pages[allocation->page];
+
+  if (true == page->is_defragmenting) {
+    printf("Cannot upload, the page is being defragmented; try again after `update()`.\n");
+    return -4;
+  }
+
+  return gl_upload_buffer(page->buffer, (GLintptr)(allocation->offset + offset), (GLsizeiptr)size, data);
+}
+
+int BufferArena::get(ArenaHandle handle, BufferRange& range) {
+
+  ArenaAllocation* allocation = get_allocation(handle);
+  if (nullptr == allocation) {
+    printf("Cannot get the range, invalid handle: %u.\n", handle);
+    return -1;
+  }
+
+  range.buffer = pages[allocation->page]->buffer;
+  range.offset = allocation->offset;
+  range.size = allocation->size;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int BufferArena::begin_frame() {
+
+  if (0 == frame_buffer) {
+    printf("Cannot begin the frame, per frame allocations are disabled.\n");
+    return -1;
+  }
+
+  if (true == is_in_frame) {
+    printf("Cannot begin the frame, `end_frame()` wasn't called.\n");
+    return -2;
+  }
+
+  /* This region was used `num_frames` ago; normally the fence has been signalled long ago. */
+  GLsync fence = frame_fences[frame_index];
+  if (nullptr != fence) {
+
+    if (GL_WAIT_FAILED == glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED)) {
+      printf("Cannot begin the frame, failed to wait for the fence of the region.\n");
+      return -3;
+    }
+
+    glDeleteSync(fence);
+    frame_fences[frame_index] = nullptr;
+  }
+
+  frame_offset = 0;
+  is_in_frame = true;
+
+  return 0;
+}
+
+int BufferArena::alloc_frame(uint64_t size, BufferRange& range, void** ptr) {
+
+  if (false == is_in_frame) {
+    printf("Cannot allocate for this frame, call `begin_frame()` first.\n");
+    return -1;
+  }
+
+  uint64_t aligned = ((size + settings.alignment - 1) / settings.alignment) * settings.alignment;
+  if (0 == size || frame_offset + aligned > settings.frame_size) {
+    return -2;
+  }
+
+  range.buffer = frame_buffer;
+  range.offset = frame_index * settings.frame_size + frame_offset;
+  range.size = size;
+
+  if (nullptr != ptr) {
+    *ptr = frame_ptr + range.offset;
+  }
+
+  frame_offset += aligned;
+
+  return 0;
+}
+
+int BufferArena::end_frame() {
+
+  if (false == is_in_frame) {
+    printf("Cannot end the frame, `begin_frame()` wasn't called.\n");
+    return -1;
+  }
+
+  frame_fences[frame_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  frame_index = (frame_index + 1) % settings.num_frames;
+  is_in_frame = false;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int BufferArena::defragment(GlWorker& worker, double min_fragmentation) {
+
+  if (DEFRAG_IDLE != defrag.state.load(std::memory_order_acquire)) {
+    return 0;
+  }
+
+  uint32_t page = RANGE_NONE;
+  double worst = 0.0;
+
+  for (size_t i = 0; i < pages.size(); ++i) {
+
+    RangeAllocatorStats stats;
+    pages[i]->allocator.get_stats(stats);
+
+    if (0 == stats.num_allocations || stats.fragmentation < min_fragmentation || stats.fragmentation <= worst) {
+      continue;
+    }
+
+    worst = stats.fragmentation;
+    page = (uint32_t)i;
+  }
+
+  if (RANGE_NONE == page) {
+    return 0;
+  }
+
+  if (0 != pages[page]->allocator.compact(defrag.allocator, defrag.moves)) {
+    printf("Cannot defragment, failed to compact the page.\n");
+    return -1;
+  }
+
+  GLuint src = pages[page]->buffer;
+  GLsizeiptr capacity = (GLsizeiptr)pages[page]->allocator.capacity;
+  GLbitfield flags = settings.storage_flags;
+
+  /* The worker may only copy after our uploads were executed. */
+  defrag.page = page;
+  defrag.buffer = 0;
+  defrag.copied = nullptr;
+  defrag.ready = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
+
+  pages[page]->is_defragmenting = true;
+  defrag.state.store(DEFRAG_COPYING, std::memory_order_release);
+
+  int r = worker.post([this, src, capacity, flags]() {
+
+    while (GL_NO_ERROR != glGetError()) {
+    }
+
+    glWaitSync(defrag.ready, 0, GL_TIMEOUT_IGNORED);
+
+    gl_create_buffer(capacity, nullptr, flags, defrag.buffer);
+
+    /* Neighbouring allocations that move by the same amount are copied at once. */
+    size_t i = 0;
+    while (i < defrag.moves.size()) {
+
+      const RangeMove& first = defrag.moves[i];
+      uint64_t size = first.size;
+      size_t j = i + 1;
+
+      while (j < defrag.moves.size()
+             && defrag.moves[j].src_offset == first.src_offset + size
+             && defrag.moves[j].dst_offset == first.dst_offset + size)
+        {
+          size += defrag.moves[j].size;
+          j++;
+        }
+
+      gl_copy_buffer(src, defrag.buffer, (GLintptr)first.src_offset, (GLintptr)first.dst_offset, (GLsizeiptr)size);
+      i = j;
+    }
+
+    if (GL_NO_ERROR != glGetError()) {
+      printf("Failed to copy the page while defragmenting.\n");
+      defrag.state.store(DEFRAG_FAILED, std::memory_order_release);
+      return;
+    }
+
+    defrag.copied = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    defrag.state.store(DEFRAG_COPIED, std::memory_order_release);
+  });
+
+  if (0 != r) {
+    printf("Cannot defragment, failed to post the copy task.\n");
+    defrag.state.store(DEFRAG_FAILED, std::memory_order_release);
+    update();
+    return -2;
+  }
+
+  return 1;
+}
+
+int BufferArena::update() {
+
+  int state = defrag.state.load(std::memory_order_acquire);
+  if (DEFRAG_IDLE == state || DEFRAG_COPYING == state) {
+    return 0;
+  }
+
+  ArenaPage* page = pages[defrag.page];
+  int r = 1;
+
+  if (DEFRAG_COPIED == state) {
+
+    /* Our next commands use the new buffer; let the GPU (not us) wait for the copy. */
+    glWaitSync(defrag.copied, 0, GL_TIMEOUT_IGNORED);
+
+    std::vector<ArenaHandle> handles(page->allocator.blocks.size(), 0);
+    for (size_t i = 0; i < allocations.size(); ++i) {
+      if (true == allocations[i].is_used && defrag.page == allocations[i].page) {
+        handles[allocations[i].block] = (ArenaHandle)(i + 1);
+      }
+    }
+
+    for (size_t i = 0; i < defrag.moves.size(); ++i) {
+
+      const RangeMove& move = defrag.moves[i];
+      ArenaAllocation& allocation = allocations[handles[move.src_block] - 1];
+
+      allocation.block = move.dst_block;
+      allocation.offset = move.dst_offset;
+
+      if (move.src_offset != move.dst_offset) {
+        bytes_moved += move.size;
+      }
+    }
+
+    delete_buffer(page->buffer);
+    page->buffer = defrag.buffer;
+    std::swap(page->allocator, defrag.allocator);
+    num_defrags++;
+  }
+  else {
+    printf("Defragmenting page %u failed, keeping the old buffer.\n", defrag.page);
+    delete_buffer(defrag.buffer);
+    r = -1;
+  }
+
+  if (nullptr != defrag.ready) {
+    glDeleteSync(defrag.ready);
+  }
+
+  if (nullptr != defrag.copied) {
+    glDeleteSync(defrag.copied);
+  }
+
+  page->is_defragmenting = false;
+
+  for (size_t i = 0; i < defrag.pending_frees.size(); ++i) {
+    free(defrag.pending_frees[i]);
+  }
+
+  defrag.allocator.shutdown();
+  defrag.moves.clear();
+  defrag.pending_frees.clear();
+  defrag.buffer = 0;
+  defrag.ready = nullptr;
+  defrag.copied = nullptr;
+  defrag.state.store(DEFRAG_IDLE, std::memory_order_release);
+
+  return r;
+}
+
+void BufferArena::get_stats(BufferArenaStats& stats) {
+
+  uint64_t total_free = 0;
+  uint64_t total_largest = 0;
+
+  stats = BufferArenaStats();
+  stats.num_pages = (uint32_t)pages.size();
+
+  for (size_t i = 0; i < pages.size(); ++i) {
+
+    RangeAllocatorStats page_stats;
+    pages[i]->allocator.get_stats(page_stats);
+
+    stats.num_allocations += page_stats.num_allocations;
+    stats.capacity += page_stats.capacity;
+    stats.used += page_stats.used;
+    total_free += page_stats.free;
+    total_largest += page_stats.largest_free;
+
+    if (page_stats.largest_free > stats.largest_free) {
+      stats.largest_free = page_stats.largest_free;
+    }
+  }
+
+  stats.occupancy = (0 == stats.capacity) ? 0.0 : (double)stats.used / stats.capacity;
+  stats.fragmentation = (0 == total_free) ? 0.0 : 1.0 - (double)total_largest / total_free;
+  stats.frame_used = (true == is_in_frame) ? frame_offset : 0;
+  stats.num_defrags = num_defrags;
+  stats.bytes_moved = bytes_moved;
+}
+
+/* ------------------------------------------------------------- */
+
+int BufferArena::create_page(uint64_t size) {
+
+  ArenaPage* page = new ArenaPage();
+
+  if (0 != page->allocator.init(size, settings.alignment)) {
+    delete page;
+    return -1;
+  }
+
+  /* Make sure we only see our own errors. */
+  while (GL_NO_ERROR != glGetError()) {
+  }
+
+  gl_create_buffer((GLsizeiptr)page->allocator.capacity, nullptr, settings.storage_flags, page->buffer);
+
+  if (GL_NO_ERROR != glGetError()) {
+    printf("Failed to create the storage for a page of %llu bytes.\n", (unsigned long long)size);
+    glDeleteBuffers(1, &page->buffer);
+    delete page;
+    return -2;
+  }
+
+  pages.push_back(page);
+
+  return 0;
+}
+
+ArenaAllocation* BufferArena::get_allocation(ArenaHandle handle) {
+
+  if (0 == handle || handle > allocations.size() || false == allocations[handle - 1].is_used) {
+    return nullptr;
+  }
+
+  return &allocations[handle - 1];
+}
+
+/* Another context may still use the buffer; the deletion queue waits for that. */
+void BufferArena::delete_buffer(GLuint buffer) {
+
+  if (0 == buffer) {
+    return;
+  }
+
+  if (nullptr == deletions) {
+    glDeleteBuffers(1, &buffer);
+    return;
+  }
+
+  DeletionBatch batch;
+  batch.add(DELETE_BUFFER, buffer);
+
+  if (0 != deletions->submit(batch)) {
+    glDeleteBuffers(1, &buffer);
+  }
+}
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,174 @@
+/*
+
+  GL BUFFER ARENA
+  ================
+
+  Instead of creating a buffer per mesh, `BufferArena` creates a
+  couple of large immutable buffers ("pages", `glBufferStorage()`)
+  and sub-allocates ranges from them with a `RangeAllocator`.
+  This means a lot less driver objects and we can draw many
+  meshes without binding another buffer.
+
+    BufferArena arena;
+    arena.init(settings, &deletions);
+
+    ArenaHandle mesh = 0;
+    arena.alloc(num_bytes, mesh);
+    arena.upload(mesh, vertices, num_bytes);
+
+    BufferRange range;
+    arena.get(mesh, range);            // buffer + offset to draw with
+    ...
+    arena.free(mesh);
+
+  An allocation is identified by an `ArenaHandle` and not by its
+  buffer + offset, because a defrag moves allocations. Always
+  call `get()` when you record a draw.
+
+  PER FRAME ALLOCATIONS
+
+  Besides the pages the arena has one persistently mapped buffer
+  that is split into `num_frames` regions. Between
+  `begin_frame()` and `end_frame()` you can linearly allocate
+  from the region of the current frame with `alloc_frame()`,
+  e.g. for uniforms or streamed vertices. `end_frame()` inserts
+  a fence and `begin_frame()` waits for the fence of the region
+  it's going to reuse (which normally has been signalled long
+  ago).
+
+  DEFRAG
+
+  `defragment()` picks the most fragmented page, computes where
+  its allocations go when packed, and posts a task to a
+  `GlWorker`. The worker creates a new buffer and copies the
+  allocations with `glCopyBufferSubData()` in its own context,
+  so the render thread doesn't stall. `update()` (call it once a
+  frame) makes the GPU wait for the copy, swaps the buffers and
+  hands the old buffer to the `DeletionQueue`.
+
+  While a page is being defragmented no new allocations are made
+  in it, `free()` is deferred until the swap, and `upload()` to
+  its allocations fails; the data would be lost.
+
+  All functions must be called on one thread, with a context of
+  the share group current. The worker must share with it too.
+
+ */
+#ifndef GL_BUFFER_ARENA_H
+#define GL_BUFFER_ARENA_H
+
+#include <stdint.h>
+#include <vector>
+#include <atomic>
+#include <glad/glad.h>
+#include <gl-state-filter.h>
+#include <range-allocator.h>
+
+/* ----------------------------------------------------------- */
+
+class GlWorker;
+class DeletionQueue;
+
+typedef uint32_t ArenaHandle;                  /* 0 is invalid. */
+
+/* ----------------------------------------------------------- */
+
+struct BufferArenaSettings {
+  uint64_t page_size = 64ull * 1024ull * 1024ull;
+  uint64_t alignment = 256;                    /* Make this a multiple of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT when you bind ranges as UBOs. */
+  GLbitfield storage_flags = GL_DYNAMIC_STORAGE_BIT;
+  uint64_t frame_size = 4ull * 1024ull * 1024ull; /* The size of one per frame region; 0 disables per frame allocations. */
+  uint32_t num_frames = 3;
+};
+
+struct BufferRange {
+  GLuint buffer = 0;
+  uint64_t offset = 0;
+  uint64_t size = 0;
+};
+
+struct BufferArenaStats {
+  uint32_t num_pages = 0;
+  uint32_t num_allocations = 0;
+  uint64_t capacity = 0;
+  uint64_t used = 0;
+  uint64_t largest_free = 0;
+  double occupancy = 0.0;
+  double fragmentation = 0.0;                  /* Over all pages: 1 - sum(largest free) / sum(free). */
+  uint64_t frame_used = 0;                     /* Bytes allocated in the current frame region. */
+  uint64_t num_defrags = 0;
+  uint64_t bytes_moved = 0;
+};
+
+/* ----------------------------------------------------------- */
+
+struct ArenaPage {
+  GLuint buffer = 0;
+  RangeAllocator allocator;
+  bool is_defragmenting = false;
+};
+
+struct ArenaAllocation {
+  uint32_t page = 0;
+  uint32_t block = RANGE_NONE;
+  uint64_t offset = 0;
+  uint64_t size = 0;                           /* The requested size. */
+  bool is_used = false;
+};
+
+struct ArenaDefrag {
+  uint32_t page = 0;
+  GLuint buffer = 0;                           /* Created by the worker. */
+  GLsync ready = nullptr;                      /* Signalled when the render thread's commands (e.g. uploads) are done. */
+  GLsync copied = nullptr;                     /* Signalled when the worker copied everything. */
+  RangeAllocator allocator;
+  std::vector<RangeMove> moves;
+  std::vector<ArenaHandle> pending_frees;
+  std::atomic<int> state{0};                   /* 0 = idle, 1 = copying, 2 = copied, < 0 = failed. */
+};
+
+/* ----------------------------------------------------------- */
+
+class BufferArena {
+public:
+  BufferArena() = default;
+  BufferArena(const BufferArena&) = delete;
+  BufferArena& operator=(const BufferArena&) = delete;
+  int init(const BufferArenaSettings& cfg, DeletionQueue* deletions); /* `deletions` is optional; without it old pages are deleted directly. */
+  int shutdown();                              /* Waits for a running defrag. */
+  int alloc(uint64_t size, ArenaHandle& handle);
+  int free(ArenaHandle handle);
+  int upload(ArenaHandle handle, const void* data, uint64_t size, uint64_t offset = 0);
+  int get(ArenaHandle handle, BufferRange& range);
+  int begin_frame();
+  int alloc_frame(uint64_t size, BufferRange& range, void** ptr);
+  int end_frame();
+  int defragment(GlWorker& worker, double min_fragmentation); /* Returns 1 when a defrag was started, 0 when nothing to do. */
+  int update();
+  void get_stats(BufferArenaStats& stats);
+
+public:
+  BufferArenaSettings settings;
+  DeletionQueue* deletions = nullptr;
+  std::vector<ArenaPage*> pages;
+  std::vector<ArenaAllocation> allocations;    /* Indexed by `handle - 1`. */
+  std::vector<ArenaHandle> free_handles;
+  ArenaDefrag defrag;
+  GLuint frame_buffer = 0;
+  uint8_t* frame_ptr = nullptr;                /* Persistently mapped. */
+  std::vector<GLsync> frame_fences;
+  uint32_t frame_index = 0;
+  uint64_t frame_offset = 0;
+  bool is_in_frame = false;
+  uint64_t num_defrags = 0;
+  uint64_t bytes_moved = 0;
+
+private:
+  int create_page(uint64_t size);
+  ArenaAllocation* get_allocation(ArenaHandle handle);
+  void delete_buffer(GLuint buffer);
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
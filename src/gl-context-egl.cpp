@@ -0,0 +1,416 @@
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+#include <gl-context.h>
+#include <gl-debug-output.h>
+
+/* ------------------------------------------------------------- */
+
+static std::once_flag gl_load_flag;
+static int gl_load_result = -1;
+
+/* ------------------------------------------------------------- */
+
+static bool has_client_extension(const char* name);
+static bool is_egl_1_5(EGLDisplay display);
+
+/* ------------------------------------------------------------- */
+
+/*
+  EGL has no dummy window dance: we only need the display. We
+  prefer the surfaceless platform of Mesa, which works without a
+  X11 or Wayland connection (e.g. llvmpipe on a build server). We
+  never terminate the display; it's shared by all the contexts of
+  the process and `eglTerminate()` would destroy them.
+*/
+int create_tmp_context(GlContext& ctx) {
+
+  int r = 0;
+  EGLint major = 0;
+  EGLint minor = 0;
+
+  /* Step 1: get the extension we need to select the platform. */
+  if (true == has_client_extension("EGL_EXT_platform_base")) {
+    ctx.eglGetPlatformDisplayEXT = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  }
+
+  step_timer_lap(ctx.timer, "tmp eglGetProcAddress");
+
+  /* Step 2: get the display. */
+  if (nullptr != ctx.eglGetPlatformDisplayEXT
+      && true == has_client_extension("EGL_MESA_platform_surfaceless"))
+    {
+      ctx.display = ctx.eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+
+  if (EGL_NO_DISPLAY == ctx.display) {
+    ctx.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+
+  if (EGL_NO_DISPLAY == ctx.display) {
+    printf("Failed to get the EGL display.\n");
+    r = -1;
+    goto error;
+  }
+
+  step_timer_lap(ctx.timer, "tmp eglGetDisplay");
+
+  if (EGL_FALSE == eglInitialize(ctx.display, &major, &minor)) {
+    printf("Failed to initialize the EGL display.\n");
+    r = -2;
+    goto error;
+  }
+
+  step_timer_lap(ctx.timer, "tmp eglInitialize");
+
+  /* Step 3: we want desktop GL, not GLES. */
+  if (EGL_FALSE == eglBindAPI(EGL_OPENGL_API)) {
+    printf("Failed to bind the OpenGL API.\n");
+    r = -3;
+    goto error;
+  }
+
+  step_timer_lap(ctx.timer, "tmp eglBindAPI");
+
+ error:
+
+  if (r < 0) {
+    if (0 != destroy_tmp_context(ctx)) {
+      printf("After failing to create a tmp context ... we also failed to deallocate some temporaries :(\n");
+    }
+  }
+
+  return r;
+}
+
+int destroy_tmp_context(GlContext& ctx) {
+
+  int r = 0;
+
+  if (EGL_NO_CONTEXT != ctx.gl) {
+
+    if (ctx.gl == eglGetCurrentContext()
+        && EGL_FALSE == eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT))
+      {
+        printf("Failed to reset the current OpenGL context.\n");
+      }
+
+    if (EGL_FALSE == eglDestroyContext(ctx.display, ctx.gl)) {
+      printf("Failed to destroy the context.\n");
+      r -= 1;
+    }
+  }
+
+  if (EGL_NO_SURFACE != ctx.surface) {
+    if (EGL_FALSE == eglDestroySurface(ctx.display, ctx.surface)) {
+      printf("Failed to destroy the surface.\n");
+      r -= 2;
+    }
+  }
+
+  /* Cleanup the members. */
+  ctx.display = EGL_NO_DISPLAY;
+  ctx.config = nullptr;
+  ctx.surface = EGL_NO_SURFACE;
+  ctx.gl = EGL_NO_CONTEXT;
+  ctx.shared = nullptr;
+  ctx.eglGetPlatformDisplayEXT = nullptr;
+
+  return r;
+}
+
+int create_main_context(GlContext& tmp, GlContext& main) {
+
+  int r = 0;
+  EGLint num_configs = 0;
+  EGLContext shared_gl = EGL_NO_CONTEXT;
+
+  /* The config attributes that we need. */
+  const EGLint config_attribs[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_ALPHA_SIZE, 8,
+    EGL_DEPTH_SIZE, 24,
+    EGL_STENCIL_SIZE, 8,
+    EGL_NONE
+  };
+
+  const EGLint surface_attribs[] = {
+    EGL_WIDTH, 1,
+    EGL_HEIGHT, 1,
+    EGL_NONE
+  };
+
+  /* The same version and profile as the WGL context; the optional ones are appended in step 3. */
+  EGLint ctx_attribs[16] = {
+    EGL_CONTEXT_MAJOR_VERSION, 4,
+    EGL_CONTEXT_MINOR_VERSION, 1,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  int num_ctx_attribs = 6;
+  const char* extensions = nullptr;
+
+  /* Validate */
+  if (EGL_NO_DISPLAY == tmp.display) {
+    printf("Given tmp context is invalid.\n");
+    r = -1;
+    goto error;
+  }
+
+  main.display = tmp.display;
+
+  /* Step 1: find a config. */
+  if (EGL_FALSE == eglChooseConfig(main.display, config_attribs, &main.config, 1, &num_configs)
+      || 0 == num_configs)
+    {
+      printf("Failed to choose a valid config for our main context.\n");
+      r = -2;
+      goto error;
+    }
+
+  step_timer_lap(main.timer, "main eglChooseConfig");
+
+  /* Step 2: a surface, so the context has a default framebuffer. */
+  main.surface = eglCreatePbufferSurface(main.display, main.config, surface_attribs);
+  if (EGL_NO_SURFACE == main.surface) {
+    printf("Failed to create the pbuffer surface for our main context.\n");
+    r = -3;
+    goto error;
+  }
+
+  step_timer_lap(main.timer, "main eglCreatePbufferSurface");
+
+  /* Step 3: create our main context; the state filter counts deletes per share group. */
+  if (nullptr != main.shared) {
+    shared_gl = main.shared->gl;
+  }
+
+  gl_state_filter_share(&main.state, (nullptr == main.shared) ? nullptr : &main.shared->state);
+
+  extensions = eglQueryString(main.display, EGL_EXTENSIONS);
+
+  if (CONTEXT_RELEASE_NONE == main.release) {
+    if (true == has_extension(extensions, "EGL_KHR_context_flush_control")) {
+      ctx_attribs[num_ctx_attribs++] = EGL_CONTEXT_RELEASE_BEHAVIOR_KHR;
+      ctx_attribs[num_ctx_attribs++] = EGL_CONTEXT_RELEASE_BEHAVIOR_NONE_KHR;
+    }
+    else {
+      printf("`EGL_KHR_context_flush_control` isn't supported, the context will flush when released.\n");
+      main.release = CONTEXT_RELEASE_FLUSH;
+    }
+  }
+
+  if (nullptr != main.debug && CONTEXT_MODE_DEFAULT == main.mode) {
+    main.mode = CONTEXT_MODE_DEBUG;
+  }
+
+  if (CONTEXT_MODE_NO_ERROR == main.mode
+      && false == has_extension(extensions, "EGL_KHR_create_context_no_error"))
+    {
+      printf("`EGL_KHR_create_context_no_error` isn't supported, the context will validate.\n");
+      main.mode = CONTEXT_MODE_DEFAULT;
+    }
+
+  if (nullptr != main.shared
+      && (CONTEXT_MODE_NO_ERROR == main.mode) != (CONTEXT_MODE_NO_ERROR == main.shared->mode))
+    {
+      printf("Cannot share a no-error context with a context that validates.\n");
+      r = -5;
+      goto error;
+    }
+
+  if (CONTEXT_MODE_DEBUG == main.mode) {
+    ctx_attribs[num_ctx_attribs++] = EGL_CONTEXT_FLAGS_KHR;
+    ctx_attribs[num_ctx_attribs++] = EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR;
+  }
+
+  if (CONTEXT_MODE_NO_ERROR == main.mode) {
+    ctx_attribs[num_ctx_attribs++] = EGL_CONTEXT_OPENGL_NO_ERROR_KHR;
+    ctx_attribs[num_ctx_attribs++] = EGL_TRUE;
+  }
+
+  /* `EGL_EXT_create_context_robustness` is for GLES only; desktop GL uses the attribute of EGL 1.5 / `EGL_KHR_create_context`. */
+  if (CONTEXT_RESET_LOSE_CONTEXT == main.reset
+      && false == has_extension(extensions, "EGL_KHR_create_context")
+      && false == is_egl_1_5(main.display))
+    {
+      printf("Neither EGL 1.5 nor `EGL_KHR_create_context` is supported, GPU resets won't be reported.\n");
+      main.reset = CONTEXT_RESET_NO_NOTIFICATION;
+    }
+
+  if (nullptr != main.shared && main.reset != main.shared->reset) {
+    printf("Cannot share contexts with a different reset notification strategy.\n");
+    r = -6;
+    goto error;
+  }
+
+  if (CONTEXT_RESET_LOSE_CONTEXT == main.reset) {
+    ctx_attribs[num_ctx_attribs++] = EGL_CONTEXT_OPENGL_RESET_NOTIFICATION_STRATEGY_KHR;
+    ctx_attribs[num_ctx_attribs++] = EGL_LOSE_CONTEXT_ON_RESET_KHR;
+  }
+
+  ctx_attribs[num_ctx_attribs] = EGL_NONE;
+
+  main.gl = eglCreateContext(main.display, main.config, shared_gl, ctx_attribs);
+  if (EGL_NO_CONTEXT == main.gl) {
+    printf("Failed to create our main OpenGL context.\n");
+    r = -4;
+    goto error;
+  }
+
+  step_timer_lap(main.timer, "main eglCreateContext");
+
+ error:
+
+  if (r < 0) {
+    printf("Failed to create the main context.\n");
+    if (0 != destroy_main_context(main)) {
+      printf("After failing to create our main context, we also couldn't clean it up correctly.\n");
+    }
+  }
+
+  return r;
+}
+
+int destroy_main_context(GlContext& main) {
+
+  if (&main.state == gl_state_filter_get_current()) {
+    gl_state_filter_make_current(nullptr);
+  }
+
+  /* The callback goes away with the context. */
+  if (nullptr != main.debug) {
+    main.debug->is_installed = false;
+  }
+
+  return destroy_tmp_context(main);
+}
+
+/* ------------------------------------------------------------- */
+
+int create_shared_context(GlContext* shared, GlContext& ctx) {
+
+  int r = 0;
+  GlContext tmp;
+  tmp.timer = ctx.timer;
+
+  if (0 != create_tmp_context(tmp)) {
+    printf("Failed to create the tmp context for our shared context.\n");
+    return -1;
+  }
+
+  ctx.shared = shared;
+  if (0 != create_main_context(tmp, ctx)) {
+    printf("Failed to create the shared context.\n");
+    r = -2;
+  }
+
+  if (0 != destroy_tmp_context(tmp)) {
+    printf("Failed to cleanly destroy the tmp context for our shared context.\n");
+  }
+
+  return r;
+}
+
+int make_context_current(GlContext& ctx) {
+
+  if (EGL_NO_CONTEXT == ctx.gl) {
+    printf("Cannot make current, not initialized (gl == EGL_NO_CONTEXT).\n");
+    return -1;
+  }
+
+  if (EGL_NO_DISPLAY == ctx.display) {
+    printf("Cannot make current, not initialized (display == EGL_NO_DISPLAY).\n");
+    return -2;
+  }
+
+  if (EGL_FALSE == eglMakeCurrent(ctx.display, ctx.surface, ctx.surface, ctx.gl)) {
+    printf("Failed to make the context current.\n");
+    return -3;
+  }
+
+  /* See _gl-context.cpp_; the pointers are global. */
+  std::call_once(gl_load_flag, []() {
+    gl_load_result = (0 == gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) ? -1 : 0;
+  });
+
+  if (0 != gl_load_result) {
+    printf("Failed to load the GL functions.\n");
+    return -4;
+  }
+
+  gl_state_filter_make_current(&ctx.state);
+
+  if (nullptr != ctx.debug
+      && false == ctx.debug->is_installed
+      && 0 != ctx.debug->install())
+    {
+      printf("Failed to install the debug output; we continue without it.\n");
+      ctx.debug = nullptr;
+    }
+
+  return 0;
+}
+
+int release_current_context() {
+
+  gl_state_filter_make_current(nullptr);
+
+  if (EGL_NO_CONTEXT == eglGetCurrentContext()) {
+    return 0;
+  }
+
+  if (EGL_FALSE == eglMakeCurrent(eglGetCurrentDisplay(), EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT)) {
+    printf("Failed to unset the current GL context.\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+void GlContext::print(const char* name) {
+
+  if (nullptr == name) {
+    printf("Cannot print, pass in a name.\n");
+    return;
+  }
+
+  if (0 != make_context_current(*this)) {
+    printf("Cannot print info, failed to make the context current.\n");
+    return;
+  }
+
+  printf("%s: EGLContext: %p\n", name, gl);
+  printf("%s: GL_VERSION: %s\n", name, glGetString(GL_VERSION));
+  printf("%s: GL_VENDOR: %s\n", name, glGetString(GL_VENDOR));
+  printf("%s: GL_RENDERER: %s\n", name, glGetString(GL_RENDERER));
+}
+
+/* ------------------------------------------------------------- */
+
+/* Client extensions are queried without a display. */
+static bool has_client_extension(const char* name) {
+  return has_extension(eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS), name);
+}
+
+/* `EGL_VERSION` starts with "<major>.<minor>". */
+static bool is_egl_1_5(EGLDisplay display) {
+
+  const char* version = eglQueryString(display, EGL_VERSION);
+  int major = 0;
+  int minor = 0;
+
+  if (nullptr == version || 2 != sscanf(version, "%d.%d", &major, &minor)) {
+    return false;
+  }
+
+  return major > 1 || (1 == major && minor >= 5);
+}
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,477 @@
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+#include <gl-context.h>
+#include <gl-debug-output.h>
+
+/* ------------------------------------------------------------- */
+
+static std::once_flag gl_load_flag;
+static int gl_load_result = -1;
+
+/* ------------------------------------------------------------- */
+
+static bool has_wgl_extension(GlContext& tmp, HDC dc, const char* name);
+
+/* ------------------------------------------------------------- */
+
+int create_tmp_context(GlContext& ctx) {
+
+  int r = 0;
+  
+  /* Step 1: create a tmp window. */
+  ctx.hwnd = CreateWindowA("STATIC", "dummy", 0, 0, 0, 1, 1, NULL, NULL, NULL, NULL);
+  if (nullptr == ctx.hwnd) {
+    printf("Failed to create our tmp window.\n");
+    r = -1;
+    goto error;
+  }
+
+  step_timer_lap(ctx.timer, "tmp CreateWindow");
+
+  /* Step 2: set the pixel format. */
+  ctx.fmt.nSize = sizeof(ctx.fmt);
+  ctx.fmt.nVersion = 1;
+  ctx.fmt.dwFlags = PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL | PFD_DOUBLEBUFFER;
+  ctx.fmt.iPixelType = PFD_TYPE_RGBA;
+  ctx.fmt.cColorBits = 32;
+  ctx.fmt.cAlphaBits = 8;
+  ctx.fmt.cDepthBits = 24;
+
+  ctx.dc = GetDC(ctx.hwnd);
+  if (nullptr == ctx.dc) {
+    printf("Failed to get the HDC from our tmp window.\n");
+    r = -2;
+    goto error;
+  }
+
+  step_timer_lap(ctx.timer, "tmp GetDC");
+
+  ctx.dx = ChoosePixelFormat(ctx.dc, &ctx.fmt);
+  if (0 == ctx.dx) {
+    printf("Failed to find a pixel format for our tmp hdc.\n");
+    r = -3;
+    goto error;
+  }
+
+  step_timer_lap(ctx.timer, "tmp ChoosePixelFormat");
+
+  if (FALSE == SetPixelFormat(ctx.dc, ctx.dx, &ctx.fmt)) {
+    printf("Failed to set the pixel format on our tmp hdc.\n");
+    r = -4;
+    goto error;
+  }
+
+  step_timer_lap(ctx.timer, "tmp SetPixelFormat");
+
+  /* Step 3. Create temporary GL context. */
+  ctx.gl = wglCreateContext(ctx.dc);
+  if (nullptr == ctx.gl) {
+    printf("Failed to create out temporary GL context.\n");
+    r = -5;
+    goto error;
+  }
+
+  step_timer_lap(ctx.timer, "tmp wglCreateContext");
+
+  if (FALSE == wglMakeCurrent(ctx.dc, ctx.gl)) {
+    printf("Failed to make our temporary GL context current.\n");
+    r = -6;
+    goto error;
+  }
+
+  step_timer_lap(ctx.timer, "tmp wglMakeCurrent");
+
+  /* Step 4. Get the extension we need for a more feature-rich context. */
+  ctx.wglChoosePixelFormatARB = reinterpret_cast<PFNWGLCHOOSEPIXELFORMATARBPROC>(wglGetProcAddress("wglChoosePixelFormatARB"));
+  if (nullptr == ctx.wglChoosePixelFormatARB) {
+    printf("Failed to get the `wglChoosePixelFormatARB()` function.\n");
+    r = -7;
+    goto error;
+  }
+  
+  ctx.wglCreateContextAttribsARB = reinterpret_cast<PFNWGLCREATECONTEXTATTRIBSARBPROC>(wglGetProcAddress("wglCreateContextAttribsARB"));
+  if (nullptr == ctx.wglCreateContextAttribsARB) {
+    printf("wglGetProcAddress() failed.\n");
+    r = -8;
+    goto error;
+  }
+
+  /* Optional; we only need it to check for optional extensions. */
+  ctx.wglGetExtensionsStringARB = reinterpret_cast<PFNWGLGETEXTENSIONSSTRINGARBPROC>(wglGetProcAddress("wglGetExtensionsStringARB"));
+
+  step_timer_lap(ctx.timer, "tmp wglGetProcAddress");
+
+ error:
+
+  if (r < 0) {
+    if (0 != destroy_tmp_context(ctx)) {
+      printf("After failing to create a tmp context ... we also failed to deallocate some temporaries :(\n");
+    }
+  }
+
+  return r;
+}
+
+int destroy_tmp_context(GlContext& ctx) {
+
+  int r = 0;
+  
+  if (nullptr != ctx.hwnd) {
+    if (FALSE == DestroyWindow(ctx.hwnd)) {
+      printf("Failed to destroy the hwnd.\n");
+      r -= 1;
+    }
+  }
+
+  if (nullptr != ctx.gl) {
+    
+    if (FALSE == wglMakeCurrent(nullptr, nullptr)) {
+      printf("Failed to reset any current OpenGL contexts.\n");
+    }
+    
+    if (FALSE == wglDeleteContext(ctx.gl)) {
+      printf("Failed to delete the temporary context.\n");
+      r -= 2;
+    }
+  }
+
+  /* Cleanup the members. */
+  ctx.hwnd = nullptr;
+  ctx.dc = nullptr;
+  ctx.dx = -1;
+  ctx.gl = nullptr;
+  ctx.shared = nullptr;
+  ctx.wglChoosePixelFormatARB = nullptr;
+  ctx.wglCreateContextAttribsARB = nullptr;
+  ctx.wglGetExtensionsStringARB = nullptr;
+
+  memset((char*)&ctx.fmt, 0x00, sizeof(ctx.fmt));
+  
+  return r;
+}
+
+int create_main_context(GlContext& tmp, GlContext& main) {
+
+  int r = 0;
+  UINT fmt_count = 0;
+  HGLRC shared_gl = nullptr;
+
+  /* The pixel format attributes that we need. */
+  const int pix_attribs[] = {
+    WGL_DRAW_TO_WINDOW_ARB, GL_TRUE,
+    WGL_SUPPORT_OPENGL_ARB, GL_TRUE,
+    WGL_DOUBLE_BUFFER_ARB, GL_TRUE,
+    WGL_PIXEL_TYPE_ARB, WGL_TYPE_RGBA_ARB,
+    WGL_ACCELERATION_ARB, WGL_FULL_ACCELERATION_ARB,
+    WGL_COLOR_BITS_ARB, 32,
+    WGL_ALPHA_BITS_ARB, 8,
+    WGL_DEPTH_BITS_ARB, 24,
+    WGL_STENCIL_BITS_ARB, 8,
+    WGL_SAMPLE_BUFFERS_ARB, GL_TRUE,
+    WGL_SAMPLES_ARB, 4,
+    0
+  };
+
+  /* The OpenGL Rendering Context attributes we need; the optional ones are appended in step 3. */
+  int ctx_attribs[16] = {
+    WGL_CONTEXT_MAJOR_VERSION_ARB, 4,
+    WGL_CONTEXT_MINOR_VERSION_ARB, 1,
+    WGL_CONTEXT_PROFILE_MASK_ARB, WGL_CONTEXT_CORE_PROFILE_BIT_ARB,
+    0
+  };
+  int num_ctx_attribs = 6;
+
+  /* Validate */
+  if (nullptr == tmp.gl) {
+    printf("Given tmp context is invalid.\n");
+    r = -1;
+    goto error;
+  }
+
+  if (nullptr == tmp.wglChoosePixelFormatARB) {
+    printf("Given tmp context has no `wglChoosePixelFormatARB()` set.\n");
+    r = -2;
+    goto error;
+  }
+
+  if (nullptr == tmp.wglCreateContextAttribsARB) {
+    printf("Given tmp context has no `wglCreateContextAttribsARB()` set.\n");
+    r = -3;
+    goto error;
+  }
+  
+  /* Step 1: we still need a HWND for our main context. */
+  main.hwnd = CreateWindowA("STATIC", "dummy", 0, 0, 0, 1, 1, NULL, NULL, NULL, NULL);
+  if (nullptr == main.hwnd) {
+    printf("Failed to create main window (hwnd).\n");
+    r = -4;
+    goto error;
+  }
+
+  step_timer_lap(main.timer, "main CreateWindow");
+
+  /* Step 2: set the pixel format */
+  main.dc = GetDC(main.hwnd);
+  if (nullptr == main.dc) {
+    printf("Failed to get the HDC from our main window.\n");
+    r = -5;
+    goto error;
+  }
+
+  step_timer_lap(main.timer, "main GetDC");
+
+  /* Find the best matching pixel format index. */
+  if (FALSE == tmp.wglChoosePixelFormatARB(main.dc, pix_attribs, NULL, 1, &main.dx, &fmt_count)) {
+    printf("Failed to choose a valid pixel format for our main hdc.\n");
+    r = -6;
+    goto error;
+  }
+
+  step_timer_lap(main.timer, "main wglChoosePixelFormatARB");
+
+  /* Now that we have found the index, fill our format descriptor. */
+  if (0 == DescribePixelFormat(main.dc, main.dx, sizeof(main.fmt), &main.fmt)) {
+    printf("Failed to fill our main pixel format descriptor.\n");
+    r = -7;
+    goto error;
+  }
+
+  step_timer_lap(main.timer, "main DescribePixelFormat");
+
+  if (FALSE == SetPixelFormat(main.dc, main.dx, &main.fmt)) {
+    printf("Failed to set the pixel format on our main dc.\n");
+    r = -8;
+    goto error;
+  }
+
+  step_timer_lap(main.timer, "main SetPixelFormat");
+
+  /* Step 3: create our main context; the state filter counts deletes per share group. */
+  if (nullptr != main.shared) {
+    shared_gl = main.shared->gl;
+  }
+
+  gl_state_filter_share(&main.state, (nullptr == main.shared) ? nullptr : &main.shared->state);
+
+  if (CONTEXT_RELEASE_NONE == main.release) {
+    if (true == has_wgl_extension(tmp, main.dc, "WGL_ARB_context_flush_control")) {
+      ctx_attribs[num_ctx_attribs++] = WGL_CONTEXT_RELEASE_BEHAVIOR_ARB;
+      ctx_attribs[num_ctx_attribs++] = WGL_CONTEXT_RELEASE_BEHAVIOR_NONE_ARB;
+    }
+    else {
+      printf("`WGL_ARB_context_flush_control` isn't supported, the context will flush when released.\n");
+      main.release = CONTEXT_RELEASE_FLUSH;
+    }
+  }
+
+  if (nullptr != main.debug && CONTEXT_MODE_DEFAULT == main.mode) {
+    main.mode = CONTEXT_MODE_DEBUG;
+  }
+
+  if (CONTEXT_MODE_NO_ERROR == main.mode
+      && false == has_wgl_extension(tmp, main.dc, "WGL_ARB_create_context_no_error"))
+    {
+      printf("`WGL_ARB_create_context_no_error` isn't supported, the context will validate.\n");
+      main.mode = CONTEXT_MODE_DEFAULT;
+    }
+
+  if (nullptr != main.shared
+      && (CONTEXT_MODE_NO_ERROR == main.mode) != (CONTEXT_MODE_NO_ERROR == main.shared->mode))
+    {
+      printf("Cannot share a no-error context with a context that validates.\n");
+      r = -9;
+      goto error;
+    }
+
+  if (CONTEXT_MODE_DEBUG == main.mode) {
+    ctx_attribs[num_ctx_attribs++] = WGL_CONTEXT_FLAGS_ARB;
+    ctx_attribs[num_ctx_attribs++] = WGL_CONTEXT_DEBUG_BIT_ARB;
+  }
+
+  if (CONTEXT_MODE_NO_ERROR == main.mode) {
+    ctx_attribs[num_ctx_attribs++] = WGL_CONTEXT_OPENGL_NO_ERROR_ARB;
+    ctx_attribs[num_ctx_attribs++] = GL_TRUE;
+  }
+
+  if (CONTEXT_RESET_LOSE_CONTEXT == main.reset
+      && false == has_wgl_extension(tmp, main.dc, "WGL_ARB_create_context_robustness"))
+    {
+      printf("`WGL_ARB_create_context_robustness` isn't supported, GPU resets won't be reported.\n");
+      main.reset = CONTEXT_RESET_NO_NOTIFICATION;
+    }
+
+  if (nullptr != main.shared && main.reset != main.shared->reset) {
+    printf("Cannot share contexts with a different reset notification strategy.\n");
+    r = -10;
+    goto error;
+  }
+
+  if (CONTEXT_RESET_LOSE_CONTEXT == main.reset) {
+    ctx_attribs[num_ctx_attribs++] = WGL_CONTEXT_RESET_NOTIFICATION_STRATEGY_ARB;
+    ctx_attribs[num_ctx_attribs++] = WGL_LOSE_CONTEXT_ON_RESET_ARB;
+  }
+
+  ctx_attribs[num_ctx_attribs] = 0;
+  
+  main.gl = tmp.wglCreateContextAttribsARB(main.dc, shared_gl, ctx_attribs);
+  if (nullptr == main.gl) {
+    printf("Failed to create our main OpenGL context.\n");
+    r = -8;
+    goto error;
+  }
+
+  step_timer_lap(main.timer, "main wglCreateContextAttribsARB");
+  
+ error:
+  
+  if (r < 0) {
+    printf("Failed to create the main context.\n");
+    if (0 != destroy_main_context(main)) {
+      printf("After failing to create our main context, we also couldn't clean it up correctly.\n");
+    }
+  }
+
+  return r;
+}
+
+int destroy_main_context(GlContext& main) {
+
+  if (&main.state == gl_state_filter_get_current()) {
+    gl_state_filter_make_current(nullptr);
+  }
+
+  /* The callback goes away with the context. */
+  if (nullptr != main.debug) {
+    main.debug->is_installed = false;
+  }
+
+  return destroy_tmp_context(main);
+}
+
+/* ------------------------------------------------------------- */
+
+int create_shared_context(GlContext* shared, GlContext& ctx) {
+
+  int r = 0;
+  GlContext tmp;
+  tmp.timer = ctx.timer;
+
+  if (0 != create_tmp_context(tmp)) {
+    printf("Failed to create the tmp context for our shared context.\n");
+    return -1;
+  }
+
+  ctx.shared = shared;
+  if (0 != create_main_context(tmp, ctx)) {
+    printf("Failed to create the shared context.\n");
+    r = -2;
+  }
+
+  if (0 != destroy_tmp_context(tmp)) {
+    printf("Failed to cleanly destroy the tmp context for our shared context.\n");
+  }
+
+  return r;
+}
+
+int make_context_current(GlContext& ctx) {
+
+  if (nullptr == ctx.gl) {
+    printf("Cannot make current, not initialized (gl == nullptr).\n");
+    return -1;
+  }
+
+  if (nullptr == ctx.dc) {
+    printf("Cannot make current, not initialized (dc == nullptr).\n");
+    return -2;
+  }
+
+  if (FALSE == wglMakeCurrent(ctx.dc, ctx.gl)) {
+    printf("Failed to make the context current.\n");
+    return -3;
+  }
+
+  /*
+    glad keeps one global set of function pointers (from
+    `wglGetProcAddress()`) and the `GLAD_GL_*` version and
+    extension flags; we fill them once, with the first context
+    that becomes current here. WGL only promises that those
+    pointers are valid for contexts on the same device with the
+    same pixel format. `create_main_context()` asks
+    `wglChoosePixelFormatARB()` for the same attributes and the
+    same 4.1 core version every time, and all windows live on
+    the one GPU we run on, so every context we make current
+    gets the same format from the same driver. A context that
+    is created some other way, or on another GPU, needs its own
+    `gladLoadGL()`.
+  */
+  std::call_once(gl_load_flag, []() {
+    gl_load_result = (0 == gladLoadGL()) ? -1 : 0;
+  });
+
+  if (0 != gl_load_result) {
+    printf("Failed to load the GL functions.\n");
+    return -4;
+  }
+
+  gl_state_filter_make_current(&ctx.state);
+
+  if (nullptr != ctx.debug
+      && false == ctx.debug->is_installed
+      && 0 != ctx.debug->install())
+    {
+      printf("Failed to install the debug output; we continue without it.\n");
+      ctx.debug = nullptr;
+    }
+
+  return 0;
+}
+
+int release_current_context() {
+
+  gl_state_filter_make_current(nullptr);
+
+  if (nullptr == wglGetCurrentContext()) {
+    return 0;
+  }
+  
+  if (FALSE == wglMakeCurrent(nullptr, nullptr)) {
+    printf("Failed to unset the current GL context.\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+void GlContext::print(const char* name) {
+
+  if (nullptr == name) {
+    printf("Cannot print, pass in a name.\n");
+    return;
+  }
+  
+  if (0 != make_context_current(*this)) {
+    printf("Cannot print info, failed to make the context current.\n");
+    return;
+  }
+
+  printf("%s: HGLRC: %p\n", name, gl);
+  printf("%s: GL_VERSION: %s\n", name, glGetString(GL_VERSION));
+  printf("%s: GL_VENDOR: %s\n", name, glGetString(GL_VENDOR));
+}
+
+/* ------------------------------------------------------------- */
+
+static bool has_wgl_extension(GlContext& tmp, HDC dc, const char* name) {
+
+  if (nullptr == tmp.wglGetExtensionsStringARB) {
+    return false;
+  }
+
+  return has_extension(tmp.wglGetExtensionsStringARB(dc), name);
+}
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,199 @@
+/*
+
+  GL CONTEXT
+  ===========
+
+  The `GlContext` and the `create_*()` / `destroy_*()` functions
+  that started out in the tests. They live here so the other
+  sources in `src/` can create (shared) contexts the same way the
+  tests do: first create a temporary context to get hold of
+  `wglChoosePixelFormatARB()` and `wglCreateContextAttribsARB()`,
+  then use that temporary context to create the main context.
+
+  Remember what we found in _test-shared-context-threading.cpp_:
+  when you create a context that shares with another one, the
+  other one must **not** be current in any thread.
+
+  All GL functions are loaded through glad. Call
+  `make_context_current()` instead of `wglMakeCurrent()` so glad
+  has been loaded before the first GL call is made, and so the
+  state filter knows which context is current.
+
+  On Linux the same functions are implemented with EGL (see
+  _gl-context-egl.cpp_) so the sources and tests that only use
+  this API can run on e.g. Mesa's llvmpipe. There the tmp context
+  only gets the display; the main context gets a 1x1 pbuffer
+  surface.
+
+  By default the driver flushes a context when it's released
+  (made non-current). Set `release` to `CONTEXT_RELEASE_NONE`
+  before creating a context that is made current and released
+  per job, to skip that flush (`WGL_ARB_context_flush_control`,
+  `EGL_KHR_context_flush_control`). Then nothing is flushed
+  for you: publish the results that another context needs with
+  a `GpuEvent` (see `gl-sync.h`, it flushes) or a `glFlush()`.
+  When the driver doesn't support it, `release` is reset to
+  `CONTEXT_RELEASE_FLUSH`.
+
+  `mode` selects the flavour of the main context:
+
+  - `CONTEXT_MODE_DEFAULT`: the driver validates every call and
+    reports errors through `glGetError()`.
+  - `CONTEXT_MODE_DEBUG`: a debug context; the driver reports
+    errors and performance warnings through `KHR_debug`. Use it
+    in CI and while developing.
+  - `CONTEXT_MODE_NO_ERROR`: the driver may skip validation
+    (`WGL_ARB_create_context_no_error`,
+    `EGL_KHR_create_context_no_error`); an error is undefined
+    behaviour. Use it in production builds, once the debug
+    builds are clean. When the driver doesn't support it, `mode`
+    is reset to `CONTEXT_MODE_DEFAULT`.
+
+  Set `debug` to capture the `KHR_debug` messages of the context
+  into a lock free ring (see `gl-debug-output.h`); the callback is
+  installed the first time the context is made current. A
+  context with `debug` set and the default mode is created as a
+  debug context.
+
+  Set `reset` to `CONTEXT_RESET_LOSE_CONTEXT` to be told about
+  GPU resets (TDRs, driver restarts): the context is created with
+  the lose-context-on-reset notification strategy
+  (`WGL_ARB_create_context_robustness`, EGL 1.5 or
+  `EGL_KHR_create_context`) and
+  `glGetGraphicsResetStatus()` returns something else than
+  `GL_NO_ERROR` once the context was lost. A lost context (and
+  its whole share group) has to be destroyed and created again;
+  `GlShareGroup` does that for you (see `gl-share-group.h`). All
+  contexts of a share group must use the same `reset`. When the
+  driver doesn't support it, `reset` is reset to
+  `CONTEXT_RESET_NO_NOTIFICATION`.
+
+  The default `mode` is set with the `GL_CONTEXT_MODE` CMake
+  option (which defines `GL_CONTEXT_DEBUG` or
+  `GL_CONTEXT_NO_ERROR`). A no-error context can't share with a
+  context that validates and vice versa, so use the same mode for
+  all the contexts of a share group.
+
+  Set `timer` (see `step-timer.h`) to time each step of the
+  `create_*()` functions; _bench-context-creation.cpp_ does this.
+
+ */
+#ifndef GL_CONTEXT_H
+#define GL_CONTEXT_H
+
+#if defined(_WIN32)
+#  include <windows.h>
+#  include <glad/glad.h>
+#  include <gl/wglext.h>
+#else
+#  include <glad/glad.h>
+#  include <EGL/egl.h>
+#  include <EGL/eglext.h>
+#endif
+
+#include <string.h>
+#include <gl-state-filter.h>
+#include <step-timer.h>
+
+/* ----------------------------------------------------------- */
+
+class GlDebugOutput;
+
+/* ----------------------------------------------------------- */
+
+enum ContextRelease {
+  CONTEXT_RELEASE_FLUSH,                       /* The default; flush when the context is released. */
+  CONTEXT_RELEASE_NONE,                        /* Don't flush; you synchronize with fences. */
+};
+
+enum ContextMode {
+  CONTEXT_MODE_DEFAULT,                        /* Validates; errors through `glGetError()`. */
+  CONTEXT_MODE_DEBUG,                          /* Validates; errors and warnings through `KHR_debug`. */
+  CONTEXT_MODE_NO_ERROR,                       /* Doesn't validate; errors are undefined behaviour. */
+};
+
+enum ContextReset {
+  CONTEXT_RESET_NO_NOTIFICATION,               /* The default; a GPU reset isn't reported. */
+  CONTEXT_RESET_LOSE_CONTEXT,                  /* Reported through `glGetGraphicsResetStatus()`; recreate the share group. */
+};
+
+#if defined(GL_CONTEXT_NO_ERROR)
+#  define CONTEXT_MODE_BUILD CONTEXT_MODE_NO_ERROR
+#elif defined(GL_CONTEXT_DEBUG)
+#  define CONTEXT_MODE_BUILD CONTEXT_MODE_DEBUG
+#else
+#  define CONTEXT_MODE_BUILD CONTEXT_MODE_DEFAULT
+#endif
+
+/* ----------------------------------------------------------- */
+
+class GlContext {
+public:
+  void print(const char* name);
+
+public:
+#if defined(_WIN32)
+  PFNWGLCHOOSEPIXELFORMATARBPROC wglChoosePixelFormatARB = nullptr;
+  PFNWGLCREATECONTEXTATTRIBSARBPROC wglCreateContextAttribsARB = nullptr;
+  PFNWGLGETEXTENSIONSSTRINGARBPROC wglGetExtensionsStringARB = nullptr;
+  PIXELFORMATDESCRIPTOR fmt = {};
+  HWND hwnd = nullptr;
+  HGLRC gl = nullptr;
+  HDC dc = nullptr;
+  int dx = -1;
+#else
+  PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT = nullptr;
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLConfig config = nullptr;
+  EGLSurface surface = EGL_NO_SURFACE;
+  EGLContext gl = EGL_NO_CONTEXT;
+#endif
+  GlContext* shared = nullptr;
+  ContextRelease release = CONTEXT_RELEASE_FLUSH;  /* Set before creating the context. */
+  ContextMode mode = CONTEXT_MODE_BUILD;           /* Set before creating the context. */
+  ContextReset reset = CONTEXT_RESET_NO_NOTIFICATION; /* Set before creating the context. */
+  GlDebugOutput* debug = nullptr;                  /* Optional; set before creating the context. */
+  StepTimer* timer = nullptr;                  /* Optional; times the steps of the `create_*()` functions. */
+  GlStateShadow state;                         /* See `gl-state-filter.h`. */
+};
+
+/* ----------------------------------------------------------- */
+
+int create_tmp_context(GlContext& ctx);
+int destroy_tmp_context(GlContext& ctx);
+int create_main_context(GlContext& tmp, GlContext& main);
+int destroy_main_context(GlContext& main);
+int create_shared_context(GlContext* shared, GlContext& ctx); /* Creates (and destroys) the tmp context for you; `shared` may be nullptr. */
+int make_context_current(GlContext& ctx);                     /* Makes `ctx` current on the calling thread and loads the GL functions the first time. */
+int release_current_context();                                /* Makes sure no context is current on the calling thread. */
+
+/* ----------------------------------------------------------- */
+
+/* `extensions` is a space separated list (WGL, EGL); `name` must match a whole entry, not the start or the end of a longer one. */
+static inline bool has_extension(const char* extensions, const char* name) {
+
+  if (nullptr == extensions || nullptr == name || '\0' == name[0]) {
+    return false;
+  }
+
+  size_t len = strlen(name);
+  const char* pos = extensions;
+
+  while (nullptr != (pos = strstr(pos, name))) {
+
+    bool is_start = (pos == extensions || ' ' == pos[-1]);
+    bool is_end = (' ' == pos[len] || '\0' == pos[len]);
+
+    if (true == is_start && true == is_end) {
+      return true;
+    }
+
+    pos += len;
+  }
+
+  return false;
+}
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,452 @@
+#include <stdio.h>
+#include <string.h>
+#include <gl-debug-output.h>
+#include <gl-sync.h>
+
+/* ------------------------------------------------------------- */
+
+static void APIENTRY on_debug_message(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* user);
+static uint64_t get_key(const DebugMessage& msg);
+
+/* ------------------------------------------------------------- */
+
+int GlDebugOutput::init(size_t capacity) {
+
+  if (nullptr != ring.cells) {
+    printf("Cannot initialize the debug output, already initialized.\n");
+    return -1;
+  }
+
+  if (0 != ring.init(capacity)) {
+    printf("Cannot initialize the debug output, failed to create the ring.\n");
+    return -2;
+  }
+
+  return 0;
+}
+
+int GlDebugOutput::install() {
+
+  if (true == is_installed) {
+    printf("Cannot install the debug output, already installed.\n");
+    return -1;
+  }
+
+  if (nullptr == glDebugMessageCallback || nullptr == glDebugMessageControl) {
+    printf("Cannot install the debug output, `KHR_debug` isn't supported.\n");
+    return -2;
+  }
+
+  if (nullptr == ring.cells && 0 != init()) {
+    printf("Cannot install the debug output, failed to initialize.\n");
+    return -3;
+  }
+
+  glEnable(GL_DEBUG_OUTPUT);
+
+  /* Allow the driver to report from its own thread(s); the ring is multi producer. */
+  glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+
+  if (false == is_notification_enabled) {
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+  }
+
+  glDebugMessageCallback(on_debug_message, this);
+
+  is_installed = true;
+
+  return 0;
+}
+
+int GlDebugOutput::uninstall() {
+
+  if (false == is_installed) {
+    return 0;
+  }
+
+  glDebugMessageCallback(nullptr, nullptr);
+  glDisable(GL_DEBUG_OUTPUT);
+
+  is_installed = false;
+
+  return 0;
+}
+
+int GlDebugOutput::shutdown() {
+
+  if (true == is_installed) {
+    printf("Cannot shutdown the debug output, the callback is still installed; destroy the context or uninstall first.\n");
+    return -1;
+  }
+
+  ring.shutdown();
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+GlDebugLog::~GlDebugLog() {
+
+  if (true == thread.joinable()) {
+    shutdown();
+  }
+}
+
+int GlDebugLog::start(DebugSink sink_func) {
+
+  if (true == thread.joinable()) {
+    printf("Cannot start the debug log, already started.\n");
+    return -1;
+  }
+
+  sink = (sink_func) ? sink_func : gl_debug_print;
+  tokens = max_burst;
+  tokens_ns = gpu_sync_now_ns();
+  num_pending_limited = 0;
+  num_emitted = 0;
+  num_deduped = 0;
+  num_rate_limited = 0;
+  dedupe.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_running = true;
+  }
+
+  thread = std::thread(&GlDebugLog::run, this);
+
+  return 0;
+}
+
+int GlDebugLog::shutdown() {
+
+  if (false == thread.joinable()) {
+    printf("Cannot shutdown the debug log, not started.\n");
+    return -1;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_running = false;
+  }
+
+  cond.notify_one();
+  thread.join();
+
+  /* The thread is gone; drain what's left and pass all pending repeats. */
+  std::lock_guard<std::mutex> lock(mutex);
+  uint64_t now = gpu_sync_now_ns();
+
+  drain(now);
+  flush_repeats(now, true, nullptr);
+
+  return 0;
+}
+
+int GlDebugLog::add(GlDebugOutput* output) {
+
+  if (nullptr == output) {
+    printf("Cannot add the debug output, it's nullptr.\n");
+    return -1;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (GlDebugOutput* o : outputs) {
+    if (o == output) {
+      printf("Cannot add the debug output, already added.\n");
+      return -2;
+    }
+  }
+
+  outputs.push_back(output);
+
+  return 0;
+}
+
+int GlDebugLog::remove(GlDebugOutput* output) {
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (size_t i = 0; i < outputs.size(); ++i) {
+
+    if (outputs[i] != output) {
+      continue;
+    }
+
+    uint64_t now = gpu_sync_now_ns();
+
+    /* Nothing may refer to `output` once it's removed. */
+    drain(now);
+    flush_repeats(now, true, output);
+    outputs.erase(outputs.begin() + i);
+
+    return 0;
+  }
+
+  printf("Cannot remove the debug output, not found.\n");
+
+  return -1;
+}
+
+/* ------------------------------------------------------------- */
+
+void GlDebugLog::run() {
+
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true == is_running) {
+
+    cond.wait_for(lock, std::chrono::nanoseconds(drain_interval_ns));
+
+    uint64_t now = gpu_sync_now_ns();
+    drain(now);
+    flush_repeats(now, false, nullptr);
+  }
+}
+
+void GlDebugLog::drain(uint64_t now) {
+
+  DebugMessage batch[32];
+
+  /* Tell how many we dropped, once we're allowed to pass messages again. */
+  if (0 != num_pending_limited && true == take_token(now)) {
+
+    DebugMessage notice;
+    notice.source = GL_DEBUG_SOURCE_APPLICATION;
+    notice.type = GL_DEBUG_TYPE_OTHER;
+    notice.severity = GL_DEBUG_SEVERITY_NOTIFICATION;
+    notice.time_ns = now;
+    snprintf(notice.text, sizeof(notice.text), "The rate limiter dropped %llu messages.", (unsigned long long)num_pending_limited);
+
+    sink(notice, 1);
+    num_pending_limited = 0;
+  }
+
+  for (GlDebugOutput* output : outputs) {
+
+    if (nullptr == output->ring.cells) {
+      continue;
+    }
+
+    size_t n = 0;
+
+    while (0 != (n = output->ring.pop_batch(batch, sizeof(batch) / sizeof(batch[0])))) {
+
+      for (size_t i = 0; i < n; ++i) {
+
+        const DebugMessage& msg = batch[i];
+        uint64_t key = get_key(msg);
+
+        std::unordered_map<uint64_t, DebugDedupeEntry>::iterator it = dedupe.find(key);
+        if (dedupe.end() != it && (now - it->second.emit_ns) < dedupe_window_ns) {
+          it->second.num_repeats++;
+          it->second.last = msg;
+          num_deduped++;
+          continue;
+        }
+
+        DebugDedupeEntry& entry = dedupe[key];
+        entry.emit_ns = now;
+        entry.num_repeats = 0;
+        entry.last = msg;
+
+        emit(msg, 1, now);
+      }
+    }
+  }
+}
+
+/*
+  Passes the repeats of the messages whose window has passed and
+  forgets the ones that weren't repeated. When `is_final` is true
+  we pass all repeats, of all outputs or only of `output`, without
+  rate limiting, and forget those messages.
+*/
+void GlDebugLog::flush_repeats(uint64_t now, bool is_final, GlDebugOutput* output) {
+
+  std::unordered_map<uint64_t, DebugDedupeEntry>::iterator it = dedupe.begin();
+
+  while (dedupe.end() != it) {
+
+    DebugDedupeEntry& entry = it->second;
+
+    if (nullptr != output && output != entry.last.output) {
+      ++it;
+      continue;
+    }
+
+    bool is_expired = (now - entry.emit_ns) >= dedupe_window_ns;
+
+    if (false == is_final && false == is_expired) {
+      ++it;
+      continue;
+    }
+
+    if (0 == entry.num_repeats) {
+      it = dedupe.erase(it);
+      continue;
+    }
+
+    if (true == is_final) {
+      sink(entry.last, entry.num_repeats);
+      num_emitted++;
+      it = dedupe.erase(it);
+      continue;
+    }
+
+    /* Keep the entry, so the repeats that follow are folded again. */
+    emit(entry.last, entry.num_repeats, now);
+    entry.emit_ns = now;
+    entry.num_repeats = 0;
+    ++it;
+  }
+}
+
+void GlDebugLog::emit(const DebugMessage& msg, uint64_t count, uint64_t now) {
+
+  if (false == take_token(now)) {
+    num_rate_limited += count;
+    num_pending_limited += count;
+    return;
+  }
+
+  sink(msg, count);
+  num_emitted++;
+}
+
+bool GlDebugLog::take_token(uint64_t now) {
+
+  tokens += ((now - tokens_ns) / 1e9) * max_per_second;
+  tokens = (tokens > max_burst) ? max_burst : tokens;
+  tokens_ns = now;
+
+  if (tokens < 1.0) {
+    return false;
+  }
+
+  tokens -= 1.0;
+
+  return true;
+}
+
+/* ------------------------------------------------------------- */
+
+void gl_debug_print(const DebugMessage& msg, uint64_t count) {
+
+  printf("[%s] %s %s %s 0x%X: %s",
+         (nullptr != msg.output) ? msg.output->name : "debug-log",
+         gl_debug_severity_to_string(msg.severity),
+         gl_debug_type_to_string(msg.type),
+         gl_debug_source_to_string(msg.source),
+         msg.id,
+         msg.text);
+
+  if (count > 1) {
+    printf(" (repeated %llu times)", (unsigned long long)count);
+  }
+
+  printf("\n");
+}
+
+const char* gl_debug_source_to_string(GLenum source) {
+
+  switch (source) {
+    case GL_DEBUG_SOURCE_API:             { return "api";         }
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   { return "window";      }
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: { return "compiler";    }
+    case GL_DEBUG_SOURCE_THIRD_PARTY:     { return "third-party"; }
+    case GL_DEBUG_SOURCE_APPLICATION:     { return "application"; }
+    case GL_DEBUG_SOURCE_OTHER:           { return "other";       }
+    default:                              { return "unknown";     }
+  }
+}
+
+const char* gl_debug_type_to_string(GLenum type) {
+
+  switch (type) {
+    case GL_DEBUG_TYPE_ERROR:               { return "error";       }
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: { return "deprecated";  }
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  { return "undefined";   }
+    case GL_DEBUG_TYPE_PORTABILITY:         { return "portability"; }
+    case GL_DEBUG_TYPE_PERFORMANCE:         { return "performance"; }
+    case GL_DEBUG_TYPE_MARKER:              { return "marker";      }
+    case GL_DEBUG_TYPE_PUSH_GROUP:          { return "push";        }
+    case GL_DEBUG_TYPE_POP_GROUP:           { return "pop";         }
+    case GL_DEBUG_TYPE_OTHER:               { return "other";       }
+    default:                                { return "unknown";     }
+  }
+}
+
+const char* gl_debug_severity_to_string(GLenum severity) {
+
+  switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH:         { return "HIGH";   }
+    case GL_DEBUG_SEVERITY_MEDIUM:       { return "MEDIUM"; }
+    case GL_DEBUG_SEVERITY_LOW:          { return "LOW";    }
+    case GL_DEBUG_SEVERITY_NOTIFICATION: { return "NOTE";   }
+    default:                             { return "?";      }
+  }
+}
+
+/* ------------------------------------------------------------- */
+
+/* Only copies; this may run on a driver thread, in the middle of a GL call. */
+static void APIENTRY on_debug_message(GLenum source,
+                                      GLenum type,
+                                      GLuint id,
+                                      GLenum severity,
+                                      GLsizei length,
+                                      const GLchar* message,
+                                      const void* user)
+{
+  GlDebugOutput* output = (GlDebugOutput*)user;
+  if (nullptr == output) {
+    return;
+  }
+
+  DebugMessage msg;
+  msg.output = output;
+  msg.source = source;
+  msg.type = type;
+  msg.id = id;
+  msg.severity = severity;
+  msg.time_ns = gpu_sync_now_ns();
+
+  if (nullptr != message) {
+    size_t len = (length < 0) ? strlen(message) : (size_t)length;
+    len = (len < DEBUG_MESSAGE_MAX_TEXT - 1) ? len : DEBUG_MESSAGE_MAX_TEXT - 1;
+    memcpy(msg.text, message, len);
+    msg.text[len] = '\0';
+  }
+
+  output->num_received.fetch_add(1, std::memory_order_relaxed);
+
+  if (false == output->ring.push(std::move(msg))) {
+    output->num_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+/* FNV-1a over everything that makes two messages the same. */
+static uint64_t get_key(const DebugMessage& msg) {
+
+  uint64_t hash = 14695981039346656037ull;
+  uint64_t fields[] = { (uint64_t)(uintptr_t)msg.output, msg.source, msg.type, msg.id, msg.severity };
+
+  for (uint64_t field : fields) {
+    for (uint32_t i = 0; i < 8; ++i) {
+      hash ^= (field >> (i * 8)) & 0xFF;
+      hash *= 1099511628211ull;
+    }
+  }
+
+  for (const char* c = msg.text; '\0' != *c; ++c) {
+    hash ^= (uint8_t)*c;
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+/* ------------------------------------------------------------- */
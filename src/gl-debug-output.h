@@ -0,0 +1,163 @@
+/*
+
+  GL DEBUG OUTPUT
+  ================
+
+  Captures the `KHR_debug` messages of a context without slowing
+  down the thread that calls GL (or the driver thread that reports
+  them). The debug callback only copies the message (truncated to
+  `DEBUG_MESSAGE_MAX_TEXT`) into a lock free ring; a background
+  thread drains the rings of all contexts and hands the messages
+  to a sink (by default `gl_debug_print()`).
+
+    GlDebugLog log;
+    log.start();
+
+    GlDebugOutput output;
+    output.name = "main";
+    log.add(&output);
+
+    GlContext ctx;
+    ctx.debug = &output;                 // see `gl-context.h`
+    create_shared_context(nullptr, ctx);
+    make_context_current(ctx);           // installs the callback
+    ...
+    destroy_main_context(ctx);
+    log.remove(&output);
+    output.shutdown();
+    log.shutdown();
+
+  `GlDebugOutput` is per context. The callback can be called from
+  the thread that made the call or from a driver thread, so the
+  ring is a `MpscQueue`. When the ring is full the message is
+  dropped and counted in `num_dropped`; the callback never blocks.
+
+  `GlDebugLog` is the drain thread. It does two things before a
+  message reaches the sink:
+
+  - deduplication: a message with the same context, source, type,
+    id, severity and text as one that was passed to the sink less
+    than `dedupe_window_ns` ago is only counted. When the window
+    has passed we pass it once more with the number of repeats.
+
+  - rate limiting: a token bucket allows `max_per_second` messages
+    with bursts of `max_burst`. Messages over the limit are
+    dropped and counted; once messages are allowed again, the sink
+    gets a message that tells how many were dropped.
+
+  The sink is only called from the drain thread.
+
+ */
+#ifndef GL_DEBUG_OUTPUT_H
+#define GL_DEBUG_OUTPUT_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+#include <glad/glad.h>
+#include <mpsc-queue.h>
+
+/* ----------------------------------------------------------- */
+
+#define DEBUG_MESSAGE_MAX_TEXT 160
+
+/* ----------------------------------------------------------- */
+
+class GlDebugOutput;
+
+struct DebugMessage {
+  GlDebugOutput* output = nullptr;             /* The context that reported it. */
+  GLenum source = 0;
+  GLenum type = 0;
+  GLuint id = 0;
+  GLenum severity = 0;
+  uint64_t time_ns = 0;                        /* When the callback was called. */
+  char text[DEBUG_MESSAGE_MAX_TEXT] = { 0 };   /* Truncated, always zero terminated. */
+};
+
+struct DebugDedupeEntry {
+  uint64_t emit_ns = 0;                        /* When we last passed it to the sink. */
+  uint64_t num_repeats = 0;                    /* Since `emit_ns`. */
+  DebugMessage last;
+};
+
+typedef std::function<void(const DebugMessage& msg, uint64_t count)> DebugSink;
+
+/* ----------------------------------------------------------- */
+
+class GlDebugOutput {
+public:
+  GlDebugOutput() = default;
+  GlDebugOutput(const GlDebugOutput&) = delete;
+  GlDebugOutput& operator=(const GlDebugOutput&) = delete;
+  int init(size_t capacity = 1024);            /* Creates the ring; `install()` calls this when you didn't. */
+  int install();                               /* Installs the callback; the context must be current. */
+  int shutdown();                              /* Destroy the context (or `uninstall()`) first. */
+  int uninstall();                             /* The context must be current. */
+
+public:
+  const char* name = "gl";                     /* Not copied; used by the sink. */
+  MpscQueue<DebugMessage> ring;
+  bool is_installed = false;
+  bool is_notification_enabled = false;        /* Set before `install()`; notifications are noisy. */
+  std::atomic<uint64_t> num_received{0};
+  std::atomic<uint64_t> num_dropped{0};        /* The ring was full. */
+};
+
+/* ----------------------------------------------------------- */
+
+class GlDebugLog {
+public:
+  GlDebugLog() = default;
+  GlDebugLog(const GlDebugLog&) = delete;
+  GlDebugLog& operator=(const GlDebugLog&) = delete;
+  ~GlDebugLog();
+  int start(DebugSink sink = nullptr);         /* nullptr uses `gl_debug_print()`. */
+  int shutdown();                              /* Drains what's left and passes the pending repeats. */
+  int add(GlDebugOutput* output);
+  int remove(GlDebugOutput* output);           /* Drains it first. */
+
+public:
+  DebugSink sink;
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::vector<GlDebugOutput*> outputs;         /* Protected by `mutex`. */
+  bool is_running = false;                     /* Protected by `mutex`. */
+  uint64_t drain_interval_ns = 10ull * 1000ull * 1000ull;
+  uint64_t dedupe_window_ns = 1000ull * 1000ull * 1000ull;
+  double max_per_second = 100.0;
+  double max_burst = 200.0;
+  uint64_t num_emitted = 0;                    /* Stats; only read these after `shutdown()`. */
+  uint64_t num_deduped = 0;
+  uint64_t num_rate_limited = 0;
+
+private:
+  void run();
+  void drain(uint64_t now);                    /* Called with `mutex` locked. */
+  void flush_repeats(uint64_t now, bool is_final, GlDebugOutput* output);
+  void emit(const DebugMessage& msg, uint64_t count, uint64_t now);
+  bool take_token(uint64_t now);
+
+private:
+  std::unordered_map<uint64_t, DebugDedupeEntry> dedupe;
+  double tokens = 0.0;
+  uint64_t tokens_ns = 0;
+  uint64_t num_pending_limited = 0;            /* Dropped since the last notice. */
+};
+
+/* ----------------------------------------------------------- */
+
+void gl_debug_print(const DebugMessage& msg, uint64_t count);
+const char* gl_debug_source_to_string(GLenum source);
+const char* gl_debug_type_to_string(GLenum type);
+const char* gl_debug_severity_to_string(GLenum severity);
+
+/* ----------------------------------------------------------- */
+
+#endif
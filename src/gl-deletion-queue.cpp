@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <utility>
+#include <gl-deletion-queue.h>
+
+/* ------------------------------------------------------------- */
+
+int DeletionBatch::add(DeletionType type, GLuint name) {
+
+  if (type >= DELETE_TYPE_COUNT) {
+    printf("Cannot add to the deletion batch, invalid type.\n");
+    return -1;
+  }
+
+  if (0 == name) {
+    return 0;
+  }
+
+  names[type].push_back(name);
+
+  return 0;
+}
+
+int DeletionBatch::add(DeletionType type, const GLuint* values, size_t count) {
+
+  if (type >= DELETE_TYPE_COUNT) {
+    printf("Cannot add to the deletion batch, invalid type.\n");
+    return -1;
+  }
+
+  if (nullptr == values) {
+    printf("Cannot add to the deletion batch, no names given.\n");
+    return -2;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    if (0 != values[i]) {
+      names[type].push_back(values[i]);
+    }
+  }
+
+  return 0;
+}
+
+bool DeletionBatch::empty() const {
+  return 0 == size();
+}
+
+size_t DeletionBatch::size() const {
+
+  size_t total = 0;
+
+  for (size_t i = 0; i < DELETE_TYPE_COUNT; ++i) {
+    total += names[i].size();
+  }
+
+  return total;
+}
+
+void DeletionBatch::clear() {
+
+  for (size_t i = 0; i < DELETE_TYPE_COUNT; ++i) {
+    names[i].clear();
+  }
+
+  fence = nullptr;
+}
+
+/* ------------------------------------------------------------- */
+
+int DeletionQueue::init(size_t capacity) {
+
+  if (0 != incoming.init(capacity)) {
+    printf("Failed to initialize the deletion queue.\n");
+    return -1;
+  }
+
+  num_deleted = 0;
+  num_delete_calls = 0;
+  num_sweeps = 0;
+
+  return 0;
+}
+
+int DeletionQueue::shutdown() {
+
+  DeletionBatch batch;
+
+  while (incoming.pop(batch)) {
+    pending.push_back(std::move(batch));
+  }
+
+  for (size_t i = 0; i < pending.size(); ++i) {
+
+    DeletionBatch& curr = pending[i];
+
+    if (GL_WAIT_FAILED == glClientWaitSync(curr.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED)) {
+      printf("Failed to wait for a deletion fence; deleting the objects anyway.\n");
+    }
+
+    glDeleteSync(curr.fence);
+
+    for (size_t j = 0; j < DELETE_TYPE_COUNT; ++j) {
+      signalled[j].insert(signalled[j].end(), curr.names[j].begin(), curr.names[j].end());
+    }
+  }
+
+  pending.clear();
+  delete_signalled();
+  incoming.shutdown();
+
+  return 0;
+}
+
+int DeletionQueue::submit(DeletionBatch& batch) {
+
+  if (true == batch.empty()) {
+    return 0;
+  }
+
+  GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  if (nullptr == fence) {
+    printf("Failed to create the fence for a deletion batch.\n");
+    return -1;
+  }
+
+  /* The sweep happens in another context; make sure our fence reaches the GPU. */
+  glFlush();
+
+  int r = submit(batch, fence);
+  if (0 != r) {
+    glDeleteSync(fence);
+  }
+
+  return r;
+}
+
+int DeletionQueue::submit(DeletionBatch& batch, GLsync fence) {
+
+  if (nullptr == fence) {
+    printf("Cannot submit the deletion batch, no fence given.\n");
+    return -1;
+  }
+
+  if (true == batch.empty()) {
+    glDeleteSync(fence);
+    return 0;
+  }
+
+  /*
+     When the queue is full we don't wait and don't log; this
+     happens when the sweeper falls behind. The names stay in
+     `batch` so the caller can submit them with the next
+     submission.
+  */
+  DeletionBatch item;
+  for (size_t i = 0; i < DELETE_TYPE_COUNT; ++i) {
+    item.names[i].swap(batch.names[i]);
+  }
+  item.fence = fence;
+
+  if (false == incoming.push(std::move(item))) {
+    for (size_t i = 0; i < DELETE_TYPE_COUNT; ++i) {
+      item.names[i].swap(batch.names[i]);
+    }
+    return -2;
+  }
+
+  batch.clear();
+
+  return 0;
+}
+
+int DeletionQueue::sweep() {
+
+  DeletionBatch batch;
+  int r = 0;
+
+  num_sweeps++;
+
+  while (incoming.pop(batch)) {
+    pending.push_back(std::move(batch));
+  }
+
+  /* Fences of different contexts aren't ordered; check them all. */
+  size_t i = 0;
+  while (i < pending.size()) {
+
+    DeletionBatch& curr = pending[i];
+    GLenum status = glClientWaitSync(curr.fence, 0, 0);
+
+    if (GL_WAIT_FAILED == status) {
+      printf("Failed to check a deletion fence.\n");
+      r = -1;
+      i++;
+      continue;
+    }
+
+    if (GL_TIMEOUT_EXPIRED == status) {
+      i++;
+      continue;
+    }
+
+    glDeleteSync(curr.fence);
+    curr.fence = nullptr;
+
+    for (size_t j = 0; j < DELETE_TYPE_COUNT; ++j) {
+      signalled[j].insert(signalled[j].end(), curr.names[j].begin(), curr.names[j].end());
+    }
+
+    if (i + 1 != pending.size()) {
+      std::swap(pending[i], pending.back());
+    }
+    pending.pop_back();
+  }
+
+  int n = delete_signalled();
+
+  return (r < 0) ? r : n;
+}
+
+/* ------------------------------------------------------------- */
+
+int DeletionQueue::delete_signalled() {
+
+  int total = 0;
+
+  for (size_t i = 0; i < DELETE_TYPE_COUNT; ++i) {
+
+    std::vector<GLuint>& names = signalled[i];
+    if (true == names.empty()) {
+      continue;
+    }
+
+    GLsizei n = (GLsizei)names.size();
+
+    switch (i) {
+      case DELETE_TEXTURE: {
+        glDeleteTextures(n, names.data());
+        num_delete_calls++;
+        break;
+      }
+      case DELETE_BUFFER: {
+        glDeleteBuffers(n, names.data());
+        num_delete_calls++;
+        break;
+      }
+      case DELETE_RENDERBUFFER: {
+        glDeleteRenderbuffers(n, names.data());
+        num_delete_calls++;
+        break;
+      }
+      case DELETE_SAMPLER: {
+        glDeleteSamplers(n, names.data());
+        num_delete_calls++;
+        break;
+      }
+      case DELETE_PROGRAM: {
+        /* There is no batched delete for programs and shaders. */
+        for (size_t j = 0; j < names.size(); ++j) {
+          glDeleteProgram(names[j]);
+        }
+        num_delete_calls += names.size();
+        break;
+      }
+      case DELETE_SHADER: {
+        for (size_t j = 0; j < names.size(); ++j) {
+          glDeleteShader(names[j]);
+        }
+        num_delete_calls += names.size();
+        break;
+      }
+    }
+
+    total += n;
+    names.clear();
+  }
+
+  num_deleted += total;
+
+  return total;
+}
+
+/* ------------------------------------------------------------- */
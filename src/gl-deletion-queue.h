@@ -0,0 +1,95 @@
+/*
+
+  GL DELETION QUEUE
+  ==================
+
+  Deleting a texture or buffer in one context while another
+  context still has GPU work that uses it, either stalls or is a
+  hazard. Instead of calling `glDelete*()` directly you add the
+  names to a `DeletionBatch` and submit the batch after the last
+  submission that used the objects:
+
+    DeletionBatch batch;
+    batch.add(DELETE_TEXTURE, tex);
+    batch.add(DELETE_BUFFER, vbo);
+    deletions.submit(batch);          // inserts + flushes a fence in the current context
+
+  `submit()` can be called from any thread that has a context of
+  the share group current; the batch + fence are handed to the
+  queue through a lock free `MpscQueue`, so it never blocks.
+
+  `sweep()` is called on one thread (e.g. a `GlWorker`, see its
+  `idle_task`) with a context of the same share group current. It
+  polls the fences without waiting and deletes the objects of all
+  signalled batches with one `glDelete*(n, ...)` call per type.
+
+  Only objects that are shared between contexts can be queued.
+  Framebuffers and vertex arrays are container objects and
+  queries aren't shared at all; they belong to the context that
+  created them and must be deleted there.
+
+ */
+#ifndef GL_DELETION_QUEUE_H
+#define GL_DELETION_QUEUE_H
+
+#include <stdint.h>
+#include <vector>
+#include <glad/glad.h>
+#include <gl-state-filter.h>
+#include <mpsc-queue.h>
+
+/* ----------------------------------------------------------- */
+
+enum DeletionType {
+  DELETE_TEXTURE = 0,
+  DELETE_BUFFER,
+  DELETE_RENDERBUFFER,
+  DELETE_SAMPLER,
+  DELETE_PROGRAM,
+  DELETE_SHADER,
+  DELETE_TYPE_COUNT
+};
+
+/* ----------------------------------------------------------- */
+
+class DeletionBatch {
+public:
+  int add(DeletionType type, GLuint name);
+  int add(DeletionType type, const GLuint* names, size_t count);
+  bool empty() const;
+  size_t size() const;
+  void clear();
+
+public:
+  std::vector<GLuint> names[DELETE_TYPE_COUNT];
+  GLsync fence = nullptr;                      /* Set by the queue when the batch is submitted. */
+};
+
+/* ----------------------------------------------------------- */
+
+class DeletionQueue {
+public:
+  DeletionQueue() = default;
+  DeletionQueue(const DeletionQueue&) = delete;
+  DeletionQueue& operator=(const DeletionQueue&) = delete;
+  int init(size_t capacity);                   /* The max number of batches in flight. */
+  int shutdown();                              /* Waits for and deletes everything that is left; a context must be current. */
+  int submit(DeletionBatch& batch);            /* Any thread; inserts a fence in the current context and takes the names out of `batch`. */
+  int submit(DeletionBatch& batch, GLsync fence); /* Any thread; the queue takes ownership of `fence` on success. Returns -2 when full. */
+  int sweep();                                 /* Sweep thread; returns the number of deleted objects or < 0 on error. */
+
+public:
+  MpscQueue<DeletionBatch> incoming;
+  std::vector<DeletionBatch> pending;          /* Only touched by the sweep thread. */
+  std::vector<GLuint> signalled[DELETE_TYPE_COUNT];
+  uint64_t num_deleted = 0;                    /* Stats; only touched by the sweep thread. */
+  uint64_t num_delete_calls = 0;
+  uint64_t num_sweeps = 0;
+
+private:
+  int delete_signalled();
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,350 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <gl-draw-batcher.h>
+#include <gl-resource.h>
+
+/* ------------------------------------------------------------- */
+
+static bool is_same_state(const BatchState& a, const BatchState& b);
+static bool is_state_less(const BatchState& a, const BatchState& b);
+static GLuint create_mapped_buffer(GLsizeiptr size, uint8_t** ptr);
+
+/* ------------------------------------------------------------- */
+
+int DrawBatcher::init(const DrawBatcherSettings& cfg) {
+
+  if (0 != command_buffer) {
+    printf("Cannot initialize the draw batcher, already initialized.\n");
+    return -1;
+  }
+
+  if (0 == GLAD_GL_VERSION_4_3 && 0 == GLAD_GL_ARB_multi_draw_indirect) {
+    printf("Cannot initialize the draw batcher, multi draw indirect isn't supported.\n");
+    return -2;
+  }
+
+  if (0 == GLAD_GL_VERSION_4_4 && 0 == GLAD_GL_ARB_buffer_storage) {
+    printf("Cannot initialize the draw batcher, immutable buffer storage isn't supported.\n");
+    return -3;
+  }
+
+  if (0 == GLAD_GL_VERSION_4_6 && 0 == GLAD_GL_ARB_shader_draw_parameters) {
+    printf("Cannot initialize the draw batcher, `gl_DrawID` isn't supported (ARB_shader_draw_parameters).\n");
+    return -4;
+  }
+
+  if (0 == cfg.max_draws || 0 == cfg.draw_data_size || 0 == cfg.max_groups || 0 == cfg.num_frames) {
+    printf("Cannot initialize the draw batcher, invalid settings.\n");
+    return -5;
+  }
+
+  settings = cfg;
+
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &data_alignment);
+  if (data_alignment <= 0) {
+    data_alignment = 256;
+  }
+
+  /* Every group can waste up to `data_alignment` bytes; round the regions up so each region starts aligned too. */
+  uint64_t align = (uint64_t)data_alignment;
+  command_region_size = (uint64_t)settings.max_draws * sizeof(DrawElementsIndirectCommand);
+  data_region_size = (uint64_t)settings.max_draws * settings.draw_data_size + (uint64_t)settings.max_groups * align;
+  data_region_size = ((data_region_size + align - 1) / align) * align;
+
+  command_buffer = create_mapped_buffer((GLsizeiptr)(command_region_size * settings.num_frames), &command_ptr);
+  data_buffer = create_mapped_buffer((GLsizeiptr)(data_region_size * settings.num_frames), &data_ptr);
+
+  if (0 == command_buffer || 0 == data_buffer) {
+    printf("Cannot initialize the draw batcher, failed to create the mapped buffers.\n");
+    shutdown();
+    return -6;
+  }
+
+  fences.assign(settings.num_frames, nullptr);
+  draws.reserve(settings.max_draws);
+  order.reserve(settings.max_draws);
+  data.reserve((size_t)settings.max_draws * settings.draw_data_size);
+
+  frame_index = 0;
+  frame_draws = 0;
+  frame_groups = 0;
+  frame_data = 0;
+  is_in_frame = false;
+  num_draws = 0;
+  num_multi_draws = 0;
+
+  return 0;
+}
+
+int DrawBatcher::shutdown() {
+
+  for (size_t i = 0; i < fences.size(); ++i) {
+    if (nullptr != fences[i]) {
+      glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+      glDeleteSync(fences[i]);
+    }
+  }
+
+  /* Deleting a buffer unmaps it. */
+  if (0 != command_buffer) {
+    glDeleteBuffers(1, &command_buffer);
+  }
+
+  if (0 != data_buffer) {
+    glDeleteBuffers(1, &data_buffer);
+  }
+
+  fences.clear();
+  draws.clear();
+  order.clear();
+  data.clear();
+  command_buffer = 0;
+  data_buffer = 0;
+  command_ptr = nullptr;
+  data_ptr = nullptr;
+  is_in_frame = false;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int DrawBatcher::begin_frame() {
+
+  if (0 == command_buffer) {
+    printf("Cannot begin the frame, the draw batcher isn't initialized.\n");
+    return -1;
+  }
+
+  if (true == is_in_frame) {
+    printf("Cannot begin the frame, `end_frame()` wasn't called.\n");
+    return -2;
+  }
+
+  /* The GPU may still read the commands of `num_frames` ago. */
+  GLsync fence = fences[frame_index];
+  if (nullptr != fence) {
+
+    if (GL_WAIT_FAILED == glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED)) {
+      printf("Cannot begin the frame, failed to wait for the fence of the region.\n");
+      return -3;
+    }
+
+    glDeleteSync(fence);
+    fences[frame_index] = nullptr;
+  }
+
+  draws.clear();
+  data.clear();
+  frame_draws = 0;
+  frame_groups = 0;
+  frame_data = 0;
+  is_in_frame = true;
+
+  return 0;
+}
+
+int DrawBatcher::add(const BatchState& state, const DrawElementsIndirectCommand& command, const void* draw_data) {
+
+  if (false == is_in_frame) {
+    printf("Cannot add a draw, call `begin_frame()` first.\n");
+    return -1;
+  }
+
+  if (frame_draws + draws.size() >= settings.max_draws) {
+    printf("Cannot add a draw, the maximum number of draws per frame (%u) has been reached.\n", settings.max_draws);
+    return -2;
+  }
+
+  BatchDraw draw;
+  draw.state = state;
+  draw.command = command;
+  draw.data_offset = (uint32_t)data.size();
+  draws.push_back(draw);
+
+  /* `insert()` with a pointer range is a memcpy; `resize()` would zero the bytes first. */
+  if (nullptr != draw_data) {
+    const uint8_t* bytes = (const uint8_t*)draw_data;
+    data.insert(data.end(), bytes, bytes + settings.draw_data_size);
+  }
+  else {
+    data.resize(data.size() + settings.draw_data_size, 0);
+  }
+
+  return 0;
+}
+
+/*
+  Sorts the draws by state and writes the commands and the per
+  draw data of each group contiguously into the region of this
+  frame. The sort is stable so draws with the same state keep
+  the order in which they were added.
+*/
+int DrawBatcher::flush() {
+
+  if (false == is_in_frame) {
+    printf("Cannot flush the draw batcher, call `begin_frame()` first.\n");
+    return -1;
+  }
+
+  if (true == draws.empty()) {
+    return 0;
+  }
+
+  order.resize(draws.size());
+  for (uint32_t i = 0; i < (uint32_t)order.size(); ++i) {
+    order[i] = i;
+  }
+
+  const std::vector<BatchDraw>& all = draws;
+  std::stable_sort(order.begin(), order.end(), [&all](uint32_t a, uint32_t b) {
+    return is_state_less(all[a].state, all[b].state);
+  });
+
+  const uint64_t align = (uint64_t)data_alignment;
+  const uint64_t data_size = settings.draw_data_size;
+  DrawElementsIndirectCommand* commands = (DrawElementsIndirectCommand*)(command_ptr + frame_index * command_region_size);
+  uint8_t* region = data_ptr + frame_index * data_region_size;
+  int num_groups = 0;
+  size_t i = 0;
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer);
+
+  while (i < order.size()) {
+
+    const BatchState& state = draws[order[i]].state;
+
+    size_t end = i + 1;
+    while (end < order.size() && true == is_same_state(state, draws[order[end]].state)) {
+      ++end;
+    }
+
+    uint64_t group_size = end - i;
+    uint64_t data_offset = ((frame_data + align - 1) / align) * align;
+
+    /* The groups we already submitted stay submitted; we drop the rest. */
+    int overflow = 0;
+
+    if (frame_groups >= settings.max_groups) {
+      printf("Cannot flush the draw batcher, the maximum number of state groups per frame (%u) has been reached; dropping %zu draws.\n", settings.max_groups, order.size() - i);
+      overflow = -2;
+    }
+    else if (data_offset + group_size * data_size > data_region_size) {
+      printf("Cannot flush the draw batcher, the per draw data region of the frame (%llu bytes) is full; dropping %zu draws.\n", (unsigned long long)data_region_size, order.size() - i);
+      overflow = -3;
+    }
+
+    if (0 != overflow) {
+      glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+      num_draws += i;
+      num_multi_draws += num_groups;
+      draws.clear();
+      data.clear();
+      return overflow;
+    }
+
+    uint32_t first_command = frame_draws;
+
+    for (size_t j = i; j < end; ++j) {
+      const BatchDraw& draw = draws[order[j]];
+      commands[frame_draws++] = draw.command;
+      memcpy(region + data_offset + (j - i) * data_size, &data[draw.data_offset], data_size);
+    }
+
+    frame_data = data_offset + group_size * data_size;
+    frame_groups++;
+
+    glUseProgram(state.program);
+    glBindVertexArray(state.vertex_array);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER,
+                      settings.data_binding,
+                      data_buffer,
+                      (GLintptr)(frame_index * data_region_size + data_offset),
+                      (GLsizeiptr)(group_size * data_size));
+
+    glMultiDrawElementsIndirect(state.mode,
+                                state.index_type,
+                                (const void*)(uintptr_t)(frame_index * command_region_size + first_command * sizeof(DrawElementsIndirectCommand)),
+                                (GLsizei)group_size,
+                                0);
+
+    num_groups++;
+    i = end;
+  }
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+  num_draws += draws.size();
+  num_multi_draws += num_groups;
+
+  draws.clear();
+  data.clear();
+
+  return num_groups;
+}
+
+int DrawBatcher::end_frame() {
+
+  if (false == is_in_frame) {
+    printf("Cannot end the frame, `begin_frame()` wasn't called.\n");
+    return -1;
+  }
+
+  if (false == draws.empty()) {
+    printf("Cannot end the frame, there are draws that weren't flushed.\n");
+    return -2;
+  }
+
+  fences[frame_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  frame_index = (frame_index + 1) % settings.num_frames;
+  is_in_frame = false;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+static bool is_same_state(const BatchState& a, const BatchState& b) {
+  return a.program == b.program
+    && a.vertex_array == b.vertex_array
+    && a.mode == b.mode
+    && a.index_type == b.index_type;
+}
+
+/* Program changes are the most expensive, so they are the most significant part of the key. */
+static bool is_state_less(const BatchState& a, const BatchState& b) {
+
+  if (a.program != b.program) {
+    return a.program < b.program;
+  }
+
+  if (a.vertex_array != b.vertex_array) {
+    return a.vertex_array < b.vertex_array;
+  }
+
+  if (a.mode != b.mode) {
+    return a.mode < b.mode;
+  }
+
+  return a.index_type < b.index_type;
+}
+
+static GLuint create_mapped_buffer(GLsizeiptr size, uint8_t** ptr) {
+
+  GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  GLuint buffer = 0;
+
+  if (0 != gl_create_buffer(size, nullptr, flags, buffer)) {
+    return 0;
+  }
+
+  if (0 != gl_map_buffer(buffer, 0, size, flags, (void**)ptr)) {
+    glDeleteBuffers(1, &buffer);
+    return 0;
+  }
+
+  return buffer;
+}
+
+/* ------------------------------------------------------------- */
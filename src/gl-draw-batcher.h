@@ -0,0 +1,121 @@
+/*
+
+  GL DRAW BATCHER
+  ================
+
+  Issuing 20k+ `glDraw*()` calls a frame, each with its own
+  `glUseProgram()`, `glBindVertexArray()` and uniform updates,
+  makes the CPU the bottleneck. The `DrawBatcher` collects the
+  draws of a frame and issues all draws that share the same
+  pipeline state (`BatchState`) with one
+  `glMultiDrawElementsIndirect()`.
+
+    batcher.begin_frame();
+    for (each object) {
+      batcher.add(state, command, &per_draw_data);
+    }
+    batcher.flush();                  // sorts by state; one multi draw per state
+    batcher.end_frame();
+
+  The indirect commands and the per draw data are written into
+  persistently mapped buffers. Both are split into `num_frames`
+  regions which are guarded by a fence, like the per frame
+  allocations of the `BufferArena`.
+
+  PER DRAW DATA
+
+  The per draw data (e.g. a model matrix + material index) of
+  one state group is stored contiguously in a shader storage
+  buffer and the range of the group is bound to `data_binding`.
+  In the vertex shader you index it with the draw id:
+
+    #extension GL_ARB_shader_draw_parameters : require
+    layout(std430, binding = 0) readonly buffer DrawData { Draw draws[]; };
+    ...
+    Draw draw = draws[gl_DrawIDARB];
+
+  Requires GL 4.3 (or `ARB_multi_draw_indirect`), GL 4.4 (or
+  `ARB_buffer_storage`) and GL 4.6 (or
+  `ARB_shader_draw_parameters`); `init()` fails when one of
+  them is missing.
+
+ */
+#ifndef GL_DRAW_BATCHER_H
+#define GL_DRAW_BATCHER_H
+
+#include <stdint.h>
+#include <vector>
+#include <glad/glad.h>
+#include <gl-state-filter.h>
+
+/* ----------------------------------------------------------- */
+
+/* The layout that GL expects in the GL_DRAW_INDIRECT_BUFFER. */
+struct DrawElementsIndirectCommand {
+  GLuint count = 0;
+  GLuint instance_count = 1;
+  GLuint first_index = 0;
+  GLint base_vertex = 0;
+  GLuint base_instance = 0;
+};
+
+struct BatchState {
+  GLuint program = 0;
+  GLuint vertex_array = 0;
+  GLenum mode = GL_TRIANGLES;
+  GLenum index_type = GL_UNSIGNED_INT;
+};
+
+struct BatchDraw {
+  BatchState state;
+  DrawElementsIndirectCommand command;
+  uint32_t data_offset = 0;                    /* Into `DrawBatcher::data`. */
+};
+
+struct DrawBatcherSettings {
+  uint32_t max_draws = 32768;                  /* Per frame. */
+  uint32_t draw_data_size = 64;                /* Bytes of per draw data; use the std430 size of your struct. */
+  uint32_t max_groups = 256;                   /* Per frame; the data of every state group starts at an aligned offset. */
+  GLuint data_binding = 0;                     /* The shader storage binding of the per draw data. */
+  uint32_t num_frames = 3;
+};
+
+/* ----------------------------------------------------------- */
+
+class DrawBatcher {
+public:
+  DrawBatcher() = default;
+  DrawBatcher(const DrawBatcher&) = delete;
+  DrawBatcher& operator=(const DrawBatcher&) = delete;
+  int init(const DrawBatcherSettings& cfg);
+  int shutdown();
+  int begin_frame();
+  int add(const BatchState& state, const DrawElementsIndirectCommand& command, const void* draw_data);
+  int flush();                                 /* Returns the number of multi draws or < 0 on error; can be called more than once a frame. When the frame is full the groups that fit are drawn and the rest is dropped. */
+  int end_frame();
+
+public:
+  DrawBatcherSettings settings;
+  std::vector<BatchDraw> draws;                /* The draws since the last `flush()`. */
+  std::vector<uint32_t> order;
+  std::vector<uint8_t> data;                   /* CPU copy of the per draw data since the last `flush()`. */
+  GLuint command_buffer = 0;
+  GLuint data_buffer = 0;
+  uint8_t* command_ptr = nullptr;              /* Persistently mapped. */
+  uint8_t* data_ptr = nullptr;
+  std::vector<GLsync> fences;
+  GLint data_alignment = 256;                  /* GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT */
+  uint64_t command_region_size = 0;
+  uint64_t data_region_size = 0;
+  uint32_t frame_index = 0;
+  uint32_t frame_draws = 0;                    /* Commands written in the current region. */
+  uint32_t frame_groups = 0;
+  uint64_t frame_data = 0;                     /* Bytes written in the current data region. */
+  bool is_in_frame = false;
+  uint64_t num_draws = 0;                      /* Stats. */
+  uint64_t num_multi_draws = 0;
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
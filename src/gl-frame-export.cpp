@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <string.h>
+#include <gl-frame-export.h>
+#include <gl-resource.h>
+#include <gl-sync.h>
+
+/* ------------------------------------------------------------- */
+
+static int create_pinned_buffer(uint8_t* ptr, uint64_t size, GLuint& buffer);
+
+/* ------------------------------------------------------------- */
+
+int GlFrameExport::init(const FrameExportSettings& cfg) {
+
+  if (0 != pack_buffer) {
+    printf("Cannot initialize the frame export, already initialized.\n");
+    return -1;
+  }
+
+  if (true == cfg.name.empty() || 0 == cfg.width || 0 == cfg.height) {
+    printf("Cannot initialize the frame export, invalid name or size.\n");
+    return -2;
+  }
+
+  FrameRingSettings ring_cfg;
+  ring_cfg.num_slots = cfg.num_slots;
+  ring_cfg.width = cfg.width;
+  ring_cfg.height = cfg.height;
+  ring_cfg.bytes_per_pixel = 4;
+  ring_cfg.format = GL_RGBA;
+  ring_cfg.type = GL_UNSIGNED_BYTE;
+
+  if (0 != ring.create(cfg.name.c_str(), ring_cfg)) {
+    printf("Failed to create the frame ring of the export.\n");
+    return -3;
+  }
+
+  settings = cfg;
+  stats = FrameExportStats();
+  region_size = ring.header->slot_size;
+  is_pinned = false;
+
+  /* Let the GPU write into the shared memory. */
+  if (true == cfg.use_pinned_memory && 0 != GLAD_GL_AMD_pinned_memory) {
+    is_pinned = (0 == create_pinned_buffer(ring.base, ring.size, pack_buffer));
+  }
+
+  if (true == is_pinned) {
+    return 0;
+  }
+
+  if (0 == GLAD_GL_VERSION_4_4 && 0 == GLAD_GL_ARB_buffer_storage) {
+    printf("Cannot initialize the frame export, we need GL 4.4 or `ARB_buffer_storage` for a persistent mapping.\n");
+    ring.close();
+    return -4;
+  }
+
+  GLbitfield map_flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  GLsizeiptr pack_size = (GLsizeiptr)(region_size * cfg.num_slots);
+  void* ptr = nullptr;
+
+  if (0 != gl_create_buffer(pack_size, nullptr, map_flags | GL_CLIENT_STORAGE_BIT, pack_buffer)) {
+    printf("Failed to create the pack buffer of the frame export.\n");
+    ring.close();
+    return -5;
+  }
+
+  if (0 != gl_map_buffer(pack_buffer, 0, pack_size, map_flags, &ptr)) {
+    printf("Failed to map the pack buffer of the frame export.\n");
+    glDeleteBuffers(1, &pack_buffer);
+    pack_buffer = 0;
+    ring.close();
+    return -6;
+  }
+
+  pack_ptr = (uint8_t*)ptr;
+
+  return 0;
+}
+
+int GlFrameExport::shutdown() {
+
+  int r = 0;
+
+  if (0 == pack_buffer) {
+    return 0;
+  }
+
+  if (0 != flush(1000ull * 1000ull * 1000ull)) {
+    printf("Failed to publish the frames in flight; we drop them.\n");
+    r = -1;
+  }
+
+  /* With pinned memory the GPU writes into the mapping of the ring; it has to be done before we unmap it. */
+  if (true == is_pinned && false == pending.empty()) {
+    glFinish();
+  }
+
+  for (FrameExportPending& p : pending) {
+    glDeleteSync(p.fence);
+    ring.cancel(p.slot);
+  }
+
+  pending.clear();
+
+  if (nullptr != pack_ptr) {
+    gl_unmap_buffer(pack_buffer);
+    pack_ptr = nullptr;
+  }
+
+  glDeleteBuffers(1, &pack_buffer);
+  pack_buffer = 0;
+
+  ring.close();
+
+  return r;
+}
+
+/* ------------------------------------------------------------- */
+
+int GlFrameExport::capture(uint64_t frame) {
+
+  if (0 == pack_buffer) {
+    printf("Cannot capture, not initialized.\n");
+    return -1;
+  }
+
+  uint64_t start_ns = gpu_sync_now_ns();
+  uint32_t slot = FRAME_RING_NONE;
+
+  int r = ring.begin_write(slot);
+  if (r < 0) {
+    return -2;
+  }
+
+  /* The consumer holds every slot; we don't wait for it. */
+  if (1 == r) {
+    stats.num_dropped++;
+    return 1;
+  }
+
+  uint64_t offset = (true == is_pinned) ? ring.header->slots[slot].offset : region_size * slot;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pack_buffer);
+  glReadPixels(0, 0, (GLsizei)settings.width, (GLsizei)settings.height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)(uintptr_t)offset);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  FrameExportPending p;
+  p.slot = slot;
+  p.frame = frame;
+  p.capture_ns = start_ns;
+  p.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  if (nullptr == p.fence) {
+    printf("Failed to create the fence of frame %llu.\n", (unsigned long long)frame);
+    ring.cancel(slot);
+    return -3;
+  }
+
+  /* Without a flush the fence may never reach the GPU and `poll()` would never see it. */
+  glFlush();
+
+  pending.push_back(p);
+  stats.num_captured++;
+
+  uint64_t capture_ns = gpu_sync_now_ns() - start_ns;
+  stats.max_capture_ns = (capture_ns > stats.max_capture_ns) ? capture_ns : stats.max_capture_ns;
+
+  return 0;
+}
+
+int GlFrameExport::poll() {
+
+  int num_published = 0;
+
+  /* The readbacks finish in order; stop at the first that didn't. */
+  while (false == pending.empty()) {
+
+    FrameExportPending& p = pending.front();
+    GLenum status = glClientWaitSync(p.fence, 0, 0);
+
+    if (GL_TIMEOUT_EXPIRED == status) {
+      break;
+    }
+
+    if (GL_WAIT_FAILED == status) {
+      printf("Failed to check the fence of frame %llu.\n", (unsigned long long)p.frame);
+      return -1;
+    }
+
+    glDeleteSync(p.fence);
+
+    if (false == is_pinned) {
+      uint64_t copy_start_ns = gpu_sync_now_ns();
+      memcpy(ring.get_data(p.slot), pack_ptr + region_size * p.slot, (size_t)ring.header->slot_size);
+      stats.total_copy_ns += gpu_sync_now_ns() - copy_start_ns;
+    }
+
+    ring.publish(p.slot, p.frame);
+
+    uint64_t latency_ns = gpu_sync_now_ns() - p.capture_ns;
+    stats.max_latency_ns = (latency_ns > stats.max_latency_ns) ? latency_ns : stats.max_latency_ns;
+    stats.num_published++;
+    num_published++;
+
+    pending.pop_front();
+  }
+
+  return num_published;
+}
+
+int GlFrameExport::flush(uint64_t timeout_ns) {
+
+  uint64_t end_ns = gpu_sync_now_ns() + timeout_ns;
+
+  while (false == pending.empty()) {
+
+    uint64_t now_ns = gpu_sync_now_ns();
+    if (now_ns >= end_ns) {
+      printf("Cannot flush the frame export, timed out with %zu frames in flight.\n", pending.size());
+      return -1;
+    }
+
+    if (GL_WAIT_FAILED == glClientWaitSync(pending.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, end_ns - now_ns)) {
+      printf("Failed to wait for the fence of frame %llu.\n", (unsigned long long)pending.front().frame);
+      return -2;
+    }
+
+    if (poll() < 0) {
+      return -3;
+    }
+  }
+
+  return 0;
+}
+
+void GlFrameExport::print() {
+
+  double num_published = (0 == stats.num_published) ? 1.0 : (double)stats.num_published;
+
+  printf("frame export: %llu captured, %llu dropped, %llu published (%s), %u x %u in %u slots\n",
+         (unsigned long long)stats.num_captured,
+         (unsigned long long)stats.num_dropped,
+         (unsigned long long)stats.num_published,
+         (true == is_pinned) ? "pinned memory, no copy" : "one copy from the pack buffer",
+         settings.width,
+         settings.height,
+         settings.num_slots);
+
+  printf("  avg copy: %.3f ms, max capture: %.3f ms, max latency: %.3f ms\n",
+         stats.total_copy_ns / num_published / 1e6,
+         stats.max_capture_ns / 1e6,
+         stats.max_latency_ns / 1e6);
+}
+
+/* ------------------------------------------------------------- */
+
+/* `GL_AMD_pinned_memory` wants a page aligned pointer; a mapping always is. */
+static int create_pinned_buffer(uint8_t* ptr, uint64_t size, GLuint& buffer) {
+
+  while (GL_NO_ERROR != glGetError()) {
+  }
+
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, buffer);
+  glBufferData(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, (GLsizeiptr)size, ptr, GL_STREAM_READ);
+  glBindBuffer(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, 0);
+
+  if (GL_NO_ERROR != glGetError()) {
+    printf("Failed to pin the shared memory; we use a pack buffer and copy.\n");
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    return -1;
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
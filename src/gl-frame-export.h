@@ -0,0 +1,101 @@
+/*
+
+  GL FRAME EXPORT
+  ================
+
+  Sends rendered frames to another process (e.g. an encoder)
+  through a `SharedFrameRing` (see `shared-frame-ring.h`) instead
+  of `glReadPixels()` into a buffer that is then copied into a
+  socket. The render thread never waits for the GPU or for the
+  consumer:
+
+    exporter.init(cfg);                        // creates the ring, the context must be current
+
+    // every frame, with the framebuffer to export bound to GL_READ_FRAMEBUFFER
+    exporter.capture(frame);
+    exporter.poll();
+
+    exporter.shutdown();
+
+  `capture()` takes a free slot of the ring and starts an
+  asynchronous `glReadPixels()` into a pixel pack buffer, followed
+  by a fence; the fence is stored with the slot. `poll()` checks
+  the fences of the slots in flight without blocking and
+  publishes every slot whose readback finished. When the
+  consumer still holds all slots, `capture()` drops the frame.
+
+  When the driver has `GL_AMD_pinned_memory` the pixel pack
+  buffer is the shared memory itself: the GPU writes into the
+  slots and publishing is only a store. Otherwise the pack buffer
+  is a persistently mapped buffer with a region per slot (client
+  storage, so it's in system memory) and `poll()` copies a
+  finished region into its slot, once; the consumer reads that
+  in place.
+
+  The rows are bottom to top, like GL reads them.
+
+ */
+#ifndef GL_FRAME_EXPORT_H
+#define GL_FRAME_EXPORT_H
+
+#include <stdint.h>
+#include <string>
+#include <deque>
+#include <glad/glad.h>
+#include <gl-state-filter.h>
+#include <shared-frame-ring.h>
+
+/* ----------------------------------------------------------- */
+
+struct FrameExportSettings {
+  std::string name;                            /* Of the ring; "/name" on Linux. */
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t num_slots = 3;
+  bool use_pinned_memory = true;               /* When `GL_AMD_pinned_memory` is supported. */
+};
+
+struct FrameExportPending {
+  uint32_t slot = FRAME_RING_NONE;
+  uint64_t frame = 0;
+  uint64_t capture_ns = 0;
+  GLsync fence = nullptr;
+};
+
+struct FrameExportStats {
+  uint64_t num_captured = 0;
+  uint64_t num_dropped = 0;                    /* No free slot. */
+  uint64_t num_published = 0;
+  uint64_t total_copy_ns = 0;                  /* PBO to slot; 0 with pinned memory. */
+  uint64_t max_capture_ns = 0;                 /* CPU time of `capture()`. */
+  uint64_t max_latency_ns = 0;                 /* `capture()` until published. */
+};
+
+/* ----------------------------------------------------------- */
+
+class GlFrameExport {
+public:
+  GlFrameExport() = default;
+  GlFrameExport(const GlFrameExport&) = delete;
+  GlFrameExport& operator=(const GlFrameExport&) = delete;
+  int init(const FrameExportSettings& cfg);
+  int shutdown();                              /* Waits for the readbacks in flight, publishes them and closes the ring. */
+  int capture(uint64_t frame);                 /* Returns 0 when captured, 1 when dropped, < 0 on error. */
+  int poll();                                  /* Returns the number of published frames or < 0 on error. */
+  int flush(uint64_t timeout_ns);              /* Blocks until all frames in flight are published. */
+  void print();
+
+public:
+  FrameExportSettings settings;
+  SharedFrameRing ring;
+  GLuint pack_buffer = 0;
+  uint8_t* pack_ptr = nullptr;                 /* Persistently mapped; nullptr with pinned memory. */
+  uint64_t region_size = 0;                    /* Per slot in `pack_buffer`. */
+  bool is_pinned = false;
+  std::deque<FrameExportPending> pending;      /* In capture order. */
+  FrameExportStats stats;
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,482 @@
+#include <stdio.h>
+#include <chrono>
+#include <gl-frame-loop.h>
+#include <gl-sync.h>
+
+/* ------------------------------------------------------------- */
+
+#if defined(_WIN32)
+static const char* frame_loop_prop = "GlFrameLoop";
+static LRESULT CALLBACK frame_loop_window_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam);
+#endif
+
+static bool is_coalesced(LoopEventType type);
+
+/* ------------------------------------------------------------- */
+
+GlFrameLoop::~GlFrameLoop() {
+
+  if (true == thread.joinable()) {
+    shutdown();
+  }
+}
+
+int GlFrameLoop::start(GlContext* context) {
+
+  if (nullptr == context) {
+    printf("Cannot start the frame loop, no context given.\n");
+    return -1;
+  }
+
+  if (true == thread.joinable()) {
+    printf("Cannot start the frame loop, already started.\n");
+    return -2;
+  }
+
+  if (!on_frame) {
+    printf("Cannot start the frame loop, `on_frame` isn't set.\n");
+    return -3;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_stopping = false;
+    events.clear();
+  }
+
+  ctx = context;
+  stats = LoopStats();
+  is_running = true;
+
+  std::promise<int> started;
+  std::future<int> result = started.get_future();
+
+  thread = std::thread(&GlFrameLoop::run, this, &started);
+
+  if (0 != result.get()) {
+    printf("Failed to make the context current on the render thread.\n");
+    thread.join();
+    return -4;
+  }
+
+  return 0;
+}
+
+int GlFrameLoop::shutdown() {
+
+  if (false == thread.joinable()) {
+    printf("Cannot shutdown the frame loop, not started.\n");
+    return -1;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_stopping = true;
+  }
+
+  cond.notify_all();
+  thread.join();
+
+#if defined(_WIN32)
+  if (nullptr != hwnd) {
+    detach();
+  }
+#endif
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int GlFrameLoop::post_event(const LoopEvent& event) {
+
+  LoopEvent ev = event;
+  ev.time_ns = gpu_sync_now_ns();
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  stats.num_events++;
+
+  /* Update a queued resize or move; we may only look back past other coalesced events so the order of the rest stays. */
+  if (true == is_coalesced(ev.type)) {
+
+    for (auto it = events.rbegin(); it != events.rend() && true == is_coalesced(it->type); ++it) {
+
+      if (it->type != ev.type) {
+        continue;
+      }
+
+      it->x = ev.x;
+      it->y = ev.y;
+      stats.num_coalesced++;
+
+      return 0;
+    }
+  }
+
+  events.push_back(ev);
+
+  return 0;
+}
+
+#if defined(_WIN32)
+
+int GlFrameLoop::pump() {
+
+  uint64_t start_ns = gpu_sync_now_ns();
+  uint64_t end_ns = start_ns;
+  int r = 0;
+  MSG msg = {};
+
+  while (TRUE == PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+
+    if (WM_QUIT == msg.message) {
+      r = 1;
+      break;
+    }
+
+    TranslateMessage(&msg);
+    DispatchMessage(&msg);
+    stats.num_messages++;
+
+    end_ns = gpu_sync_now_ns();
+    if (end_ns - start_ns >= pump_budget_ns) {
+      stats.num_pump_budget_hits++;
+      break;
+    }
+  }
+
+  end_ns = gpu_sync_now_ns();
+  stats.max_pump_ns = (end_ns - start_ns > stats.max_pump_ns) ? end_ns - start_ns : stats.max_pump_ns;
+
+  return r;
+}
+
+int GlFrameLoop::wait_for_messages(uint64_t timeout_ns) {
+
+  DWORD timeout_ms = (DWORD)((timeout_ns + 999999) / 1000000);
+
+  if (WAIT_FAILED == MsgWaitForMultipleObjects(0, nullptr, FALSE, timeout_ms, QS_ALLINPUT)) {
+    printf("Failed to wait for messages.\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+int GlFrameLoop::inject(const LoopEvent& event) {
+  printf("Cannot inject, on Windows the messages come from the window; use `post_event()`.\n");
+  return -1;
+}
+
+int GlFrameLoop::attach(HWND window) {
+
+  if (nullptr == window) {
+    printf("Cannot attach the frame loop, window is nullptr.\n");
+    return -1;
+  }
+
+  if (nullptr != hwnd) {
+    printf("Cannot attach the frame loop, already attached to a window.\n");
+    return -2;
+  }
+
+  /* A property, not `GWLP_USERDATA`, which belongs to whoever created the window. */
+  if (FALSE == SetPropA(window, frame_loop_prop, (HANDLE)this)) {
+    printf("Failed to set the frame loop property of the window.\n");
+    return -3;
+  }
+
+  prev_proc = (WNDPROC)SetWindowLongPtr(window, GWLP_WNDPROC, (LONG_PTR)frame_loop_window_proc);
+  if (nullptr == prev_proc) {
+    printf("Failed to replace the window procedure.\n");
+    RemovePropA(window, frame_loop_prop);
+    return -4;
+  }
+
+  hwnd = window;
+
+  return 0;
+}
+
+int GlFrameLoop::detach() {
+
+  if (nullptr == hwnd) {
+    printf("Cannot detach the frame loop, not attached.\n");
+    return -1;
+  }
+
+  SetWindowLongPtr(hwnd, GWLP_WNDPROC, (LONG_PTR)prev_proc);
+  RemovePropA(hwnd, frame_loop_prop);
+
+  hwnd = nullptr;
+  prev_proc = nullptr;
+
+  return 0;
+}
+
+#else
+
+/* The stand-in for the OS queue: `inject()` queues, we dispatch to `post_event()` like the window procedure does. */
+int GlFrameLoop::pump() {
+
+  uint64_t start_ns = gpu_sync_now_ns();
+  uint64_t end_ns = start_ns;
+  int r = 0;
+
+  while (true) {
+
+    LoopEvent msg;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (true == messages.empty()) {
+        break;
+      }
+      msg = messages.front();
+      messages.pop_front();
+    }
+
+    post_event(msg);
+    stats.num_messages++;
+
+    if (LOOP_EVENT_CLOSE == msg.type) {
+      r = 1;
+      break;
+    }
+
+    end_ns = gpu_sync_now_ns();
+    if (end_ns - start_ns >= pump_budget_ns) {
+      stats.num_pump_budget_hits++;
+      break;
+    }
+  }
+
+  end_ns = gpu_sync_now_ns();
+  stats.max_pump_ns = (end_ns - start_ns > stats.max_pump_ns) ? end_ns - start_ns : stats.max_pump_ns;
+
+  return r;
+}
+
+int GlFrameLoop::wait_for_messages(uint64_t timeout_ns) {
+
+  std::unique_lock<std::mutex> lock(mutex);
+
+  cond.wait_for(lock, std::chrono::nanoseconds(timeout_ns), [this]() {
+    return false == messages.empty();
+  });
+
+  return 0;
+}
+
+int GlFrameLoop::inject(const LoopEvent& event) {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    messages.push_back(event);
+  }
+
+  cond.notify_all();
+
+  return 0;
+}
+
+#endif
+
+void GlFrameLoop::print() {
+
+  double num_frames = (0 == stats.num_frames) ? 1.0 : (double)stats.num_frames;
+
+  printf("frame loop: %llu frames, %llu messages, %llu events, %llu coalesced, %.2f delivered per frame\n",
+         (unsigned long long)stats.num_frames,
+         (unsigned long long)stats.num_messages,
+         (unsigned long long)stats.num_events,
+         (unsigned long long)stats.num_coalesced,
+         stats.num_delivered / num_frames);
+
+  printf("  max pump: %.3f ms (budget hit %llu times), max frame gap: %.3f ms, max event latency: %.3f ms\n",
+         stats.max_pump_ns / 1e6,
+         (unsigned long long)stats.num_pump_budget_hits,
+         stats.max_frame_gap_ns / 1e6,
+         stats.max_event_latency_ns / 1e6);
+}
+
+/* ------------------------------------------------------------- */
+
+void GlFrameLoop::run(std::promise<int>* started) {
+
+  if (0 != make_context_current(*ctx)) {
+    is_running = false;
+    started->set_value(-1);
+    return;
+  }
+
+  /* Don't touch `started` after this; see `GlWorker::run()`. */
+  started->set_value(0);
+
+  std::vector<LoopEvent> frame_events;
+  uint64_t frame = 0;
+  uint64_t prev_start_ns = 0;
+
+  while (true) {
+
+    uint64_t start_ns = gpu_sync_now_ns();
+    frame_events.clear();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      if (true == is_stopping) {
+        break;
+      }
+
+      while (false == events.empty() && frame_events.size() < max_events_per_frame) {
+        frame_events.push_back(events.front());
+        events.pop_front();
+      }
+    }
+
+    for (const LoopEvent& ev : frame_events) {
+      uint64_t latency_ns = start_ns - ev.time_ns;
+      stats.max_event_latency_ns = (latency_ns > stats.max_event_latency_ns) ? latency_ns : stats.max_event_latency_ns;
+    }
+
+    if (0 != prev_start_ns && start_ns - prev_start_ns > stats.max_frame_gap_ns) {
+      stats.max_frame_gap_ns = start_ns - prev_start_ns;
+    }
+
+    prev_start_ns = start_ns;
+
+    if (false == frame_events.empty() && on_events) {
+      on_events(frame_events);
+    }
+
+    stats.num_delivered += frame_events.size();
+
+    if (0 != on_frame(frame)) {
+      printf("Frame %llu failed; we continue.\n", (unsigned long long)frame);
+    }
+
+    frame++;
+    stats.num_frames = frame;
+
+    uint64_t frame_ns = gpu_sync_now_ns() - start_ns;
+
+    if (frame_ns < min_frame_ns) {
+      std::unique_lock<std::mutex> lock(mutex);
+      cond.wait_for(lock, std::chrono::nanoseconds(min_frame_ns - frame_ns), [this]() {
+        return true == is_stopping;
+      });
+    }
+  }
+
+  release_current_context();
+  is_running = false;
+}
+
+/* ------------------------------------------------------------- */
+
+const char* loop_event_type_to_string(LoopEventType type) {
+
+  switch (type) {
+    case LOOP_EVENT_RESIZE:     { return "resize";     }
+    case LOOP_EVENT_MOUSE_MOVE: { return "mouse move"; }
+    case LOOP_EVENT_MOUSE_DOWN: { return "mouse down"; }
+    case LOOP_EVENT_MOUSE_UP:   { return "mouse up";   }
+    case LOOP_EVENT_KEY_DOWN:   { return "key down";   }
+    case LOOP_EVENT_KEY_UP:     { return "key up";     }
+    case LOOP_EVENT_CLOSE:      { return "close";      }
+    default:                    { return "unknown";    }
+  }
+}
+
+/* ------------------------------------------------------------- */
+
+static bool is_coalesced(LoopEventType type) {
+  return LOOP_EVENT_RESIZE == type || LOOP_EVENT_MOUSE_MOVE == type;
+}
+
+#if defined(_WIN32)
+
+/*
+  Runs on the window thread, also from within the modal loop of
+  a drag. We only post events; the render thread does the work.
+  The window isn't destroyed on `WM_CLOSE` because the render
+  thread still renders into it; destroy it after `shutdown()`.
+  Everything we don't handle goes to the previous procedure.
+*/
+static LRESULT CALLBACK frame_loop_window_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
+
+  GlFrameLoop* loop = reinterpret_cast<GlFrameLoop*>(GetPropA(hwnd, frame_loop_prop));
+  if (nullptr == loop || nullptr == loop->prev_proc) {
+    return DefWindowProc(hwnd, msg, wparam, lparam);
+  }
+
+  LoopEvent ev;
+
+  switch (msg) {
+
+    case WM_SIZE: {
+      ev.type = LOOP_EVENT_RESIZE;
+      ev.x = LOWORD(lparam);
+      ev.y = HIWORD(lparam);
+      loop->post_event(ev);
+      return 0;
+    }
+
+    case WM_MOUSEMOVE: {
+      ev.type = LOOP_EVENT_MOUSE_MOVE;
+      ev.x = (int16_t)LOWORD(lparam);
+      ev.y = (int16_t)HIWORD(lparam);
+      loop->post_event(ev);
+      return 0;
+    }
+
+    case WM_LBUTTONDOWN:
+    case WM_LBUTTONUP: {
+      ev.type = (WM_LBUTTONDOWN == msg) ? LOOP_EVENT_MOUSE_DOWN : LOOP_EVENT_MOUSE_UP;
+      ev.x = (int16_t)LOWORD(lparam);
+      ev.y = (int16_t)HIWORD(lparam);
+      loop->post_event(ev);
+      return 0;
+    }
+
+    case WM_KEYDOWN:
+    case WM_KEYUP: {
+      ev.type = (WM_KEYDOWN == msg) ? LOOP_EVENT_KEY_DOWN : LOOP_EVENT_KEY_UP;
+      ev.key = (uint32_t)wparam;
+      loop->post_event(ev);
+      return 0;
+    }
+
+    case WM_CLOSE: {
+      ev.type = LOOP_EVENT_CLOSE;
+      loop->post_event(ev);
+      PostQuitMessage(0);
+      return 0;
+    }
+
+    /* The render thread paints; tell Windows the window is valid so it stops sending `WM_PAINT`. */
+    case WM_PAINT: {
+      ValidateRect(hwnd, nullptr);
+      return 0;
+    }
+
+    case WM_ERASEBKGND: {
+      return 1;
+    }
+
+    /* The window is going away without `shutdown()`; unhook so the property doesn't outlive it. */
+    case WM_NCDESTROY: {
+      WNDPROC prev_proc = loop->prev_proc;
+      loop->detach();
+      return CallWindowProc(prev_proc, hwnd, msg, wparam, lparam);
+    }
+  }
+
+  return CallWindowProc(loop->prev_proc, hwnd, msg, wparam, lparam);
+}
+
+#endif
+
+/* ------------------------------------------------------------- */
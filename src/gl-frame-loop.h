@@ -0,0 +1,159 @@
+/*
+
+  GL FRAME LOOP
+  ==============
+
+  Runs the frames on a render thread that owns the context of the
+  window, while the thread that owns the window only pumps its
+  messages. A blocking `GetMessage()` loop (like the one in
+  _test-research.cpp_) can't render; and while the user drags or
+  resizes the window, Windows runs its own modal loop inside
+  `DispatchMessage()`, so a loop that renders in between the
+  messages stalls until the mouse is released. With the frames on
+  their own thread, the GPU keeps getting work whatever the
+  window thread does.
+
+    loop.on_events = [](const std::vector<LoopEvent>& events) { ... };
+    loop.on_frame = [&](uint64_t frame) { ... render ...; presenter.present(); return 0; };
+    loop.start(&ctx);                          // `ctx` must not be current
+    loop.attach(hwnd);                         // Windows; routes the window messages to the loop
+
+    while (0 == loop.pump()) {
+      loop.wait_for_messages(10000000);
+    }
+
+    loop.shutdown();
+
+  `pump()` drains the messages of the calling thread with
+  `PeekMessage()`, but for at most `pump_budget_ns`; whatever is
+  left stays in the queue for the next call. It returns 1 once
+  the window was closed or `WM_QUIT` was posted.
+
+  The window procedure (see `attach()`) turns the messages into
+  `LoopEvent`s and posts them to the render thread. Resizes and
+  mouse moves are coalesced: a new resize updates a resize that
+  is still queued instead of queuing another one (same for mouse
+  moves), but it only looks back past other resizes and mouse
+  moves. Keys, buttons and close events are never coalesced and
+  keep their order, so each of them that arrives in between
+  starts a new resize. A drag with only resizes costs the render
+  thread one resize per frame; in _test-frame-loop.cpp_, which
+  posts a key after every 500 resizes, about a million resizes
+  arrive as a few thousand, some 15 per frame. The render thread
+  takes at most `max_events_per_frame` events per frame and
+  calls `on_events` before `on_frame`.
+
+  `attach()` subclasses the window: it stores the loop in a
+  window property and calls the previous window procedure for
+  every message it doesn't handle. `detach()` (also called by
+  `shutdown()`) puts the previous procedure back.
+
+  There is no window system in this repository on Linux (the
+  contexts render into a pbuffer), so there the "messages" are
+  the events passed to `inject()`, which stands in for the OS
+  queue; `pump()` drains and dispatches them the same way. Both
+  platforms can also call `post_event()` directly, which is what
+  the window procedure does.
+
+  The frame rate is up to `on_frame`: with a vsynced presenter
+  (see `gl-presenter.h`) the swap paces the loop. Set
+  `min_frame_ns` to cap it otherwise.
+
+ */
+#ifndef GL_FRAME_LOOP_H
+#define GL_FRAME_LOOP_H
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <condition_variable>
+#include <gl-context.h>
+
+/* ----------------------------------------------------------- */
+
+enum LoopEventType {
+  LOOP_EVENT_RESIZE,                           /* Coalesced; `x` and `y` are the new size. */
+  LOOP_EVENT_MOUSE_MOVE,                       /* Coalesced; `x` and `y` are the position. */
+  LOOP_EVENT_MOUSE_DOWN,                       /* `key` is the button. */
+  LOOP_EVENT_MOUSE_UP,
+  LOOP_EVENT_KEY_DOWN,                         /* `key` is the virtual key code. */
+  LOOP_EVENT_KEY_UP,
+  LOOP_EVENT_CLOSE,                            /* `pump()` returns 1 when it dispatched this. */
+};
+
+struct LoopEvent {
+  LoopEventType type = LOOP_EVENT_RESIZE;
+  int32_t x = 0;
+  int32_t y = 0;
+  uint32_t key = 0;
+  uint64_t time_ns = 0;                        /* When it was posted (first posted, for coalesced events). */
+};
+
+struct LoopStats {
+  uint64_t num_frames = 0;
+  uint64_t num_events = 0;                     /* Posted. */
+  uint64_t num_coalesced = 0;
+  uint64_t num_delivered = 0;                  /* Passed to `on_events`. */
+  uint64_t num_messages = 0;                   /* Dispatched by `pump()`. */
+  uint64_t num_pump_budget_hits = 0;           /* `pump()` returned with messages left. */
+  uint64_t max_pump_ns = 0;
+  uint64_t max_frame_gap_ns = 0;               /* The longest time between the start of two frames. */
+  uint64_t max_event_latency_ns = 0;           /* Posted until delivered. */
+};
+
+/* ----------------------------------------------------------- */
+
+class GlFrameLoop {
+public:
+  GlFrameLoop() = default;
+  GlFrameLoop(const GlFrameLoop&) = delete;
+  GlFrameLoop& operator=(const GlFrameLoop&) = delete;
+  ~GlFrameLoop();
+  int start(GlContext* ctx);                   /* Starts the render thread which makes `ctx` current. */
+  int shutdown();                              /* Stops and joins the render thread. */
+  int pump();                                  /* Window thread: 0 = ok, 1 = closed, < 0 on error. */
+  int wait_for_messages(uint64_t timeout_ns);  /* Window thread: blocks until there are messages or the timeout passed. */
+  int post_event(const LoopEvent& event);      /* Any thread. */
+  int inject(const LoopEvent& event);          /* Linux: queues a platform message for `pump()`. */
+  void print();
+#if defined(_WIN32)
+  int attach(HWND hwnd);                       /* Subclasses `hwnd`; unhandled messages go to its previous window procedure. */
+  int detach();                                /* Puts the previous window procedure back. */
+#endif
+
+public:
+  GlContext* ctx = nullptr;
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<LoopEvent> events;                /* Posted, not taken by the render thread yet; protected by `mutex`. */
+  std::deque<LoopEvent> messages;              /* Linux: the stand-in for the OS queue; protected by `mutex`. */
+  std::function<void(const std::vector<LoopEvent>& events)> on_events; /* Render thread; set before `start()`. */
+  std::function<int(uint64_t frame)> on_frame; /* Render thread; set before `start()`. */
+  uint64_t pump_budget_ns = 2000000;
+  uint32_t max_events_per_frame = 64;
+  uint64_t min_frame_ns = 0;
+  std::atomic<bool> is_running{false};
+  bool is_stopping = false;                    /* Protected by `mutex`. */
+  LoopStats stats;                             /* Only read after `shutdown()`. */
+#if defined(_WIN32)
+  HWND hwnd = nullptr;
+  WNDPROC prev_proc = nullptr;                 /* The window procedure `attach()` replaced. */
+#endif
+
+private:
+  void run(std::promise<int>* started);
+};
+
+/* ----------------------------------------------------------- */
+
+const char* loop_event_type_to_string(LoopEventType type);
+
+/* ----------------------------------------------------------- */
+
+#endif
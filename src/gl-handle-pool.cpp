@@ -0,0 +1,212 @@
+#include <gl-handle-pool.h>
+
+/* ------------------------------------------------------------- */
+
+int TexturePool::create(
+  GLuint name,
+  GLenum target,
+  GLenum internal_format,
+  GLsizei width,
+  GLsizei height,
+  const GlContext* owner,
+  TextureHandle& handle
+)
+{
+  if (0 == name) {
+    printf("Cannot create a texture handle, invalid name.\n");
+    return -1;
+  }
+
+  if (0 != create_slot(handle)) {
+    return -2;
+  }
+
+  names.push_back(name);
+  targets.push_back(target);
+  internal_formats.push_back(internal_format);
+  widths.push_back(width);
+  heights.push_back(height);
+  owners.push_back(owner);
+
+  return 0;
+}
+
+int TexturePool::destroy(TextureHandle handle, GLuint& name) {
+
+  uint32_t dense = 0;
+
+  name = 0;
+
+  if (0 != destroy_slot(handle, dense)) {
+    printf("Cannot destroy the texture handle, it's stale.\n");
+    return -1;
+  }
+
+  name = names[dense];
+
+  swap_remove(names, dense);
+  swap_remove(targets, dense);
+  swap_remove(internal_formats, dense);
+  swap_remove(widths, dense);
+  swap_remove(heights, dense);
+  swap_remove(owners, dense);
+
+  return 0;
+}
+
+GLuint TexturePool::get_name(TextureHandle handle) const {
+  uint32_t dense = lookup(handle);
+  return (HANDLE_NONE == dense) ? 0 : names[dense];
+}
+
+/* ------------------------------------------------------------- */
+
+int BufferPool::create(GLuint name, GLsizeiptr size, GLbitfield flag, const GlContext* owner, BufferHandle& handle) {
+
+  if (0 == name) {
+    printf("Cannot create a buffer handle, invalid name.\n");
+    return -1;
+  }
+
+  if (0 != create_slot(handle)) {
+    return -2;
+  }
+
+  names.push_back(name);
+  sizes.push_back(size);
+  flags.push_back(flag);
+  owners.push_back(owner);
+
+  return 0;
+}
+
+int BufferPool::destroy(BufferHandle handle, GLuint& name) {
+
+  uint32_t dense = 0;
+
+  name = 0;
+
+  if (0 != destroy_slot(handle, dense)) {
+    printf("Cannot destroy the buffer handle, it's stale.\n");
+    return -1;
+  }
+
+  name = names[dense];
+
+  swap_remove(names, dense);
+  swap_remove(sizes, dense);
+  swap_remove(flags, dense);
+  swap_remove(owners, dense);
+
+  return 0;
+}
+
+GLuint BufferPool::get_name(BufferHandle handle) const {
+  uint32_t dense = lookup(handle);
+  return (HANDLE_NONE == dense) ? 0 : names[dense];
+}
+
+/* ------------------------------------------------------------- */
+
+int ProgramPool::create(GLuint name, const GlContext* owner, ProgramHandle& handle) {
+
+  if (0 == name) {
+    printf("Cannot create a program handle, invalid name.\n");
+    return -1;
+  }
+
+  if (0 != create_slot(handle)) {
+    return -2;
+  }
+
+  names.push_back(name);
+  owners.push_back(owner);
+
+  return 0;
+}
+
+int ProgramPool::destroy(ProgramHandle handle, GLuint& name) {
+
+  uint32_t dense = 0;
+
+  name = 0;
+
+  if (0 != destroy_slot(handle, dense)) {
+    printf("Cannot destroy the program handle, it's stale.\n");
+    return -1;
+  }
+
+  name = names[dense];
+
+  swap_remove(names, dense);
+  swap_remove(owners, dense);
+
+  return 0;
+}
+
+GLuint ProgramPool::get_name(ProgramHandle handle) const {
+  uint32_t dense = lookup(handle);
+  return (HANDLE_NONE == dense) ? 0 : names[dense];
+}
+
+/* ------------------------------------------------------------- */
+
+int FramebufferPool::create(GLuint name, GLsizei width, GLsizei height, const GlContext* owner, FramebufferHandle& handle) {
+
+  if (0 == name) {
+    printf("Cannot create a framebuffer handle, invalid name.\n");
+    return -1;
+  }
+
+  if (0 != create_slot(handle)) {
+    return -2;
+  }
+
+  names.push_back(name);
+  widths.push_back(width);
+  heights.push_back(height);
+  owners.push_back(owner);
+
+  return 0;
+}
+
+int FramebufferPool::destroy(FramebufferHandle handle, GLuint& name) {
+
+  uint32_t dense = 0;
+
+  name = 0;
+
+  if (0 != destroy_slot(handle, dense)) {
+    printf("Cannot destroy the framebuffer handle, it's stale.\n");
+    return -1;
+  }
+
+  name = names[dense];
+
+  swap_remove(names, dense);
+  swap_remove(widths, dense);
+  swap_remove(heights, dense);
+  swap_remove(owners, dense);
+
+  return 0;
+}
+
+GLuint FramebufferPool::get_name(FramebufferHandle handle, const GlContext* current) const {
+
+  uint32_t dense = lookup(handle);
+  if (HANDLE_NONE == dense) {
+    return 0;
+  }
+
+  /* Checked in every build, so a wrong context gets 0 in release builds too. */
+  if (current != owners[dense]) {
+#if GL_HANDLE_DEBUG
+    printf("Framebuffer %u is used in a context that didn't create it; framebuffers aren't shared.\n", names[dense]);
+#endif
+    return 0;
+  }
+
+  return names[dense];
+}
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,280 @@
+/*
+
+  GL HANDLE POOL
+  ===============
+
+  Raw `GLuint` names don't tell you when an object was deleted
+  (possibly by another context of the share group) and the name
+  was reused by the driver. Instead we hand out typed handles:
+
+    TextureHandle tex;
+    textures.create(name, GL_TEXTURE_2D, GL_RGBA8, 256, 256, &ctx, tex);
+    ...
+    GLuint name = textures.get_name(tex);   // 0 when `tex` is stale
+
+  A handle is 32 bits: the lower `HANDLE_INDEX_BITS` are the
+  index of a slot, the upper bits are the generation of that
+  slot. Destroying a handle increments the generation of its
+  slot, so every copy of the old handle becomes stale. The value
+  0 is never a valid handle.
+
+  The metadata (name, size, format, owning context, ...) is
+  stored in separate arrays (SoA) that are kept dense: when an
+  object is destroyed the last element is moved into its place.
+  A sparse array maps the index of a handle to the dense
+  position, so a lookup is two array reads and a compare; no
+  hashing. Iterating over all live objects walks the dense
+  arrays.
+
+  Lookups always validate the generation and `FramebufferPool`
+  always checks that a framebuffer is only used in the context
+  that created it. In debug builds (`GL_HANDLE_DEBUG`, on when
+  `NDEBUG` isn't defined) these failed lookups are logged too.
+
+  The pools don't call GL; they only track the names. They are
+  not thread safe.
+
+ */
+#ifndef GL_HANDLE_POOL_H
+#define GL_HANDLE_POOL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <glad/glad.h>
+
+/* ----------------------------------------------------------- */
+
+#if !defined(GL_HANDLE_DEBUG) && !defined(NDEBUG)
+#  define GL_HANDLE_DEBUG 1
+#endif
+
+#define HANDLE_INDEX_BITS 20
+#define HANDLE_INDEX_MASK ((1u << HANDLE_INDEX_BITS) - 1u)
+#define HANDLE_GENERATION_MASK ((1u << (32 - HANDLE_INDEX_BITS)) - 1u)
+#define HANDLE_NONE 0xFFFFFFFFu
+
+/* ----------------------------------------------------------- */
+
+class GlContext;
+
+template<typename Tag>
+struct GlHandle {
+  uint32_t index() const { return value & HANDLE_INDEX_MASK; }
+  uint32_t generation() const { return value >> HANDLE_INDEX_BITS; }
+  bool is_null() const { return 0 == value; }
+  bool operator==(const GlHandle& other) const { return value == other.value; }
+  bool operator!=(const GlHandle& other) const { return value != other.value; }
+
+  uint32_t value = 0;
+};
+
+struct TextureTag {};
+struct BufferTag {};
+struct ProgramTag {};
+struct FramebufferTag {};
+
+typedef GlHandle<TextureTag> TextureHandle;
+typedef GlHandle<BufferTag> BufferHandle;
+typedef GlHandle<ProgramTag> ProgramHandle;
+typedef GlHandle<FramebufferTag> FramebufferHandle;
+
+/* ----------------------------------------------------------- */
+
+/*
+  Keeps track of the slots; the typed pools below add the
+  metadata arrays. `create_slot()` appends one dense element,
+  the pool must `push_back()` its arrays. `destroy_slot()` moves
+  the last dense element into `dense`; the pool must do the same
+  with `swap_remove()`.
+*/
+template<typename Tag>
+class HandlePool {
+public:
+  uint32_t size() const { return (uint32_t)dense_to_index.size(); }
+  uint32_t lookup(GlHandle<Tag> handle) const; /* Returns the dense position or HANDLE_NONE. */
+  bool is_alive(GlHandle<Tag> handle) const;
+  GlHandle<Tag> get_handle(uint32_t dense) const;
+
+public:
+  std::vector<uint32_t> generations;           /* Per index. */
+  std::vector<uint32_t> sparse;                /* Index -> dense position. */
+  std::vector<uint32_t> dense_to_index;
+  std::vector<uint32_t> free_indices;
+  mutable uint64_t num_stale = 0;              /* How often a stale handle was used. */
+
+protected:
+  int create_slot(GlHandle<Tag>& handle);
+  int destroy_slot(GlHandle<Tag> handle, uint32_t& dense);
+};
+
+/* ----------------------------------------------------------- */
+
+template<typename T>
+inline void swap_remove(std::vector<T>& values, uint32_t dx) {
+  values[dx] = values.back();
+  values.pop_back();
+}
+
+/* ----------------------------------------------------------- */
+
+class TexturePool : public HandlePool<TextureTag> {
+public:
+  int create(GLuint name, GLenum target, GLenum internal_format, GLsizei width, GLsizei height, const GlContext* owner, TextureHandle& handle);
+  int destroy(TextureHandle handle, GLuint& name);  /* Gives back the name so you can delete (or queue) it. */
+  GLuint get_name(TextureHandle handle) const;      /* 0 when stale. */
+
+public:
+  std::vector<GLuint> names;
+  std::vector<GLenum> targets;
+  std::vector<GLenum> internal_formats;
+  std::vector<GLsizei> widths;
+  std::vector<GLsizei> heights;
+  std::vector<const GlContext*> owners;
+};
+
+class BufferPool : public HandlePool<BufferTag> {
+public:
+  int create(GLuint name, GLsizeiptr size, GLbitfield flags, const GlContext* owner, BufferHandle& handle);
+  int destroy(BufferHandle handle, GLuint& name);
+  GLuint get_name(BufferHandle handle) const;
+
+public:
+  std::vector<GLuint> names;
+  std::vector<GLsizeiptr> sizes;
+  std::vector<GLbitfield> flags;               /* Storage flags or usage. */
+  std::vector<const GlContext*> owners;
+};
+
+class ProgramPool : public HandlePool<ProgramTag> {
+public:
+  int create(GLuint name, const GlContext* owner, ProgramHandle& handle);
+  int destroy(ProgramHandle handle, GLuint& name);
+  GLuint get_name(ProgramHandle handle) const;
+
+public:
+  std::vector<GLuint> names;
+  std::vector<const GlContext*> owners;
+};
+
+/* Framebuffers aren't shared between contexts; pass the current context to `get_name()`. */
+class FramebufferPool : public HandlePool<FramebufferTag> {
+public:
+  int create(GLuint name, GLsizei width, GLsizei height, const GlContext* owner, FramebufferHandle& handle);
+  int destroy(FramebufferHandle handle, GLuint& name);
+  GLuint get_name(FramebufferHandle handle, const GlContext* current) const;
+
+public:
+  std::vector<GLuint> names;
+  std::vector<GLsizei> widths;
+  std::vector<GLsizei> heights;
+  std::vector<const GlContext*> owners;
+};
+
+/* ----------------------------------------------------------- */
+
+template<typename Tag>
+uint32_t HandlePool<Tag>::lookup(GlHandle<Tag> handle) const {
+
+  if (true == handle.is_null()) {
+    return HANDLE_NONE;
+  }
+
+  uint32_t dx = handle.index();
+
+  if (dx >= generations.size() || generations[dx] != handle.generation()) {
+    num_stale++;
+#if GL_HANDLE_DEBUG
+    printf("Stale handle; index: %u, generation: %u, current generation: %u.\n",
+           dx,
+           handle.generation(),
+           (dx < generations.size()) ? generations[dx] : 0u);
+#endif
+    return HANDLE_NONE;
+  }
+
+  return sparse[dx];
+}
+
+template<typename Tag>
+bool HandlePool<Tag>::is_alive(GlHandle<Tag> handle) const {
+
+  uint32_t dx = handle.index();
+
+  return false == handle.is_null()
+    && dx < generations.size()
+    && generations[dx] == handle.generation();
+}
+
+template<typename Tag>
+GlHandle<Tag> HandlePool<Tag>::get_handle(uint32_t dense) const {
+
+  GlHandle<Tag> handle;
+
+  if (dense < dense_to_index.size()) {
+    uint32_t dx = dense_to_index[dense];
+    handle.value = (generations[dx] << HANDLE_INDEX_BITS) | dx;
+  }
+
+  return handle;
+}
+
+template<typename Tag>
+int HandlePool<Tag>::create_slot(GlHandle<Tag>& handle) {
+
+  uint32_t dx = 0;
+
+  if (false == free_indices.empty()) {
+    dx = free_indices.back();
+    free_indices.pop_back();
+  }
+  else {
+
+    if (generations.size() > HANDLE_INDEX_MASK) {
+      printf("Cannot create a handle, the pool is full.\n");
+      return -1;
+    }
+
+    dx = (uint32_t)generations.size();
+    generations.push_back(1);
+    sparse.push_back(HANDLE_NONE);
+  }
+
+  sparse[dx] = (uint32_t)dense_to_index.size();
+  dense_to_index.push_back(dx);
+  handle.value = (generations[dx] << HANDLE_INDEX_BITS) | dx;
+
+  return 0;
+}
+
+template<typename Tag>
+int HandlePool<Tag>::destroy_slot(GlHandle<Tag> handle, uint32_t& dense) {
+
+  dense = lookup(handle);
+  if (HANDLE_NONE == dense) {
+    return -1;
+  }
+
+  uint32_t dx = handle.index();
+  uint32_t last = (uint32_t)dense_to_index.size() - 1;
+  uint32_t moved = dense_to_index[last];
+
+  dense_to_index[dense] = moved;
+  sparse[moved] = dense;
+  dense_to_index.pop_back();
+  sparse[dx] = HANDLE_NONE;
+
+  /* Generation 0 is never used so the value 0 stays invalid. */
+  generations[dx] = (generations[dx] + 1) & HANDLE_GENERATION_MASK;
+  if (0 == generations[dx]) {
+    generations[dx] = 1;
+  }
+
+  free_indices.push_back(dx);
+
+  return 0;
+}
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,400 @@
+#include <stdio.h>
+#include <gl-memory-monitor.h>
+
+/* ------------------------------------------------------------- */
+
+GlMemoryMonitor::GlMemoryMonitor() {
+
+  for (uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+    current_bytes[i] = 0;
+    peak_bytes[i] = 0;
+    evicted_bytes[i] = 0;
+  }
+}
+
+int GlMemoryMonitor::start(GlContext* shared) {
+
+  if (nullptr == shared) {
+    printf("Cannot start the memory monitor, no context given to share with.\n");
+    return -1;
+  }
+
+  if (true == worker.thread.joinable()) {
+    printf("Cannot start the memory monitor, already started.\n");
+    return -2;
+  }
+
+  /* The worker context joins the share group, so it must be created like the others. */
+  worker.ctx.mode = shared->mode;
+  worker.ctx.reset = shared->reset;
+  worker.idle_interval_ns = poll_interval_ns;
+  worker.idle_task = [this]() {
+    poll();
+  };
+
+  if (0 != worker.start(shared)) {
+    printf("Failed to start the memory monitor worker.\n");
+    return -3;
+  }
+
+  return 0;
+}
+
+int GlMemoryMonitor::shutdown() {
+
+  if (false == worker.thread.joinable()) {
+    printf("Cannot shutdown the memory monitor, not started.\n");
+    return -1;
+  }
+
+  if (0 != worker.shutdown()) {
+    printf("Failed to shutdown the memory monitor worker.\n");
+    return -2;
+  }
+
+  return 0;
+}
+
+int GlMemoryMonitor::poll() {
+
+  MemorySource source = MEMORY_SOURCE_NONE;
+  uint64_t total = 0;
+  uint64_t available = 0;
+  uint64_t evicted = 0;
+  uint64_t num_evictions = 0;
+
+  if (false == is_source_detected) {
+
+    if (0 != GLAD_GL_NVX_gpu_memory_info) {
+      source = MEMORY_SOURCE_NVX;
+    }
+    else if (0 != GLAD_GL_ATI_meminfo) {
+      source = MEMORY_SOURCE_ATI;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    driver.source = source;
+    is_source_detected = true;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    source = driver.source;
+    total = driver.driver_total_bytes;
+  }
+
+  /* All values are in KB. */
+  if (MEMORY_SOURCE_NVX == source) {
+
+    GLint dedicated_kb = 0;
+    GLint available_kb = 0;
+    GLint evicted_kb = 0;
+    GLint count = 0;
+
+    glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &dedicated_kb);
+    glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &available_kb);
+    glGetIntegerv(GL_GPU_MEMORY_INFO_EVICTED_MEMORY_NVX, &evicted_kb);
+    glGetIntegerv(GL_GPU_MEMORY_INFO_EVICTION_COUNT_NVX, &count);
+
+    total = (uint64_t)dedicated_kb * 1024ull;
+    available = (uint64_t)available_kb * 1024ull;
+    evicted = (uint64_t)evicted_kb * 1024ull;
+    num_evictions = (uint64_t)count;
+  }
+  else if (MEMORY_SOURCE_ATI == source) {
+
+    /* Total free, largest free block, total auxiliary free, largest auxiliary free block. */
+    GLint free_kb[4] = { 0 };
+    glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, free_kb);
+
+    available = (uint64_t)free_kb[0] * 1024ull;
+
+    if (0 == total) {
+      total = available + total_current_bytes.load();
+    }
+  }
+
+  /* The pressure is the highest of ours and the driver's. */
+  uint64_t used = total_current_bytes.load();
+  uint64_t bytes_to_free = 0;
+  double ratio = 0.0;
+
+  if (0 != budget_bytes) {
+
+    uint64_t limit = (uint64_t)(warning_ratio * budget_bytes);
+    ratio = (double)used / budget_bytes;
+
+    if (used > limit) {
+      bytes_to_free = used - limit;
+    }
+  }
+
+  if (0 != total) {
+
+    uint64_t driver_used = (total > available) ? (total - available) : 0;
+    uint64_t limit = (uint64_t)(warning_ratio * total);
+    double driver_ratio = (double)driver_used / total;
+
+    if (driver_ratio > ratio) {
+      ratio = driver_ratio;
+    }
+
+    if (driver_used > limit && driver_used - limit > bytes_to_free) {
+      bytes_to_free = driver_used - limit;
+    }
+  }
+
+  MemoryPressureEvent ev;
+  ev.ratio = ratio;
+  ev.bytes_to_free = bytes_to_free;
+
+  if (ratio >= critical_ratio) {
+    ev.pressure = MEMORY_PRESSURE_CRITICAL;
+  }
+  else if (ratio >= warning_ratio) {
+    ev.pressure = MEMORY_PRESSURE_WARNING;
+  }
+
+  bool is_event = false;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    is_event = (MEMORY_PRESSURE_NONE != ev.pressure || MEMORY_PRESSURE_NONE != driver.pressure);
+
+    driver.pressure = ev.pressure;
+    driver.ratio = ratio;
+    driver.budget_bytes = budget_bytes;
+    driver.driver_total_bytes = total;
+    driver.driver_available_bytes = available;
+    driver.driver_evicted_bytes = evicted;
+    driver.driver_num_evictions = num_evictions;
+    driver.num_polls++;
+
+    if (true == is_event) {
+      driver.num_pressure_events++;
+    }
+  }
+
+  if (true == is_event && on_pressure) {
+    on_pressure(ev);
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+void GlMemoryMonitor::add(MemoryCategory category, uint64_t bytes) {
+
+  if (category >= MEMORY_CATEGORY_COUNT) {
+    printf("Cannot add to the memory monitor, invalid category.\n");
+    return;
+  }
+
+  update_peak(peak_bytes[category], current_bytes[category].fetch_add(bytes) + bytes);
+  update_peak(total_peak_bytes, total_current_bytes.fetch_add(bytes) + bytes);
+}
+
+int GlMemoryMonitor::remove(MemoryCategory category, uint64_t bytes) {
+
+  if (category >= MEMORY_CATEGORY_COUNT) {
+    printf("Cannot remove from the memory monitor, invalid category.\n");
+    return -1;
+  }
+
+  /* Removing more than was added (twice, or with another category) would wrap the totals around. */
+  uint64_t prev = current_bytes[category].load();
+
+  do {
+    if (bytes > prev) {
+      printf("Cannot remove %llu bytes from the memory monitor, only %llu bytes of `%s` are tracked.\n",
+             (unsigned long long)bytes,
+             (unsigned long long)prev,
+             memory_category_to_string(category));
+      return -2;
+    }
+  } while (false == current_bytes[category].compare_exchange_weak(prev, prev - bytes));
+
+  total_current_bytes.fetch_sub(bytes);
+
+  return 0;
+}
+
+int GlMemoryMonitor::evict(MemoryCategory category, uint64_t bytes) {
+
+  if (category >= MEMORY_CATEGORY_COUNT) {
+    printf("Cannot evict from the memory monitor, invalid category.\n");
+    return -1;
+  }
+
+  if (0 != remove(category, bytes)) {
+    return -2;
+  }
+
+  evicted_bytes[category].fetch_add(bytes);
+
+  return 0;
+}
+
+void GlMemoryMonitor::update_peak(std::atomic<uint64_t>& peak, uint64_t value) {
+
+  uint64_t prev = peak.load();
+
+  while (value > prev && false == peak.compare_exchange_weak(prev, value)) {
+  }
+}
+
+/* ------------------------------------------------------------- */
+
+void GlMemoryMonitor::get_stats(GpuMemoryStats& stats) {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats = driver;
+  }
+
+  stats.total_evicted_bytes = 0;
+
+  for (uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+    stats.current_bytes[i] = current_bytes[i].load();
+    stats.peak_bytes[i] = peak_bytes[i].load();
+    stats.evicted_bytes[i] = evicted_bytes[i].load();
+    stats.total_evicted_bytes += stats.evicted_bytes[i];
+  }
+
+  stats.total_current_bytes = total_current_bytes.load();
+  stats.total_peak_bytes = total_peak_bytes.load();
+}
+
+void GlMemoryMonitor::print() {
+
+  GpuMemoryStats stats;
+  get_stats(stats);
+
+  const char* sources[] = { "none", "GL_NVX_gpu_memory_info", "GL_ATI_meminfo" };
+  const double mb = 1024.0 * 1024.0;
+
+  printf("memory\n");
+  printf("  source: %s, pressure: %s (%.2f), polls: %llu, pressure events: %llu\n",
+         sources[stats.source],
+         memory_pressure_to_string(stats.pressure),
+         stats.ratio,
+         (unsigned long long)stats.num_polls,
+         (unsigned long long)stats.num_pressure_events);
+
+  if (MEMORY_SOURCE_NONE != stats.source) {
+    printf("  driver: total %.1f, available %.1f, evicted %.1f (%llu times)\n",
+           stats.driver_total_bytes / mb,
+           stats.driver_available_bytes / mb,
+           stats.driver_evicted_bytes / mb,
+           (unsigned long long)stats.driver_num_evictions);
+  }
+
+  printf("  %-16s %10s %10s %10s\n", "category", "current", "peak", "evicted");
+
+  for (uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+    printf("  %-16s %10.1f %10.1f %10.1f\n",
+           memory_category_to_string((MemoryCategory)i),
+           stats.current_bytes[i] / mb,
+           stats.peak_bytes[i] / mb,
+           stats.evicted_bytes[i] / mb);
+  }
+
+  printf("  %-16s %10.1f %10.1f %10.1f\n",
+         "total",
+         stats.total_current_bytes / mb,
+         stats.total_peak_bytes / mb,
+         stats.total_evicted_bytes / mb);
+
+  printf("  (all sizes in MB, budget %.1f)\n", stats.budget_bytes / mb);
+}
+
+/* ------------------------------------------------------------- */
+
+/* `depth` is the number of layers (or slices); we don't halve it per level. */
+uint64_t memory_texture_bytes(GLenum internal_format, GLsizei width, GLsizei height, GLsizei depth, GLsizei levels) {
+
+  uint64_t texel_bytes = 4;
+  uint64_t block_bytes = 0;
+  uint64_t total = 0;
+
+  switch (internal_format) {
+    case GL_R8:                                  { texel_bytes = 1;  break; }
+    case GL_RG8:
+    case GL_R16:
+    case GL_R16F:                                { texel_bytes = 2;  break; }
+    case GL_RGB16:
+    case GL_RGB16F:
+    case GL_RGB16I:
+    case GL_RGB16UI:                             { texel_bytes = 6;  break; }
+    case GL_RGBA16:
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:                   { texel_bytes = 8;  break; }
+    case GL_RGB32F:
+    case GL_RGB32I:
+    case GL_RGB32UI:                             { texel_bytes = 12; break; }
+    case GL_RGBA32F:                             { texel_bytes = 16; break; }
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RED_RGTC1:                { block_bytes = 8;  break; }
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RG_RGTC2:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+    case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:  { block_bytes = 16; break; }
+    default:                                     { texel_bytes = 4;  break; } /* RGBA8, RGB8 (padded), depth, RGB10_A2, ... */
+  }
+
+  if (0 >= width || 0 >= height) {
+    return 0;
+  }
+
+  if (0 >= depth) {
+    depth = 1;
+  }
+
+  if (0 >= levels) {
+    levels = 1;
+  }
+
+  for (GLsizei i = 0; i < levels; ++i) {
+
+    if (0 != block_bytes) {
+      total += ((width + 3) / 4) * ((height + 3) / 4) * block_bytes * depth;
+    }
+    else {
+      total += (uint64_t)width * height * texel_bytes * depth;
+    }
+
+    width = (width > 1) ? width / 2 : 1;
+    height = (height > 1) ? height / 2 : 1;
+  }
+
+  return total;
+}
+
+const char* memory_category_to_string(MemoryCategory category) {
+
+  switch (category) {
+    case MEMORY_TEXTURE:       { return "texture";       }
+    case MEMORY_BUFFER:        { return "buffer";        }
+    case MEMORY_RENDER_TARGET: { return "render target"; }
+    case MEMORY_OTHER:         { return "other";         }
+    default:                   { return "unknown";       }
+  }
+}
+
+const char* memory_pressure_to_string(MemoryPressure pressure) {
+
+  switch (pressure) {
+    case MEMORY_PRESSURE_NONE:     { return "none";     }
+    case MEMORY_PRESSURE_WARNING:  { return "warning";  }
+    case MEMORY_PRESSURE_CRITICAL: { return "critical"; }
+    default:                       { return "unknown";  }
+  }
+}
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,161 @@
+/*
+
+  GL MEMORY MONITOR
+  ==================
+
+  Tracks how much GPU memory we use and tells the texture cache
+  (or whoever owns a lot of memory) to evict before the driver
+  starts paging.
+
+    GlMemoryMonitor monitor;
+    monitor.budget_bytes = 2048ull * 1024ull * 1024ull;
+    monitor.on_pressure = [&](const MemoryPressureEvent& ev) {
+      cache.request_eviction(ev.bytes_to_free);  // on the monitor thread
+    };
+    monitor.start(&main);                        // `main` must not be current
+
+    gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, 1024, 1024, 0, tex);
+    monitor.add(MEMORY_TEXTURE, memory_texture_bytes(GL_RGBA8, 1024, 1024, 1, 1));
+    ...
+    monitor.evict(MEMORY_TEXTURE, bytes);        // the cache evicted it
+    monitor.shutdown();
+
+  There are two sources of information:
+
+  - what we allocate ourselves: call `add()` / `remove()` with a
+    category when you create / delete a texture, buffer, render
+    target, ...; or `evict()` when you deleted it because of
+    memory pressure. These can be called from any thread. We keep
+    the current, peak and evicted bytes per category. `remove()`
+    and `evict()` fail when you remove more than is tracked for
+    the category, e.g. when you remove a texture twice.
+
+  - what the driver tells us: `GL_NVX_gpu_memory_info` (dedicated
+    and available video memory, plus what the driver evicted) or
+    `GL_ATI_meminfo` (free texture memory). The driver numbers
+    include what other processes use. Many drivers have neither,
+    e.g. llvmpipe; then only our own allocations count.
+
+  `start()` creates a `GlWorker` (see `gl-worker.h`) whose
+  context shares with the given one and uses its idle task to
+  `poll()` every `poll_interval_ns`. Each poll computes the
+  pressure: the highest of our usage relative to `budget_bytes`
+  (when set) and the driver's usage relative to its dedicated
+  memory. For ATI we don't know the size of the memory; we use
+  what was free at the first poll plus what we tracked then.
+
+  At `warning_ratio` or more the pressure is
+  `MEMORY_PRESSURE_WARNING`, at `critical_ratio` or more it's
+  `MEMORY_PRESSURE_CRITICAL`. While it's not
+  `MEMORY_PRESSURE_NONE`, `on_pressure` is called on every poll
+  with the number of bytes that has to be freed to get below
+  `warning_ratio` again. It's called once more when the pressure
+  is back to none. `get_stats()` returns all the numbers; use them
+  as metrics, e.g. to size the capacity of a node.
+
+ */
+#ifndef GL_MEMORY_MONITOR_H
+#define GL_MEMORY_MONITOR_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <gl-worker.h>
+
+/* ----------------------------------------------------------- */
+
+enum MemoryCategory {
+  MEMORY_TEXTURE = 0,
+  MEMORY_BUFFER,
+  MEMORY_RENDER_TARGET,
+  MEMORY_OTHER,
+  MEMORY_CATEGORY_COUNT
+};
+
+enum MemoryPressure {
+  MEMORY_PRESSURE_NONE,
+  MEMORY_PRESSURE_WARNING,                     /* Evict what you can miss. */
+  MEMORY_PRESSURE_CRITICAL,                    /* The driver is about to page (or already does). */
+};
+
+enum MemorySource {
+  MEMORY_SOURCE_NONE,                          /* Only our own allocations. */
+  MEMORY_SOURCE_NVX,                           /* `GL_NVX_gpu_memory_info` */
+  MEMORY_SOURCE_ATI,                           /* `GL_ATI_meminfo` */
+};
+
+/* ----------------------------------------------------------- */
+
+struct MemoryPressureEvent {
+  MemoryPressure pressure = MEMORY_PRESSURE_NONE;
+  double ratio = 0.0;                          /* Used / available; the highest of ours and the driver's. */
+  uint64_t bytes_to_free = 0;                  /* To get below `warning_ratio`. */
+};
+
+struct GpuMemoryStats {
+  MemorySource source = MEMORY_SOURCE_NONE;
+  MemoryPressure pressure = MEMORY_PRESSURE_NONE;
+  double ratio = 0.0;
+  uint64_t budget_bytes = 0;
+  uint64_t driver_total_bytes = 0;             /* NVX: dedicated; ATI: estimated at the first poll. */
+  uint64_t driver_available_bytes = 0;
+  uint64_t driver_evicted_bytes = 0;           /* NVX only */
+  uint64_t driver_num_evictions = 0;           /* NVX only */
+  uint64_t current_bytes[MEMORY_CATEGORY_COUNT] = { 0 };
+  uint64_t peak_bytes[MEMORY_CATEGORY_COUNT] = { 0 };
+  uint64_t evicted_bytes[MEMORY_CATEGORY_COUNT] = { 0 };
+  uint64_t total_current_bytes = 0;
+  uint64_t total_peak_bytes = 0;
+  uint64_t total_evicted_bytes = 0;
+  uint64_t num_polls = 0;
+  uint64_t num_pressure_events = 0;
+};
+
+/* ----------------------------------------------------------- */
+
+class GlMemoryMonitor {
+public:
+  GlMemoryMonitor();
+  GlMemoryMonitor(const GlMemoryMonitor&) = delete;
+  GlMemoryMonitor& operator=(const GlMemoryMonitor&) = delete;
+  int start(GlContext* shared);                /* `shared` must not be current while this runs. */
+  int shutdown();
+  int poll();                                  /* Called by the worker; call it yourself when you didn't `start()`, with a context current. */
+  void add(MemoryCategory category, uint64_t bytes);
+  int remove(MemoryCategory category, uint64_t bytes); /* Fails (and changes nothing) when `bytes` is more than is tracked for `category`. */
+  int evict(MemoryCategory category, uint64_t bytes);  /* `remove()` and count it as evicted. */
+  void get_stats(GpuMemoryStats& stats);
+  void print();
+
+public:
+  GlWorker worker;
+  std::function<void(const MemoryPressureEvent& ev)> on_pressure; /* Optional; called on the thread that polls. */
+  uint64_t budget_bytes = 0;                   /* Our budget; 0 means we only look at the driver. */
+  double warning_ratio = 0.80;
+  double critical_ratio = 0.95;
+  uint64_t poll_interval_ns = 100ull * 1000ull * 1000ull;
+
+private:
+  void update_peak(std::atomic<uint64_t>& peak, uint64_t value);
+
+private:
+  std::mutex mutex;                            /* Protects `driver`. */
+  GpuMemoryStats driver;                       /* Only the driver fields, the pressure and the counters are used. */
+  bool is_source_detected = false;             /* Only used by the thread that polls. */
+  std::atomic<uint64_t> current_bytes[MEMORY_CATEGORY_COUNT];
+  std::atomic<uint64_t> peak_bytes[MEMORY_CATEGORY_COUNT];
+  std::atomic<uint64_t> evicted_bytes[MEMORY_CATEGORY_COUNT];
+  std::atomic<uint64_t> total_current_bytes{0};
+  std::atomic<uint64_t> total_peak_bytes{0};
+};
+
+/* ----------------------------------------------------------- */
+
+uint64_t memory_texture_bytes(GLenum internal_format, GLsizei width, GLsizei height, GLsizei depth, GLsizei levels); /* An estimate; drivers pad and align. */
+const char* memory_category_to_string(MemoryCategory category);
+const char* memory_pressure_to_string(MemoryPressure pressure);
+
+/* ----------------------------------------------------------- */
+
+#endif
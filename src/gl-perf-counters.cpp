@@ -0,0 +1,631 @@
+#include <stdio.h>
+#include <string.h>
+#include <gl-perf-counters.h>
+
+/* ------------------------------------------------------------- */
+
+static PerfCounterType intel_type_to_perf_type(GLuint data_type);
+static PerfCounterType amd_type_to_perf_type(GLenum type);
+static uint32_t get_amd_num_words(PerfCounterType type);
+
+/* ------------------------------------------------------------- */
+
+int GlPerfCounters::init(PerfBackend requested, uint32_t num_frames) {
+
+  int r = 0;
+
+  if (false == frames.empty()) {
+    printf("Cannot initialize the perf counters, already initialized.\n");
+    return -1;
+  }
+
+  /* We need at least one frame in flight besides the one we record. */
+  if (num_frames < 2) {
+    printf("Cannot initialize the perf counters, we need at least 2 frames.\n");
+    return -2;
+  }
+
+  if (PERF_BACKEND_NONE == requested) {
+    if (0 != GLAD_GL_INTEL_performance_query) {
+      requested = PERF_BACKEND_INTEL;
+    }
+    else if (0 != GLAD_GL_AMD_performance_monitor) {
+      requested = PERF_BACKEND_AMD;
+    }
+    else {
+      printf("Cannot initialize the perf counters, neither `GL_INTEL_performance_query` nor `GL_AMD_performance_monitor` is supported.\n");
+      return -3;
+    }
+  }
+
+  counters.clear();
+  selected.clear();
+
+  switch (requested) {
+    case PERF_BACKEND_INTEL: { r = enumerate_intel(); break; }
+    case PERF_BACKEND_AMD:   { r = enumerate_amd();   break; }
+    case PERF_BACKEND_MOCK:  { r = enumerate_mock();  break; }
+    default:                 { r = -1;                break; }
+  }
+
+  if (0 != r) {
+    printf("Cannot initialize the perf counters, failed to enumerate the counters.\n");
+    return -4;
+  }
+
+  backend = requested;
+  frames.resize(num_frames);
+  last_report = PerfReport();
+  query_size = 0;
+  frame_index = 0;
+  frame_number = 0;
+  is_in_frame = false;
+  is_in_scope = false;
+  is_started = false;
+  num_collected = 0;
+  num_dropped = 0;
+
+  return 0;
+}
+
+int GlPerfCounters::shutdown() {
+
+  for (PerfFrame& frame : frames) {
+
+    if (PERF_BACKEND_INTEL == backend) {
+      for (GLuint handle : frame.handles) {
+        glDeletePerfQueryINTEL(handle);
+      }
+    }
+
+    if (PERF_BACKEND_AMD == backend && false == frame.handles.empty()) {
+      glDeletePerfMonitorsAMD((GLsizei)frame.handles.size(), frame.handles.data());
+    }
+  }
+
+  frames.clear();
+  is_in_frame = false;
+  is_in_scope = false;
+  is_started = false;
+
+  return 0;
+}
+
+int GlPerfCounters::select(const char* name) {
+
+  if (nullptr == name) {
+    printf("Cannot select the counter, name is nullptr.\n");
+    return -1;
+  }
+
+  if (true == is_started) {
+    printf("Cannot select the counter, the first frame began already.\n");
+    return -2;
+  }
+
+  /* INTEL counters with the same name can be part of several queries; we prefer the query of the counters that were selected. */
+  bool is_in_other_query = false;
+  int found = -1;
+
+  for (uint32_t i = 0; i < counters.size(); ++i) {
+
+    if (counters[i].name != name) {
+      continue;
+    }
+
+    if (PERF_BACKEND_INTEL == backend
+        && false == selected.empty()
+        && counters[selected[0]].group_id != counters[i].group_id)
+      {
+        is_in_other_query = true;
+        continue;
+      }
+
+    found = (int)i;
+    break;
+  }
+
+  if (found < 0 && true == is_in_other_query) {
+    printf("Cannot select `%s`, it's not part of the query of the counters that were selected (`%s`).\n", name, counters[selected[0]].group.c_str());
+    return -3;
+  }
+
+  if (found < 0) {
+    printf("Cannot select `%s`, the counter doesn't exist.\n", name);
+    return -4;
+  }
+
+  for (uint32_t index : selected) {
+    if (index == (uint32_t)found) {
+      return 0;
+    }
+  }
+
+  selected.push_back((uint32_t)found);
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int GlPerfCounters::begin_frame() {
+
+  if (true == frames.empty()) {
+    printf("Cannot begin the frame, the perf counters aren't initialized.\n");
+    return -1;
+  }
+
+  if (true == is_in_frame) {
+    printf("Cannot begin the frame, `end_frame()` wasn't called.\n");
+    return -2;
+  }
+
+  if (true == selected.empty()) {
+    printf("Cannot begin the frame, no counters selected.\n");
+    return -3;
+  }
+
+  if (false == is_started && PERF_BACKEND_INTEL == backend) {
+    GLchar query_name[256] = { 0 };
+    GLuint num_counters = 0;
+    GLuint num_instances = 0;
+    GLuint caps = 0;
+    glGetPerfQueryInfoINTEL(counters[selected[0]].group_id, sizeof(query_name), query_name, &query_size, &num_counters, &num_instances, &caps);
+    data.resize((query_size + 3) / 4);
+  }
+
+  is_started = true;
+
+  collect();
+
+  /* The GPU is more than `num_frames` behind; we rather lose a frame than wait. */
+  PerfFrame& frame = frames[frame_index];
+  if (true == frame.is_pending) {
+    frame.is_pending = false;
+    num_dropped++;
+  }
+
+  frame.number = frame_number;
+  frame.samples.clear();
+  is_in_frame = true;
+
+  return 0;
+}
+
+int GlPerfCounters::end_frame() {
+
+  if (false == is_in_frame) {
+    printf("Cannot end the frame, `begin_frame()` wasn't called.\n");
+    return -1;
+  }
+
+  if (true == is_in_scope) {
+    printf("Cannot end the frame, a scope is still open.\n");
+    return -2;
+  }
+
+  frames[frame_index].is_pending = true;
+  frame_index = (frame_index + 1) % frames.size();
+  frame_number++;
+  is_in_frame = false;
+
+  return 0;
+}
+
+int GlPerfCounters::begin_scope(const char* name) {
+
+  if (false == is_in_frame) {
+    printf("Cannot begin the scope, `begin_frame()` wasn't called.\n");
+    return -1;
+  }
+
+  if (true == is_in_scope) {
+    printf("Cannot begin the scope `%s`, scopes can't be nested.\n", (nullptr != name) ? name : "");
+    return -2;
+  }
+
+  /* `print()` and the samples keep the pointer. */
+  if (nullptr == name) {
+    printf("Cannot begin the scope, name is nullptr.\n");
+    return -3;
+  }
+
+  PerfFrame& frame = frames[frame_index];
+  PerfSample sample;
+  sample.name = name;
+  sample.handle = get_handle(frame, frame.samples.size());
+
+  if (PERF_BACKEND_INTEL == backend) {
+    glBeginPerfQueryINTEL(sample.handle);
+  }
+  else if (PERF_BACKEND_AMD == backend) {
+    glBeginPerfMonitorAMD(sample.handle);
+  }
+
+  frame.samples.push_back(sample);
+  is_in_scope = true;
+
+  return 0;
+}
+
+int GlPerfCounters::end_scope() {
+
+  if (false == is_in_scope) {
+    printf("Cannot end the scope, there is no open scope.\n");
+    return -1;
+  }
+
+  PerfSample& sample = frames[frame_index].samples.back();
+
+  if (PERF_BACKEND_INTEL == backend) {
+    glEndPerfQueryINTEL(sample.handle);
+  }
+  else if (PERF_BACKEND_AMD == backend) {
+    glEndPerfMonitorAMD(sample.handle);
+  }
+
+  is_in_scope = false;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+/* Collects the oldest frames first so the reports stay in order. */
+int GlPerfCounters::collect() {
+
+  int num = 0;
+
+  for (size_t i = 0; i < frames.size(); ++i) {
+
+    PerfFrame& frame = frames[(frame_index + i) % frames.size()];
+    if (false == frame.is_pending) {
+      continue;
+    }
+
+    if (1 != collect_frame(frame)) {
+      break;
+    }
+
+    num++;
+  }
+
+  return num;
+}
+
+void GlPerfCounters::print() {
+
+  if (true == last_report.scopes.empty()) {
+    printf("perf counters: no frames collected yet.\n");
+    return;
+  }
+
+  const char* names[] = { "none", "intel", "amd", "mock" };
+  size_t num_counters = last_report.counters.size();
+
+  printf("perf counters (%s): frame %llu\n", names[backend], (unsigned long long)last_report.frame);
+
+  for (size_t s = 0; s < last_report.scopes.size(); ++s) {
+    printf("  %s\n", last_report.scopes[s]);
+    for (size_t c = 0; c < num_counters; ++c) {
+      printf("    %-40s %16.2f\n", last_report.counters[c], last_report.values[s * num_counters + c]);
+    }
+  }
+}
+
+/* ------------------------------------------------------------- */
+
+int GlPerfCounters::collect_frame(PerfFrame& frame) {
+
+  for (uint32_t i = 0; i < frame.samples.size(); ++i) {
+    if (1 != read_sample(frame, i, frame.samples[i])) {
+      return 0;
+    }
+  }
+
+  last_report.frame = frame.number;
+  last_report.counters.clear();
+  last_report.scopes.clear();
+  last_report.values.clear();
+
+  for (uint32_t index : selected) {
+    last_report.counters.push_back(counters[index].name.c_str());
+  }
+
+  for (const PerfSample& sample : frame.samples) {
+    last_report.scopes.push_back(sample.name);
+    last_report.values.insert(last_report.values.end(), sample.values.begin(), sample.values.end());
+  }
+
+  frame.is_pending = false;
+  num_collected++;
+
+  if (on_report) {
+    on_report(last_report);
+  }
+
+  return 1;
+}
+
+int GlPerfCounters::read_sample(const PerfFrame& frame, uint32_t scope, PerfSample& sample) {
+
+  sample.values.assign(selected.size(), 0.0);
+
+  if (PERF_BACKEND_MOCK == backend) {
+
+    if (frame_number <= frame.number + mock_latency_frames) {
+      return 0;
+    }
+
+    for (size_t i = 0; i < selected.size(); ++i) {
+      sample.values[i] = (double)(frame.number * 1000 + scope * 10 + selected[i]);
+    }
+
+    return 1;
+  }
+
+  if (PERF_BACKEND_INTEL == backend) {
+
+    GLuint num_written = 0;
+    glGetPerfQueryDataINTEL(sample.handle, GL_PERFQUERY_DONOT_FLUSH_INTEL, query_size, data.data(), &num_written);
+
+    if (0 == num_written) {
+      return 0;
+    }
+
+    const uint8_t* ptr = (const uint8_t*)data.data();
+
+    for (size_t i = 0; i < selected.size(); ++i) {
+
+      const PerfCounterInfo& info = counters[selected[i]];
+      const uint8_t* value = ptr + info.offset;
+
+      switch (info.type) {
+        case PERF_COUNTER_UINT32: { uint32_t v = 0; memcpy(&v, value, sizeof(v)); sample.values[i] = (double)v; break; }
+        case PERF_COUNTER_UINT64: { uint64_t v = 0; memcpy(&v, value, sizeof(v)); sample.values[i] = (double)v; break; }
+        case PERF_COUNTER_FLOAT:  { float v = 0;    memcpy(&v, value, sizeof(v)); sample.values[i] = (double)v; break; }
+        case PERF_COUNTER_DOUBLE: { double v = 0;   memcpy(&v, value, sizeof(v)); sample.values[i] = v;         break; }
+        case PERF_COUNTER_BOOL:   { uint32_t v = 0; memcpy(&v, value, sizeof(v)); sample.values[i] = (0 != v);  break; }
+      }
+    }
+
+    return 1;
+  }
+
+  if (PERF_BACKEND_AMD == backend) {
+
+    GLuint is_available = 0;
+    GLuint result_size = 0;
+    GLint num_written = 0;
+
+    glGetPerfMonitorCounterDataAMD(sample.handle, GL_PERFMON_RESULT_AVAILABLE_AMD, sizeof(is_available), &is_available, nullptr);
+    if (0 == is_available) {
+      return 0;
+    }
+
+    glGetPerfMonitorCounterDataAMD(sample.handle, GL_PERFMON_RESULT_SIZE_AMD, sizeof(result_size), &result_size, nullptr);
+    data.resize(result_size / 4);
+    glGetPerfMonitorCounterDataAMD(sample.handle, GL_PERFMON_RESULT_AMD, result_size, data.data(), &num_written);
+
+    /* The result is a list of (group, counter, value); the size of the value depends on its type. */
+    size_t num_words = (size_t)num_written / 4;
+    size_t pos = 0;
+
+    while (pos + 2 < num_words) {
+
+      GLuint group_id = data[pos + 0];
+      GLuint counter_id = data[pos + 1];
+      uint32_t num_value_words = 0;
+      pos += 2;
+
+      for (size_t i = 0; i < selected.size(); ++i) {
+
+        const PerfCounterInfo& info = counters[selected[i]];
+        if (group_id != info.group_id || counter_id != info.counter_id) {
+          continue;
+        }
+
+        num_value_words = get_amd_num_words(info.type);
+
+        switch (info.type) {
+          case PERF_COUNTER_UINT64: { uint64_t v = 0; memcpy(&v, &data[pos], sizeof(v)); sample.values[i] = (double)v; break; }
+          case PERF_COUNTER_FLOAT:  { float v = 0;    memcpy(&v, &data[pos], sizeof(v)); sample.values[i] = (double)v; break; }
+          default:                  { sample.values[i] = (double)data[pos];                                            break; }
+        }
+      }
+
+      /* We only get the counters we selected; bail out if that's not the case. */
+      if (0 == num_value_words) {
+        printf("The AMD perf monitor returned a counter that we didn't select; we skip the rest.\n");
+        break;
+      }
+
+      pos += num_value_words;
+    }
+
+    return 1;
+  }
+
+  return -1;
+}
+
+GLuint GlPerfCounters::get_handle(PerfFrame& frame, size_t index) {
+
+  while (frame.handles.size() <= index) {
+
+    GLuint handle = 0;
+
+    if (PERF_BACKEND_INTEL == backend) {
+      glCreatePerfQueryINTEL(counters[selected[0]].group_id, &handle);
+    }
+    else if (PERF_BACKEND_AMD == backend) {
+      glGenPerfMonitorsAMD(1, &handle);
+      for (uint32_t i : selected) {
+        glSelectPerfMonitorCountersAMD(handle, GL_TRUE, counters[i].group_id, 1, &counters[i].counter_id);
+      }
+    }
+    else {
+      handle = (GLuint)frame.handles.size() + 1;
+    }
+
+    frame.handles.push_back(handle);
+  }
+
+  return frame.handles[index];
+}
+
+/* ------------------------------------------------------------- */
+
+int GlPerfCounters::enumerate_intel() {
+
+  if (0 == GLAD_GL_INTEL_performance_query) {
+    printf("Cannot enumerate the INTEL perf counters, `GL_INTEL_performance_query` isn't supported.\n");
+    return -1;
+  }
+
+  GLchar query_name[256] = { 0 };
+  GLchar counter_name[256] = { 0 };
+  GLchar counter_desc[1024] = { 0 };
+  GLuint query_id = 0;
+
+  glGetFirstPerfQueryIdINTEL(&query_id);
+
+  while (0 != query_id) {
+
+    GLuint data_size = 0;
+    GLuint num_counters = 0;
+    GLuint num_instances = 0;
+    GLuint caps = 0;
+
+    glGetPerfQueryInfoINTEL(query_id, sizeof(query_name), query_name, &data_size, &num_counters, &num_instances, &caps);
+
+    /* Counter ids start at 1. */
+    for (GLuint counter_id = 1; counter_id <= num_counters; ++counter_id) {
+
+      GLuint offset = 0;
+      GLuint size = 0;
+      GLuint type = 0;
+      GLuint data_type = 0;
+      GLuint64 raw_max = 0;
+
+      glGetPerfCounterInfoINTEL(query_id, counter_id,
+                                sizeof(counter_name), counter_name,
+                                sizeof(counter_desc), counter_desc,
+                                &offset, &size, &type, &data_type, &raw_max);
+
+      PerfCounterInfo info;
+      info.name = counter_name;
+      info.group = query_name;
+      info.type = intel_type_to_perf_type(data_type);
+      info.group_id = query_id;
+      info.counter_id = counter_id;
+      info.offset = offset;
+
+      counters.push_back(info);
+    }
+
+    GLuint next_id = 0;
+    glGetNextPerfQueryIdINTEL(query_id, &next_id);
+    query_id = next_id;
+  }
+
+  return 0;
+}
+
+int GlPerfCounters::enumerate_amd() {
+
+  if (0 == GLAD_GL_AMD_performance_monitor) {
+    printf("Cannot enumerate the AMD perf counters, `GL_AMD_performance_monitor` isn't supported.\n");
+    return -1;
+  }
+
+  GLchar group_name[256] = { 0 };
+  GLchar counter_name[256] = { 0 };
+  GLint num_groups = 0;
+
+  glGetPerfMonitorGroupsAMD(&num_groups, 0, nullptr);
+
+  std::vector<GLuint> groups(num_groups);
+  glGetPerfMonitorGroupsAMD(nullptr, num_groups, groups.data());
+
+  for (GLuint group_id : groups) {
+
+    GLint num_counters = 0;
+    GLint max_active = 0;
+
+    glGetPerfMonitorGroupStringAMD(group_id, sizeof(group_name), nullptr, group_name);
+    glGetPerfMonitorCountersAMD(group_id, &num_counters, &max_active, 0, nullptr);
+
+    std::vector<GLuint> ids(num_counters);
+    glGetPerfMonitorCountersAMD(group_id, nullptr, nullptr, num_counters, ids.data());
+
+    for (GLuint counter_id : ids) {
+
+      GLenum type = 0;
+
+      glGetPerfMonitorCounterStringAMD(group_id, counter_id, sizeof(counter_name), nullptr, counter_name);
+      glGetPerfMonitorCounterInfoAMD(group_id, counter_id, GL_COUNTER_TYPE_AMD, &type);
+
+      PerfCounterInfo info;
+      info.name = counter_name;
+      info.group = group_name;
+      info.type = amd_type_to_perf_type(type);
+      info.group_id = group_id;
+      info.counter_id = counter_id;
+
+      counters.push_back(info);
+    }
+  }
+
+  return 0;
+}
+
+int GlPerfCounters::enumerate_mock() {
+
+  const char* names[] = { "GPU Time", "GPU Busy", "Vertices Shaded", "Fragments Shaded", "Texture Reads" };
+  const PerfCounterType types[] = { PERF_COUNTER_UINT64, PERF_COUNTER_FLOAT, PERF_COUNTER_UINT64, PERF_COUNTER_UINT64, PERF_COUNTER_UINT64 };
+
+  for (uint32_t i = 0; i < 5; ++i) {
+
+    PerfCounterInfo info;
+    info.name = names[i];
+    info.group = "Mock";
+    info.type = types[i];
+    info.group_id = 1;
+    info.counter_id = i + 1;
+
+    counters.push_back(info);
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+static PerfCounterType intel_type_to_perf_type(GLuint data_type) {
+
+  switch (data_type) {
+    case GL_PERFQUERY_COUNTER_DATA_UINT32_INTEL: { return PERF_COUNTER_UINT32; }
+    case GL_PERFQUERY_COUNTER_DATA_UINT64_INTEL: { return PERF_COUNTER_UINT64; }
+    case GL_PERFQUERY_COUNTER_DATA_FLOAT_INTEL:  { return PERF_COUNTER_FLOAT;  }
+    case GL_PERFQUERY_COUNTER_DATA_DOUBLE_INTEL: { return PERF_COUNTER_DOUBLE; }
+    case GL_PERFQUERY_COUNTER_DATA_BOOL32_INTEL: { return PERF_COUNTER_BOOL;   }
+    default:                                     { return PERF_COUNTER_UINT32; }
+  }
+}
+
+static PerfCounterType amd_type_to_perf_type(GLenum type) {
+
+  switch (type) {
+    case GL_UNSIGNED_INT64_AMD: { return PERF_COUNTER_UINT64; }
+    case GL_PERCENTAGE_AMD:     { return PERF_COUNTER_FLOAT;  }
+    case GL_FLOAT:              { return PERF_COUNTER_FLOAT;  }
+    default:                    { return PERF_COUNTER_UINT32; }
+  }
+}
+
+static uint32_t get_amd_num_words(PerfCounterType type) {
+  return (PERF_COUNTER_UINT64 == type) ? 2 : 1;
+}
+
+/* ------------------------------------------------------------- */
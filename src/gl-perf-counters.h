@@ -0,0 +1,157 @@
+/*
+
+  GL PERF COUNTERS
+  =================
+
+  Samples hardware performance counters (vertices shaded, cache
+  misses, busy percentages, ...) around named scopes of a frame,
+  with one API for the vendor extensions:
+
+  - `PERF_BACKEND_INTEL`: `GL_INTEL_performance_query`. The driver
+    offers queries (e.g. "Render Metrics Basic"), each with a
+    fixed set of counters; the selected counters must all belong
+    to the same query.
+  - `PERF_BACKEND_AMD`: `GL_AMD_performance_monitor`. Counters are
+    grouped; a monitor can sample counters of several groups.
+  - `PERF_BACKEND_MOCK`: fake counters that don't need a driver
+    (or a context), so the collection and the reports can be
+    tested anywhere. The value of counter `c` (its index in
+    `counters`) in scope `s` of frame `f` is `f * 1000 + s * 10 +
+    c`, and results become available once `mock_latency_frames`
+    more frames ended.
+
+    counters.init();                           // picks INTEL or AMD
+    counters.select("GPU Busy");
+    counters.select("Vertices Shaded");
+
+    counters.begin_frame();
+      counters.begin_scope("shadows");  ... counters.end_scope();
+      counters.begin_scope("opaque");   ... counters.end_scope();
+    counters.end_frame();
+
+    counters.print();                          // the last collected frame
+
+  Select the counters before the first frame; `counters` lists
+  what the backend offers. Neither extension can nest its
+  queries, so scopes can't be nested either.
+
+  Results are collected like the timestamps of the `GlProfiler`
+  (see `gl-profiler.h`): each frame has its own pool of queries
+  and there are `num_frames` of them (2 by default, so we record
+  one frame while the GPU works on the previous one).
+  `begin_frame()` collects the frames whose results are
+  available, without blocking. When a pool is needed again before
+  its results arrived, that frame is dropped (see `num_dropped`).
+
+  Each collected frame becomes a `PerfReport` with one row per
+  scope and one value per selected counter (converted to double).
+  It's stored in `last_report` and passed to `on_report`.
+
+  Must be used on one thread, with the same context current as
+  with `init()` (the mock backend doesn't need a context).
+
+ */
+#ifndef GL_PERF_COUNTERS_H
+#define GL_PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include <glad/glad.h>
+
+/* ----------------------------------------------------------- */
+
+enum PerfBackend {
+  PERF_BACKEND_NONE,                           /* Passed to `init()`: pick INTEL, then AMD. */
+  PERF_BACKEND_INTEL,
+  PERF_BACKEND_AMD,
+  PERF_BACKEND_MOCK,
+};
+
+enum PerfCounterType {
+  PERF_COUNTER_UINT32,
+  PERF_COUNTER_UINT64,
+  PERF_COUNTER_FLOAT,
+  PERF_COUNTER_DOUBLE,
+  PERF_COUNTER_BOOL,
+};
+
+/* ----------------------------------------------------------- */
+
+struct PerfCounterInfo {
+  std::string name;
+  std::string group;                           /* INTEL: the query; AMD: the group. */
+  PerfCounterType type = PERF_COUNTER_UINT64;
+  GLuint group_id = 0;                         /* INTEL: the query id; AMD: the group id. */
+  GLuint counter_id = 0;
+  GLuint offset = 0;                           /* INTEL: where the value is in the query data. */
+};
+
+struct PerfSample {
+  const char* name = nullptr;                  /* Not copied; use string literals. */
+  GLuint handle = 0;                           /* INTEL: query handle; AMD: monitor. */
+  std::vector<double> values;                  /* One per selected counter, once collected. */
+};
+
+struct PerfFrame {
+  uint64_t number = 0;
+  std::vector<PerfSample> samples;
+  std::vector<GLuint> handles;                 /* The pool; grows when a frame has more scopes. */
+  bool is_pending = false;                     /* Ended, waiting for the results. */
+};
+
+struct PerfReport {
+  uint64_t frame = 0;
+  std::vector<const char*> counters;           /* The names of the selected counters. */
+  std::vector<const char*> scopes;
+  std::vector<double> values;                  /* Scope major: `values[scope * counters.size() + counter]`. */
+};
+
+/* ----------------------------------------------------------- */
+
+class GlPerfCounters {
+public:
+  GlPerfCounters() = default;
+  GlPerfCounters(const GlPerfCounters&) = delete;
+  GlPerfCounters& operator=(const GlPerfCounters&) = delete;
+  int init(PerfBackend backend = PERF_BACKEND_NONE, uint32_t num_frames = 2);
+  int shutdown();
+  int select(const char* name);                /* Before the first frame. */
+  int begin_frame();
+  int end_frame();
+  int begin_scope(const char* name);
+  int end_scope();
+  int collect();                               /* Returns the number of frames collected; never blocks. */
+  void print();                                /* Prints `last_report`. */
+
+public:
+  PerfBackend backend = PERF_BACKEND_NONE;
+  std::vector<PerfCounterInfo> counters;       /* What the backend offers. */
+  std::vector<uint32_t> selected;              /* Indices into `counters`. */
+  std::vector<PerfFrame> frames;
+  std::vector<GLuint> data;                    /* Scratch memory for the query results. */
+  GLuint query_size = 0;                       /* INTEL: the size of the data of the selected query. */
+  PerfReport last_report;
+  std::function<void(const PerfReport& report)> on_report; /* Optional. */
+  uint32_t mock_latency_frames = 1;
+  uint32_t frame_index = 0;
+  uint64_t frame_number = 0;
+  bool is_in_frame = false;
+  bool is_in_scope = false;
+  bool is_started = false;                     /* The first frame began; the selection is fixed. */
+  uint64_t num_collected = 0;                  /* Stats */
+  uint64_t num_dropped = 0;
+
+private:
+  int enumerate_intel();
+  int enumerate_amd();
+  int enumerate_mock();
+  GLuint get_handle(PerfFrame& frame, size_t index);
+  int read_sample(const PerfFrame& frame, uint32_t scope, PerfSample& sample); /* Returns 1 when the values were read, 0 when not available yet. */
+  int collect_frame(PerfFrame& frame);
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
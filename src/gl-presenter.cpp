@@ -0,0 +1,578 @@
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <chrono>
+#include <gl-presenter.h>
+#include <gl-sync.h>
+
+/* ------------------------------------------------------------- */
+
+/* A vsynced swap that blocked at least this long returned right after a vblank. */
+static const uint64_t min_block_ns = 1000000;
+
+/* ------------------------------------------------------------- */
+
+#if defined(_WIN32)
+static bool has_wgl_extension(HDC dc, const char* name);
+#endif
+
+/* ------------------------------------------------------------- */
+
+int GlPresenter::init(GlContext* context, PresentBackend requested) {
+
+  if (true == is_in_frame) {
+    printf("Cannot initialize the presenter, a frame is in progress.\n");
+    return -1;
+  }
+
+  if (PRESENT_BACKEND_DRIVER == requested && nullptr == context) {
+    printf("Cannot initialize the presenter, no context given.\n");
+    return -2;
+  }
+
+  if (0 == max_pending || 0 == num_predict_frames) {
+    printf("Cannot initialize the presenter, `max_pending` and `num_predict_frames` can't be 0.\n");
+    return -3;
+  }
+
+  ctx = context;
+  backend = requested;
+  frame_number = 0;
+  last_display_ns = 0;
+  predicted_ns = 0;
+  num_dropped = 0;
+  costs.clear();
+  pending.clear();
+  stats = PresentStats();
+  last = PresentTimings();
+
+  if (PRESENT_BACKEND_SIMULATED == backend) {
+    refresh_ns = sim.refresh_ns;
+    has_adaptive = true;
+    has_delay_before_swap = false;
+  }
+  else {
+
+#if defined(_WIN32)
+    if (true == has_wgl_extension(ctx->dc, "WGL_EXT_swap_control")) {
+      wglSwapIntervalEXT = reinterpret_cast<PFNWGLSWAPINTERVALEXTPROC>(wglGetProcAddress("wglSwapIntervalEXT"));
+    }
+
+    if (true == has_wgl_extension(ctx->dc, "WGL_NV_delay_before_swap")) {
+      wglDelayBeforeSwapNV = reinterpret_cast<PFNWGLDELAYBEFORESWAPNVPROC>(wglGetProcAddress("wglDelayBeforeSwapNV"));
+    }
+
+    has_adaptive = has_wgl_extension(ctx->dc, "WGL_EXT_swap_control_tear");
+    has_delay_before_swap = (nullptr != wglDelayBeforeSwapNV);
+
+    /* 0 and 1 mean "the default of the hardware". */
+    int hz = GetDeviceCaps(ctx->dc, VREFRESH);
+    if (hz > 1) {
+      refresh_ns = 1000000000ull / (uint64_t)hz;
+    }
+#else
+    /* EGL has no adaptive vsync, no delay before swap and can't tell the refresh rate. */
+    has_adaptive = false;
+    has_delay_before_swap = false;
+#endif
+
+    queries.resize(max_pending);
+    glGenQueries(max_pending, queries.data());
+    calibrate();
+  }
+
+  vblank_ns = now();
+
+  if (0 != set_swap(mode, swap_interval)) {
+    printf("Failed to set the swap interval of the presenter.\n");
+    return -4;
+  }
+
+  return 0;
+}
+
+int GlPresenter::shutdown() {
+
+  if (PRESENT_BACKEND_DRIVER == backend && false == queries.empty()) {
+    glDeleteQueries((GLsizei)queries.size(), queries.data());
+  }
+
+  queries.clear();
+  pending.clear();
+  costs.clear();
+  is_in_frame = false;
+  ctx = nullptr;
+
+  return 0;
+}
+
+int GlPresenter::set_swap(PresentMode requested, uint32_t interval) {
+
+  if (PRESENT_MODE_IMMEDIATE != requested && 0 == interval) {
+    printf("Cannot set the swap interval, use `PRESENT_MODE_IMMEDIATE` for interval 0.\n");
+    return -1;
+  }
+
+  if (PRESENT_MODE_ADAPTIVE == requested && false == has_adaptive) {
+    printf("Adaptive vsync isn't supported; we use vsync.\n");
+    requested = PRESENT_MODE_VSYNC;
+  }
+
+  if (PRESENT_MODE_IMMEDIATE == requested) {
+    interval = 0;
+  }
+
+  int value = (PRESENT_MODE_ADAPTIVE == requested) ? -(int)interval : (int)interval;
+
+  if (PRESENT_BACKEND_DRIVER == backend) {
+
+#if defined(_WIN32)
+    if (nullptr == wglSwapIntervalEXT) {
+      printf("Cannot set the swap interval, `WGL_EXT_swap_control` isn't supported.\n");
+      return -2;
+    }
+
+    if (FALSE == wglSwapIntervalEXT(value)) {
+      printf("Failed to set the swap interval to %d.\n", value);
+      return -3;
+    }
+#else
+    if (EGL_FALSE == eglSwapInterval(ctx->display, value)) {
+      printf("Failed to set the swap interval to %d.\n", value);
+      return -3;
+    }
+#endif
+  }
+
+  mode = requested;
+  swap_interval = interval;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int GlPresenter::begin_frame() {
+
+  if (true == is_in_frame) {
+    printf("Cannot begin the frame, `present()` wasn't called.\n");
+    return -1;
+  }
+
+  if (PRESENT_BACKEND_DRIVER == backend) {
+
+    if (nullptr == ctx) {
+      printf("Cannot begin the frame, the presenter isn't initialized.\n");
+      return -2;
+    }
+
+    if (0 != calibrate_interval && 0 == (frame_number % calibrate_interval)) {
+      calibrate();
+    }
+
+    collect();
+  }
+
+  /* Start as late as we can and still make the vblank. */
+  uint64_t start_ns = now();
+
+  if (true == is_low_latency
+      && PRESENT_MODE_IMMEDIATE != mode
+      && 0 != predicted_ns)
+    {
+      uint64_t wake_ns = get_target(start_ns) - predicted_ns - margin_ns;
+      if (wake_ns > start_ns) {
+        sleep_until(wake_ns);
+      }
+    }
+
+  current = PresentTimings();
+  current.frame = frame_number;
+  current.begin_ns = now();
+  current.wait_ns = current.begin_ns - start_ns;
+  current.target_ns = get_target(current.begin_ns);
+  is_in_frame = true;
+
+  return 0;
+}
+
+int GlPresenter::wait_before_swap() {
+
+  if (false == is_in_frame) {
+    printf("Cannot wait before the swap, `begin_frame()` wasn't called.\n");
+    return -1;
+  }
+
+  if (PRESENT_MODE_IMMEDIATE == mode) {
+    return 0;
+  }
+
+#if defined(_WIN32)
+  if (PRESENT_BACKEND_DRIVER == backend && true == has_delay_before_swap) {
+
+    uint64_t delay_start_ns = now();
+
+    if (TRUE == wglDelayBeforeSwapNV(ctx->dc, (GLfloat)((double)margin_ns / 1e9))) {
+      current.delay_ns += now() - delay_start_ns;
+      return 0;
+    }
+  }
+#endif
+
+  uint64_t start_ns = now();
+
+  if (current.target_ns > margin_ns) {
+    sleep_until(current.target_ns - margin_ns);
+  }
+
+  current.delay_ns += now() - start_ns;
+
+  return 0;
+}
+
+int GlPresenter::present() {
+
+  if (false == is_in_frame) {
+    printf("Cannot present, `begin_frame()` wasn't called.\n");
+    return -1;
+  }
+
+  is_in_frame = false;
+  current.submit_ns = now();
+
+  if (PRESENT_BACKEND_SIMULATED == backend) {
+    simulate_swap();
+    last_display_ns = current.display_ns;
+  }
+  else {
+
+    /* The pool is full; the oldest frame uses the query we need. */
+    if (pending.size() >= max_pending) {
+      finish_frame(pending.front());
+      pending.erase(pending.begin());
+      num_dropped++;
+    }
+
+    glQueryCounter(queries[frame_number % max_pending], GL_TIMESTAMP);
+
+    if (0 != swap()) {
+      printf("Failed to swap the buffers.\n");
+      frame_number++;
+      return -2;
+    }
+
+    current.swap_ns = now();
+
+    last_display_ns = current.swap_ns;
+    if (PRESENT_MODE_IMMEDIATE != mode) {
+      last_display_ns = get_next_vblank(current.swap_ns);
+      last_display_ns = (current.target_ns > last_display_ns) ? current.target_ns : last_display_ns;
+    }
+  }
+
+  if (PRESENT_MODE_IMMEDIATE != mode
+      && false == current.is_torn
+      && current.swap_ns - current.submit_ns >= min_block_ns)
+    {
+      vblank_ns = current.swap_ns;
+    }
+
+  if (PRESENT_BACKEND_SIMULATED == backend) {
+    finish_frame(current);
+  }
+  else {
+    pending.push_back(current);
+  }
+
+  frame_number++;
+
+  return 0;
+}
+
+/* Finishes the frames whose GPU timestamp is available, oldest first. */
+int GlPresenter::collect() {
+
+  int num = 0;
+
+  while (false == pending.empty()) {
+
+    PresentTimings& timings = pending.front();
+    GLuint query = queries[timings.frame % max_pending];
+    GLint is_available = 0;
+    GLuint64 gpu_ns = 0;
+
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &is_available);
+    if (0 == is_available) {
+      break;
+    }
+
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpu_ns);
+    timings.gpu_ns = (uint64_t)((int64_t)gpu_ns + gpu_to_cpu_ns);
+
+    finish_frame(timings);
+    pending.erase(pending.begin());
+    num++;
+  }
+
+  return num;
+}
+
+/* ------------------------------------------------------------- */
+
+uint64_t GlPresenter::get_next_vblank(uint64_t time_ns) {
+
+  if (0 == refresh_ns) {
+    return time_ns;
+  }
+
+  if (time_ns <= vblank_ns) {
+    return vblank_ns - ((vblank_ns - time_ns) / refresh_ns) * refresh_ns;
+  }
+
+  return vblank_ns + ((time_ns - vblank_ns + refresh_ns - 1) / refresh_ns) * refresh_ns;
+}
+
+uint64_t GlPresenter::now() {
+  return (PRESENT_BACKEND_SIMULATED == backend) ? sim.now_ns : gpu_sync_now_ns();
+}
+
+void GlPresenter::print() {
+
+  double num = (0 == stats.num_frames) ? 1.0 : (double)stats.num_frames;
+
+  printf("presenter: %s, interval %u, %.2f Hz%s\n",
+         present_mode_to_string(mode),
+         swap_interval,
+         (0 == refresh_ns) ? 0.0 : 1e9 / (double)refresh_ns,
+         (true == is_low_latency) ? ", low latency" : "");
+
+  printf("  frames: %llu, missed: %llu, torn: %llu, dropped timestamps: %llu\n",
+         (unsigned long long)stats.num_frames,
+         (unsigned long long)stats.num_missed,
+         (unsigned long long)stats.num_torn,
+         (unsigned long long)num_dropped);
+
+  printf("  latency: avg %.2f ms, max %.2f ms\n", stats.total_latency_ns / num / 1e6, stats.max_latency_ns / 1e6);
+  printf("  cpu:     avg %.2f ms, max %.2f ms\n", stats.total_cpu_ns / num / 1e6, stats.max_cpu_ns / 1e6);
+  printf("  swap:    avg %.2f ms, max %.2f ms\n", stats.total_swap_ns / num / 1e6, stats.max_swap_ns / 1e6);
+  printf("  wait:    avg %.2f ms\n", stats.total_wait_ns / num / 1e6);
+}
+
+/* ------------------------------------------------------------- */
+
+/* The vblank at which a frame that starts at `start_ns` can be shown, given the prediction and the interval. */
+uint64_t GlPresenter::get_target(uint64_t start_ns) {
+
+  uint64_t earliest_ns = start_ns;
+
+  if (0 != predicted_ns) {
+    earliest_ns += predicted_ns + margin_ns;
+  }
+
+  if (PRESENT_MODE_IMMEDIATE == mode) {
+    return earliest_ns;
+  }
+
+  /* Half a refresh of slack so a slightly early estimate still rounds to the right vblank. */
+  if (0 != last_display_ns) {
+    uint64_t next_ns = last_display_ns + swap_interval * refresh_ns - refresh_ns / 2;
+    earliest_ns = (next_ns > earliest_ns) ? next_ns : earliest_ns;
+  }
+
+  return get_next_vblank(earliest_ns);
+}
+
+/* Sleeps most of the time and yields for the last millisecond, as the sleep granularity is coarse on Windows. */
+void GlPresenter::sleep_until(uint64_t time_ns) {
+
+  if (PRESENT_BACKEND_SIMULATED == backend) {
+    sim.now_ns = (time_ns > sim.now_ns) ? time_ns : sim.now_ns;
+    return;
+  }
+
+  while (true) {
+
+    uint64_t now_ns = gpu_sync_now_ns();
+    if (now_ns >= time_ns) {
+      break;
+    }
+
+    if (time_ns - now_ns > 1500000) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(time_ns - now_ns - 1000000));
+    }
+    else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+int GlPresenter::swap() {
+
+#if defined(_WIN32)
+  if (FALSE == SwapBuffers(ctx->dc)) {
+    return -1;
+  }
+#else
+  if (EGL_FALSE == eglSwapBuffers(ctx->display, ctx->surface)) {
+    return -1;
+  }
+#endif
+
+  return 0;
+}
+
+/*
+  The simulated display: the GPU works on the frames in order and
+  `sim.gpu_ns` per frame. A vsynced swap blocks until the flip
+  at the first vblank after the GPU finished and at least
+  `swap_interval` vblanks after the previous flip. Immediate
+  swaps, and adaptive swaps of a frame that missed its vblank,
+  don't block and flip when the GPU is done.
+*/
+void GlPresenter::simulate_swap() {
+
+  uint64_t refresh = sim.refresh_ns;
+  uint64_t gpu_begin_ns = (sim.gpu_done_ns > sim.now_ns) ? sim.gpu_done_ns : sim.now_ns;
+  sim.gpu_done_ns = gpu_begin_ns + sim.gpu_ns;
+
+  uint64_t ready_ns = sim.gpu_done_ns;
+  uint64_t min_flip_ns = ready_ns;
+  bool is_late = false;
+
+  /* The interval counts vblanks, so a torn flip counts from the vblank before it. */
+  if (PRESENT_MODE_IMMEDIATE != mode && 0 != sim.num_flips) {
+    uint64_t last_vblank_ns = sim.last_flip_ns;
+    if (sim.last_flip_ns > sim.phase_ns) {
+      last_vblank_ns -= (sim.last_flip_ns - sim.phase_ns) % refresh;
+    }
+    uint64_t due_ns = last_vblank_ns + swap_interval * refresh;
+    min_flip_ns = (due_ns > min_flip_ns) ? due_ns : min_flip_ns;
+    is_late = ready_ns > due_ns;
+  }
+
+  uint64_t flip_ns = sim.phase_ns;
+  if (min_flip_ns > sim.phase_ns) {
+    flip_ns = sim.phase_ns + ((min_flip_ns - sim.phase_ns + refresh - 1) / refresh) * refresh;
+  }
+
+  bool is_blocking = true;
+
+  if (PRESENT_MODE_IMMEDIATE == mode
+      || (PRESENT_MODE_ADAPTIVE == mode && true == is_late))
+    {
+      flip_ns = ready_ns;
+      is_blocking = false;
+    }
+
+  if (true == is_blocking && flip_ns > sim.now_ns) {
+    sim.now_ns = flip_ns;
+  }
+
+  sim.last_flip_ns = flip_ns;
+  sim.num_flips++;
+
+  current.swap_ns = sim.now_ns;
+  current.gpu_ns = ready_ns;
+  current.display_ns = flip_ns;
+  current.is_torn = (flip_ns < sim.phase_ns) || (0 != (flip_ns - sim.phase_ns) % refresh);
+}
+
+/* Predicts when a driver frame was shown, updates the prediction and the stats. */
+void GlPresenter::finish_frame(PresentTimings& timings) {
+
+  if (PRESENT_BACKEND_DRIVER == backend) {
+
+    uint64_t ready_ns = (0 != timings.gpu_ns) ? timings.gpu_ns : timings.swap_ns;
+    uint64_t vblank = get_next_vblank(ready_ns);
+
+    timings.display_ns = (timings.target_ns > vblank) ? timings.target_ns : vblank;
+
+    if (PRESENT_MODE_IMMEDIATE == mode
+        || (PRESENT_MODE_ADAPTIVE == mode && ready_ns > timings.target_ns))
+      {
+        timings.display_ns = ready_ns;
+        timings.is_torn = true;
+      }
+  }
+
+  /* A quarter refresh of slack for the predicted vblanks. */
+  timings.is_missed = (PRESENT_MODE_IMMEDIATE != mode)
+    && (timings.display_ns > timings.target_ns + refresh_ns / 4);
+
+  if (0 != timings.gpu_ns && timings.gpu_ns > timings.begin_ns + timings.delay_ns) {
+
+    uint64_t cost = timings.gpu_ns - timings.begin_ns - timings.delay_ns;
+
+    if (costs.size() < num_predict_frames) {
+      costs.push_back(cost);
+    }
+    else {
+      costs[timings.frame % num_predict_frames] = cost;
+    }
+
+    predicted_ns = 0;
+    for (uint64_t c : costs) {
+      predicted_ns = (c > predicted_ns) ? c : predicted_ns;
+    }
+  }
+
+  uint64_t latency_ns = (timings.display_ns > timings.begin_ns) ? timings.display_ns - timings.begin_ns : 0;
+  uint64_t cpu_ns = timings.submit_ns - timings.begin_ns;
+  uint64_t swap_ns = timings.swap_ns - timings.submit_ns;
+
+  stats.num_frames++;
+  stats.num_missed += (true == timings.is_missed) ? 1 : 0;
+  stats.num_torn += (true == timings.is_torn) ? 1 : 0;
+  stats.total_latency_ns += latency_ns;
+  stats.max_latency_ns = (latency_ns > stats.max_latency_ns) ? latency_ns : stats.max_latency_ns;
+  stats.total_cpu_ns += cpu_ns;
+  stats.max_cpu_ns = (cpu_ns > stats.max_cpu_ns) ? cpu_ns : stats.max_cpu_ns;
+  stats.total_swap_ns += swap_ns;
+  stats.max_swap_ns = (swap_ns > stats.max_swap_ns) ? swap_ns : stats.max_swap_ns;
+  stats.total_wait_ns += timings.wait_ns;
+
+  last = timings;
+
+  if (on_frame) {
+    on_frame(last);
+  }
+}
+
+/* See `GlProfiler::calibrate()`. */
+void GlPresenter::calibrate() {
+
+  GLint64 gpu_ns = 0;
+  uint64_t before = gpu_sync_now_ns();
+  glGetInteger64v(GL_TIMESTAMP, &gpu_ns);
+  uint64_t after = gpu_sync_now_ns();
+
+  gpu_to_cpu_ns = (int64_t)(before + (after - before) / 2) - (int64_t)gpu_ns;
+}
+
+/* ------------------------------------------------------------- */
+
+const char* present_mode_to_string(PresentMode mode) {
+
+  switch (mode) {
+    case PRESENT_MODE_IMMEDIATE: { return "immediate"; }
+    case PRESENT_MODE_VSYNC:     { return "vsync";     }
+    case PRESENT_MODE_ADAPTIVE:  { return "adaptive";  }
+    default:                     { return "unknown";   }
+  }
+}
+
+/* ------------------------------------------------------------- */
+
+#if defined(_WIN32)
+static bool has_wgl_extension(HDC dc, const char* name) {
+
+  PFNWGLGETEXTENSIONSSTRINGARBPROC get_extensions = reinterpret_cast<PFNWGLGETEXTENSIONSSTRINGARBPROC>(wglGetProcAddress("wglGetExtensionsStringARB"));
+  if (nullptr == get_extensions) {
+    return false;
+  }
+
+  return has_extension(get_extensions(dc), name);
+}
+#endif
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,197 @@
+/*
+
+  GL PRESENTER
+  =============
+
+  Presents the frames of a `GlContext` and paces them to the
+  display. It manages the swap interval, adaptive vsync and a
+  "just in time" frame start that cuts the input-to-photon
+  latency, and it records the timestamps of every frame.
+
+    presenter.init(&ctx);                      // `ctx` is current
+    presenter.set_swap(PRESENT_MODE_ADAPTIVE, 1);
+    presenter.is_low_latency = true;
+
+    while (...) {
+      presenter.begin_frame();                 // may sleep; then sample the input
+      ... render ...
+      presenter.present();                     // swaps
+    }
+
+    presenter.print();
+
+  Modes (`set_swap()`):
+
+  - `PRESENT_MODE_IMMEDIATE`: swap interval 0; the frame is shown
+    as soon as the GPU finished it, it tears.
+  - `PRESENT_MODE_VSYNC`: the frame is shown at a vblank, at most
+    one frame every `swap_interval` refreshes. A frame that is
+    late waits for the next vblank.
+  - `PRESENT_MODE_ADAPTIVE`: vsync, but a late frame is shown
+    right away (it tears) instead of waiting a whole refresh
+    (`WGL_EXT_swap_control_tear`, a negative swap interval). When
+    the driver doesn't support it, `mode` is reset to
+    `PRESENT_MODE_VSYNC`.
+
+  With vsync, a frame that starts right after the previous swap
+  returned is shown about one refresh after the input was
+  sampled. When `is_low_latency` is set, `begin_frame()` sleeps
+  until `predicted_ns + margin_ns` before the vblank that the
+  frame targets, where `predicted_ns` is the longest time from
+  `begin_frame()` until the GPU finished, of the last
+  `num_predict_frames` frames. `wait_before_swap()` blocks until
+  `margin_ns` before the vblank (`WGL_NV_delay_before_swap` when
+  available), so you can update late latched data (e.g. the
+  camera) right before `present()`; what's left of the frame,
+  GPU included, must fit in `margin_ns`.
+
+  The vblanks are predicted from `refresh_ns` and `vblank_ns`,
+  the last vblank we know of: a vsynced swap that blocked returns
+  right after a vblank, so we take its return time. On Windows
+  `refresh_ns` comes from the display; EGL has no way to ask, so
+  set it yourself when the display isn't 60 Hz.
+
+  For every frame we record (see `PresentTimings`) when
+  `begin_frame()` returned, when the CPU submitted the frame,
+  when the swap returned, when the GPU finished it (a
+  `GL_TIMESTAMP` query, collected without blocking like the
+  `GlProfiler` does) and when it was shown. The finished frames
+  are passed to `on_frame` and summed in `stats`.
+
+  `PRESENT_BACKEND_SIMULATED` doesn't touch GL: the swaps are
+  presented to a simulated display (`sim`) with a vblank clock
+  that only moves when the presenter waits or when you advance
+  `sim.now_ns` to simulate CPU work; `sim.gpu_ns` is the GPU time
+  of a frame. The pacing logic is the same, so it can be tested
+  without a GPU or a display.
+
+  Must be used on one thread, with the context current.
+
+ */
+#ifndef GL_PRESENTER_H
+#define GL_PRESENTER_H
+
+#include <stdint.h>
+#include <vector>
+#include <functional>
+#include <gl-context.h>
+
+/* ----------------------------------------------------------- */
+
+enum PresentMode {
+  PRESENT_MODE_IMMEDIATE,                      /* Swap interval 0; tears. */
+  PRESENT_MODE_VSYNC,                          /* Shown at a vblank; late frames wait a refresh. */
+  PRESENT_MODE_ADAPTIVE,                       /* Vsync, but late frames are shown right away. */
+};
+
+enum PresentBackend {
+  PRESENT_BACKEND_DRIVER,                      /* Swaps the surface of the context. */
+  PRESENT_BACKEND_SIMULATED,                   /* Presents to `sim`; no GL. */
+};
+
+/* ----------------------------------------------------------- */
+
+struct PresentTimings {
+  uint64_t frame = 0;
+  uint64_t wait_ns = 0;                        /* How long `begin_frame()` slept. */
+  uint64_t begin_ns = 0;                       /* `begin_frame()` returned; the input is sampled after this. */
+  uint64_t target_ns = 0;                      /* The vblank we aimed for. */
+  uint64_t delay_ns = 0;                       /* How long `wait_before_swap()` blocked; not part of the predicted cost. */
+  uint64_t submit_ns = 0;                      /* `present()` was called; the CPU is done with the frame. */
+  uint64_t swap_ns = 0;                        /* The swap returned. */
+  uint64_t gpu_ns = 0;                         /* The GPU finished the frame; 0 when the query was dropped. */
+  uint64_t display_ns = 0;                     /* The frame was shown; predicted with the driver backend. */
+  bool is_missed = false;                      /* Shown after `target_ns`. */
+  bool is_torn = false;                        /* Shown between two vblanks. */
+};
+
+struct PresentStats {
+  uint64_t num_frames = 0;
+  uint64_t num_missed = 0;
+  uint64_t num_torn = 0;
+  uint64_t total_latency_ns = 0;               /* `begin_ns` until `display_ns`. */
+  uint64_t max_latency_ns = 0;
+  uint64_t total_cpu_ns = 0;                   /* `begin_ns` until `submit_ns`. */
+  uint64_t max_cpu_ns = 0;
+  uint64_t total_swap_ns = 0;                  /* `submit_ns` until `swap_ns`. */
+  uint64_t max_swap_ns = 0;
+  uint64_t total_wait_ns = 0;
+};
+
+struct SimulatedDisplay {
+  uint64_t now_ns = 0;                         /* The simulated clock; advance it to simulate CPU work. */
+  uint64_t refresh_ns = 16666667;
+  uint64_t phase_ns = 0;                       /* The time of the first vblank. */
+  uint64_t gpu_ns = 0;                         /* The GPU time of the next frames. */
+  uint64_t gpu_done_ns = 0;                    /* When the GPU finishes the last submitted frame. */
+  uint64_t last_flip_ns = 0;
+  uint64_t num_flips = 0;
+};
+
+/* ----------------------------------------------------------- */
+
+class GlPresenter {
+public:
+  GlPresenter() = default;
+  GlPresenter(const GlPresenter&) = delete;
+  GlPresenter& operator=(const GlPresenter&) = delete;
+  int init(GlContext* ctx, PresentBackend backend = PRESENT_BACKEND_DRIVER); /* `ctx` is nullptr for the simulated backend. */
+  int shutdown();
+  int set_swap(PresentMode mode, uint32_t interval = 1);
+  int begin_frame();
+  int wait_before_swap();                      /* Optional; between `begin_frame()` and `present()`. */
+  int present();
+  int collect();                               /* Returns the number of frames finished; never blocks. Called by `begin_frame()`. */
+  uint64_t get_next_vblank(uint64_t time_ns);  /* The first predicted vblank at or after `time_ns`. */
+  uint64_t now();                              /* `gpu_sync_now_ns()` or `sim.now_ns`. */
+  void print();                                /* Prints `stats`. */
+
+public:
+  GlContext* ctx = nullptr;
+  PresentBackend backend = PRESENT_BACKEND_DRIVER;
+  PresentMode mode = PRESENT_MODE_VSYNC;
+  uint32_t swap_interval = 1;
+  uint64_t refresh_ns = 16666667;
+  uint64_t vblank_ns = 0;                      /* The last vblank we know of. */
+  bool is_low_latency = false;                 /* Start the frames just in time for their vblank. */
+  uint64_t margin_ns = 2000000;                /* Slack for the just in time start and `wait_before_swap()`. */
+  uint64_t predicted_ns = 0;                   /* The predicted time from `begin_frame()` until the GPU finished. */
+  uint32_t num_predict_frames = 16;
+  std::vector<uint64_t> costs;                 /* The last `num_predict_frames` costs that `predicted_ns` is based on. */
+  std::vector<PresentTimings> pending;         /* Driver: waiting for their GPU timestamps, oldest first. */
+  std::vector<GLuint> queries;                 /* Driver: the `GL_TIMESTAMP` pool, `max_pending` of them. */
+  uint32_t max_pending = 4;
+  PresentTimings current;
+  PresentTimings last;                         /* The last finished frame. */
+  PresentStats stats;
+  std::function<void(const PresentTimings& timings)> on_frame; /* Optional. */
+  SimulatedDisplay sim;
+  uint64_t frame_number = 0;
+  uint64_t last_display_ns = 0;                /* When the previous frame is shown (predicted). */
+  int64_t gpu_to_cpu_ns = 0;                   /* See `GlProfiler`. */
+  uint32_t calibrate_interval = 60;
+  bool is_in_frame = false;
+  bool has_adaptive = false;
+  bool has_delay_before_swap = false;
+  uint64_t num_dropped = 0;                    /* GPU timestamps that weren't available in time. */
+#if defined(_WIN32)
+  PFNWGLSWAPINTERVALEXTPROC wglSwapIntervalEXT = nullptr;
+  PFNWGLDELAYBEFORESWAPNVPROC wglDelayBeforeSwapNV = nullptr;
+#endif
+
+private:
+  uint64_t get_target(uint64_t start_ns);
+  void sleep_until(uint64_t time_ns);
+  int swap();
+  void simulate_swap();
+  void finish_frame(PresentTimings& timings);
+  void calibrate();
+};
+
+/* ----------------------------------------------------------- */
+
+const char* present_mode_to_string(PresentMode mode);
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,417 @@
+#include <stdio.h>
+#include <gl-profiler.h>
+#include <gl-sync.h>
+
+/* ------------------------------------------------------------- */
+
+static const uint32_t initial_queries_per_frame = 64;
+
+/* ------------------------------------------------------------- */
+
+static void write_event(FILE* fp, bool& is_first, const char* name, uint32_t tid, double ts_us, double dur_us);
+static void write_thread_name(FILE* fp, bool& is_first, uint32_t tid, const char* name, const char* suffix);
+static void write_escaped(FILE* fp, const char* str);
+
+/* ------------------------------------------------------------- */
+
+int GlProfiler::init(const char* profiler_name, uint32_t num_frames) {
+
+  if (false == frames.empty()) {
+    printf("Cannot initialize the profiler, already initialized.\n");
+    return -1;
+  }
+
+  if (0 == GLAD_GL_VERSION_3_3 && 0 == GLAD_GL_ARB_timer_query) {
+    printf("Cannot initialize the profiler, timer queries aren't supported.\n");
+    return -2;
+  }
+
+  /* We need at least one frame in flight besides the one we record. */
+  if (num_frames < 2) {
+    printf("Cannot initialize the profiler, we need at least 2 frames.\n");
+    return -3;
+  }
+
+  name = (nullptr == profiler_name) ? "GL" : profiler_name;
+  thread = std::this_thread::get_id();
+  frames.resize(num_frames);
+
+  for (size_t i = 0; i < frames.size(); ++i) {
+    frames[i].queries.resize(initial_queries_per_frame, 0);
+    glGenQueries(initial_queries_per_frame, frames[i].queries.data());
+  }
+
+  stack.clear();
+  last_frame.clear();
+  trace.clear();
+  frame_index = 0;
+  frame_number = 0;
+  is_in_frame = false;
+  num_collected = 0;
+  num_dropped = 0;
+  num_trace_dropped = 0;
+
+  calibrate();
+
+  return 0;
+}
+
+int GlProfiler::shutdown() {
+
+  for (size_t i = 0; i < frames.size(); ++i) {
+    if (false == frames[i].queries.empty()) {
+      glDeleteQueries((GLsizei)frames[i].queries.size(), frames[i].queries.data());
+    }
+  }
+
+  frames.clear();
+  stack.clear();
+  is_in_frame = false;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int GlProfiler::begin_frame() {
+
+  if (true == frames.empty()) {
+    printf("Cannot begin the frame, the profiler isn't initialized.\n");
+    return -1;
+  }
+
+  if (true == is_in_frame) {
+    printf("Cannot begin the frame, `end_frame()` wasn't called.\n");
+    return -2;
+  }
+
+  collect();
+
+  /* The GPU is more than `num_frames` behind; we rather lose a frame than wait. */
+  ProfileFrame& frame = frames[frame_index];
+  if (true == frame.is_pending) {
+    frame.is_pending = false;
+    num_dropped++;
+  }
+
+  if (0 != calibrate_interval && 0 == (frame_number % calibrate_interval)) {
+    calibrate();
+  }
+
+  frame.number = frame_number;
+  frame.scopes.clear();
+  frame.num_queries = 0;
+  stack.clear();
+  is_in_frame = true;
+
+  return begin("frame", true);
+}
+
+int GlProfiler::end_frame() {
+
+  if (false == is_in_frame) {
+    printf("Cannot end the frame, `begin_frame()` wasn't called.\n");
+    return -1;
+  }
+
+  if (1 != stack.size()) {
+    printf("Cannot end the frame, %zu scope(s) are still open.\n", stack.size() - 1);
+    return -2;
+  }
+
+  end_scope();
+
+  frames[frame_index].is_pending = true;
+  frame_index = (frame_index + 1) % frames.size();
+  frame_number++;
+  is_in_frame = false;
+
+  return 0;
+}
+
+int GlProfiler::begin_scope(const char* scope_name) {
+  return begin(scope_name, true);
+}
+
+int GlProfiler::begin_cpu_scope(const char* scope_name) {
+  return begin(scope_name, false);
+}
+
+int GlProfiler::end_scope() {
+
+  if (true == stack.empty()) {
+    printf("Cannot end the scope, there is no open scope.\n");
+    return -1;
+  }
+
+  ProfileFrame& frame = frames[frame_index];
+  ProfileScope& scope = frame.scopes[stack.back()];
+
+  if (PROFILER_NONE != scope.begin_query) {
+    glQueryCounter(get_query(frame, scope.end_query), GL_TIMESTAMP);
+  }
+
+  scope.cpu_end_ns = gpu_sync_now_ns();
+  stack.pop_back();
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+/* Collects the oldest frames first so `trace` stays in order. */
+int GlProfiler::collect() {
+
+  int num = 0;
+
+  for (size_t i = 0; i < frames.size(); ++i) {
+
+    ProfileFrame& frame = frames[(frame_index + i) % frames.size()];
+    if (false == frame.is_pending) {
+      continue;
+    }
+
+    if (1 != collect_frame(frame)) {
+      break;
+    }
+
+    num++;
+  }
+
+  return num;
+}
+
+void GlProfiler::print() {
+
+  if (true == last_frame.empty()) {
+    printf("%s: no frames collected yet.\n", name);
+    return;
+  }
+
+  printf("%s: frame %llu\n", name, (unsigned long long)last_frame[0].frame);
+
+  for (size_t i = 0; i < last_frame.size(); ++i) {
+
+    const ProfileScope& scope = last_frame[i];
+    double cpu_ms = (scope.cpu_end_ns - scope.cpu_begin_ns) / 1e6;
+
+    if (PROFILER_NONE == scope.begin_query) {
+      printf("  %*s%-*s cpu: %8.3f ms\n", scope.depth * 2, "", 24 - scope.depth * 2, scope.name, cpu_ms);
+    }
+    else {
+      double gpu_ms = (scope.gpu_end_ns - scope.gpu_begin_ns) / 1e6;
+      printf("  %*s%-*s cpu: %8.3f ms, gpu: %8.3f ms\n", scope.depth * 2, "", 24 - scope.depth * 2, scope.name, cpu_ms, gpu_ms);
+    }
+  }
+}
+
+/* ------------------------------------------------------------- */
+
+int GlProfiler::begin(const char* scope_name, bool is_gpu) {
+
+  if (false == is_in_frame) {
+    printf("Cannot begin the scope `%s`, call `begin_frame()` first.\n", scope_name);
+    return -1;
+  }
+
+  ProfileFrame& frame = frames[frame_index];
+
+  ProfileScope scope;
+  scope.name = scope_name;
+  scope.depth = (uint32_t)stack.size();
+  scope.parent = (true == stack.empty()) ? PROFILER_NONE : stack.back();
+  scope.frame = frame.number;
+  scope.cpu_begin_ns = gpu_sync_now_ns();
+
+  if (true == is_gpu) {
+    glQueryCounter(get_query(frame, scope.begin_query), GL_TIMESTAMP);
+  }
+
+  stack.push_back((uint32_t)frame.scopes.size());
+  frame.scopes.push_back(scope);
+
+  return 0;
+}
+
+/*
+  The queries of a frame finish in order, so when the last one
+  (the end of the "frame" scope) is available, all of them are.
+  Returns 1 when collected, 0 when the results aren't there yet.
+*/
+int GlProfiler::collect_frame(ProfileFrame& frame) {
+
+  if (0 == frame.num_queries) {
+    frame.is_pending = false;
+    return 1;
+  }
+
+  GLuint available = GL_FALSE;
+  glGetQueryObjectuiv(frame.queries[frame.num_queries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+  if (GL_FALSE == available) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < frame.scopes.size(); ++i) {
+
+    ProfileScope& scope = frame.scopes[i];
+    if (PROFILER_NONE == scope.begin_query || PROFILER_NONE == scope.end_query) {
+      continue;
+    }
+
+    GLuint64 begin_ns = 0;
+    GLuint64 end_ns = 0;
+    glGetQueryObjectui64v(frame.queries[scope.begin_query], GL_QUERY_RESULT, &begin_ns);
+    glGetQueryObjectui64v(frame.queries[scope.end_query], GL_QUERY_RESULT, &end_ns);
+
+    scope.gpu_begin_ns = (uint64_t)((int64_t)begin_ns + gpu_to_cpu_ns);
+    scope.gpu_end_ns = (uint64_t)((int64_t)end_ns + gpu_to_cpu_ns);
+  }
+
+  last_frame = frame.scopes;
+
+  if (trace.size() + frame.scopes.size() <= max_trace_scopes) {
+    trace.insert(trace.end(), frame.scopes.begin(), frame.scopes.end());
+  }
+  else {
+    num_trace_dropped += frame.scopes.size();
+  }
+
+  frame.is_pending = false;
+  num_collected++;
+
+  return 1;
+}
+
+GLuint GlProfiler::get_query(ProfileFrame& frame, uint32_t& index) {
+
+  if (frame.num_queries == frame.queries.size()) {
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    frame.queries.push_back(query);
+  }
+
+  index = frame.num_queries++;
+
+  return frame.queries[index];
+}
+
+/* `glGetInteger64v(GL_TIMESTAMP)` returns the GPU time now; we take the CPU time around it. */
+void GlProfiler::calibrate() {
+
+  GLint64 gpu_ns = 0;
+  uint64_t before = gpu_sync_now_ns();
+  glGetInteger64v(GL_TIMESTAMP, &gpu_ns);
+  uint64_t after = gpu_sync_now_ns();
+
+  gpu_to_cpu_ns = (int64_t)(before + (after - before) / 2) - (int64_t)gpu_ns;
+}
+
+/* ------------------------------------------------------------- */
+
+/*
+  Chrome trace event format: each profiler gets a CPU and a GPU
+  track in the same process; times are in microseconds relative
+  to the first scope.
+*/
+int gl_profiler_write_trace(const char* path, GlProfiler** profilers, size_t num_profilers) {
+
+  if (nullptr == path || nullptr == profilers) {
+    printf("Cannot write the trace, invalid arguments.\n");
+    return -1;
+  }
+
+  uint64_t origin = UINT64_MAX;
+
+  for (size_t i = 0; i < num_profilers; ++i) {
+    for (const ProfileScope& scope : profilers[i]->trace) {
+      origin = (scope.cpu_begin_ns < origin) ? scope.cpu_begin_ns : origin;
+      if (0 != scope.gpu_begin_ns && scope.gpu_begin_ns < origin) {
+        origin = scope.gpu_begin_ns;
+      }
+    }
+  }
+
+  FILE* fp = fopen(path, "wb");
+  if (nullptr == fp) {
+    printf("Cannot write the trace, failed to open `%s`.\n", path);
+    return -2;
+  }
+
+  bool is_first = true;
+  fprintf(fp, "{\"traceEvents\":[\n");
+
+  for (size_t i = 0; i < num_profilers; ++i) {
+
+    const GlProfiler* profiler = profilers[i];
+    uint32_t cpu_tid = (uint32_t)(i * 2 + 1);
+    uint32_t gpu_tid = (uint32_t)(i * 2 + 2);
+
+    write_thread_name(fp, is_first, cpu_tid, profiler->name, " CPU");
+    write_thread_name(fp, is_first, gpu_tid, profiler->name, " GPU");
+
+    for (const ProfileScope& scope : profiler->trace) {
+
+      write_event(fp,
+                  is_first,
+                  scope.name,
+                  cpu_tid,
+                  (scope.cpu_begin_ns - origin) / 1e3,
+                  (scope.cpu_end_ns - scope.cpu_begin_ns) / 1e3);
+
+      if (PROFILER_NONE == scope.begin_query || 0 == scope.gpu_begin_ns) {
+        continue;
+      }
+
+      write_event(fp,
+                  is_first,
+                  scope.name,
+                  gpu_tid,
+                  ((int64_t)scope.gpu_begin_ns - (int64_t)origin) / 1e3,
+                  ((int64_t)scope.gpu_end_ns - (int64_t)scope.gpu_begin_ns) / 1e3);
+    }
+  }
+
+  fprintf(fp, "\n]}\n");
+
+  if (0 != fclose(fp)) {
+    printf("Failed to write the trace to `%s`.\n", path);
+    return -3;
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+static void write_event(FILE* fp, bool& is_first, const char* name, uint32_t tid, double ts_us, double dur_us) {
+
+  fprintf(fp, "%s{\"name\":\"", (true == is_first) ? "" : ",\n");
+  write_escaped(fp, name);
+  fprintf(fp, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", tid, ts_us, dur_us);
+
+  is_first = false;
+}
+
+static void write_thread_name(FILE* fp, bool& is_first, uint32_t tid, const char* name, const char* suffix) {
+
+  fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", (true == is_first) ? "" : ",\n", tid);
+  write_escaped(fp, name);
+  fprintf(fp, "%s\"}}", suffix);
+
+  is_first = false;
+}
+
+static void write_escaped(FILE* fp, const char* str) {
+
+  for (const char* c = str; nullptr != c && '\0' != *c; ++c) {
+    if ('"' == *c || '\\' == *c) {
+      fputc('\\', fp);
+    }
+    if ((unsigned char)*c >= 0x20) {
+      fputc(*c, fp);
+    }
+  }
+}
+
+/* ------------------------------------------------------------- */
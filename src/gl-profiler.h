@@ -0,0 +1,130 @@
+/*
+
+  GL PROFILER
+  ============
+
+  Measures how long the passes of a frame take on the GPU and on
+  the CPU. Every scope puts a `GL_TIMESTAMP` query
+  (`glQueryCounter()`) at its begin and end. We use timestamps
+  instead of `GL_TIME_ELAPSED` because elapsed queries can't be
+  nested, timestamps can.
+
+    profiler.init("render");
+
+    profiler.begin_frame();
+      profiler.begin_scope("shadows");
+        ...
+      profiler.end_scope();
+      profiler.begin_scope("opaque");
+        profiler.begin_cpu_scope("cull"); ... profiler.end_scope();
+        ...
+      profiler.end_scope();
+    profiler.end_frame();
+
+  Query results are only read when they're available: each frame
+  has its own pool of query objects and there are `num_frames`
+  of them. `begin_frame()` collects the results of all frames
+  that are ready without blocking. When the pool of a frame is
+  needed again while its results still aren't available, the
+  results of that frame are dropped (see `num_dropped`) instead
+  of stalling the CPU.
+
+  `begin_frame()` opens a root scope named "frame", so each frame
+  is one tree. The last collected tree is kept in `last_frame`
+  (see `print()`); all collected scopes are kept in `trace` until
+  `max_trace_scopes` is reached.
+
+  GPU timestamps are converted to our CPU clock
+  (`gpu_sync_now_ns()`) by comparing `glGetInteger64v(GL_TIMESTAMP)`
+  with the CPU time, which we redo every `calibrate_interval`
+  frames. `gl_profiler_write_trace()` writes the CPU and GPU
+  scopes of one or more profilers (e.g. one per context thread)
+  into one Chrome trace file (chrome://tracing or Perfetto).
+
+  A profiler must be used on one thread, with the same context
+  current as with `init()`.
+
+ */
+#ifndef GL_PROFILER_H
+#define GL_PROFILER_H
+
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <glad/glad.h>
+
+/* ----------------------------------------------------------- */
+
+#define PROFILER_NONE 0xFFFFFFFFu
+
+/* ----------------------------------------------------------- */
+
+struct ProfileScope {
+  const char* name = nullptr;                  /* Not copied; use string literals. */
+  uint32_t depth = 0;
+  uint32_t parent = PROFILER_NONE;             /* Index into the scopes of the same frame. */
+  uint32_t begin_query = PROFILER_NONE;        /* PROFILER_NONE for CPU only scopes. */
+  uint32_t end_query = PROFILER_NONE;
+  uint64_t frame = 0;
+  uint64_t cpu_begin_ns = 0;
+  uint64_t cpu_end_ns = 0;
+  uint64_t gpu_begin_ns = 0;                   /* In the CPU clock; 0 until collected. */
+  uint64_t gpu_end_ns = 0;
+};
+
+struct ProfileFrame {
+  uint64_t number = 0;
+  std::vector<ProfileScope> scopes;
+  std::vector<GLuint> queries;                 /* The pool; grows when a frame has more scopes. */
+  uint32_t num_queries = 0;                    /* Used this frame. */
+  bool is_pending = false;                     /* Ended, waiting for the query results. */
+};
+
+/* ----------------------------------------------------------- */
+
+class GlProfiler {
+public:
+  GlProfiler() = default;
+  GlProfiler(const GlProfiler&) = delete;
+  GlProfiler& operator=(const GlProfiler&) = delete;
+  int init(const char* name, uint32_t num_frames = 4);
+  int shutdown();
+  int begin_frame();
+  int end_frame();
+  int begin_scope(const char* name);           /* GPU and CPU. */
+  int begin_cpu_scope(const char* name);       /* CPU only. */
+  int end_scope();                             /* Ends the innermost scope, GPU or CPU. */
+  int collect();                               /* Returns the number of frames collected; never blocks. */
+  void print();                                /* Prints `last_frame`. */
+
+public:
+  const char* name = nullptr;
+  std::thread::id thread;
+  std::vector<ProfileFrame> frames;
+  std::vector<uint32_t> stack;                 /* Open scopes of the current frame. */
+  std::vector<ProfileScope> last_frame;
+  std::vector<ProfileScope> trace;
+  size_t max_trace_scopes = 1024 * 1024;
+  uint32_t frame_index = 0;
+  uint64_t frame_number = 0;
+  bool is_in_frame = false;
+  int64_t gpu_to_cpu_ns = 0;                   /* Add to a GPU timestamp to get the CPU time. */
+  uint32_t calibrate_interval = 60;
+  uint64_t num_collected = 0;                  /* Stats */
+  uint64_t num_dropped = 0;
+  uint64_t num_trace_dropped = 0;
+
+private:
+  int begin(const char* name, bool is_gpu);
+  int collect_frame(ProfileFrame& frame);
+  GLuint get_query(ProfileFrame& frame, uint32_t& index);
+  void calibrate();
+};
+
+/* ----------------------------------------------------------- */
+
+int gl_profiler_write_trace(const char* path, GlProfiler** profilers, size_t num_profilers);
+
+/* ----------------------------------------------------------- */
+
+#endif
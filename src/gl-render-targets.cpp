@@ -0,0 +1,611 @@
+#include <stdio.h>
+#include <algorithm>
+#include <gl-render-targets.h>
+#include <gl-memory-monitor.h>
+#include <gl-resource.h>
+
+/* ------------------------------------------------------------- */
+
+static bool is_same_desc(const RenderTargetDesc& a, const RenderTargetDesc& b);
+static uint64_t get_desc_bytes(const RenderTargetDesc& desc);
+static int create_texture(const RenderTargetDesc& desc, GLuint& texture);
+static bool is_color_attachment(GLenum attachment);
+
+/* ------------------------------------------------------------- */
+
+int GlRenderTargets::init(GlMemoryMonitor* mon) {
+
+  if (false == resources.empty() || false == framebuffers.empty()) {
+    printf("Cannot initialize the render targets, already initialized.\n");
+    return -1;
+  }
+
+  monitor = mon;
+  frame = 0;
+  is_in_frame = false;
+  is_compiled = false;
+  has_invalidate = (0 != GLAD_GL_VERSION_4_3 || 0 != GLAD_GL_ARB_invalidate_subdata);
+  stats = RenderTargetStats();
+
+  return 0;
+}
+
+int GlRenderTargets::shutdown() {
+
+  for (RenderTargetFramebuffer& fb : framebuffers) {
+    glDeleteFramebuffers(1, &fb.name);
+  }
+
+  for (RenderTargetResource& res : resources) {
+
+    glDeleteTextures(1, &res.texture);
+
+    if (nullptr != monitor) {
+      monitor->remove(MEMORY_RENDER_TARGET, res.bytes);
+    }
+  }
+
+  stats.num_deleted += resources.size();
+  stats.pool_bytes = 0;
+
+  framebuffers.clear();
+  resources.clear();
+  passes.clear();
+  targets.clear();
+  order.clear();
+  is_in_frame = false;
+  is_compiled = false;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int GlRenderTargets::begin_frame() {
+
+  if (true == is_in_frame) {
+    printf("Cannot begin the frame, `end_frame()` wasn't called.\n");
+    return -1;
+  }
+
+  passes.clear();
+  targets.clear();
+  frame++;
+  is_in_frame = true;
+  is_compiled = false;
+
+  return 0;
+}
+
+uint32_t GlRenderTargets::add_pass(const char* name) {
+
+  if (false == is_in_frame || true == is_compiled) {
+    printf("Cannot add the pass, passes are added between `begin_frame()` and `compile()`.\n");
+    return RENDER_TARGET_NONE;
+  }
+
+  RenderPass pass;
+  pass.name = (nullptr != name) ? name : "";
+  passes.push_back(pass);
+
+  return (uint32_t)passes.size() - 1;
+}
+
+uint32_t GlRenderTargets::create(const RenderTargetDesc& desc, const char* name) {
+
+  if (false == is_in_frame || true == is_compiled) {
+    printf("Cannot create the render target, targets are created between `begin_frame()` and `compile()`.\n");
+    return RENDER_TARGET_NONE;
+  }
+
+  if (0 >= desc.width || 0 >= desc.height) {
+    printf("Cannot create the render target, invalid size %d x %d.\n", desc.width, desc.height);
+    return RENDER_TARGET_NONE;
+  }
+
+  RenderTarget target;
+  target.desc = desc;
+  target.name = (nullptr != name) ? name : "";
+  targets.push_back(target);
+
+  return (uint32_t)targets.size() - 1;
+}
+
+uint32_t GlRenderTargets::import(GLuint texture, const RenderTargetDesc& desc, const char* name) {
+
+  if (0 == texture) {
+    printf("Cannot import the render target, texture is 0.\n");
+    return RENDER_TARGET_NONE;
+  }
+
+  uint32_t dx = create(desc, name);
+  if (RENDER_TARGET_NONE == dx) {
+    return RENDER_TARGET_NONE;
+  }
+
+  targets[dx].imported = texture;
+
+  return dx;
+}
+
+int GlRenderTargets::write(uint32_t pass, uint32_t target, GLenum attachment) {
+
+  if (false == is_in_frame || true == is_compiled) {
+    printf("Cannot declare the write, do this between `begin_frame()` and `compile()`.\n");
+    return -1;
+  }
+
+  if (pass >= passes.size() || target >= targets.size()) {
+    printf("Cannot declare the write, invalid pass %u or target %u.\n", pass, target);
+    return -2;
+  }
+
+  RenderPass& rp = passes[pass];
+  RenderTarget& rt = targets[target];
+
+  if (RENDER_TARGET_MAX_ATTACHMENTS == rp.num_attachments) {
+    printf("Cannot declare the write, pass `%s` has too many attachments.\n", rp.name.c_str());
+    return -3;
+  }
+
+  for (uint32_t i = 0; i < rp.num_attachments; ++i) {
+
+    const RenderTargetDesc& other = targets[rp.attachments[i].target].desc;
+
+    if (rp.attachments[i].attachment == attachment) {
+      printf("Cannot declare the write, pass `%s` already has attachment 0x%04x.\n", rp.name.c_str(), attachment);
+      return -4;
+    }
+
+    if (other.width != rt.desc.width || other.height != rt.desc.height || other.samples != rt.desc.samples) {
+      printf("Cannot declare the write, the attachments of pass `%s` must have the same size and samples.\n", rp.name.c_str());
+      return -5;
+    }
+  }
+
+  rp.attachments[rp.num_attachments].target = target;
+  rp.attachments[rp.num_attachments].attachment = attachment;
+  rp.num_attachments++;
+
+  rt.first_pass = (RENDER_TARGET_NONE == rt.first_pass || pass < rt.first_pass) ? pass : rt.first_pass;
+  rt.last_pass = (RENDER_TARGET_NONE == rt.last_pass || pass > rt.last_pass) ? pass : rt.last_pass;
+
+  return 0;
+}
+
+int GlRenderTargets::read(uint32_t pass, uint32_t target) {
+
+  if (false == is_in_frame || true == is_compiled) {
+    printf("Cannot declare the read, do this between `begin_frame()` and `compile()`.\n");
+    return -1;
+  }
+
+  if (pass >= passes.size() || target >= targets.size()) {
+    printf("Cannot declare the read, invalid pass %u or target %u.\n", pass, target);
+    return -2;
+  }
+
+  RenderTarget& rt = targets[target];
+
+  /* A transient target has no content before it's written; an imported one has. */
+  if (0 == rt.imported && (RENDER_TARGET_NONE == rt.first_pass || rt.first_pass >= pass)) {
+    printf("Cannot declare the read, target `%s` isn't written by a pass before `%s`.\n", rt.name.c_str(), passes[pass].name.c_str());
+    return -3;
+  }
+
+  rt.first_pass = (RENDER_TARGET_NONE == rt.first_pass || pass < rt.first_pass) ? pass : rt.first_pass;
+  rt.last_pass = (RENDER_TARGET_NONE == rt.last_pass || pass > rt.last_pass) ? pass : rt.last_pass;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+/*
+  Greedy interval assignment: the targets are handled by their
+  first pass; a texture is free for a target when the target
+  that had it before ended in an earlier pass.
+*/
+int GlRenderTargets::compile() {
+
+  if (false == is_in_frame || true == is_compiled) {
+    printf("Cannot compile, call `compile()` once between `begin_frame()` and `end_frame()`.\n");
+    return -1;
+  }
+
+  order.clear();
+
+  for (uint32_t i = 0; i < targets.size(); ++i) {
+    if (0 == targets[i].imported && RENDER_TARGET_NONE != targets[i].first_pass) {
+      order.push_back(i);
+    }
+  }
+
+  std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    if (targets[a].first_pass != targets[b].first_pass) {
+      return targets[a].first_pass < targets[b].first_pass;
+    }
+    return a < b;
+  });
+
+  for (RenderTargetResource& res : resources) {
+    res.busy_until = RENDER_TARGET_NONE;
+  }
+
+  stats.num_targets = (uint32_t)order.size();
+  stats.num_resources = 0;
+  stats.requested_bytes = 0;
+  stats.used_bytes = 0;
+
+  for (uint32_t dx : order) {
+
+    RenderTarget& rt = targets[dx];
+    uint32_t found = RENDER_TARGET_NONE;
+
+    stats.requested_bytes += get_desc_bytes(rt.desc);
+
+    for (uint32_t i = 0; i < resources.size(); ++i) {
+
+      const RenderTargetResource& res = resources[i];
+
+      if (false == is_same_desc(res.desc, rt.desc)) {
+        continue;
+      }
+
+      if (RENDER_TARGET_NONE == res.busy_until || res.busy_until < rt.first_pass) {
+        found = i;
+        break;
+      }
+    }
+
+    if (RENDER_TARGET_NONE == found) {
+
+      RenderTargetResource res;
+      res.desc = rt.desc;
+      res.bytes = get_desc_bytes(rt.desc);
+
+      if (0 != create_texture(rt.desc, res.texture)) {
+        printf("Failed to create the texture for render target `%s`.\n", rt.name.c_str());
+        return -2;
+      }
+
+      if (nullptr != monitor) {
+        monitor->add(MEMORY_RENDER_TARGET, res.bytes);
+      }
+
+      resources.push_back(res);
+      found = (uint32_t)resources.size() - 1;
+      stats.num_created++;
+      stats.pool_bytes += res.bytes;
+    }
+
+    RenderTargetResource& res = resources[found];
+
+    if (RENDER_TARGET_NONE == res.busy_until) {
+      stats.num_resources++;
+      stats.used_bytes += res.bytes;
+    }
+
+    res.busy_until = rt.last_pass;
+    res.last_used_frame = frame;
+    rt.resource = found;
+  }
+
+  is_compiled = true;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int GlRenderTargets::begin_pass(uint32_t pass) {
+
+  if (false == is_compiled) {
+    printf("Cannot begin the pass, call `compile()` first.\n");
+    return -1;
+  }
+
+  if (pass >= passes.size()) {
+    printf("Cannot begin the pass, invalid pass %u.\n", pass);
+    return -2;
+  }
+
+  RenderPass& rp = passes[pass];
+
+  /* A pass that only reads (e.g. a compute pass) doesn't need a framebuffer. */
+  if (0 == rp.num_attachments) {
+    return 0;
+  }
+
+  GLuint textures[RENDER_TARGET_MAX_ATTACHMENTS] = { 0 };
+
+  for (uint32_t i = 0; i < rp.num_attachments; ++i) {
+    textures[i] = get_texture(rp.attachments[i].target);
+  }
+
+  /* Find the framebuffer with the same textures on the same attachments. */
+  RenderTargetFramebuffer* fb = nullptr;
+
+  for (RenderTargetFramebuffer& cached : framebuffers) {
+
+    if (cached.num_attachments != rp.num_attachments) {
+      continue;
+    }
+
+    bool is_same = true;
+
+    for (uint32_t i = 0; i < rp.num_attachments && true == is_same; ++i) {
+      is_same = (cached.attachments[i] == rp.attachments[i].attachment && cached.textures[i] == textures[i]);
+    }
+
+    if (true == is_same) {
+      fb = &cached;
+      break;
+    }
+  }
+
+  bool is_new = (nullptr == fb);
+
+  if (true == is_new) {
+
+    RenderTargetFramebuffer created;
+    created.num_attachments = rp.num_attachments;
+
+    if (0 != gl_create_framebuffer(created.name)) {
+      printf("Failed to create the framebuffer for pass `%s`.\n", rp.name.c_str());
+      return -3;
+    }
+
+    for (uint32_t i = 0; i < rp.num_attachments; ++i) {
+      created.attachments[i] = rp.attachments[i].attachment;
+      created.textures[i] = textures[i];
+      gl_attach_texture(created.name, created.attachments[i], created.textures[i], 0);
+    }
+
+    if (0 != gl_check_framebuffer(created.name)) {
+      printf("Failed to create a complete framebuffer for pass `%s`.\n", rp.name.c_str());
+      glDeleteFramebuffers(1, &created.name);
+      return -4;
+    }
+
+    framebuffers.push_back(created);
+    fb = &framebuffers.back();
+    stats.num_framebuffers_created++;
+  }
+
+  fb->last_used_frame = frame;
+  rp.framebuffer = fb->name;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, fb->name);
+
+  /* A new framebuffer only draws into GL_COLOR_ATTACHMENT0. */
+  if (true == is_new) {
+
+    GLenum draw_buffers[RENDER_TARGET_MAX_ATTACHMENTS] = { GL_NONE };
+    GLsizei num_draw_buffers = 0;
+
+    for (uint32_t i = 0; i < rp.num_attachments; ++i) {
+      if (true == is_color_attachment(rp.attachments[i].attachment)) {
+        draw_buffers[num_draw_buffers++] = rp.attachments[i].attachment;
+      }
+    }
+
+    glDrawBuffers((0 == num_draw_buffers) ? 1 : num_draw_buffers, draw_buffers);
+  }
+
+  const RenderTargetDesc& desc = targets[rp.attachments[0].target].desc;
+  glViewport(0, 0, desc.width, desc.height);
+
+  /* The targets that start here may have the content of the target that had the texture before. */
+  if (true == has_invalidate) {
+
+    GLenum invalid[RENDER_TARGET_MAX_ATTACHMENTS] = { GL_NONE };
+    GLsizei num_invalid = 0;
+
+    for (uint32_t i = 0; i < rp.num_attachments; ++i) {
+      const RenderTarget& rt = targets[rp.attachments[i].target];
+      if (0 == rt.imported && pass == rt.first_pass) {
+        invalid[num_invalid++] = rp.attachments[i].attachment;
+      }
+    }
+
+    if (0 != num_invalid) {
+      glInvalidateFramebuffer(GL_FRAMEBUFFER, num_invalid, invalid);
+      stats.num_invalidated += num_invalid;
+    }
+  }
+
+  return 0;
+}
+
+int GlRenderTargets::end_pass(uint32_t pass) {
+
+  if (false == is_compiled) {
+    printf("Cannot end the pass, call `compile()` first.\n");
+    return -1;
+  }
+
+  if (pass >= passes.size()) {
+    printf("Cannot end the pass, invalid pass %u.\n", pass);
+    return -2;
+  }
+
+  RenderPass& rp = passes[pass];
+
+  if (0 == rp.num_attachments || false == has_invalidate) {
+    return 0;
+  }
+
+  /* Nothing reads the targets that end here; the driver doesn't have to keep (or resolve) them. */
+  GLenum invalid[RENDER_TARGET_MAX_ATTACHMENTS] = { GL_NONE };
+  GLsizei num_invalid = 0;
+
+  for (uint32_t i = 0; i < rp.num_attachments; ++i) {
+    const RenderTarget& rt = targets[rp.attachments[i].target];
+    if (0 == rt.imported && pass == rt.last_pass) {
+      invalid[num_invalid++] = rp.attachments[i].attachment;
+    }
+  }
+
+  if (0 != num_invalid) {
+    glBindFramebuffer(GL_FRAMEBUFFER, rp.framebuffer);
+    glInvalidateFramebuffer(GL_FRAMEBUFFER, num_invalid, invalid);
+    stats.num_invalidated += num_invalid;
+  }
+
+  return 0;
+}
+
+int GlRenderTargets::end_frame() {
+
+  if (false == is_in_frame) {
+    printf("Cannot end the frame, `begin_frame()` wasn't called.\n");
+    return -1;
+  }
+
+  is_in_frame = false;
+  is_compiled = false;
+
+  /* Framebuffers of passes we no longer have. */
+  for (size_t i = 0; i < framebuffers.size();) {
+
+    if (frame - framebuffers[i].last_used_frame < max_unused_frames || frame == framebuffers[i].last_used_frame) {
+      ++i;
+      continue;
+    }
+
+    glDeleteFramebuffers(1, &framebuffers[i].name);
+    framebuffers[i] = framebuffers.back();
+    framebuffers.pop_back();
+  }
+
+  /* Textures of targets we no longer have, and the framebuffers they're attached to. */
+  for (size_t i = 0; i < resources.size();) {
+
+    RenderTargetResource& res = resources[i];
+
+    if (frame - res.last_used_frame < max_unused_frames || frame == res.last_used_frame) {
+      ++i;
+      continue;
+    }
+
+    for (size_t j = 0; j < framebuffers.size();) {
+
+      bool is_attached = false;
+
+      for (uint32_t k = 0; k < framebuffers[j].num_attachments; ++k) {
+        is_attached |= (framebuffers[j].textures[k] == res.texture);
+      }
+
+      if (false == is_attached) {
+        ++j;
+        continue;
+      }
+
+      glDeleteFramebuffers(1, &framebuffers[j].name);
+      framebuffers[j] = framebuffers.back();
+      framebuffers.pop_back();
+    }
+
+    glDeleteTextures(1, &res.texture);
+
+    if (nullptr != monitor) {
+      monitor->remove(MEMORY_RENDER_TARGET, res.bytes);
+    }
+
+    stats.pool_bytes -= res.bytes;
+    stats.num_deleted++;
+
+    resources[i] = resources.back();
+    resources.pop_back();
+  }
+
+  return 0;
+}
+
+GLuint GlRenderTargets::get_texture(uint32_t target) {
+
+  if (false == is_compiled || target >= targets.size()) {
+    return 0;
+  }
+
+  const RenderTarget& rt = targets[target];
+
+  if (0 != rt.imported) {
+    return rt.imported;
+  }
+
+  if (RENDER_TARGET_NONE == rt.resource) {
+    return 0;
+  }
+
+  return resources[rt.resource].texture;
+}
+
+void GlRenderTargets::print() {
+
+  printf("render targets: %u targets in %u textures, requested %.2f MiB, used %.2f MiB, pool %.2f MiB\n",
+         stats.num_targets,
+         stats.num_resources,
+         stats.requested_bytes / (1024.0 * 1024.0),
+         stats.used_bytes / (1024.0 * 1024.0),
+         stats.pool_bytes / (1024.0 * 1024.0));
+
+  printf("  textures created: %llu, deleted: %llu, framebuffers created: %llu, cached: %zu, invalidated attachments: %llu\n",
+         (unsigned long long)stats.num_created,
+         (unsigned long long)stats.num_deleted,
+         (unsigned long long)stats.num_framebuffers_created,
+         framebuffers.size(),
+         (unsigned long long)stats.num_invalidated);
+}
+
+/* ------------------------------------------------------------- */
+
+static bool is_same_desc(const RenderTargetDesc& a, const RenderTargetDesc& b) {
+  return a.internal_format == b.internal_format
+    && a.width == b.width
+    && a.height == b.height
+    && a.samples == b.samples;
+}
+
+static uint64_t get_desc_bytes(const RenderTargetDesc& desc) {
+  uint64_t samples = (desc.samples > 1) ? (uint64_t)desc.samples : 1;
+  return memory_texture_bytes(desc.internal_format, desc.width, desc.height, 1, 1) * samples;
+}
+
+static int create_texture(const RenderTargetDesc& desc, GLuint& texture) {
+
+  if (desc.samples <= 1) {
+
+    if (0 != gl_create_texture(GL_TEXTURE_2D, 1, desc.internal_format, desc.width, desc.height, 0, texture)) {
+      return -1;
+    }
+
+    gl_set_texture_parameter(GL_TEXTURE_2D, texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl_set_texture_parameter(GL_TEXTURE_2D, texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl_set_texture_parameter(GL_TEXTURE_2D, texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    gl_set_texture_parameter(GL_TEXTURE_2D, texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    return 0;
+  }
+
+  /* `gl_create_texture()` has no multisample targets. */
+  if (true == gl_resource_has_dsa()) {
+    glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &texture);
+    glTextureStorage2DMultisample(texture, desc.samples, desc.internal_format, desc.width, desc.height, GL_TRUE);
+    return 0;
+  }
+
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, texture);
+  glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, desc.samples, desc.internal_format, desc.width, desc.height, GL_TRUE);
+  glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+
+  return 0;
+}
+
+static bool is_color_attachment(GLenum attachment) {
+  return attachment >= GL_COLOR_ATTACHMENT0 && attachment <= GL_COLOR_ATTACHMENT15;
+}
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,188 @@
+/*
+
+  GL RENDER TARGETS
+  ==================
+
+  Our contexts render into a hidden window (or a pbuffer) whose
+  default framebuffer has 4x MSAA and depth/stencil that we never
+  present. Headless rendering goes into framebuffers that the
+  `GlRenderTargets` creates instead. Every frame the passes
+  declare which (transient) render targets they write and read;
+  the manager then gives each target a texture from a pool. Two
+  targets that are never alive in the same pass can get the same
+  texture, so a chain like scene -> blur -> blur -> tonemap
+  needs two color textures instead of four.
+
+    targets.begin_frame();
+
+    uint32_t scene = targets.add_pass("scene");
+    uint32_t blur = targets.add_pass("blur");
+    uint32_t color = targets.create(color_desc, "color");
+    uint32_t depth = targets.create(depth_desc, "depth");
+    uint32_t blurred = targets.create(color_desc, "blurred");
+
+    targets.write(scene, color, GL_COLOR_ATTACHMENT0);
+    targets.write(scene, depth, GL_DEPTH_STENCIL_ATTACHMENT);
+    targets.read(blur, color);
+    targets.write(blur, blurred, GL_COLOR_ATTACHMENT0);
+
+    targets.compile();                         // lifetimes + aliasing
+
+    targets.begin_pass(scene);                 // binds the framebuffer and sets the viewport
+    ... draw ...
+    targets.end_pass(scene);
+
+    targets.begin_pass(blur);
+    glBindTexture(GL_TEXTURE_2D, targets.get_texture(color));
+    ... draw ...
+    targets.end_pass(blur);
+
+    targets.end_frame();
+
+  The passes run in the order they were added. The lifetime of a
+  target is the range from the first to the last pass that uses
+  it. `compile()` walks the targets by their first pass and gives
+  each one a texture from the pool with the same description
+  that is free by then; when there is none it creates one. GL has
+  no memory heaps we could place textures in (like Vulkan or
+  D3D12), so we alias whole textures between targets with the
+  same format, size and number of samples.
+
+  The content of an aliased texture is undefined when a target
+  starts; clear it or overwrite every pixel. `begin_pass()` tells
+  the driver with `glInvalidateFramebuffer()` for the targets that
+  start in the pass, and `end_pass()` for the ones that end in it
+  without being read (e.g. depth), so it doesn't have to keep
+  them.
+
+  Targets that have to outlive the frame (e.g. the image that is
+  read back) are imported with `import()`; they're never
+  aliased.
+
+  The pool and the framebuffers live across frames, so a frame
+  that declares the same passes as the previous one doesn't
+  create anything. A texture that wasn't used for
+  `max_unused_frames` frames is deleted, together with the
+  framebuffers that use it. Pass a `GlMemoryMonitor` to `init()`
+  to count the pool as `MEMORY_RENDER_TARGET`.
+
+  Framebuffers can't be shared between contexts: use a manager
+  per context, always with that context current.
+
+ */
+#ifndef GL_RENDER_TARGETS_H
+#define GL_RENDER_TARGETS_H
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <glad/glad.h>
+#include <gl-state-filter.h>
+
+/* ----------------------------------------------------------- */
+
+#define RENDER_TARGET_NONE 0xFFFFFFFFu
+#define RENDER_TARGET_MAX_ATTACHMENTS 9        /* 8 color + depth (or depth/stencil). */
+
+/* ----------------------------------------------------------- */
+
+class GlMemoryMonitor;
+
+struct RenderTargetDesc {
+  GLenum internal_format = GL_RGBA8;
+  GLsizei width = 0;
+  GLsizei height = 0;
+  GLsizei samples = 0;                         /* > 1 creates a multisample texture. */
+};
+
+struct RenderTarget {
+  RenderTargetDesc desc;
+  std::string name;
+  uint32_t first_pass = RENDER_TARGET_NONE;
+  uint32_t last_pass = RENDER_TARGET_NONE;
+  uint32_t resource = RENDER_TARGET_NONE;      /* Index into `resources`; set by `compile()`. */
+  GLuint imported = 0;                         /* The texture given to `import()`. */
+};
+
+struct RenderPassAttachment {
+  uint32_t target = RENDER_TARGET_NONE;
+  GLenum attachment = GL_NONE;
+};
+
+struct RenderPass {
+  std::string name;
+  RenderPassAttachment attachments[RENDER_TARGET_MAX_ATTACHMENTS];
+  uint32_t num_attachments = 0;
+  GLuint framebuffer = 0;                      /* Set by `begin_pass()`. */
+};
+
+/* A pooled texture. */
+struct RenderTargetResource {
+  RenderTargetDesc desc;
+  GLuint texture = 0;
+  uint64_t bytes = 0;
+  uint64_t last_used_frame = 0;
+  uint32_t busy_until = RENDER_TARGET_NONE;    /* The last pass of the target that has it this frame. */
+};
+
+/* A cached framebuffer with the textures attached to it. */
+struct RenderTargetFramebuffer {
+  GLuint name = 0;
+  GLenum attachments[RENDER_TARGET_MAX_ATTACHMENTS] = { GL_NONE };
+  GLuint textures[RENDER_TARGET_MAX_ATTACHMENTS] = { 0 };
+  uint32_t num_attachments = 0;
+  uint64_t last_used_frame = 0;
+};
+
+struct RenderTargetStats {
+  uint32_t num_targets = 0;                    /* Of the last frame. */
+  uint32_t num_resources = 0;                  /* Textures used by the last frame. */
+  uint64_t requested_bytes = 0;                /* What the targets of the last frame would need without aliasing. */
+  uint64_t used_bytes = 0;                     /* What they used. */
+  uint64_t pool_bytes = 0;                     /* Everything in the pool. */
+  uint64_t num_created = 0;                    /* Textures; since `init()`. */
+  uint64_t num_deleted = 0;
+  uint64_t num_framebuffers_created = 0;
+  uint64_t num_invalidated = 0;                /* Attachments passed to `glInvalidateFramebuffer()`. */
+};
+
+/* ----------------------------------------------------------- */
+
+class GlRenderTargets {
+public:
+  GlRenderTargets() = default;
+  GlRenderTargets(const GlRenderTargets&) = delete;
+  GlRenderTargets& operator=(const GlRenderTargets&) = delete;
+  int init(GlMemoryMonitor* monitor = nullptr);
+  int shutdown();                              /* Deletes the pool and the framebuffers; the context must be current. */
+  int begin_frame();
+  uint32_t add_pass(const char* name);         /* Returns the pass index or RENDER_TARGET_NONE. */
+  uint32_t create(const RenderTargetDesc& desc, const char* name); /* A transient target; returns its index or RENDER_TARGET_NONE. */
+  uint32_t import(GLuint texture, const RenderTargetDesc& desc, const char* name);
+  int write(uint32_t pass, uint32_t target, GLenum attachment);
+  int read(uint32_t pass, uint32_t target);
+  int compile();
+  int begin_pass(uint32_t pass);
+  int end_pass(uint32_t pass);
+  int end_frame();                             /* Deletes what wasn't used for `max_unused_frames` frames. */
+  GLuint get_texture(uint32_t target);         /* Valid from `compile()` until `end_frame()`. */
+  void print();
+
+public:
+  std::vector<RenderPass> passes;              /* Of the current frame. */
+  std::vector<RenderTarget> targets;           /* Of the current frame. */
+  std::vector<RenderTargetResource> resources;
+  std::vector<RenderTargetFramebuffer> framebuffers;
+  std::vector<uint32_t> order;                 /* The targets by first pass. */
+  GlMemoryMonitor* monitor = nullptr;
+  uint64_t frame = 0;
+  uint32_t max_unused_frames = 2;
+  bool is_in_frame = false;
+  bool is_compiled = false;
+  bool has_invalidate = false;                 /* GL 4.3 or `ARB_invalidate_subdata`. */
+  RenderTargetStats stats;
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,721 @@
+#include <stdio.h>
+#include <atomic>
+#include <gl-resource.h>
+
+/* ------------------------------------------------------------- */
+
+static std::atomic<bool> is_dsa_enabled{true};
+
+/* ------------------------------------------------------------- */
+
+static bool has_buffer_storage();
+static bool has_texture_storage();
+static GLenum get_format_for(GLenum internal_format);
+static GLenum get_type_for(GLenum internal_format);
+static GLenum get_binding_for(GLenum target);
+static GLuint get_bound(GLenum target);
+
+/* ------------------------------------------------------------- */
+
+bool gl_resource_has_dsa() {
+  return true == is_dsa_enabled.load(std::memory_order_relaxed)
+    && (0 != GLAD_GL_VERSION_4_5 || 0 != GLAD_GL_ARB_direct_state_access);
+}
+
+void gl_resource_set_dsa_enabled(bool enabled) {
+  is_dsa_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+/* ------------------------------------------------------------- */
+
+int gl_create_buffer(GLsizeiptr size, const void* data, GLbitfield storage_flags, GLuint& buffer) {
+
+  if (0 != buffer) {
+    printf("Cannot create the buffer, the given name is not 0; already created?\n");
+    return -1;
+  }
+
+  if (0 >= size) {
+    printf("Cannot create the buffer, invalid size.\n");
+    return -2;
+  }
+
+  bool is_immutable = has_buffer_storage();
+
+  if (false == is_immutable && 0 != (storage_flags & GL_MAP_PERSISTENT_BIT)) {
+    printf("Cannot create the buffer, persistent mapping needs immutable buffer storage which isn't supported.\n");
+    return -3;
+  }
+
+  if (true == gl_resource_has_dsa()) {
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, size, data, storage_flags);
+    return 0;
+  }
+
+  /* Without DSA we bind to edit; we put back what the caller had bound. */
+  GLuint prev = get_bound(GL_COPY_WRITE_BUFFER);
+
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+  if (true == is_immutable) {
+    glBufferStorage(GL_COPY_WRITE_BUFFER, size, data, storage_flags);
+  }
+  else {
+    GLenum usage = (0 != (storage_flags & (GL_DYNAMIC_STORAGE_BIT | GL_MAP_WRITE_BIT))) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+    glBufferData(GL_COPY_WRITE_BUFFER, size, data, usage);
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, prev);
+
+  return 0;
+}
+
+int gl_upload_buffer(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) {
+
+  if (0 == buffer || nullptr == data) {
+    printf("Cannot upload to the buffer, invalid buffer or data.\n");
+    return -1;
+  }
+
+  if (true == gl_resource_has_dsa()) {
+    glNamedBufferSubData(buffer, offset, size, data);
+    return 0;
+  }
+
+  GLuint prev = get_bound(GL_COPY_WRITE_BUFFER);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, prev);
+
+  return 0;
+}
+
+int gl_download_buffer(GLuint buffer, GLintptr offset, GLsizeiptr size, void* data) {
+
+  if (0 == buffer || nullptr == data) {
+    printf("Cannot download the buffer, invalid buffer or data.\n");
+    return -1;
+  }
+
+  if (true == gl_resource_has_dsa()) {
+    glGetNamedBufferSubData(buffer, offset, size, data);
+    return 0;
+  }
+
+  GLuint prev = get_bound(GL_COPY_READ_BUFFER);
+  glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+  glGetBufferSubData(GL_COPY_READ_BUFFER, offset, size, data);
+  glBindBuffer(GL_COPY_READ_BUFFER, prev);
+
+  return 0;
+}
+
+int gl_copy_buffer(GLuint src, GLuint dst, GLintptr src_offset, GLintptr dst_offset, GLsizeiptr size) {
+
+  if (0 == src || 0 == dst) {
+    printf("Cannot copy the buffer, invalid source or destination.\n");
+    return -1;
+  }
+
+  if (true == gl_resource_has_dsa()) {
+    glCopyNamedBufferSubData(src, dst, src_offset, dst_offset, size);
+    return 0;
+  }
+
+  GLuint prev_read = get_bound(GL_COPY_READ_BUFFER);
+  GLuint prev_write = get_bound(GL_COPY_WRITE_BUFFER);
+  glBindBuffer(GL_COPY_READ_BUFFER, src);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, src_offset, dst_offset, size);
+  glBindBuffer(GL_COPY_READ_BUFFER, prev_read);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, prev_write);
+
+  return 0;
+}
+
+int gl_map_buffer(GLuint buffer, GLintptr offset, GLsizeiptr size, GLbitfield access, void** ptr) {
+
+  if (0 == buffer || nullptr == ptr) {
+    printf("Cannot map the buffer, invalid buffer or pointer.\n");
+    return -1;
+  }
+
+  if (true == gl_resource_has_dsa()) {
+    *ptr = glMapNamedBufferRange(buffer, offset, size, access);
+  }
+  else {
+    GLuint prev = get_bound(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    *ptr = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size, access);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, prev);
+  }
+
+  if (nullptr == *ptr) {
+    printf("Failed to map the buffer.\n");
+    return -2;
+  }
+
+  return 0;
+}
+
+int gl_unmap_buffer(GLuint buffer) {
+
+  if (0 == buffer) {
+    printf("Cannot unmap the buffer, invalid buffer.\n");
+    return -1;
+  }
+
+  GLboolean r = GL_FALSE;
+
+  if (true == gl_resource_has_dsa()) {
+    r = glUnmapNamedBuffer(buffer);
+  }
+  else {
+    GLuint prev = get_bound(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    r = glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, prev);
+  }
+
+  /* GL_FALSE means the data store got corrupted while mapped. */
+  if (GL_FALSE == r) {
+    printf("Failed to unmap the buffer, its contents are undefined.\n");
+    return -2;
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int gl_create_texture(GLenum target, GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height, GLsizei depth, GLuint& texture) {
+
+  if (0 != texture) {
+    printf("Cannot create the texture, the given name is not 0; already created?\n");
+    return -1;
+  }
+
+  bool is_3d = (GL_TEXTURE_3D == target || GL_TEXTURE_2D_ARRAY == target || GL_TEXTURE_CUBE_MAP_ARRAY == target);
+  bool is_2d = (GL_TEXTURE_2D == target || GL_TEXTURE_RECTANGLE == target || GL_TEXTURE_CUBE_MAP == target || GL_TEXTURE_1D_ARRAY == target);
+
+  if (false == is_2d && false == is_3d) {
+    printf("Cannot create the texture, unsupported target.\n");
+    return -2;
+  }
+
+  if (0 >= levels || 0 >= width || 0 >= height || (true == is_3d && 0 >= depth)) {
+    printf("Cannot create the texture, invalid size or number of levels.\n");
+    return -3;
+  }
+
+  if (true == gl_resource_has_dsa()) {
+
+    glCreateTextures(target, 1, &texture);
+
+    if (true == is_3d) {
+      glTextureStorage3D(texture, levels, internal_format, width, height, depth);
+    }
+    else {
+      glTextureStorage2D(texture, levels, internal_format, width, height);
+    }
+
+    return 0;
+  }
+
+  /* Mutable storage needs a pixel format and type that match the internal format, even without data. */
+  bool is_immutable = has_texture_storage();
+  GLenum format = GL_NONE;
+  GLenum type = GL_NONE;
+
+  if (false == is_immutable) {
+    format = get_format_for(internal_format);
+    type = get_type_for(internal_format);
+    if (GL_NONE == format || GL_NONE == type) {
+      printf("Cannot create the texture, the internal format 0x%04x isn't supported without texture storage.\n", internal_format);
+      return -4;
+    }
+  }
+
+  /* Without DSA we bind to edit; we put back what the caller had bound to the active unit. */
+  GLuint prev = get_bound(target);
+
+  glGenTextures(1, &texture);
+  glBindTexture(target, texture);
+
+  if (true == is_immutable) {
+    if (true == is_3d) {
+      glTexStorage3D(target, levels, internal_format, width, height, depth);
+    }
+    else {
+      glTexStorage2D(target, levels, internal_format, width, height);
+    }
+  }
+  else {
+
+    /* Mutable storage: specify every level ourself and limit the levels so the texture is complete. */
+    GLsizei w = width;
+    GLsizei h = height;
+    GLsizei d = depth;
+
+    for (GLsizei level = 0; level < levels; ++level) {
+
+      if (true == is_3d) {
+        glTexImage3D(target, level, internal_format, w, h, d, 0, format, type, nullptr);
+      }
+      else if (GL_TEXTURE_CUBE_MAP == target) {
+        for (GLenum face = 0; face < 6; ++face) {
+          glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, internal_format, w, h, 0, format, type, nullptr);
+        }
+      }
+      else {
+        glTexImage2D(target, level, internal_format, w, h, 0, format, type, nullptr);
+      }
+
+      w = (w > 1) ? w / 2 : 1;
+      h = (h > 1 && GL_TEXTURE_1D_ARRAY != target) ? h / 2 : h;
+      d = (d > 1 && GL_TEXTURE_3D == target) ? d / 2 : d;
+    }
+
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+  }
+
+  glBindTexture(target, prev);
+
+  return 0;
+}
+
+int gl_upload_texture(GLenum target,
+                      GLuint texture,
+                      GLint level,
+                      GLint x,
+                      GLint y,
+                      GLint z,
+                      GLsizei width,
+                      GLsizei height,
+                      GLsizei depth,
+                      GLenum format,
+                      GLenum type,
+                      const void* pixels)
+{
+  if (0 == texture) {
+    printf("Cannot upload to the texture, invalid texture.\n");
+    return -1;
+  }
+
+  bool is_3d = (GL_TEXTURE_3D == target || GL_TEXTURE_2D_ARRAY == target || GL_TEXTURE_CUBE_MAP_ARRAY == target);
+
+  /* DSA treats the faces of a cube map as the layers of a 2D array, selected by `z`. */
+  if (true == gl_resource_has_dsa()) {
+
+    if (true == is_3d || GL_TEXTURE_CUBE_MAP == target) {
+      glTextureSubImage3D(texture, level, x, y, z, width, height, (0 == depth) ? 1 : depth, format, type, pixels);
+    }
+    else {
+      glTextureSubImage2D(texture, level, x, y, width, height, format, type, pixels);
+    }
+
+    return 0;
+  }
+
+  GLuint prev = get_bound(target);
+  glBindTexture(target, texture);
+
+  if (true == is_3d) {
+    glTexSubImage3D(target, level, x, y, z, width, height, depth, format, type, pixels);
+  }
+  else if (GL_TEXTURE_CUBE_MAP == target) {
+    if (depth > 1) {
+      printf("Cannot upload more than one cube map face at once without DSA.\n");
+      glBindTexture(target, prev);
+      return -2;
+    }
+    glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + z, level, x, y, width, height, format, type, pixels);
+  }
+  else {
+    glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+  }
+
+  glBindTexture(target, prev);
+
+  return 0;
+}
+
+int gl_set_texture_parameter(GLenum target, GLuint texture, GLenum name, GLint value) {
+
+  if (0 == texture) {
+    printf("Cannot set the texture parameter, invalid texture.\n");
+    return -1;
+  }
+
+  if (true == gl_resource_has_dsa()) {
+    glTextureParameteri(texture, name, value);
+    return 0;
+  }
+
+  GLuint prev = get_bound(target);
+  glBindTexture(target, texture);
+  glTexParameteri(target, name, value);
+  glBindTexture(target, prev);
+
+  return 0;
+}
+
+int gl_generate_mipmaps(GLenum target, GLuint texture) {
+
+  if (0 == texture) {
+    printf("Cannot generate the mipmaps, invalid texture.\n");
+    return -1;
+  }
+
+  if (true == gl_resource_has_dsa()) {
+    glGenerateTextureMipmap(texture);
+    return 0;
+  }
+
+  GLuint prev = get_bound(target);
+  glBindTexture(target, texture);
+  glGenerateMipmap(target);
+  glBindTexture(target, prev);
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int gl_create_framebuffer(GLuint& framebuffer) {
+
+  if (0 != framebuffer) {
+    printf("Cannot create the framebuffer, the given name is not 0; already created?\n");
+    return -1;
+  }
+
+  if (true == gl_resource_has_dsa()) {
+    glCreateFramebuffers(1, &framebuffer);
+    return 0;
+  }
+
+  /* A name from glGenFramebuffers() becomes a framebuffer when it's bound for the first time. */
+  GLint prev = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev);
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)prev);
+
+  return 0;
+}
+
+int gl_attach_texture(GLuint framebuffer, GLenum attachment, GLuint texture, GLint level) {
+
+  if (0 == framebuffer) {
+    printf("Cannot attach the texture, invalid framebuffer.\n");
+    return -1;
+  }
+
+  if (true == gl_resource_has_dsa()) {
+    glNamedFramebufferTexture(framebuffer, attachment, texture, level);
+    return 0;
+  }
+
+  GLint prev = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture(GL_DRAW_FRAMEBUFFER, attachment, texture, level);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)prev);
+
+  return 0;
+}
+
+int gl_check_framebuffer(GLuint framebuffer) {
+
+  if (0 == framebuffer) {
+    printf("Cannot check the framebuffer, invalid framebuffer.\n");
+    return -1;
+  }
+
+  GLenum status = GL_NONE;
+
+  if (true == gl_resource_has_dsa()) {
+    status = glCheckNamedFramebufferStatus(framebuffer, GL_DRAW_FRAMEBUFFER);
+  }
+  else {
+    GLint prev = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)prev);
+  }
+
+  if (GL_FRAMEBUFFER_COMPLETE != status) {
+    printf("The framebuffer is not complete, status: 0x%04x.\n", status);
+    return -2;
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+static bool has_buffer_storage() {
+  return 0 != GLAD_GL_VERSION_4_4 || 0 != GLAD_GL_ARB_buffer_storage;
+}
+
+static bool has_texture_storage() {
+  return 0 != GLAD_GL_VERSION_4_2 || 0 != GLAD_GL_ARB_texture_storage;
+}
+
+/* `glTexImage*()` wants a format and type that match the internal format, even without data. */
+/* Returns GL_NONE for a format we don't know; the fallback of `gl_create_texture()` fails then. */
+static GLenum get_format_for(GLenum internal_format) {
+
+  switch (internal_format) {
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32:
+    case GL_DEPTH_COMPONENT32F: {
+      return GL_DEPTH_COMPONENT;
+    }
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH32F_STENCIL8: {
+      return GL_DEPTH_STENCIL;
+    }
+    case GL_STENCIL_INDEX8: {
+      return GL_STENCIL_INDEX;
+    }
+    case GL_R8:
+    case GL_R8_SNORM:
+    case GL_R16:
+    case GL_R16_SNORM:
+    case GL_R16F:
+    case GL_R32F: {
+      return GL_RED;
+    }
+    case GL_RG8:
+    case GL_RG8_SNORM:
+    case GL_RG16:
+    case GL_RG16_SNORM:
+    case GL_RG16F:
+    case GL_RG32F: {
+      return GL_RG;
+    }
+    case GL_RGB8:
+    case GL_RGB8_SNORM:
+    case GL_SRGB8:
+    case GL_RGB16:
+    case GL_RGB16_SNORM:
+    case GL_RGB16F:
+    case GL_RGB32F:
+    case GL_R11F_G11F_B10F:
+    case GL_RGB9_E5:
+    case GL_RGB565: {
+      return GL_RGB;
+    }
+    case GL_RGBA8:
+    case GL_RGBA8_SNORM:
+    case GL_SRGB8_ALPHA8:
+    case GL_RGBA16:
+    case GL_RGBA16_SNORM:
+    case GL_RGBA16F:
+    case GL_RGBA32F:
+    case GL_RGB10_A2:
+    case GL_RGB5_A1:
+    case GL_RGBA4: {
+      return GL_RGBA;
+    }
+    case GL_R8I:
+    case GL_R8UI:
+    case GL_R16I:
+    case GL_R16UI:
+    case GL_R32I:
+    case GL_R32UI: {
+      return GL_RED_INTEGER;
+    }
+    case GL_RG8I:
+    case GL_RG8UI:
+    case GL_RG16I:
+    case GL_RG16UI:
+    case GL_RG32I:
+    case GL_RG32UI: {
+      return GL_RG_INTEGER;
+    }
+    case GL_RGB8I:
+    case GL_RGB8UI:
+    case GL_RGB16I:
+    case GL_RGB16UI:
+    case GL_RGB32I:
+    case GL_RGB32UI: {
+      return GL_RGB_INTEGER;
+    }
+    case GL_RGBA8I:
+    case GL_RGBA8UI:
+    case GL_RGBA16I:
+    case GL_RGBA16UI:
+    case GL_RGBA32I:
+    case GL_RGBA32UI:
+    case GL_RGB10_A2UI: {
+      return GL_RGBA_INTEGER;
+    }
+    default: {
+      return GL_NONE;
+    }
+  }
+}
+
+/* Returns GL_NONE for a format we don't know, like `get_format_for()`. */
+static GLenum get_type_for(GLenum internal_format) {
+
+  switch (internal_format) {
+    case GL_R8:
+    case GL_RG8:
+    case GL_RGB8:
+    case GL_SRGB8:
+    case GL_RGBA8:
+    case GL_SRGB8_ALPHA8:
+    case GL_R8UI:
+    case GL_RG8UI:
+    case GL_RGB8UI:
+    case GL_RGBA8UI:
+    case GL_STENCIL_INDEX8: {
+      return GL_UNSIGNED_BYTE;
+    }
+    case GL_R8_SNORM:
+    case GL_RG8_SNORM:
+    case GL_RGB8_SNORM:
+    case GL_RGBA8_SNORM:
+    case GL_R8I:
+    case GL_RG8I:
+    case GL_RGB8I:
+    case GL_RGBA8I: {
+      return GL_BYTE;
+    }
+    case GL_R16:
+    case GL_RG16:
+    case GL_RGB16:
+    case GL_RGBA16:
+    case GL_R16UI:
+    case GL_RG16UI:
+    case GL_RGB16UI:
+    case GL_RGBA16UI:
+    case GL_DEPTH_COMPONENT16: {
+      return GL_UNSIGNED_SHORT;
+    }
+    case GL_R16_SNORM:
+    case GL_RG16_SNORM:
+    case GL_RGB16_SNORM:
+    case GL_RGBA16_SNORM:
+    case GL_R16I:
+    case GL_RG16I:
+    case GL_RGB16I:
+    case GL_RGBA16I: {
+      return GL_SHORT;
+    }
+    case GL_R32UI:
+    case GL_RG32UI:
+    case GL_RGB32UI:
+    case GL_RGBA32UI:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32: {
+      return GL_UNSIGNED_INT;
+    }
+    case GL_R32I:
+    case GL_RG32I:
+    case GL_RGB32I:
+    case GL_RGBA32I: {
+      return GL_INT;
+    }
+    case GL_R16F:
+    case GL_RG16F:
+    case GL_RGB16F:
+    case GL_RGBA16F: {
+      return GL_HALF_FLOAT;
+    }
+    case GL_R32F:
+    case GL_RG32F:
+    case GL_RGB32F:
+    case GL_RGBA32F:
+    case GL_DEPTH_COMPONENT32F: {
+      return GL_FLOAT;
+    }
+    case GL_R11F_G11F_B10F: {
+      return GL_UNSIGNED_INT_10F_11F_11F_REV;
+    }
+    case GL_RGB9_E5: {
+      return GL_UNSIGNED_INT_5_9_9_9_REV;
+    }
+    case GL_RGB565: {
+      return GL_UNSIGNED_SHORT_5_6_5;
+    }
+    case GL_RGB10_A2:
+    case GL_RGB10_A2UI: {
+      return GL_UNSIGNED_INT_2_10_10_10_REV;
+    }
+    case GL_RGB5_A1: {
+      return GL_UNSIGNED_SHORT_5_5_5_1;
+    }
+    case GL_RGBA4: {
+      return GL_UNSIGNED_SHORT_4_4_4_4;
+    }
+    case GL_DEPTH24_STENCIL8: {
+      return GL_UNSIGNED_INT_24_8;
+    }
+    case GL_DEPTH32F_STENCIL8: {
+      return GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+    }
+    default: {
+      return GL_NONE;
+    }
+  }
+}
+
+static GLenum get_binding_for(GLenum target) {
+
+  switch (target) {
+    case GL_COPY_READ_BUFFER: {
+      return GL_COPY_READ_BUFFER_BINDING;
+    }
+    case GL_COPY_WRITE_BUFFER: {
+      return GL_COPY_WRITE_BUFFER_BINDING;
+    }
+    case GL_TEXTURE_2D: {
+      return GL_TEXTURE_BINDING_2D;
+    }
+    case GL_TEXTURE_RECTANGLE: {
+      return GL_TEXTURE_BINDING_RECTANGLE;
+    }
+    case GL_TEXTURE_CUBE_MAP: {
+      return GL_TEXTURE_BINDING_CUBE_MAP;
+    }
+    case GL_TEXTURE_1D_ARRAY: {
+      return GL_TEXTURE_BINDING_1D_ARRAY;
+    }
+    case GL_TEXTURE_3D: {
+      return GL_TEXTURE_BINDING_3D;
+    }
+    case GL_TEXTURE_2D_ARRAY: {
+      return GL_TEXTURE_BINDING_2D_ARRAY;
+    }
+    case GL_TEXTURE_CUBE_MAP_ARRAY: {
+      return GL_TEXTURE_BINDING_CUBE_MAP_ARRAY;
+    }
+    default: {
+      return GL_NONE;
+    }
+  }
+}
+
+/* The name bound to `target` (of the active texture unit); only used by the bind-to-edit fallback. */
+static GLuint get_bound(GLenum target) {
+
+  GLenum binding = get_binding_for(target);
+  if (GL_NONE == binding) {
+    return 0;
+  }
+
+  GLint prev = 0;
+  glGetIntegerv(binding, &prev);
+
+  return (GLuint)prev;
+}
+
+/* ------------------------------------------------------------- */
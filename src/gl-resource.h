@@ -0,0 +1,78 @@
+/*
+
+  GL RESOURCE
+  ============
+
+  A thin layer to create and edit buffers, textures and
+  framebuffers. We create 4.1 contexts, but most drivers we run
+  on support direct state access (GL 4.5 or
+  `ARB_direct_state_access`). With DSA we edit an object by its
+  name (`glNamedBufferSubData()`, `glTextureSubImage2D()`, ...)
+  instead of binding it first, which means fewer bind calls and
+  the bindings of the context stay as they are; e.g. an upload
+  on a worker doesn't invalidate anything the render code or
+  the state filter knows about.
+
+    GLuint tex = 0;
+    gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, 256, 256, 0, tex);
+    gl_upload_texture(GL_TEXTURE_2D, tex, 0, 0, 0, 0, 256, 256, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    gl_set_texture_parameter(GL_TEXTURE_2D, tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+  When DSA isn't supported we fall back to bind-to-edit. Buffers
+  are bound to `GL_COPY_WRITE_BUFFER` (and `GL_COPY_READ_BUFFER`
+  for copies) and textures to their target on the active unit.
+  Framebuffers are bound to `GL_DRAW_FRAMEBUFFER`. In all cases
+  the previous binding is queried first and restored
+  afterwards. The functions take the texture `target` for the
+  fallback; DSA ignores it. Cube map faces are selected with
+  `z`; the fallback uploads one face per call.
+
+  `gl_create_buffer()` uses immutable storage when the driver
+  has it (GL 4.4 or `ARB_buffer_storage`) and otherwise
+  `glBufferData()`, which can't be mapped persistently.
+  `gl_create_texture()` does the same with `glTexStorage*()`
+  (GL 4.2 or `ARB_texture_storage`); without it every level is
+  specified with `glTexImage*()`, which only works for the
+  uncompressed sized formats that we know the pixel format and
+  type of.
+
+  `gl_resource_set_dsa_enabled(false)` forces the fallback, so
+  both paths can be tested on one driver.
+
+ */
+#ifndef GL_RESOURCE_H
+#define GL_RESOURCE_H
+
+#include <glad/glad.h>
+#include <gl-state-filter.h>
+
+/* ----------------------------------------------------------- */
+
+bool gl_resource_has_dsa();                    /* True when DSA is supported and not disabled. */
+void gl_resource_set_dsa_enabled(bool enabled);
+
+/* ----------------------------------------------------------- */
+
+int gl_create_buffer(GLsizeiptr size, const void* data, GLbitfield storage_flags, GLuint& buffer);
+int gl_upload_buffer(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+int gl_download_buffer(GLuint buffer, GLintptr offset, GLsizeiptr size, void* data);
+int gl_copy_buffer(GLuint src, GLuint dst, GLintptr src_offset, GLintptr dst_offset, GLsizeiptr size);
+int gl_map_buffer(GLuint buffer, GLintptr offset, GLsizeiptr size, GLbitfield access, void** ptr);
+int gl_unmap_buffer(GLuint buffer);
+
+/* ----------------------------------------------------------- */
+
+int gl_create_texture(GLenum target, GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height, GLsizei depth, GLuint& texture); /* `depth` is for 3D and array textures. */
+int gl_upload_texture(GLenum target, GLuint texture, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels);
+int gl_set_texture_parameter(GLenum target, GLuint texture, GLenum name, GLint value);
+int gl_generate_mipmaps(GLenum target, GLuint texture);
+
+/* ----------------------------------------------------------- */
+
+int gl_create_framebuffer(GLuint& framebuffer);
+int gl_attach_texture(GLuint framebuffer, GLenum attachment, GLuint texture, GLint level);
+int gl_check_framebuffer(GLuint framebuffer);  /* Returns 0 when complete. */
+
+/* ----------------------------------------------------------- */
+
+#endif
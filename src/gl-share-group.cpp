@@ -0,0 +1,475 @@
+#include <stdio.h>
+#include <gl-share-group.h>
+#include <gl-resource.h>
+#include <gl-sync.h>
+
+/* ------------------------------------------------------------- */
+
+static GLenum get_reset_status();
+
+/* ------------------------------------------------------------- */
+
+GlShareGroup::~GlShareGroup() {
+
+  if (true == watchdog.joinable()) {
+    destroy();
+  }
+}
+
+int GlShareGroup::add_context(GlContext* ctx) {
+
+  if (nullptr == ctx) {
+    printf("Cannot add the context to the share group, it's nullptr.\n");
+    return -1;
+  }
+
+  if (true == watchdog.joinable()) {
+    printf("Cannot add the context to the share group, already created.\n");
+    return -2;
+  }
+
+  contexts.push_back(ctx);
+
+  return 0;
+}
+
+int GlShareGroup::create() {
+
+  int r = 0;
+
+  if (true == contexts.empty()) {
+    printf("Cannot create the share group, no contexts added.\n");
+    return -1;
+  }
+
+  if (true == watchdog.joinable()) {
+    printf("Cannot create the share group, already created.\n");
+    return -2;
+  }
+
+  reset_status = GL_NO_ERROR;
+  lost_ns = 0;
+  num_recoveries = 0;
+
+  if (0 != create_contexts()) {
+    r = -3;
+    goto error;
+  }
+
+  if (0 != start_watchdog()) {
+    r = -4;
+    goto error;
+  }
+
+  if (0 != make_context_current(*contexts[0])) {
+    r = -5;
+    goto error;
+  }
+
+ error:
+
+  if (r < 0) {
+    printf("Failed to create the share group.\n");
+    if (0 != destroy()) {
+      printf("After failing to create the share group, we also couldn't clean it up correctly.\n");
+    }
+  }
+
+  return r;
+}
+
+int GlShareGroup::destroy() {
+
+  int r = 0;
+
+  if (0 != stop_watchdog()) {
+    r -= 1;
+  }
+
+  /* The resources go away with the contexts. */
+  for (ShareGroupResource& res : resources) {
+    *res.name = 0;
+  }
+
+  resources.clear();
+
+  if (0 != destroy_contexts()) {
+    r -= 2;
+  }
+
+  return r;
+}
+
+/*
+  The objects of a reset share group are gone and the contexts
+  can't be used anymore; we don't delete anything ourselves, we
+  destroy the contexts and start over.
+*/
+int GlShareGroup::recover() {
+
+  if (true == contexts.empty()) {
+    printf("Cannot recover the share group, no contexts added.\n");
+    return -1;
+  }
+
+  uint64_t start_ns = gpu_sync_now_ns();
+
+  if (nullptr != timer) {
+    timer->begin();
+  }
+
+  if (0 != stop_watchdog()) {
+    printf("Failed to stop the watchdog; we continue.\n");
+  }
+
+  step_timer_lap(timer, "stop watchdog");
+
+  if (0 != destroy_contexts()) {
+    printf("Failed to cleanly destroy the lost contexts; we continue.\n");
+  }
+
+  step_timer_lap(timer, "destroy contexts");
+
+  reset_status = GL_NO_ERROR;
+  lost_ns = 0;
+
+  if (0 != create_contexts()) {
+    printf("Cannot recover the share group, failed to create the contexts.\n");
+    return -2;
+  }
+
+  step_timer_lap(timer, "create contexts");
+
+  if (0 != start_watchdog()) {
+    printf("Cannot recover the share group, failed to start the watchdog.\n");
+    return -3;
+  }
+
+  step_timer_lap(timer, "start watchdog");
+
+  if (0 != make_context_current(*contexts[0])) {
+    printf("Cannot recover the share group, failed to make the root current.\n");
+    return -4;
+  }
+
+  step_timer_lap(timer, "make current");
+
+  if (0 != create_resources()) {
+    printf("Cannot recover the share group, failed to recreate the resources.\n");
+    return -5;
+  }
+
+  step_timer_lap(timer, "recreate resources");
+
+  recover_ns = gpu_sync_now_ns() - start_ns;
+  num_recoveries++;
+
+  if (nullptr != timer) {
+    timer->add("total", recover_ns);
+  }
+
+  return 0;
+}
+
+bool GlShareGroup::is_lost() {
+  return GL_NO_ERROR != reset_status.load();
+}
+
+/* ------------------------------------------------------------- */
+
+int GlShareGroup::create_buffer(GLsizeiptr size, const void* data, GLbitfield storage_flags, GLuint& buffer) {
+
+  if (nullptr == data) {
+    printf("Cannot create the buffer, we need the data to recreate it after a reset.\n");
+    return -1;
+  }
+
+  if (0 != gl_create_buffer(size, data, storage_flags, buffer)) {
+    printf("Failed to create the buffer of the share group.\n");
+    return -2;
+  }
+
+  ShareGroupResource res;
+  res.type = SHARE_GROUP_BUFFER;
+  res.name = &buffer;
+  res.data = data;
+  res.size = size;
+  res.storage_flags = storage_flags;
+
+  resources.push_back(res);
+
+  return 0;
+}
+
+int GlShareGroup::create_texture(GLenum internal_format, GLsizei width, GLsizei height, GLenum format, GLenum pixel_type, const void* pixels, GLuint& texture) {
+
+  if (nullptr == pixels) {
+    printf("Cannot create the texture, we need the pixels to recreate it after a reset.\n");
+    return -1;
+  }
+
+  if (0 != gl_create_texture(GL_TEXTURE_2D, 1, internal_format, width, height, 0, texture)) {
+    printf("Failed to create the texture of the share group.\n");
+    return -2;
+  }
+
+  if (0 != gl_upload_texture(GL_TEXTURE_2D, texture, 0, 0, 0, 0, width, height, 0, format, pixel_type, pixels)) {
+    printf("Failed to upload the texture of the share group.\n");
+    return -3;
+  }
+
+  ShareGroupResource res;
+  res.type = SHARE_GROUP_TEXTURE;
+  res.name = &texture;
+  res.data = pixels;
+  res.internal_format = internal_format;
+  res.width = width;
+  res.height = height;
+  res.format = format;
+  res.pixel_type = pixel_type;
+
+  resources.push_back(res);
+
+  return 0;
+}
+
+int GlShareGroup::destroy_resource(GLuint& name) {
+
+  for (size_t i = 0; i < resources.size(); ++i) {
+
+    if (&name != resources[i].name) {
+      continue;
+    }
+
+    if (SHARE_GROUP_BUFFER == resources[i].type) {
+      glDeleteBuffers(1, &name);
+    }
+    else {
+      glDeleteTextures(1, &name);
+    }
+
+    name = 0;
+    resources.erase(resources.begin() + i);
+
+    return 0;
+  }
+
+  printf("Cannot destroy the resource, it wasn't created by the share group.\n");
+
+  return -1;
+}
+
+/* ------------------------------------------------------------- */
+
+/*
+  Contexts that share may only be created while the context they
+  share with isn't current, so we create them all before the
+  watchdog or the caller makes one current.
+*/
+int GlShareGroup::create_contexts() {
+
+  int r = 0;
+  GlContext* root = contexts[0];
+
+  if (0 != release_current_context()) {
+    printf("Cannot create the contexts of the share group, failed to release the current context.\n");
+    return -1;
+  }
+
+  if (0 != create_shared_context(nullptr, *root)) {
+    printf("Failed to create the root context of the share group.\n");
+    return -2;
+  }
+
+  root->state.invalidate();
+
+  for (size_t i = 1; i < contexts.size(); ++i) {
+
+    contexts[i]->reset = root->reset;
+
+    if (0 != create_shared_context(root, *contexts[i])) {
+      printf("Failed to create context %zu of the share group.\n", i);
+      r = -3;
+      goto error;
+    }
+
+    contexts[i]->state.invalidate();
+  }
+
+  watchdog_ctx.mode = root->mode;
+  watchdog_ctx.reset = root->reset;
+
+  if (0 != create_shared_context(root, watchdog_ctx)) {
+    printf("Failed to create the watchdog context of the share group.\n");
+    r = -4;
+    goto error;
+  }
+
+ error:
+
+  if (r < 0) {
+    destroy_contexts();
+  }
+
+  return r;
+}
+
+int GlShareGroup::destroy_contexts() {
+
+  int r = 0;
+
+  if (0 != release_current_context()) {
+    printf("Failed to release the current context before destroying the share group.\n");
+    r -= 1;
+  }
+
+  if (0 != destroy_main_context(watchdog_ctx)) {
+    r -= 2;
+  }
+
+  for (size_t i = contexts.size(); i > 0; --i) {
+    if (0 != destroy_main_context(*contexts[i - 1])) {
+      r -= 4;
+    }
+  }
+
+  return r;
+}
+
+/* The root is current. */
+int GlShareGroup::create_resources() {
+
+  int r = 0;
+
+  for (ShareGroupResource& res : resources) {
+
+    *res.name = 0;
+
+    if (SHARE_GROUP_BUFFER == res.type) {
+      if (0 != gl_create_buffer(res.size, res.data, res.storage_flags, *res.name)) {
+        printf("Failed to recreate a buffer of the share group.\n");
+        r = -1;
+      }
+      continue;
+    }
+
+    if (0 != gl_create_texture(GL_TEXTURE_2D, 1, res.internal_format, res.width, res.height, 0, *res.name)
+        || 0 != gl_upload_texture(GL_TEXTURE_2D, *res.name, 0, 0, 0, 0, res.width, res.height, 0, res.format, res.pixel_type, res.data))
+      {
+        printf("Failed to recreate a texture of the share group.\n");
+        r = -2;
+      }
+  }
+
+  return r;
+}
+
+/* ------------------------------------------------------------- */
+
+int GlShareGroup::start_watchdog() {
+
+  if (true == watchdog.joinable()) {
+    printf("Cannot start the watchdog, already started.\n");
+    return -1;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_watching = true;
+  }
+
+  std::promise<int> started;
+  std::future<int> result = started.get_future();
+
+  watchdog = std::thread(&GlShareGroup::watch, this, &started);
+
+  if (0 != result.get()) {
+    printf("Failed to start the watchdog.\n");
+    watchdog.join();
+    return -2;
+  }
+
+  return 0;
+}
+
+int GlShareGroup::stop_watchdog() {
+
+  if (false == watchdog.joinable()) {
+    return 0;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_watching = false;
+  }
+
+  cond.notify_one();
+  watchdog.join();
+
+  return 0;
+}
+
+void GlShareGroup::watch(std::promise<int>* started) {
+
+  if (0 != make_context_current(watchdog_ctx)) {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_watching = false;
+    started->set_value(-1);
+    return;
+  }
+
+  /* Don't touch `started` after this; `start_watchdog()` returns. */
+  started->set_value(0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true == is_watching) {
+
+    if (GL_NO_ERROR == reset_status.load()) {
+
+      lock.unlock();
+      GLenum status = get_reset_status();
+
+      if (GL_NO_ERROR != status) {
+        lost_ns = gpu_sync_now_ns();
+        reset_status = status;
+        if (on_reset) {
+          on_reset(status);
+        }
+      }
+
+      lock.lock();
+    }
+
+    /* Once lost, we only wait for `recover()` or `destroy()`. */
+    cond.wait_for(lock, std::chrono::nanoseconds(poll_interval_ns), [this]() {
+      return false == is_watching;
+    });
+  }
+
+  lock.unlock();
+
+  release_current_context();
+}
+
+/* ------------------------------------------------------------- */
+
+/* Read the pointers on each call so a test can replace them. */
+static GLenum get_reset_status() {
+
+  if (nullptr != glad_glGetGraphicsResetStatus) {
+    return glGetGraphicsResetStatus();
+  }
+
+  if (nullptr != glad_glGetGraphicsResetStatusARB) {
+    return glGetGraphicsResetStatusARB();
+  }
+
+  if (nullptr != glad_glGetGraphicsResetStatusKHR) {
+    return glGetGraphicsResetStatusKHR();
+  }
+
+  return GL_NO_ERROR;
+}
+
+/* ------------------------------------------------------------- */
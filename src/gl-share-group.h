@@ -0,0 +1,139 @@
+/*
+
+  GL SHARE GROUP
+  ===============
+
+  Detects GPU resets (TDRs, driver restarts, ...) and rebuilds a
+  share group after one, so a long running render node recovers
+  on its own instead of rendering nothing until someone restarts
+  it.
+
+    GlContext main;
+    main.reset = CONTEXT_RESET_LOSE_CONTEXT;   // see `gl-context.h`
+
+    GlShareGroup group;
+    group.add_context(&main);
+    group.create();                            // `main` is current now
+    group.create_buffer(size, vertices, 0, vbo);
+
+    while (true == is_running) {
+      if (true == group.is_lost()) {
+        group.recover();
+      }
+      render();
+    }
+
+    group.destroy();
+
+  The first context that you add is the root; the others share
+  with it and get its `reset` strategy. `create()` creates them
+  all and makes the root current on the calling thread. It also
+  creates one more context for the watchdog: a thread that polls
+  `glGetGraphicsResetStatus()` every `poll_interval_ns`. A reset
+  affects the whole share group, so one context is enough to
+  notice it. When it returns something else than `GL_NO_ERROR`,
+  the watchdog stores the status and the time in `reset_status`
+  and `lost_ns`, calls `on_reset` (on the watchdog thread) and
+  stops polling.
+
+  After a reset every object of the share group is gone, so the
+  group keeps a CPU copy of the resources that you create through
+  it: `create_buffer()` and `create_texture()` create and upload
+  the object like `gl_create_buffer()` and `gl_create_texture()`
+  do (see `gl-resource.h`), and remember the data pointer (it's
+  not copied) and where you keep the name. `recover()` destroys
+  all contexts, creates them again, makes the root current and
+  recreates the resources from their CPU copies; it writes the
+  new names into your variables, so keep them at a fixed address.
+  Objects that you created yourself have to be recreated by you.
+
+  `recover()` must be called on the thread that called
+  `create()`, and the other contexts of the group must not be
+  current on any thread. Set `timer` to time the steps of
+  `recover()`.
+
+  The watchdog calls `glGetGraphicsResetStatus()` through the
+  glad pointer (or the ARB / KHR one), so a test can inject a
+  reset by replacing that pointer; see _test-share-group.cpp_.
+
+ */
+#ifndef GL_SHARE_GROUP_H
+#define GL_SHARE_GROUP_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+#include <gl-context.h>
+
+/* ----------------------------------------------------------- */
+
+enum ShareGroupResourceType {
+  SHARE_GROUP_BUFFER,
+  SHARE_GROUP_TEXTURE,
+};
+
+struct ShareGroupResource {
+  ShareGroupResourceType type = SHARE_GROUP_BUFFER;
+  GLuint* name = nullptr;                      /* Your variable; `recover()` writes the new name into it. */
+  const void* data = nullptr;                  /* The CPU copy; not copied. */
+  GLsizeiptr size = 0;                         /* Buffers */
+  GLbitfield storage_flags = 0;                /* Buffers */
+  GLenum internal_format = 0;                  /* Textures; 2D with one level. */
+  GLsizei width = 0;
+  GLsizei height = 0;
+  GLenum format = 0;
+  GLenum pixel_type = 0;
+};
+
+/* ----------------------------------------------------------- */
+
+class GlShareGroup {
+public:
+  GlShareGroup() = default;
+  GlShareGroup(const GlShareGroup&) = delete;
+  GlShareGroup& operator=(const GlShareGroup&) = delete;
+  ~GlShareGroup();
+  int add_context(GlContext* ctx);             /* Before `create()`; the first one is the root. */
+  int create();                                /* Creates the contexts, makes the root current and starts the watchdog. */
+  int destroy();
+  int recover();                               /* Rebuilds the share group and its resources. */
+  bool is_lost();
+
+  /* The root must be current. */
+  int create_buffer(GLsizeiptr size, const void* data, GLbitfield storage_flags, GLuint& buffer);
+  int create_texture(GLenum internal_format, GLsizei width, GLsizei height, GLenum format, GLenum pixel_type, const void* pixels, GLuint& texture);
+  int destroy_resource(GLuint& name);
+
+public:
+  std::vector<GlContext*> contexts;
+  std::vector<ShareGroupResource> resources;
+  GlContext watchdog_ctx;
+  std::thread watchdog;
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool is_watching = false;                    /* Protected by `mutex`. */
+  std::function<void(GLenum status)> on_reset; /* Optional; called on the watchdog thread. */
+  uint64_t poll_interval_ns = 5ull * 1000ull * 1000ull;
+  std::atomic<GLenum> reset_status{GL_NO_ERROR};
+  std::atomic<uint64_t> lost_ns{0};            /* When the watchdog saw the reset. */
+  StepTimer* timer = nullptr;                  /* Optional; times the steps of `recover()`. */
+  uint64_t recover_ns = 0;                     /* How long the last `recover()` took. */
+  uint32_t num_recoveries = 0;
+
+private:
+  int create_contexts();
+  int destroy_contexts();
+  int create_resources();
+  int start_watchdog();
+  int stop_watchdog();
+  void watch(std::promise<int>* started);
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,743 @@
+#include <string.h>
+#include <gl-state-filter.h>
+
+/* ------------------------------------------------------------- */
+
+static thread_local GlStateShadow* current_shadow = nullptr;
+
+/* ------------------------------------------------------------- */
+
+static int get_buffer_slot(GLenum target);
+static int get_texture_slot(GLenum target);
+static int get_cap_slot(GLenum cap);
+static bool is_filtered(GlStateShadow* shadow, bool is_same);
+static GlStateShadow* get_shadow();
+static void count_delete(GlStateShadow* shadow);
+
+/* ------------------------------------------------------------- */
+
+GlStateShadow::GlStateShadow() {
+  group_deletes = &num_deletes;
+  invalidate();
+  stats.num_invalidations = 0;
+}
+
+void GlStateShadow::invalidate() {
+
+  reset_bindings();
+
+  for (uint32_t i = 0; i < STATE_CAP_COUNT; ++i) {
+    caps[i] = STATE_CAP_UNKNOWN;
+  }
+
+  active_texture = STATE_UNKNOWN;
+  program = STATE_UNKNOWN;
+  blend_src_rgb = STATE_UNKNOWN;
+  blend_dst_rgb = STATE_UNKNOWN;
+  blend_src_alpha = STATE_UNKNOWN;
+  blend_dst_alpha = STATE_UNKNOWN;
+  blend_equation_rgb = STATE_UNKNOWN;
+  blend_equation_alpha = STATE_UNKNOWN;
+  depth_func = STATE_UNKNOWN;
+  depth_mask = STATE_UNKNOWN;
+  color_mask = STATE_UNKNOWN;
+  cull_face = STATE_UNKNOWN;
+  front_face = STATE_UNKNOWN;
+  is_viewport_known = false;
+  is_scissor_known = false;
+
+  stats.num_invalidations++;
+}
+
+void GlStateShadow::reset_bindings() {
+
+  /* Read the counter first; a delete that happens while we reset is seen by the next call. */
+  delete_generation = group_deletes->load(std::memory_order_acquire);
+
+  for (uint32_t i = 0; i < STATE_BUFFER_COUNT; ++i) {
+    buffers[i] = STATE_UNKNOWN;
+  }
+
+  for (uint32_t i = 0; i < STATE_MAX_TEXTURE_UNITS; ++i) {
+    for (uint32_t j = 0; j < STATE_TEXTURE_COUNT; ++j) {
+      textures[i][j] = STATE_UNKNOWN;
+    }
+    samplers[i] = STATE_UNKNOWN;
+  }
+
+  vertex_array = STATE_UNKNOWN;
+  draw_framebuffer = STATE_UNKNOWN;
+  read_framebuffer = STATE_UNKNOWN;
+}
+
+/* ------------------------------------------------------------- */
+
+void gl_state_filter_make_current(GlStateShadow* shadow) {
+
+  current_shadow = shadow;
+
+  if (nullptr == shadow) {
+    return;
+  }
+
+  std::thread::id id = std::this_thread::get_id();
+
+  if (shadow->thread != id) {
+    shadow->invalidate();
+    shadow->thread = id;
+  }
+}
+
+void gl_state_filter_share(GlStateShadow* shadow, GlStateShadow* shared) {
+
+  if (nullptr == shadow) {
+    return;
+  }
+
+  shadow->group_deletes = (nullptr == shared) ? &shadow->num_deletes : shared->group_deletes;
+  shadow->reset_bindings();
+}
+
+GlStateShadow* gl_state_filter_get_current() {
+  return current_shadow;
+}
+
+void gl_state_filter_invalidate() {
+
+  if (nullptr != current_shadow) {
+    current_shadow->invalidate();
+  }
+}
+
+/* ------------------------------------------------------------- */
+
+void filter_glBindBuffer(GLenum target, GLuint buffer) {
+
+  GlStateShadow* shadow = get_shadow();
+  int slot = get_buffer_slot(target);
+
+  if (nullptr == shadow || slot < 0) {
+    glad_glBindBuffer(target, buffer);
+    return;
+  }
+
+  if (true == is_filtered(shadow, shadow->buffers[slot] == buffer)) {
+    return;
+  }
+
+  shadow->buffers[slot] = buffer;
+  glad_glBindBuffer(target, buffer);
+}
+
+/* The indexed binding isn't shadowed but these also change the generic binding. */
+void filter_glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+
+  GlStateShadow* shadow = get_shadow();
+  int slot = get_buffer_slot(target);
+
+  if (nullptr != shadow && slot >= 0) {
+    shadow->buffers[slot] = buffer;
+  }
+
+  glad_glBindBufferBase(target, index, buffer);
+}
+
+void filter_glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+
+  GlStateShadow* shadow = get_shadow();
+  int slot = get_buffer_slot(target);
+
+  if (nullptr != shadow && slot >= 0) {
+    shadow->buffers[slot] = buffer;
+  }
+
+  glad_glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void filter_glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr != shadow && nullptr != buffers) {
+    for (GLsizei i = 0; i < n; ++i) {
+      for (uint32_t j = 0; j < STATE_BUFFER_COUNT; ++j) {
+        if (shadow->buffers[j] == buffers[i]) {
+          shadow->buffers[j] = 0;
+        }
+      }
+    }
+  }
+
+  glad_glDeleteBuffers(n, buffers);
+  count_delete(shadow);
+}
+
+void filter_glActiveTexture(GLenum texture) {
+
+  GlStateShadow* shadow = get_shadow();
+  uint32_t unit = texture - GL_TEXTURE0;
+
+  if (nullptr == shadow) {
+    glad_glActiveTexture(texture);
+    return;
+  }
+
+  if (true == is_filtered(shadow, shadow->active_texture == unit)) {
+    return;
+  }
+
+  shadow->active_texture = unit;
+  glad_glActiveTexture(texture);
+}
+
+void filter_glBindTexture(GLenum target, GLuint texture) {
+
+  GlStateShadow* shadow = get_shadow();
+  int slot = get_texture_slot(target);
+
+  if (nullptr == shadow
+      || slot < 0
+      || shadow->active_texture >= STATE_MAX_TEXTURE_UNITS)
+    {
+      glad_glBindTexture(target, texture);
+      return;
+    }
+
+  uint32_t& bound = shadow->textures[shadow->active_texture][slot];
+
+  if (true == is_filtered(shadow, bound == texture)) {
+    return;
+  }
+
+  bound = texture;
+  glad_glBindTexture(target, texture);
+}
+
+void filter_glDeleteTextures(GLsizei n, const GLuint* textures) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr != shadow && nullptr != textures) {
+    for (GLsizei i = 0; i < n; ++i) {
+      for (uint32_t j = 0; j < STATE_MAX_TEXTURE_UNITS; ++j) {
+        for (uint32_t k = 0; k < STATE_TEXTURE_COUNT; ++k) {
+          if (shadow->textures[j][k] == textures[i]) {
+            shadow->textures[j][k] = 0;
+          }
+        }
+      }
+    }
+  }
+
+  glad_glDeleteTextures(n, textures);
+  count_delete(shadow);
+}
+
+void filter_glBindSampler(GLuint unit, GLuint sampler) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr == shadow || unit >= STATE_MAX_TEXTURE_UNITS) {
+    glad_glBindSampler(unit, sampler);
+    return;
+  }
+
+  if (true == is_filtered(shadow, shadow->samplers[unit] == sampler)) {
+    return;
+  }
+
+  shadow->samplers[unit] = sampler;
+  glad_glBindSampler(unit, sampler);
+}
+
+void filter_glDeleteSamplers(GLsizei n, const GLuint* samplers) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr != shadow && nullptr != samplers) {
+    for (GLsizei i = 0; i < n; ++i) {
+      for (uint32_t j = 0; j < STATE_MAX_TEXTURE_UNITS; ++j) {
+        if (shadow->samplers[j] == samplers[i]) {
+          shadow->samplers[j] = 0;
+        }
+      }
+    }
+  }
+
+  glad_glDeleteSamplers(n, samplers);
+  count_delete(shadow);
+}
+
+void filter_glUseProgram(GLuint program) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr == shadow) {
+    glad_glUseProgram(program);
+    return;
+  }
+
+  if (true == is_filtered(shadow, shadow->program == program)) {
+    return;
+  }
+
+  shadow->program = program;
+  glad_glUseProgram(program);
+}
+
+void filter_glBindVertexArray(GLuint array) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr == shadow) {
+    glad_glBindVertexArray(array);
+    return;
+  }
+
+  if (true == is_filtered(shadow, shadow->vertex_array == array)) {
+    return;
+  }
+
+  /* The element array binding is stored in the vertex array. */
+  shadow->vertex_array = array;
+  shadow->buffers[STATE_BUFFER_ELEMENT_ARRAY] = STATE_UNKNOWN;
+  glad_glBindVertexArray(array);
+}
+
+void filter_glDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr != shadow && nullptr != arrays) {
+    for (GLsizei i = 0; i < n; ++i) {
+      if (shadow->vertex_array == arrays[i]) {
+        shadow->vertex_array = 0;
+        shadow->buffers[STATE_BUFFER_ELEMENT_ARRAY] = STATE_UNKNOWN;
+      }
+    }
+  }
+
+  glad_glDeleteVertexArrays(n, arrays);
+  count_delete(shadow);
+}
+
+void filter_glBindFramebuffer(GLenum target, GLuint framebuffer) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr == shadow) {
+    glad_glBindFramebuffer(target, framebuffer);
+    return;
+  }
+
+  bool is_same = false;
+
+  switch (target) {
+    case GL_FRAMEBUFFER: {
+      is_same = (shadow->draw_framebuffer == framebuffer && shadow->read_framebuffer == framebuffer);
+      break;
+    }
+    case GL_DRAW_FRAMEBUFFER: {
+      is_same = (shadow->draw_framebuffer == framebuffer);
+      break;
+    }
+    case GL_READ_FRAMEBUFFER: {
+      is_same = (shadow->read_framebuffer == framebuffer);
+      break;
+    }
+    default: {
+      glad_glBindFramebuffer(target, framebuffer);
+      return;
+    }
+  }
+
+  if (true == is_filtered(shadow, is_same)) {
+    return;
+  }
+
+  if (GL_FRAMEBUFFER == target || GL_DRAW_FRAMEBUFFER == target) {
+    shadow->draw_framebuffer = framebuffer;
+  }
+
+  if (GL_FRAMEBUFFER == target || GL_READ_FRAMEBUFFER == target) {
+    shadow->read_framebuffer = framebuffer;
+  }
+
+  glad_glBindFramebuffer(target, framebuffer);
+}
+
+void filter_glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr != shadow && nullptr != framebuffers) {
+    for (GLsizei i = 0; i < n; ++i) {
+      if (shadow->draw_framebuffer == framebuffers[i]) {
+        shadow->draw_framebuffer = 0;
+      }
+      if (shadow->read_framebuffer == framebuffers[i]) {
+        shadow->read_framebuffer = 0;
+      }
+    }
+  }
+
+  glad_glDeleteFramebuffers(n, framebuffers);
+  count_delete(shadow);
+}
+
+void filter_glEnable(GLenum cap) {
+
+  GlStateShadow* shadow = get_shadow();
+  int slot = get_cap_slot(cap);
+
+  if (nullptr == shadow || slot < 0) {
+    glad_glEnable(cap);
+    return;
+  }
+
+  if (true == is_filtered(shadow, 1 == shadow->caps[slot])) {
+    return;
+  }
+
+  shadow->caps[slot] = 1;
+  glad_glEnable(cap);
+}
+
+void filter_glDisable(GLenum cap) {
+
+  GlStateShadow* shadow = get_shadow();
+  int slot = get_cap_slot(cap);
+
+  if (nullptr == shadow || slot < 0) {
+    glad_glDisable(cap);
+    return;
+  }
+
+  if (true == is_filtered(shadow, 0 == shadow->caps[slot])) {
+    return;
+  }
+
+  shadow->caps[slot] = 0;
+  glad_glDisable(cap);
+}
+
+void filter_glBlendFunc(GLenum sfactor, GLenum dfactor) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr == shadow) {
+    glad_glBlendFunc(sfactor, dfactor);
+    return;
+  }
+
+  bool is_same = shadow->blend_src_rgb == sfactor
+    && shadow->blend_dst_rgb == dfactor
+    && shadow->blend_src_alpha == sfactor
+    && shadow->blend_dst_alpha == dfactor;
+
+  if (true == is_filtered(shadow, is_same)) {
+    return;
+  }
+
+  shadow->blend_src_rgb = sfactor;
+  shadow->blend_dst_rgb = dfactor;
+  shadow->blend_src_alpha = sfactor;
+  shadow->blend_dst_alpha = dfactor;
+  glad_glBlendFunc(sfactor, dfactor);
+}
+
+void filter_glBlendFuncSeparate(GLenum sfactor_rgb, GLenum dfactor_rgb, GLenum sfactor_alpha, GLenum dfactor_alpha) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr == shadow) {
+    glad_glBlendFuncSeparate(sfactor_rgb, dfactor_rgb, sfactor_alpha, dfactor_alpha);
+    return;
+  }
+
+  bool is_same = shadow->blend_src_rgb == sfactor_rgb
+    && shadow->blend_dst_rgb == dfactor_rgb
+    && shadow->blend_src_alpha == sfactor_alpha
+    && shadow->blend_dst_alpha == dfactor_alpha;
+
+  if (true == is_filtered(shadow, is_same)) {
+    return;
+  }
+
+  shadow->blend_src_rgb = sfactor_rgb;
+  shadow->blend_dst_rgb = dfactor_rgb;
+  shadow->blend_src_alpha = sfactor_alpha;
+  shadow->blend_dst_alpha = dfactor_alpha;
+  glad_glBlendFuncSeparate(sfactor_rgb, dfactor_rgb, sfactor_alpha, dfactor_alpha);
+}
+
+void filter_glBlendEquation(GLenum mode) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr == shadow) {
+    glad_glBlendEquation(mode);
+    return;
+  }
+
+  if (true == is_filtered(shadow, shadow->blend_equation_rgb == mode && shadow->blend_equation_alpha == mode)) {
+    return;
+  }
+
+  shadow->blend_equation_rgb = mode;
+  shadow->blend_equation_alpha = mode;
+  glad_glBlendEquation(mode);
+}
+
+void filter_glBlendEquationSeparate(GLenum mode_rgb, GLenum mode_alpha) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr == shadow) {
+    glad_glBlendEquationSeparate(mode_rgb, mode_alpha);
+    return;
+  }
+
+  if (true == is_filtered(shadow, shadow->blend_equation_rgb == mode_rgb && shadow->blend_equation_alpha == mode_alpha)) {
+    return;
+  }
+
+  shadow->blend_equation_rgb = mode_rgb;
+  shadow->blend_equation_alpha = mode_alpha;
+  glad_glBlendEquationSeparate(mode_rgb, mode_alpha);
+}
+
+void filter_glDepthFunc(GLenum func) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr == shadow) {
+    glad_glDepthFunc(func);
+    return;
+  }
+
+  if (true == is_filtered(shadow, shadow->depth_func == func)) {
+    return;
+  }
+
+  shadow->depth_func = func;
+  glad_glDepthFunc(func);
+}
+
+void filter_glDepthMask(GLboolean flag) {
+
+  GlStateShadow* shadow = get_shadow();
+  uint32_t value = (GL_FALSE == flag) ? 0 : 1;
+
+  if (nullptr == shadow) {
+    glad_glDepthMask(flag);
+    return;
+  }
+
+  if (true == is_filtered(shadow, shadow->depth_mask == value)) {
+    return;
+  }
+
+  shadow->depth_mask = value;
+  glad_glDepthMask(flag);
+}
+
+void filter_glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+
+  GlStateShadow* shadow = get_shadow();
+  uint32_t value = ((GL_FALSE == red) ? 0 : 1)
+    | ((GL_FALSE == green) ? 0 : 2)
+    | ((GL_FALSE == blue) ? 0 : 4)
+    | ((GL_FALSE == alpha) ? 0 : 8);
+
+  if (nullptr == shadow) {
+    glad_glColorMask(red, green, blue, alpha);
+    return;
+  }
+
+  if (true == is_filtered(shadow, shadow->color_mask == value)) {
+    return;
+  }
+
+  shadow->color_mask = value;
+  glad_glColorMask(red, green, blue, alpha);
+}
+
+void filter_glCullFace(GLenum mode) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr == shadow) {
+    glad_glCullFace(mode);
+    return;
+  }
+
+  if (true == is_filtered(shadow, shadow->cull_face == mode)) {
+    return;
+  }
+
+  shadow->cull_face = mode;
+  glad_glCullFace(mode);
+}
+
+void filter_glFrontFace(GLenum mode) {
+
+  GlStateShadow* shadow = get_shadow();
+
+  if (nullptr == shadow) {
+    glad_glFrontFace(mode);
+    return;
+  }
+
+  if (true == is_filtered(shadow, shadow->front_face == mode)) {
+    return;
+  }
+
+  shadow->front_face = mode;
+  glad_glFrontFace(mode);
+}
+
+void filter_glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+
+  GlStateShadow* shadow = get_shadow();
+  GLint value[4] = { x, y, width, height };
+
+  if (nullptr == shadow) {
+    glad_glViewport(x, y, width, height);
+    return;
+  }
+
+  bool is_same = (true == shadow->is_viewport_known && 0 == memcmp(shadow->viewport, value, sizeof(value)));
+
+  if (true == is_filtered(shadow, is_same)) {
+    return;
+  }
+
+  memcpy(shadow->viewport, value, sizeof(value));
+  shadow->is_viewport_known = true;
+  glad_glViewport(x, y, width, height);
+}
+
+void filter_glScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+
+  GlStateShadow* shadow = get_shadow();
+  GLint value[4] = { x, y, width, height };
+
+  if (nullptr == shadow) {
+    glad_glScissor(x, y, width, height);
+    return;
+  }
+
+  bool is_same = (true == shadow->is_scissor_known && 0 == memcmp(shadow->scissor, value, sizeof(value)));
+
+  if (true == is_filtered(shadow, is_same)) {
+    return;
+  }
+
+  memcpy(shadow->scissor, value, sizeof(value));
+  shadow->is_scissor_known = true;
+  glad_glScissor(x, y, width, height);
+}
+
+/* ------------------------------------------------------------- */
+
+/* Returns the shadow of the current context, after forgetting its bindings when another context of the share group deleted objects. */
+static GlStateShadow* get_shadow() {
+
+  GlStateShadow* shadow = current_shadow;
+
+  if (nullptr != shadow
+      && shadow->delete_generation != shadow->group_deletes->load(std::memory_order_acquire))
+    {
+      shadow->reset_bindings();
+      shadow->stats.num_delete_resets++;
+    }
+
+  return shadow;
+}
+
+/* Our own shadow is already up to date; it only skips the reset when nobody else deleted something in the mean time. */
+static void count_delete(GlStateShadow* shadow) {
+
+  if (nullptr == shadow) {
+    return;
+  }
+
+  uint64_t prev = shadow->group_deletes->fetch_add(1, std::memory_order_acq_rel);
+  if (prev == shadow->delete_generation) {
+    shadow->delete_generation = prev + 1;
+  }
+}
+
+static bool is_filtered(GlStateShadow* shadow, bool is_same) {
+
+  shadow->stats.num_calls++;
+
+  if (true == is_same) {
+    shadow->stats.num_filtered++;
+  }
+
+  return is_same;
+}
+
+static int get_buffer_slot(GLenum target) {
+
+  switch (target) {
+    case GL_ARRAY_BUFFER:              { return STATE_BUFFER_ARRAY;              }
+    case GL_ELEMENT_ARRAY_BUFFER:      { return STATE_BUFFER_ELEMENT_ARRAY;      }
+    case GL_COPY_READ_BUFFER:          { return STATE_BUFFER_COPY_READ;          }
+    case GL_COPY_WRITE_BUFFER:         { return STATE_BUFFER_COPY_WRITE;         }
+    case GL_PIXEL_PACK_BUFFER:         { return STATE_BUFFER_PIXEL_PACK;         }
+    case GL_PIXEL_UNPACK_BUFFER:       { return STATE_BUFFER_PIXEL_UNPACK;       }
+    case GL_UNIFORM_BUFFER:            { return STATE_BUFFER_UNIFORM;            }
+    case GL_SHADER_STORAGE_BUFFER:     { return STATE_BUFFER_SHADER_STORAGE;     }
+    case GL_DRAW_INDIRECT_BUFFER:      { return STATE_BUFFER_DRAW_INDIRECT;      }
+    case GL_DISPATCH_INDIRECT_BUFFER:  { return STATE_BUFFER_DISPATCH_INDIRECT;  }
+    case GL_TEXTURE_BUFFER:            { return STATE_BUFFER_TEXTURE;            }
+    case GL_TRANSFORM_FEEDBACK_BUFFER: { return STATE_BUFFER_TRANSFORM_FEEDBACK; }
+    case GL_ATOMIC_COUNTER_BUFFER:     { return STATE_BUFFER_ATOMIC_COUNTER;     }
+    case GL_QUERY_BUFFER:              { return STATE_BUFFER_QUERY;              }
+    default:                           { return -1;                              }
+  }
+}
+
+static int get_texture_slot(GLenum target) {
+
+  switch (target) {
+    case GL_TEXTURE_1D:                   { return STATE_TEXTURE_1D;                   }
+    case GL_TEXTURE_2D:                   { return STATE_TEXTURE_2D;                   }
+    case GL_TEXTURE_3D:                   { return STATE_TEXTURE_3D;                   }
+    case GL_TEXTURE_1D_ARRAY:             { return STATE_TEXTURE_1D_ARRAY;             }
+    case GL_TEXTURE_2D_ARRAY:             { return STATE_TEXTURE_2D_ARRAY;             }
+    case GL_TEXTURE_RECTANGLE:            { return STATE_TEXTURE_RECTANGLE;            }
+    case GL_TEXTURE_CUBE_MAP:             { return STATE_TEXTURE_CUBE_MAP;             }
+    case GL_TEXTURE_CUBE_MAP_ARRAY:       { return STATE_TEXTURE_CUBE_MAP_ARRAY;       }
+    case GL_TEXTURE_BUFFER:               { return STATE_TEXTURE_BUFFER;               }
+    case GL_TEXTURE_2D_MULTISAMPLE:       { return STATE_TEXTURE_2D_MULTISAMPLE;       }
+    case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: { return STATE_TEXTURE_2D_MULTISAMPLE_ARRAY; }
+    default:                              { return -1;                                 }
+  }
+}
+
+static int get_cap_slot(GLenum cap) {
+
+  switch (cap) {
+    case GL_BLEND:                       { return STATE_CAP_BLEND;                    }
+    case GL_CULL_FACE:                   { return STATE_CAP_CULL_FACE;                }
+    case GL_DEPTH_TEST:                  { return STATE_CAP_DEPTH_TEST;               }
+    case GL_DEPTH_CLAMP:                 { return STATE_CAP_DEPTH_CLAMP;              }
+    case GL_STENCIL_TEST:                { return STATE_CAP_STENCIL_TEST;             }
+    case GL_SCISSOR_TEST:                { return STATE_CAP_SCISSOR_TEST;             }
+    case GL_POLYGON_OFFSET_FILL:         { return STATE_CAP_POLYGON_OFFSET_FILL;      }
+    case GL_MULTISAMPLE:                 { return STATE_CAP_MULTISAMPLE;              }
+    case GL_SAMPLE_ALPHA_TO_COVERAGE:    { return STATE_CAP_SAMPLE_ALPHA_TO_COVERAGE; }
+    case GL_FRAMEBUFFER_SRGB:            { return STATE_CAP_FRAMEBUFFER_SRGB;         }
+    case GL_PRIMITIVE_RESTART:           { return STATE_CAP_PRIMITIVE_RESTART;        }
+    case GL_RASTERIZER_DISCARD:          { return STATE_CAP_RASTERIZER_DISCARD;       }
+    case GL_PROGRAM_POINT_SIZE:          { return STATE_CAP_PROGRAM_POINT_SIZE;       }
+    case GL_TEXTURE_CUBE_MAP_SEAMLESS:   { return STATE_CAP_TEXTURE_CUBE_MAP_SEAMLESS; }
+    default:                             { return -1;                                 }
+  }
+}
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,269 @@
+/*
+
+  GL STATE FILTER
+  ================
+
+  Rendering code often calls `glBindBuffer()`, `glBindTexture()`,
+  `glUseProgram()`, `glEnable()`, ... without checking what is
+  already bound/set. Every call is a full trip into the driver.
+
+  When you compile with `GL_STATE_FILTER` defined, this header
+  redirects those functions in the same way glad does it:
+
+    #define glBindBuffer glad_glBindBuffer      // glad
+    #define glBindBuffer filter_glBindBuffer    // us
+
+  The `filter_*()` functions compare the call with a shadow of
+  the state of the current context and only call the glad
+  function when the state actually changes. Without
+  `GL_STATE_FILTER` nothing is redirected and you pay nothing.
+
+  Every `GlContext` has its own `GlStateShadow`. The shadow of
+  the current context is kept in a thread local pointer which
+  is updated by `make_context_current()` and
+  `release_current_context()`. When a context is made current on
+  another thread than the one that used it last, we can't know
+  what happened to its state in the mean time, so the shadow is
+  invalidated: every field becomes "unknown" and the next call
+  always goes to the driver. Call `gl_state_filter_invalidate()`
+  yourself when code that isn't compiled with the filter (e.g.
+  a library) changed the state.
+
+  Deleting a bound buffer, texture, sampler, vertex array or
+  framebuffer resets the binding to 0, like GL does for the
+  current context. Other contexts of the share group keep the
+  deleted object bound, while its name can be handed out again;
+  binding that name in such a context must reach the driver. So
+  every share group has one delete counter which each filtered
+  delete increments, and each shadow remembers the value it has
+  seen. When a filtered call finds that another context deleted
+  something since, the object bindings of its shadow (not the
+  other state) become unknown. `create_main_context()` links
+  the shadow of a context to the counter of the context it
+  shares with; deletes through a context that isn't made
+  current with `make_context_current()`, or that are done
+  through glad directly, aren't counted. The filter assumes the
+  calls are valid; a call that generates a GL error may leave
+  the shadow out of sync.
+
+  Indexed state (`glEnablei()`, `glBlendFunci()`, ...) and the
+  multi-bind functions aren't shadowed; when you use them, call
+  `gl_state_filter_invalidate()`.
+
+ */
+#ifndef GL_STATE_FILTER_H
+#define GL_STATE_FILTER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <glad/glad.h>
+
+/* ----------------------------------------------------------- */
+
+#define STATE_UNKNOWN 0xFFFFFFFFu
+#define STATE_CAP_UNKNOWN 0xFFu
+#define STATE_MAX_TEXTURE_UNITS 32
+
+enum StateBufferSlot {
+  STATE_BUFFER_ARRAY = 0,
+  STATE_BUFFER_ELEMENT_ARRAY,                  /* Part of the vertex array; unknown after the vertex array changed. */
+  STATE_BUFFER_COPY_READ,
+  STATE_BUFFER_COPY_WRITE,
+  STATE_BUFFER_PIXEL_PACK,
+  STATE_BUFFER_PIXEL_UNPACK,
+  STATE_BUFFER_UNIFORM,
+  STATE_BUFFER_SHADER_STORAGE,
+  STATE_BUFFER_DRAW_INDIRECT,
+  STATE_BUFFER_DISPATCH_INDIRECT,
+  STATE_BUFFER_TEXTURE,
+  STATE_BUFFER_TRANSFORM_FEEDBACK,
+  STATE_BUFFER_ATOMIC_COUNTER,
+  STATE_BUFFER_QUERY,
+  STATE_BUFFER_COUNT
+};
+
+enum StateTextureSlot {
+  STATE_TEXTURE_1D = 0,
+  STATE_TEXTURE_2D,
+  STATE_TEXTURE_3D,
+  STATE_TEXTURE_1D_ARRAY,
+  STATE_TEXTURE_2D_ARRAY,
+  STATE_TEXTURE_RECTANGLE,
+  STATE_TEXTURE_CUBE_MAP,
+  STATE_TEXTURE_CUBE_MAP_ARRAY,
+  STATE_TEXTURE_BUFFER,
+  STATE_TEXTURE_2D_MULTISAMPLE,
+  STATE_TEXTURE_2D_MULTISAMPLE_ARRAY,
+  STATE_TEXTURE_COUNT
+};
+
+enum StateCap {
+  STATE_CAP_BLEND = 0,
+  STATE_CAP_CULL_FACE,
+  STATE_CAP_DEPTH_TEST,
+  STATE_CAP_DEPTH_CLAMP,
+  STATE_CAP_STENCIL_TEST,
+  STATE_CAP_SCISSOR_TEST,
+  STATE_CAP_POLYGON_OFFSET_FILL,
+  STATE_CAP_MULTISAMPLE,
+  STATE_CAP_SAMPLE_ALPHA_TO_COVERAGE,
+  STATE_CAP_FRAMEBUFFER_SRGB,
+  STATE_CAP_PRIMITIVE_RESTART,
+  STATE_CAP_RASTERIZER_DISCARD,
+  STATE_CAP_PROGRAM_POINT_SIZE,
+  STATE_CAP_TEXTURE_CUBE_MAP_SEAMLESS,
+  STATE_CAP_COUNT
+};
+
+/* ----------------------------------------------------------- */
+
+struct GlStateFilterStats {
+  uint64_t num_calls = 0;                      /* Calls of shadowed state. */
+  uint64_t num_filtered = 0;                   /* Calls we didn't pass to the driver. */
+  uint64_t num_invalidations = 0;
+  uint64_t num_delete_resets = 0;              /* Times the bindings became unknown because another context deleted something. */
+};
+
+class GlStateShadow {
+public:
+  GlStateShadow();
+  GlStateShadow(const GlStateShadow&) = delete;
+  GlStateShadow& operator=(const GlStateShadow&) = delete;
+  void invalidate();
+  void reset_bindings();                       /* Makes the object bindings unknown; the rest of the state is kept. */
+
+public:
+  std::thread::id thread;                      /* The thread on which the context was current last. */
+  std::atomic<uint64_t> num_deletes{0};        /* The delete counter of the share group when this is the first context. */
+  std::atomic<uint64_t>* group_deletes = nullptr; /* The delete counter of the share group; points to `num_deletes` or that of another shadow. */
+  uint64_t delete_generation = 0;              /* The value of `group_deletes` that the bindings are up to date with. */
+  uint32_t buffers[STATE_BUFFER_COUNT];
+  uint32_t textures[STATE_MAX_TEXTURE_UNITS][STATE_TEXTURE_COUNT];
+  uint32_t samplers[STATE_MAX_TEXTURE_UNITS];
+  uint32_t active_texture;                     /* The unit, not the GL_TEXTURE0 + unit enum. */
+  uint32_t program;
+  uint32_t vertex_array;
+  uint32_t draw_framebuffer;
+  uint32_t read_framebuffer;
+  uint8_t caps[STATE_CAP_COUNT];               /* 0, 1 or STATE_CAP_UNKNOWN. */
+  uint32_t blend_src_rgb;
+  uint32_t blend_dst_rgb;
+  uint32_t blend_src_alpha;
+  uint32_t blend_dst_alpha;
+  uint32_t blend_equation_rgb;
+  uint32_t blend_equation_alpha;
+  uint32_t depth_func;
+  uint32_t depth_mask;
+  uint32_t color_mask;                         /* RGBA bits. */
+  uint32_t cull_face;
+  uint32_t front_face;
+  GLint viewport[4];
+  GLint scissor[4];
+  bool is_viewport_known;
+  bool is_scissor_known;
+  GlStateFilterStats stats;
+};
+
+/* ----------------------------------------------------------- */
+
+void gl_state_filter_make_current(GlStateShadow* shadow); /* Called by `make_context_current()` / `release_current_context()`. */
+void gl_state_filter_share(GlStateShadow* shadow, GlStateShadow* shared); /* Called by `create_main_context()`; `shared` may be nullptr. */
+GlStateShadow* gl_state_filter_get_current();
+void gl_state_filter_invalidate();                        /* Invalidates the shadow of the current context. */
+
+/* ----------------------------------------------------------- */
+
+void filter_glBindBuffer(GLenum target, GLuint buffer);
+void filter_glBindBufferBase(GLenum target, GLuint index, GLuint buffer);
+void filter_glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+void filter_glDeleteBuffers(GLsizei n, const GLuint* buffers);
+void filter_glActiveTexture(GLenum texture);
+void filter_glBindTexture(GLenum target, GLuint texture);
+void filter_glDeleteTextures(GLsizei n, const GLuint* textures);
+void filter_glBindSampler(GLuint unit, GLuint sampler);
+void filter_glDeleteSamplers(GLsizei n, const GLuint* samplers);
+void filter_glUseProgram(GLuint program);
+void filter_glBindVertexArray(GLuint array);
+void filter_glDeleteVertexArrays(GLsizei n, const GLuint* arrays);
+void filter_glBindFramebuffer(GLenum target, GLuint framebuffer);
+void filter_glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers);
+void filter_glEnable(GLenum cap);
+void filter_glDisable(GLenum cap);
+void filter_glBlendFunc(GLenum sfactor, GLenum dfactor);
+void filter_glBlendFuncSeparate(GLenum sfactor_rgb, GLenum dfactor_rgb, GLenum sfactor_alpha, GLenum dfactor_alpha);
+void filter_glBlendEquation(GLenum mode);
+void filter_glBlendEquationSeparate(GLenum mode_rgb, GLenum mode_alpha);
+void filter_glDepthFunc(GLenum func);
+void filter_glDepthMask(GLboolean flag);
+void filter_glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+void filter_glCullFace(GLenum mode);
+void filter_glFrontFace(GLenum mode);
+void filter_glViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void filter_glScissor(GLint x, GLint y, GLsizei width, GLsizei height);
+
+/* ----------------------------------------------------------- */
+
+#if defined(GL_STATE_FILTER)
+
+#  undef glBindBuffer
+#  undef glBindBufferBase
+#  undef glBindBufferRange
+#  undef glDeleteBuffers
+#  undef glActiveTexture
+#  undef glBindTexture
+#  undef glDeleteTextures
+#  undef glBindSampler
+#  undef glDeleteSamplers
+#  undef glUseProgram
+#  undef glBindVertexArray
+#  undef glDeleteVertexArrays
+#  undef glBindFramebuffer
+#  undef glDeleteFramebuffers
+#  undef glEnable
+#  undef glDisable
+#  undef glBlendFunc
+#  undef glBlendFuncSeparate
+#  undef glBlendEquation
+#  undef glBlendEquationSeparate
+#  undef glDepthFunc
+#  undef glDepthMask
+#  undef glColorMask
+#  undef glCullFace
+#  undef glFrontFace
+#  undef glViewport
+#  undef glScissor
+
+#  define glBindBuffer filter_glBindBuffer
+#  define glBindBufferBase filter_glBindBufferBase
+#  define glBindBufferRange filter_glBindBufferRange
+#  define glDeleteBuffers filter_glDeleteBuffers
+#  define glActiveTexture filter_glActiveTexture
+#  define glBindTexture filter_glBindTexture
+#  define glDeleteTextures filter_glDeleteTextures
+#  define glBindSampler filter_glBindSampler
+#  define glDeleteSamplers filter_glDeleteSamplers
+#  define glUseProgram filter_glUseProgram
+#  define glBindVertexArray filter_glBindVertexArray
+#  define glDeleteVertexArrays filter_glDeleteVertexArrays
+#  define glBindFramebuffer filter_glBindFramebuffer
+#  define glDeleteFramebuffers filter_glDeleteFramebuffers
+#  define glEnable filter_glEnable
+#  define glDisable filter_glDisable
+#  define glBlendFunc filter_glBlendFunc
+#  define glBlendFuncSeparate filter_glBlendFuncSeparate
+#  define glBlendEquation filter_glBlendEquation
+#  define glBlendEquationSeparate filter_glBlendEquationSeparate
+#  define glDepthFunc filter_glDepthFunc
+#  define glDepthMask filter_glDepthMask
+#  define glColorMask filter_glColorMask
+#  define glCullFace filter_glCullFace
+#  define glFrontFace filter_glFrontFace
+#  define glViewport filter_glViewport
+#  define glScissor filter_glScissor
+
+#endif
+
+/* ----------------------------------------------------------- */
+
+#endif
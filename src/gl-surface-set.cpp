@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <gl-surface-set.h>
+#include <gl-state-filter.h>
+#include <gl-sync.h>
+
+/* ------------------------------------------------------------- */
+
+int GlSurfaceSet::init(GlContext* context) {
+
+  if (nullptr == context) {
+    printf("Cannot initialize the surface set, no context given.\n");
+    return -1;
+  }
+
+  if (false == surfaces.empty()) {
+    printf("Cannot initialize the surface set, already initialized.\n");
+    return -2;
+  }
+
+#if defined(_WIN32)
+  if (nullptr == context->gl || wglGetCurrentContext() != context->gl) {
+    printf("Cannot initialize the surface set, the context must be current.\n");
+    return -3;
+  }
+
+  if (0 >= context->dx) {
+    printf("Cannot initialize the surface set, the context has no pixel format.\n");
+    return -4;
+  }
+#else
+  if (EGL_NO_CONTEXT == context->gl || eglGetCurrentContext() != context->gl) {
+    printf("Cannot initialize the surface set, the context must be current.\n");
+    return -3;
+  }
+#endif
+
+  ctx = context;
+  current = SURFACE_NONE;
+  stats = SurfaceStats();
+
+  return 0;
+}
+
+int GlSurfaceSet::shutdown() {
+
+  int r = 0;
+
+  if (nullptr == ctx) {
+    return 0;
+  }
+
+  if (SURFACE_NONE != current && 0 != make_context_current(*ctx)) {
+    printf("Failed to make the context current on its own surface again.\n");
+    r = -1;
+  }
+
+  for (GlSurface& surf : surfaces) {
+#if defined(_WIN32)
+    ReleaseDC(surf.hwnd, surf.dc);
+#else
+    eglDestroySurface(ctx->display, surf.surface);
+#endif
+  }
+
+  surfaces.clear();
+  current = SURFACE_NONE;
+  ctx = nullptr;
+
+  return r;
+}
+
+/* ------------------------------------------------------------- */
+
+#if defined(_WIN32)
+
+int GlSurfaceSet::add_window(HWND hwnd) {
+
+  if (nullptr == ctx) {
+    printf("Cannot add the window, not initialized.\n");
+    return -1;
+  }
+
+  if (nullptr == hwnd) {
+    printf("Cannot add the window, hwnd is nullptr.\n");
+    return -2;
+  }
+
+  GlSurface surf;
+  surf.hwnd = hwnd;
+  surf.dc = GetDC(hwnd);
+
+  if (nullptr == surf.dc) {
+    printf("Cannot add the window, failed to get its DC.\n");
+    return -3;
+  }
+
+  /* A pixel format can only be set once per window. */
+  int dx = GetPixelFormat(surf.dc);
+
+  if (0 == dx && FALSE == SetPixelFormat(surf.dc, ctx->dx, &ctx->fmt)) {
+    printf("Cannot add the window, failed to set the pixel format of the context.\n");
+    ReleaseDC(hwnd, surf.dc);
+    return -4;
+  }
+
+  if (0 != dx && ctx->dx != dx) {
+    printf("Cannot add the window, it has pixel format %d while the context needs %d.\n", dx, ctx->dx);
+    ReleaseDC(hwnd, surf.dc);
+    return -5;
+  }
+
+  RECT rect = {};
+  GetClientRect(hwnd, &rect);
+  surf.width = rect.right - rect.left;
+  surf.height = rect.bottom - rect.top;
+
+  surfaces.push_back(surf);
+
+  return 0;
+}
+
+#else
+
+int GlSurfaceSet::add_pbuffer(int width, int height) {
+
+  if (nullptr == ctx) {
+    printf("Cannot add the pbuffer, not initialized.\n");
+    return -1;
+  }
+
+  if (width <= 0 || height <= 0) {
+    printf("Cannot add the pbuffer, invalid size %d x %d.\n", width, height);
+    return -2;
+  }
+
+  const EGLint attribs[] = {
+    EGL_WIDTH, width,
+    EGL_HEIGHT, height,
+    EGL_NONE
+  };
+
+  GlSurface surf;
+  surf.surface = eglCreatePbufferSurface(ctx->display, ctx->config, attribs);
+  surf.width = width;
+  surf.height = height;
+
+  if (EGL_NO_SURFACE == surf.surface) {
+    printf("Cannot add the pbuffer, failed to create it (0x%04x).\n", eglGetError());
+    return -3;
+  }
+
+  surfaces.push_back(surf);
+
+  return 0;
+}
+
+#endif
+
+/* ------------------------------------------------------------- */
+
+/*
+  Only the drawable changes, so the state of the context (and its
+  shadow in the state filter) stays valid. The viewport doesn't
+  follow the drawable though; set it per surface.
+*/
+int GlSurfaceSet::make_current(uint32_t index) {
+
+  if (index >= surfaces.size()) {
+    printf("Cannot make surface %u current, there are %zu surfaces.\n", index, surfaces.size());
+    return -1;
+  }
+
+  GlSurface& surf = surfaces[index];
+
+  /* Ask the driver instead of trusting `current`; `make_context_current()` or other code may have switched since. */
+#if defined(_WIN32)
+  bool is_current = (wglGetCurrentContext() == ctx->gl && wglGetCurrentDC() == surf.dc);
+#else
+  bool is_current = (eglGetCurrentContext() == ctx->gl && eglGetCurrentSurface(EGL_DRAW) == surf.surface);
+#endif
+
+  if (true == is_current) {
+    current = index;
+    return 0;
+  }
+
+  uint64_t start_ns = gpu_sync_now_ns();
+
+#if defined(_WIN32)
+  if (FALSE == wglMakeCurrent(surf.dc, ctx->gl)) {
+    printf("Failed to make the context current on surface %u.\n", index);
+    return -2;
+  }
+#else
+  if (EGL_FALSE == eglMakeCurrent(ctx->display, surf.surface, surf.surface, ctx->gl)) {
+    printf("Failed to make the context current on surface %u.\n", index);
+    return -2;
+  }
+#endif
+
+  gl_state_filter_make_current(&ctx->state);
+
+  uint64_t switch_ns = gpu_sync_now_ns() - start_ns;
+  stats.num_switches++;
+  stats.total_switch_ns += switch_ns;
+  stats.max_switch_ns = (switch_ns > stats.max_switch_ns) ? switch_ns : stats.max_switch_ns;
+  current = index;
+
+  return 0;
+}
+
+int GlSurfaceSet::swap_all() {
+
+  if (true == surfaces.empty()) {
+    printf("Cannot swap, there are no surfaces.\n");
+    return -1;
+  }
+
+  uint64_t start_ns = gpu_sync_now_ns();
+  int r = 0;
+
+#if defined(_WIN32)
+  if (true == use_swap_multiple) {
+
+    WGLSWAP batch[WGL_SWAPMULTIPLE_MAX];
+
+    for (size_t first = 0; first < surfaces.size(); first += WGL_SWAPMULTIPLE_MAX) {
+
+      UINT num = 0;
+
+      for (size_t i = first; i < surfaces.size() && num < WGL_SWAPMULTIPLE_MAX; ++i) {
+        batch[num].hdc = surfaces[i].dc;
+        batch[num].uiFlags = 0;
+        num++;
+      }
+
+      if (0 == wglSwapMultipleBuffers(num, batch)) {
+        printf("Failed to swap surfaces %zu to %zu.\n", first, first + num - 1);
+        r = -3;
+      }
+
+      stats.num_batches++;
+    }
+  }
+  else {
+
+    for (size_t i = 0; i < surfaces.size(); ++i) {
+      if (FALSE == SwapBuffers(surfaces[i].dc)) {
+        printf("Failed to swap surface %zu.\n", i);
+        r = -2;
+      }
+      stats.num_batches++;
+    }
+  }
+#else
+  /* EGL can only swap the surface that is current; start with the one that is current now to save a switch. */
+  uint32_t num = (uint32_t)surfaces.size();
+  uint32_t first = (current < num) ? current : 0;
+
+  for (uint32_t n = 0; n < num; ++n) {
+
+    uint32_t i = (first + n) % num;
+
+    if (0 != make_current(i)) {
+      r = -2;
+      continue;
+    }
+
+    if (EGL_FALSE == eglSwapBuffers(ctx->display, surfaces[i].surface)) {
+      printf("Failed to swap surface %u.\n", i);
+      r = -3;
+    }
+
+    stats.num_batches++;
+  }
+#endif
+
+  for (GlSurface& surf : surfaces) {
+    surf.num_swaps++;
+  }
+
+  uint64_t swap_ns = gpu_sync_now_ns() - start_ns;
+  stats.num_frames++;
+  stats.total_swap_ns += swap_ns;
+  stats.max_swap_ns = (swap_ns > stats.max_swap_ns) ? swap_ns : stats.max_swap_ns;
+
+  return r;
+}
+
+void GlSurfaceSet::print() {
+
+  double num_frames = (0 == stats.num_frames) ? 1.0 : (double)stats.num_frames;
+  double num_switches = (0 == stats.num_switches) ? 1.0 : (double)stats.num_switches;
+
+  printf("surface set: %zu surfaces, %llu frames, %.2f driver swap calls per frame\n",
+         surfaces.size(),
+         (unsigned long long)stats.num_frames,
+         stats.num_batches / num_frames);
+
+  printf("  swap all: avg %.3f ms, max %.3f ms\n", stats.total_swap_ns / num_frames / 1e6, stats.max_swap_ns / 1e6);
+  printf("  switch:   avg %.3f ms, max %.3f ms (%llu switches)\n",
+         stats.total_switch_ns / num_switches / 1e6,
+         stats.max_switch_ns / 1e6,
+         (unsigned long long)stats.num_switches);
+}
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,109 @@
+/*
+
+  GL SURFACE SET
+  ===============
+
+  Presents one context to many windows (e.g. the displays of a
+  video wall). WGL lets you make a context current on any DC
+  whose pixel format matches the one the context was created
+  with, so instead of a context per window (and a copy of every
+  resource per context, or a share group that can't share
+  vertex arrays and framebuffers) we create one context and give
+  each window the pixel format that the context cached (`dx` and
+  `fmt`, see `gl-context.h`).
+
+    surfaces.init(&ctx);                       // `ctx` is current
+    surfaces.add_window(hwnd_left);
+    surfaces.add_window(hwnd_right);
+
+    for (size_t i = 0; i < surfaces.surfaces.size(); ++i) {
+      surfaces.make_current(i);
+      ... render the view of window i ...
+    }
+
+    surfaces.swap_all();                       // one batch per frame
+
+  `swap_all()` swaps all surfaces in one call to
+  `wglSwapMultipleBuffers()` (`WGL_SWAPMULTIPLE_MAX` windows per
+  call); with vsync, swapping the windows one by one could wait a
+  refresh per window. Set `use_swap_multiple` to false to swap
+  them one by one, e.g. to compare.
+
+  On Linux the surfaces are pbuffers created with the config of
+  the context (`add_pbuffer()`); there are no windows here. EGL
+  has no batched swap and can only swap the surface that is
+  current, so `swap_all()` makes each one current and swaps them
+  one by one.
+
+  The state of the context stays when it's made current on
+  another surface, except the viewport which you set per surface.
+
+  After the set is used, `make_context_current()` makes the
+  context current on its own surface again. Remove the windows
+  with `shutdown()` before they're destroyed.
+
+ */
+#ifndef GL_SURFACE_SET_H
+#define GL_SURFACE_SET_H
+
+#include <stdint.h>
+#include <vector>
+#include <gl-context.h>
+
+/* ----------------------------------------------------------- */
+
+#define SURFACE_NONE 0xFFFFFFFFu
+
+/* ----------------------------------------------------------- */
+
+struct GlSurface {
+#if defined(_WIN32)
+  HWND hwnd = nullptr;
+  HDC dc = nullptr;
+#else
+  EGLSurface surface = EGL_NO_SURFACE;
+#endif
+  int width = 0;
+  int height = 0;
+  uint64_t num_swaps = 0;
+};
+
+struct SurfaceStats {
+  uint64_t num_switches = 0;                   /* `make_current()` calls that changed the surface. */
+  uint64_t total_switch_ns = 0;
+  uint64_t max_switch_ns = 0;
+  uint64_t num_frames = 0;                     /* `swap_all()` calls. */
+  uint64_t num_batches = 0;                    /* Calls to the driver. */
+  uint64_t total_swap_ns = 0;
+  uint64_t max_swap_ns = 0;
+};
+
+/* ----------------------------------------------------------- */
+
+class GlSurfaceSet {
+public:
+  GlSurfaceSet() = default;
+  GlSurfaceSet(const GlSurfaceSet&) = delete;
+  GlSurfaceSet& operator=(const GlSurfaceSet&) = delete;
+  int init(GlContext* ctx);
+  int shutdown();                              /* Makes the context current on its own surface and removes all surfaces. */
+#if defined(_WIN32)
+  int add_window(HWND hwnd);                   /* Sets the pixel format of the context on the window. */
+#else
+  int add_pbuffer(int width, int height);
+#endif
+  int make_current(uint32_t index);
+  int swap_all();
+  void print();
+
+public:
+  GlContext* ctx = nullptr;
+  std::vector<GlSurface> surfaces;
+  uint32_t current = SURFACE_NONE;             /* The surface `make_current()` last made current; it checks the driver before it skips a switch. */
+  bool use_swap_multiple = true;               /* WGL: batch the swaps with `wglSwapMultipleBuffers()`. */
+  SurfaceStats stats;
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
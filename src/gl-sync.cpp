@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+#include <gl-sync.h>
+
+/* ------------------------------------------------------------- */
+
+static void update_max(std::atomic<uint64_t>& dst, uint64_t value);
+static void backoff(GpuWaitPolicy policy);
+
+/* ------------------------------------------------------------- */
+
+uint64_t gpu_sync_now_ns() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+}
+
+/* ------------------------------------------------------------- */
+
+void GpuWaitStats::reset() {
+  num_waits = 0;
+  num_timeouts = 0;
+  total_wait_ns = 0;
+  max_wait_ns = 0;
+  total_latency_ns = 0;
+  max_latency_ns = 0;
+}
+
+void GpuWaitStats::print(const char* name) {
+
+  uint64_t n = num_waits.load();
+  uint64_t signalled = n - num_timeouts.load();
+
+  printf("%s: waits: %llu, timeouts: %llu, avg wait: %.3f us, max wait: %.3f us, avg latency: %.3f us, max latency: %.3f us\n",
+         (nullptr == name) ? "GpuEvent" : name,
+         (unsigned long long)n,
+         (unsigned long long)num_timeouts.load(),
+         (0 == n) ? 0.0 : (total_wait_ns.load() / (double)n) / 1000.0,
+         max_wait_ns.load() / 1000.0,
+         (0 == signalled) ? 0.0 : (total_latency_ns.load() / (double)signalled) / 1000.0,
+         max_latency_ns.load() / 1000.0);
+}
+
+/* ------------------------------------------------------------- */
+
+int GpuEvent::signal() {
+
+  if (nullptr != fence.load(std::memory_order_acquire)) {
+    printf("Cannot signal, the previous signal hasn't been reset.\n");
+    return -1;
+  }
+
+  GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  if (nullptr == sync) {
+    printf("Failed to create a fence.\n");
+    return -2;
+  }
+
+  /* Make sure the fence reaches the GPU; other contexts can't flush our context. */
+  glFlush();
+
+  signal_time_ns.store(gpu_sync_now_ns(), std::memory_order_relaxed);
+  fence.store(sync, std::memory_order_release);
+
+  return 0;
+}
+
+int GpuEvent::wait_cpu(uint64_t timeout_ns) {
+
+  uint64_t start = gpu_sync_now_ns();
+  uint64_t deadline = (GPU_WAIT_FOREVER == timeout_ns) ? GPU_WAIT_FOREVER : start + timeout_ns;
+  GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+  GLenum status = GL_TIMEOUT_EXPIRED;
+  int r = GPU_WAIT_TIMEOUT;
+
+  /* Step 1: wait until the producer created the fence. */
+  GLsync sync = fence.load(std::memory_order_acquire);
+  while (nullptr == sync) {
+    if (gpu_sync_now_ns() >= deadline) {
+      goto done;
+    }
+    backoff(policy);
+    sync = fence.load(std::memory_order_acquire);
+  }
+
+  /* Step 2: wait until the GPU passed the fence. */
+  while (true) {
+
+    uint64_t now = gpu_sync_now_ns();
+    uint64_t remaining = (now >= deadline) ? 0 : deadline - now;
+    GLuint64 wait_ns = (GPU_WAIT_BLOCK == policy) ? remaining : 0;
+
+    status = glClientWaitSync(sync, flags, wait_ns);
+    flags = 0;
+
+    if (GL_ALREADY_SIGNALED == status || GL_CONDITION_SATISFIED == status) {
+      r = GPU_WAIT_SIGNALLED;
+      break;
+    }
+
+    if (GL_WAIT_FAILED == status) {
+      printf("Failed to wait for the fence.\n");
+      r = -1;
+      break;
+    }
+
+    if (0 == remaining) {
+      break;
+    }
+
+    if (GPU_WAIT_BLOCK != policy) {
+      backoff(policy);
+    }
+  }
+
+ done:
+
+  uint64_t end = gpu_sync_now_ns();
+  uint64_t waited = end - start;
+
+  stats.num_waits++;
+  stats.total_wait_ns += waited;
+  update_max(stats.max_wait_ns, waited);
+
+  if (GPU_WAIT_TIMEOUT == r) {
+    stats.num_timeouts++;
+  }
+  else if (GPU_WAIT_SIGNALLED == r) {
+    uint64_t signalled_at = signal_time_ns.load(std::memory_order_relaxed);
+    uint64_t latency = (end > signalled_at) ? end - signalled_at : 0;
+    stats.total_latency_ns += latency;
+    update_max(stats.max_latency_ns, latency);
+  }
+
+  return r;
+}
+
+int GpuEvent::wait_gpu(uint64_t timeout_ns) {
+
+  uint64_t start = gpu_sync_now_ns();
+  uint64_t deadline = (GPU_WAIT_FOREVER == timeout_ns) ? GPU_WAIT_FOREVER : start + timeout_ns;
+
+  GLsync sync = fence.load(std::memory_order_acquire);
+  while (nullptr == sync) {
+    if (gpu_sync_now_ns() >= deadline) {
+      stats.num_waits++;
+      stats.num_timeouts++;
+      return GPU_WAIT_TIMEOUT;
+    }
+    backoff(policy);
+    sync = fence.load(std::memory_order_acquire);
+  }
+
+  /* The GPU of the current context waits; we return immediately. */
+  glWaitSync(sync, 0, GL_TIMEOUT_IGNORED);
+
+  uint64_t waited = gpu_sync_now_ns() - start;
+  stats.num_waits++;
+  stats.total_wait_ns += waited;
+  update_max(stats.max_wait_ns, waited);
+
+  return GPU_WAIT_SIGNALLED;
+}
+
+int GpuEvent::is_signalled() {
+
+  GLsync sync = fence.load(std::memory_order_acquire);
+  if (nullptr == sync) {
+    return 0;
+  }
+
+  GLint value = GL_UNSIGNALED;
+  glGetSynciv(sync, GL_SYNC_STATUS, sizeof(value), nullptr, &value);
+
+  return (GL_SIGNALED == value) ? 1 : 0;
+}
+
+int GpuEvent::reset() {
+
+  GLsync sync = fence.exchange(nullptr, std::memory_order_acq_rel);
+  if (nullptr != sync) {
+    glDeleteSync(sync);
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+static void update_max(std::atomic<uint64_t>& dst, uint64_t value) {
+
+  uint64_t curr = dst.load(std::memory_order_relaxed);
+
+  while (value > curr && false == dst.compare_exchange_weak(curr, value, std::memory_order_relaxed)) {
+  }
+}
+
+static void backoff(GpuWaitPolicy policy) {
+
+  switch (policy) {
+    case GPU_WAIT_SPIN: {
+      break;
+    }
+    case GPU_WAIT_YIELD: {
+      std::this_thread::yield();
+      break;
+    }
+    case GPU_WAIT_BLOCK: {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+      break;
+    }
+  }
+}
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,98 @@
+/*
+
+  GL SYNC
+  ========
+
+  Small wrappers around `glFenceSync()`, `glWaitSync()` and
+  `glClientWaitSync()` that we use to synchronize between
+  threads that each have a context in the same share group.
+
+  A `GpuEvent` is signalled in one context and waited on in
+  another one. Sync objects are shared between the contexts of a
+  share group, so the waiting context can use the fence that the
+  signalling context created. `signal()` flushes the signalling
+  context; without a flush the fence might never reach the GPU
+  and a wait from another context could block forever.
+
+  The producer calls `signal()`, the consumer calls `wait_cpu()`
+  or `wait_gpu()` and then `reset()` which deletes the fence. A
+  producer can only signal again after the consumer did the
+  reset. When the consumer starts waiting before the producer
+  signalled, it first waits (using the same policy) until the
+  fence has been created.
+
+  Wait policies:
+
+  - `GPU_WAIT_SPIN`: poll the fence without giving up the CPU;
+     lowest latency, burns a core.
+  - `GPU_WAIT_YIELD`: poll, but yield between polls.
+  - `GPU_WAIT_BLOCK`: let the driver block in `glClientWaitSync()`.
+
+ */
+#ifndef GL_SYNC_H
+#define GL_SYNC_H
+
+#include <stdint.h>
+#include <atomic>
+#include <glad/glad.h>
+
+/* ----------------------------------------------------------- */
+
+#define GPU_WAIT_FOREVER UINT64_MAX
+
+/* ----------------------------------------------------------- */
+
+enum GpuWaitPolicy {
+  GPU_WAIT_SPIN,
+  GPU_WAIT_YIELD,
+  GPU_WAIT_BLOCK,
+};
+
+enum GpuWaitResult {
+  GPU_WAIT_SIGNALLED = 0,
+  GPU_WAIT_TIMEOUT = 1,
+};
+
+/* ----------------------------------------------------------- */
+
+class GpuWaitStats {
+public:
+  void reset();
+  void print(const char* name);
+
+public:
+  std::atomic<uint64_t> num_waits{0};
+  std::atomic<uint64_t> num_timeouts{0};
+  std::atomic<uint64_t> total_wait_ns{0};
+  std::atomic<uint64_t> max_wait_ns{0};
+  std::atomic<uint64_t> total_latency_ns{0}; /* Time between `signal()` and the moment the waiter saw the fence signalled. */
+  std::atomic<uint64_t> max_latency_ns{0};
+};
+
+/* ----------------------------------------------------------- */
+
+class GpuEvent {
+public:
+  GpuEvent() = default;
+  GpuEvent(const GpuEvent&) = delete;
+  GpuEvent& operator=(const GpuEvent&) = delete;
+  int signal();                                      /* Producer: inserts a fence in the current context and flushes. */
+  int wait_cpu(uint64_t timeout_ns = GPU_WAIT_FOREVER); /* Consumer: blocks the calling thread; returns a `GpuWaitResult` or < 0 on error. */
+  int wait_gpu(uint64_t timeout_ns = GPU_WAIT_FOREVER); /* Consumer: makes the GPU of the current context wait; only blocks the CPU until the fence exists. */
+  int is_signalled();                                /* Returns 1 when signalled, 0 when not (yet) and < 0 on error. */
+  int reset();                                       /* Consumer: deletes the fence; a context of the share group must be current. */
+
+public:
+  std::atomic<GLsync> fence{nullptr};
+  std::atomic<uint64_t> signal_time_ns{0};
+  GpuWaitPolicy policy = GPU_WAIT_BLOCK;
+  GpuWaitStats stats;
+};
+
+/* ----------------------------------------------------------- */
+
+uint64_t gpu_sync_now_ns(); /* Monotonic clock we use for the stats. */
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,463 @@
+#include <stdio.h>
+#include <algorithm>
+#include <gl-texture-residency.h>
+#include <gl-resource.h>
+
+/* ------------------------------------------------------------- */
+
+int TextureResidency::init(const TextureResidencySettings& cfg) {
+
+  if (0 != table_buffer) {
+    printf("Cannot initialize the texture residency, already initialized.\n");
+    return -1;
+  }
+
+  if (0 == GLAD_GL_ARB_bindless_texture) {
+    printf("Cannot initialize the texture residency, bindless textures aren't supported.\n");
+    return -2;
+  }
+
+  if (0 == GLAD_GL_VERSION_4_4 && 0 == GLAD_GL_ARB_buffer_storage) {
+    printf("Cannot initialize the texture residency, immutable buffer storage isn't supported.\n");
+    return -3;
+  }
+
+  if (cfg.max_textures < 2 || 0 == cfg.max_resident || 0 == cfg.num_frames) {
+    printf("Cannot initialize the texture residency, invalid settings.\n");
+    return -4;
+  }
+
+  settings = cfg;
+
+  GLint align = 256;
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
+  if (align <= 0) {
+    align = 256;
+  }
+
+  table_region_size = (uint64_t)settings.max_textures * sizeof(GLuint64);
+  table_region_size = ((table_region_size + align - 1) / align) * align;
+
+  GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  GLsizeiptr total = (GLsizeiptr)(table_region_size * settings.num_frames);
+
+  if (0 != gl_create_buffer(total, nullptr, flags, table_buffer)
+      || 0 != gl_map_buffer(table_buffer, 0, total, flags, (void**)&table_ptr))
+    {
+      printf("Cannot initialize the texture residency, failed to map the handle table.\n");
+      glDeleteBuffers(1, &table_buffer);
+      table_buffer = 0;
+      table_ptr = nullptr;
+      return -5;
+    }
+
+  /* Slot 0: the texture we point every non-resident slot to. */
+  const uint8_t white[4] = { 255, 255, 255, 255 };
+  gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1, 0, fallback_texture);
+  gl_upload_texture(GL_TEXTURE_2D, fallback_texture, 0, 0, 0, 0, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+  gl_set_texture_parameter(GL_TEXTURE_2D, fallback_texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  gl_set_texture_parameter(GL_TEXTURE_2D, fallback_texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  textures.assign(settings.max_textures, ResidentTexture());
+  textures[0].texture = fallback_texture;
+  textures[0].handle = glGetTextureHandleARB(fallback_texture);
+  textures[0].is_added = true;
+
+  if (0 == textures[0].handle) {
+    printf("Cannot initialize the texture residency, failed to get the handle of the fallback texture.\n");
+    shutdown();
+    return -6;
+  }
+
+  glMakeTextureHandleResidentARB(textures[0].handle);
+  textures[0].is_resident = true;
+
+  /* Hand out the low slots first. */
+  free_slots.clear();
+  for (uint32_t i = settings.max_textures - 1; i > 0; --i) {
+    free_slots.push_back(i);
+  }
+
+  requested.clear();
+  resident.clear();
+  removed.clear();
+  region_versions.assign(settings.num_frames, 0);
+  fences.assign(settings.num_frames, nullptr);
+  table_version = 1;
+  frame_index = 0;
+  frame = settings.num_frames;
+  is_in_frame = false;
+  is_updated = false;
+  num_made_resident = 0;
+  num_made_non_resident = 0;
+  num_table_writes = 0;
+
+  return 0;
+}
+
+int TextureResidency::shutdown() {
+
+  for (size_t i = 0; i < fences.size(); ++i) {
+    if (nullptr != fences[i]) {
+      glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+      glDeleteSync(fences[i]);
+    }
+  }
+
+  /* Deleting a texture makes its handles non-resident. */
+  for (size_t i = 0; i < textures.size(); ++i) {
+    if (true == textures[i].is_added) {
+      glDeleteTextures(1, &textures[i].texture);
+    }
+  }
+
+  if (0 != table_buffer) {
+    glDeleteBuffers(1, &table_buffer);
+  }
+
+  textures.clear();
+  free_slots.clear();
+  requested.clear();
+  resident.clear();
+  removed.clear();
+  region_versions.clear();
+  fences.clear();
+  table_buffer = 0;
+  table_ptr = nullptr;
+  fallback_texture = 0;
+  is_in_frame = false;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int TextureResidency::add(GLuint texture, GLuint sampler, uint32_t& slot) {
+
+  if (0 == table_buffer) {
+    printf("Cannot add the texture, the texture residency isn't initialized.\n");
+    return -1;
+  }
+
+  if (0 == texture) {
+    printf("Cannot add the texture, it's 0.\n");
+    return -2;
+  }
+
+  if (true == free_slots.empty()) {
+    printf("Cannot add the texture, all %u slots are used.\n", settings.max_textures);
+    return -3;
+  }
+
+  GLuint64 handle = (0 == sampler)
+    ? glGetTextureHandleARB(texture)
+    : glGetTextureSamplerHandleARB(texture, sampler);
+
+  if (0 == handle) {
+    printf("Cannot add the texture, failed to get its handle.\n");
+    return -4;
+  }
+
+  slot = free_slots.back();
+  free_slots.pop_back();
+
+  ResidentTexture& tex = textures[slot];
+  tex = ResidentTexture();
+  tex.texture = texture;
+  tex.handle = handle;
+  tex.is_added = true;
+
+  return 0;
+}
+
+int TextureResidency::remove(uint32_t slot) {
+
+  ResidentTexture* tex = get_texture(slot);
+  if (nullptr == tex) {
+    printf("Cannot remove the texture, invalid slot %u.\n", slot);
+    return -1;
+  }
+
+  if (true == tex->is_removed) {
+    return 0;
+  }
+
+  /* The slot points to the fallback from the next table write on; the texture is deleted in `update()`. */
+  tex->is_removed = true;
+  removed.push_back(slot);
+
+  if (true == tex->is_resident) {
+    table_version++;
+  }
+
+  return 0;
+}
+
+int TextureResidency::use(uint32_t slot) {
+
+  if (false == is_in_frame) {
+    printf("Cannot use the texture, call `begin_frame()` first.\n");
+    return -1;
+  }
+
+  ResidentTexture* tex = get_texture(slot);
+  if (nullptr == tex || true == tex->is_removed) {
+    printf("Cannot use the texture, invalid slot %u.\n", slot);
+    return -2;
+  }
+
+  tex->last_used = frame;
+
+  if (false == tex->is_resident && false == tex->is_requested) {
+    tex->is_requested = true;
+    requested.push_back(slot);
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int TextureResidency::begin_frame() {
+
+  if (0 == table_buffer) {
+    printf("Cannot begin the frame, the texture residency isn't initialized.\n");
+    return -1;
+  }
+
+  if (true == is_in_frame) {
+    printf("Cannot begin the frame, `end_frame()` wasn't called.\n");
+    return -2;
+  }
+
+  /* After this wait every frame up to `frame - num_frames` is done on the GPU. */
+  GLsync fence = fences[frame_index];
+  if (nullptr != fence) {
+
+    if (GL_WAIT_FAILED == glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED)) {
+      printf("Cannot begin the frame, failed to wait for the fence of the region.\n");
+      return -3;
+    }
+
+    glDeleteSync(fence);
+    fences[frame_index] = nullptr;
+  }
+
+  frame++;
+  is_in_frame = true;
+  is_updated = false;
+
+  return 0;
+}
+
+/*
+  Applies the residency changes of this frame in one go and
+  writes the handle table into the region of this frame when it
+  changed. Call it once a frame, after the last `use()` and
+  before the draws that sample the textures.
+*/
+int TextureResidency::update() {
+
+  if (false == is_in_frame) {
+    printf("Cannot update the texture residency, call `begin_frame()` first.\n");
+    return -1;
+  }
+
+  if (true == is_updated) {
+    printf("Cannot update the texture residency, already updated this frame.\n");
+    return -2;
+  }
+
+  /* Removed textures, once the GPU doesn't use them anymore. */
+  size_t num_removed = removed.size();
+  for (size_t i = 0; i < num_removed; ) {
+
+    uint32_t slot = removed[i];
+    ResidentTexture& tex = textures[slot];
+
+    if (false == is_gpu_done(tex)) {
+      ++i;
+      continue;
+    }
+
+    if (true == tex.is_resident) {
+      make_non_resident(slot);
+    }
+
+    glDeleteTextures(1, &tex.texture);
+    tex = ResidentTexture();
+    free_slots.push_back(slot);
+
+    removed[i] = removed[num_removed - 1];
+    removed.pop_back();
+    num_removed--;
+  }
+
+  /* Make the textures of this frame resident. */
+  for (size_t i = 0; i < requested.size(); ++i) {
+
+    uint32_t slot = requested[i];
+    ResidentTexture& tex = textures[slot];
+    tex.is_requested = false;
+
+    if (true == tex.is_resident || true == tex.is_removed || false == tex.is_added) {
+      continue;
+    }
+
+    glMakeTextureHandleResidentARB(tex.handle);
+    tex.is_resident = true;
+    resident.push_back(slot);
+    num_made_resident++;
+    table_version++;
+  }
+
+  requested.clear();
+
+  /* Evict the textures that weren't used for a while. */
+  for (size_t i = 0; i < resident.size(); ) {
+
+    uint32_t slot = resident[i];
+    ResidentTexture& tex = textures[slot];
+
+    if (tex.last_used + settings.keep_frames < frame && true == is_gpu_done(tex)) {
+      make_non_resident(slot);
+      continue;
+    }
+
+    ++i;
+  }
+
+  /* Still over budget: evict the least recently used ones. */
+  if (resident.size() > settings.max_resident) {
+
+    sorted = resident;
+    std::sort(sorted.begin(), sorted.end(), [this](uint32_t a, uint32_t b) {
+      return textures[a].last_used < textures[b].last_used;
+    });
+
+    for (size_t i = 0; i < sorted.size() && resident.size() > settings.max_resident; ++i) {
+
+      if (false == is_gpu_done(textures[sorted[i]])) {
+        break;
+      }
+
+      make_non_resident(sorted[i]);
+    }
+  }
+
+  /* Write the table when this region has an old version. */
+  if (region_versions[frame_index] != table_version) {
+
+    GLuint64* table = (GLuint64*)(table_ptr + frame_index * table_region_size);
+    GLuint64 fallback = textures[0].handle;
+
+    for (uint32_t i = 0; i < settings.max_textures; ++i) {
+      const ResidentTexture& tex = textures[i];
+      table[i] = (true == tex.is_resident && false == tex.is_removed) ? tex.handle : fallback;
+    }
+
+    region_versions[frame_index] = table_version;
+    num_table_writes++;
+  }
+
+  is_updated = true;
+
+  return 0;
+}
+
+int TextureResidency::bind(GLuint binding) {
+
+  if (false == is_updated) {
+    printf("Cannot bind the handle table, call `update()` first.\n");
+    return -1;
+  }
+
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER,
+                    binding,
+                    table_buffer,
+                    (GLintptr)(frame_index * table_region_size),
+                    (GLsizeiptr)(settings.max_textures * sizeof(GLuint64)));
+
+  return 0;
+}
+
+int TextureResidency::end_frame() {
+
+  if (false == is_in_frame) {
+    printf("Cannot end the frame, `begin_frame()` wasn't called.\n");
+    return -1;
+  }
+
+  fences[frame_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  frame_index = (frame_index + 1) % settings.num_frames;
+  is_in_frame = false;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+GLuint64 TextureResidency::get_handle(uint32_t slot) {
+
+  ResidentTexture* tex = get_texture(slot);
+  if (nullptr == tex) {
+    return 0;
+  }
+
+  return tex->handle;
+}
+
+void TextureResidency::get_stats(TextureResidencyStats& stats) {
+
+  stats.num_textures = (uint32_t)(textures.size() - free_slots.size());
+  stats.num_resident = (uint32_t)resident.size();
+  stats.num_made_resident = num_made_resident;
+  stats.num_made_non_resident = num_made_non_resident;
+  stats.num_table_writes = num_table_writes;
+
+  /* The fallback texture is one of them. */
+  if (stats.num_textures > 0) {
+    stats.num_textures--;
+  }
+}
+
+/* ------------------------------------------------------------- */
+
+/* Slot 0 is ours; it can't be used, removed or evicted. */
+ResidentTexture* TextureResidency::get_texture(uint32_t slot) {
+
+  if (0 == slot || slot >= textures.size()) {
+    return nullptr;
+  }
+
+  if (false == textures[slot].is_added) {
+    return nullptr;
+  }
+
+  return &textures[slot];
+}
+
+/* `begin_frame()` waited for the fence of `frame - num_frames`. */
+bool TextureResidency::is_gpu_done(const ResidentTexture& tex) {
+  return tex.last_used + settings.num_frames <= frame;
+}
+
+void TextureResidency::make_non_resident(uint32_t slot) {
+
+  ResidentTexture& tex = textures[slot];
+
+  glMakeTextureHandleNonResidentARB(tex.handle);
+  tex.is_resident = false;
+  num_made_non_resident++;
+  table_version++;
+
+  for (size_t i = 0; i < resident.size(); ++i) {
+    if (slot == resident[i]) {
+      resident[i] = resident.back();
+      resident.pop_back();
+      break;
+    }
+  }
+}
+
+/* ------------------------------------------------------------- */
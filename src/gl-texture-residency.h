@@ -0,0 +1,149 @@
+/*
+
+  GL TEXTURE RESIDENCY
+  =====================
+
+  With `ARB_bindless_texture` a shader samples a texture through
+  a 64 bit handle instead of a texture unit, so a material system
+  doesn't have to call `glActiveTexture()` / `glBindTexture()`
+  for every draw. A handle can only be used while it's
+  "resident", and drivers limit how much can be resident at
+  once. `TextureResidency` manages that:
+
+    uint32_t slot = 0;
+    residency.add(texture, sampler, slot);  // takes ownership of `texture`
+
+    residency.begin_frame();
+    for (each draw) {
+      residency.use(material.slot);
+    }
+    residency.update();                     // makes used textures resident, evicts, writes the table
+    residency.bind(1);                      // the handle table as SSBO at binding 1
+    ... draw ...
+    residency.end_frame();
+
+  `use()` only stamps the texture with the current frame number.
+  `update()` applies all residency changes of the frame at once:
+  it makes the textures that were used and aren't resident yet
+  resident, and makes textures non-resident that weren't used
+  for `keep_frames` frames or, when there are more than
+  `max_resident`, the least recently used ones.
+
+  HANDLE TABLE
+
+  The shader gets the handles from a table that is indexed by
+  slot:
+
+    #extension GL_ARB_bindless_texture : require
+    layout(std430, binding = 1) readonly buffer Textures { uvec2 textures[]; };
+    ...
+    vec4 color = texture(sampler2D(textures[slot]), uv);
+
+  The table lives in a persistently mapped buffer that is split
+  into `num_frames` regions guarded by fences; a region is only
+  rewritten when the table changed since that region was written
+  last. Slot 0 is a 1x1 white texture which is always resident;
+  the table contains its handle for every slot that isn't
+  resident, so a shader never samples a non-resident handle.
+
+  A texture that was used in a frame is never made non-resident
+  until the GPU finished that frame; `begin_frame()` waits for
+  the fence of the frame `num_frames` ago, so a texture is
+  evicted at the earliest `num_frames` frames after its last
+  use. `remove()` is deferred in the same way: the texture is
+  made non-resident and deleted once the GPU is done with it.
+
+  Note that getting a handle makes the texture (and sampler)
+  state immutable; set the parameters before `add()`. Handles
+  are shared by the share group, but residency is per context:
+  a handle is only resident in the context that made it
+  resident. So all functions must be called on one thread, with
+  the context that draws with the handles current.
+
+ */
+#ifndef GL_TEXTURE_RESIDENCY_H
+#define GL_TEXTURE_RESIDENCY_H
+
+#include <stdint.h>
+#include <vector>
+#include <glad/glad.h>
+#include <gl-state-filter.h>
+
+/* ----------------------------------------------------------- */
+
+struct TextureResidencySettings {
+  uint32_t max_textures = 4096;                /* The number of slots in the handle table. */
+  uint32_t max_resident = 1024;                /* Keep at most this many textures resident. */
+  uint32_t keep_frames = 120;                  /* Unused textures are made non-resident after this many frames. */
+  uint32_t num_frames = 3;
+};
+
+struct ResidentTexture {
+  GLuint texture = 0;
+  GLuint64 handle = 0;
+  uint64_t last_used = 0;                      /* Frame number of the last `use()`. */
+  bool is_added = false;
+  bool is_resident = false;
+  bool is_requested = false;                   /* Used this frame while not resident. */
+  bool is_removed = false;                     /* Waits for the GPU before it gets deleted. */
+};
+
+struct TextureResidencyStats {
+  uint32_t num_textures = 0;
+  uint32_t num_resident = 0;
+  uint64_t num_made_resident = 0;
+  uint64_t num_made_non_resident = 0;
+  uint64_t num_table_writes = 0;               /* How often a region of the table was rewritten. */
+};
+
+/* ----------------------------------------------------------- */
+
+class TextureResidency {
+public:
+  TextureResidency() = default;
+  TextureResidency(const TextureResidency&) = delete;
+  TextureResidency& operator=(const TextureResidency&) = delete;
+  int init(const TextureResidencySettings& cfg);
+  int shutdown();                              /* Waits for the GPU and deletes all textures. */
+  int add(GLuint texture, GLuint sampler, uint32_t& slot); /* `sampler` is optional (0). */
+  int remove(uint32_t slot);
+  int use(uint32_t slot);
+  int begin_frame();
+  int update();
+  int bind(GLuint binding);
+  int end_frame();
+  GLuint64 get_handle(uint32_t slot);
+  void get_stats(TextureResidencyStats& stats);
+
+public:
+  TextureResidencySettings settings;
+  std::vector<ResidentTexture> textures;       /* Indexed by slot. */
+  std::vector<uint32_t> free_slots;
+  std::vector<uint32_t> requested;             /* Slots to make resident in `update()`. */
+  std::vector<uint32_t> resident;              /* Slots that are resident, except slot 0. */
+  std::vector<uint32_t> removed;
+  std::vector<uint32_t> sorted;                /* Scratch, for the LRU eviction. */
+  GLuint table_buffer = 0;
+  uint8_t* table_ptr = nullptr;                /* Persistently mapped. */
+  uint64_t table_region_size = 0;
+  uint64_t table_version = 1;
+  std::vector<uint64_t> region_versions;
+  std::vector<GLsync> fences;
+  GLuint fallback_texture = 0;
+  uint32_t frame_index = 0;                    /* The region. */
+  uint64_t frame = 0;                          /* Frame number; starts at `num_frames` so "never used" is old enough. */
+  bool is_in_frame = false;
+  bool is_updated = false;
+  uint64_t num_made_resident = 0;
+  uint64_t num_made_non_resident = 0;
+  uint64_t num_table_writes = 0;
+
+private:
+  ResidentTexture* get_texture(uint32_t slot);
+  bool is_gpu_done(const ResidentTexture& tex);
+  void make_non_resident(uint32_t slot);
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
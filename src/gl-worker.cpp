@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <gl-worker.h>
+#include <gl-sync.h>
+
+/* ------------------------------------------------------------- */
+
+GlWorker::~GlWorker() {
+  
+  if (true == thread.joinable()) {
+    shutdown();
+  }
+}
+
+int GlWorker::start(GlContext* shared) {
+
+  if (true == thread.joinable()) {
+    printf("Cannot start the worker, already started.\n");
+    return -1;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_running = true;
+    is_stopping = false;
+    shutdown_deadline_ns = 0;
+  }
+
+  shutdown_ns = 0;
+  num_executed = 0;
+  num_dropped = 0;
+  num_idle = 0;
+
+  std::promise<int> created;
+  std::future<int> result = created.get_future();
+
+  thread = std::thread(&GlWorker::run, this, shared, &created);
+
+  if (0 != result.get()) {
+    printf("Failed to create the worker context.\n");
+    thread.join();
+    return -2;
+  }
+
+  return 0;
+}
+
+int GlWorker::post(std::function<void()> task) {
+
+  if (!task) {
+    printf("Cannot post, invalid task.\n");
+    return -1;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    if (false == is_running || true == is_stopping) {
+      printf("Cannot post, the worker isn't running.\n");
+      return -2;
+    }
+    
+    tasks.push_back(std::move(task));
+  }
+
+  cond.notify_one();
+
+  return 0;
+}
+
+int GlWorker::shutdown() {
+
+  if (false == thread.joinable()) {
+    printf("Cannot shutdown the worker, not started.\n");
+    return -1;
+  }
+
+  uint64_t start = gpu_sync_now_ns();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_stopping = true;
+    shutdown_deadline_ns = start + max_shutdown_ns;
+  }
+
+  cond.notify_one();
+  thread.join();
+
+  shutdown_ns = gpu_sync_now_ns() - start;
+
+  if (shutdown_ns > max_shutdown_ns) {
+    printf("Worker shutdown took %.3f ms which is longer than the max of %.3f ms; a task didn't return in time.\n",
+           shutdown_ns / 1e6,
+           max_shutdown_ns / 1e6);
+  }
+
+  return 0;
+}
+
+size_t GlWorker::num_pending() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return tasks.size();
+}
+
+/* ------------------------------------------------------------- */
+
+void GlWorker::run(GlContext* shared, std::promise<int>* created) {
+
+  if (0 != create_shared_context(shared, ctx)) {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_running = false;
+    created->set_value(-1);
+    return;
+  }
+
+  if (0 != make_context_current(ctx)) {
+    destroy_main_context(ctx);
+    std::lock_guard<std::mutex> lock(mutex);
+    is_running = false;
+    created->set_value(-2);
+    return;
+  }
+
+  /* Don't touch `created` after this; `start()` returns and the promise goes out of scope. */
+  created->set_value(0);
+
+  std::function<void()> task;
+  bool has_idle_task = (bool)idle_task;
+  uint64_t next_idle_ns = gpu_sync_now_ns() + idle_interval_ns;
+
+  while (true) {
+
+    bool is_idle = false;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      auto has_work = [this]() { return false == tasks.empty() || true == is_stopping; };
+
+      if (false == has_idle_task) {
+        cond.wait(lock, has_work);
+      }
+      else {
+        uint64_t now = gpu_sync_now_ns();
+        if (now < next_idle_ns) {
+          cond.wait_for(lock, std::chrono::nanoseconds(next_idle_ns - now), has_work);
+        }
+        if (false == is_stopping && gpu_sync_now_ns() >= next_idle_ns) {
+          is_idle = true;
+        }
+        else if (false == has_work()) {
+          /* Spurious wakeup. */
+          continue;
+        }
+      }
+
+      if (false == is_idle) {
+
+        if (true == tasks.empty()) {
+          /* Stopping and drained. */
+          break;
+        }
+
+        if (true == is_stopping && gpu_sync_now_ns() > shutdown_deadline_ns) {
+          num_dropped += tasks.size();
+          tasks.clear();
+          break;
+        }
+
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+    }
+
+    if (true == is_idle) {
+      idle_task();
+      num_idle++;
+      next_idle_ns = gpu_sync_now_ns() + idle_interval_ns;
+      continue;
+    }
+
+    task();
+    task = nullptr;
+    num_executed++;
+  }
+
+  if (num_dropped > 0) {
+    printf("Dropped %llu worker tasks, draining took longer than the max shutdown time.\n", (unsigned long long)num_dropped);
+  }
+
+  /* Make sure our commands were executed before the context goes away. */
+  glFinish();
+
+  if (0 != release_current_context()) {
+    printf("Failed to release the worker context.\n");
+  }
+
+  if (0 != destroy_main_context(ctx)) {
+    printf("Failed to cleanly destroy the worker context.\n");
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  is_running = false;
+}
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,84 @@
+/*
+
+  GL WORKER
+  ==========
+
+  A thread that owns a context which shares with the context
+  you pass into `start()`. This replaces the bare `std::thread`
+  + `thread_func()` that we used in the threading test, which
+  never joined its thread and leaked its context.
+
+  - `start()` launches the thread, which creates its context and
+    makes it current. `start()` only returns once the context has
+    been created (or failed to), so the context you share with
+    can be made current again when `start()` returns.
+
+  - `post()` queues a task. Tasks run in order, on the worker
+    thread, with the worker context current.
+
+  - `shutdown()` stops accepting tasks, drains the queue, makes
+    the context non-current, deletes it and joins the thread.
+    Draining is bounded by `max_shutdown_ns`; tasks that haven't
+    started when that time passed are dropped so a worker can
+    always be restarted quickly (e.g. on a config reload). The
+    time the shutdown took is stored in `shutdown_ns`.
+
+  - `idle_task` is optional and must be set before `start()`. It
+    runs on the worker thread every `idle_interval_ns`, in between
+    the posted tasks; we use it for periodic jobs like sweeping a
+    `DeletionQueue`. It doesn't run anymore once `shutdown()` has
+    been called.
+
+  Remember: the context you pass into `start()` must not be
+  current in any thread while `start()` runs.
+
+ */
+#ifndef GL_WORKER_H
+#define GL_WORKER_H
+
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <functional>
+#include <condition_variable>
+#include <gl-context.h>
+
+/* ----------------------------------------------------------- */
+
+class GlWorker {
+public:
+  GlWorker() = default;
+  GlWorker(const GlWorker&) = delete;
+  GlWorker& operator=(const GlWorker&) = delete;
+  ~GlWorker();
+  int start(GlContext* shared);
+  int post(std::function<void()> task);
+  int shutdown();
+  size_t num_pending();
+
+public:
+  GlContext ctx;
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<std::function<void()>> tasks;
+  std::function<void()> idle_task;                  /* Optional; set before `start()`. */
+  uint64_t idle_interval_ns = 1000ull * 1000ull;
+  bool is_running = false;                          /* Protected by `mutex`. */
+  bool is_stopping = false;                         /* Protected by `mutex`. */
+  uint64_t max_shutdown_ns = 1000ull * 1000ull * 1000ull;
+  uint64_t shutdown_deadline_ns = 0;                /* Protected by `mutex`. */
+  uint64_t shutdown_ns = 0;                         /* How long the last `shutdown()` took. */
+  uint64_t num_executed = 0;                        /* Stats; only read these after `shutdown()`. */
+  uint64_t num_dropped = 0;
+  uint64_t num_idle = 0;                            /* How often `idle_task` ran. */
+
+private:
+  void run(GlContext* shared, std::promise<int>* created);
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,203 @@
+/*
+
+  MPSC QUEUE
+  ===========
+
+  Bounded, lock free, multiple producer / single consumer ring
+  buffer. Use this when several worker threads (each with their
+  own shared context) hand things to one render thread.
+
+  This is Dmitry Vyukov's bounded queue where every cell has a
+  sequence number. A producer claims a cell by incrementing
+  `tail` with a CAS, writes the item and then publishes it by
+  updating the sequence of the cell. Because there is only one
+  consumer, popping doesn't need a CAS. When a producer claimed
+  a cell but didn't publish it yet, the consumer stops there;
+  items are never reordered.
+
+  - The capacity is rounded up to a power of two.
+  - `head` and `tail` live on their own cache line.
+  - `pop_batch()` pops up to `max` items in one go.
+
+  `T` must be default constructible and move assignable.
+
+ */
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <utility>
+#include <spsc-queue.h>
+
+/* ----------------------------------------------------------- */
+
+template<typename T>
+class MpscQueue {
+public:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+public:
+  MpscQueue() = default;
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+  ~MpscQueue();
+  int init(size_t capacity);
+  int shutdown();
+  bool push(const T& item);               /* Any thread; returns false when full. */
+  bool push(T&& item);                    /* Any thread; returns false when full. */
+  bool pop(T& item);                      /* Consumer; returns false when empty. */
+  size_t pop_batch(T* items, size_t max); /* Consumer; returns the number of popped items. */
+  size_t size() const;                    /* Approximate. */
+
+public:
+  Cell* cells = nullptr;
+  size_t mask = 0;
+  uint8_t pad0[CACHE_LINE_SIZE];
+  std::atomic<size_t> tail{0};            /* Producers CAS this. */
+  uint8_t pad1[CACHE_LINE_SIZE];
+  std::atomic<size_t> head{0};            /* Only the consumer writes this. */
+  uint8_t pad2[CACHE_LINE_SIZE];
+
+private:
+  template<typename U> bool emplace(U&& item);
+};
+
+/* ----------------------------------------------------------- */
+
+template<typename T>
+MpscQueue<T>::~MpscQueue() {
+  shutdown();
+}
+
+template<typename T>
+int MpscQueue<T>::init(size_t capacity) {
+
+  if (nullptr != cells) {
+    return -1;
+  }
+
+  if (capacity < 2) {
+    return -2;
+  }
+
+  size_t n = 2;
+  while (n < capacity) {
+    n <<= 1;
+  }
+
+  cells = new Cell[n];
+  mask = n - 1;
+
+  for (size_t i = 0; i < n; ++i) {
+    cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  head.store(0, std::memory_order_relaxed);
+  tail.store(0, std::memory_order_release);
+
+  return 0;
+}
+
+template<typename T>
+int MpscQueue<T>::shutdown() {
+
+  if (nullptr != cells) {
+    delete[] cells;
+  }
+
+  cells = nullptr;
+  mask = 0;
+
+  return 0;
+}
+
+template<typename T>
+bool MpscQueue<T>::push(const T& item) {
+  return emplace(item);
+}
+
+template<typename T>
+bool MpscQueue<T>::push(T&& item) {
+  return emplace(std::move(item));
+}
+
+template<typename T>
+template<typename U>
+bool MpscQueue<T>::emplace(U&& item) {
+
+  Cell* cell = nullptr;
+  size_t pos = tail.load(std::memory_order_relaxed);
+
+  while (true) {
+
+    cell = &cells[pos & mask];
+    size_t seq = cell->seq.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+    if (0 == diff) {
+      /* The cell is free; try to claim it. */
+      if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else if (diff < 0) {
+      /* The consumer didn't pop this cell yet; full. */
+      return false;
+    }
+    else {
+      /* Another producer claimed this cell. */
+      pos = tail.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->data = std::forward<U>(item);
+  cell->seq.store(pos + 1, std::memory_order_release);
+
+  return true;
+}
+
+template<typename T>
+bool MpscQueue<T>::pop(T& item) {
+  return 1 == pop_batch(&item, 1);
+}
+
+template<typename T>
+size_t MpscQueue<T>::pop_batch(T* items, size_t max) {
+
+  size_t pos = head.load(std::memory_order_relaxed);
+  size_t n = 0;
+
+  while (n < max) {
+
+    Cell& cell = cells[(pos + n) & mask];
+    if (cell.seq.load(std::memory_order_acquire) != pos + n + 1) {
+      break;
+    }
+
+    items[n] = std::move(cell.data);
+    cell.seq.store(pos + n + mask + 1, std::memory_order_release);
+    n++;
+  }
+
+  if (n > 0) {
+    head.store(pos + n, std::memory_order_release);
+  }
+
+  return n;
+}
+
+template<typename T>
+size_t MpscQueue<T>::size() const {
+  size_t t = tail.load(std::memory_order_acquire);
+  size_t h = head.load(std::memory_order_acquire);
+  return (t > h) ? t - h : 0;
+}
+
+/* ----------------------------------------------------------- */
+
+#endif
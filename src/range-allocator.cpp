@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <range-allocator.h>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+/* ------------------------------------------------------------- */
+
+static uint32_t find_last_set(uint64_t v);
+static uint32_t find_first_set(uint64_t v);
+static void mapping_insert(uint64_t units, uint32_t& fl, uint32_t& sl);
+static void mapping_search(uint64_t units, uint32_t& fl, uint32_t& sl);
+
+/* ------------------------------------------------------------- */
+
+int RangeAllocator::init(uint64_t cap, uint64_t align) {
+
+  if (0 != capacity) {
+    printf("Cannot initialize the range allocator, already initialized.\n");
+    return -1;
+  }
+
+  if (0 == align) {
+    printf("Cannot initialize the range allocator, invalid alignment.\n");
+    return -2;
+  }
+
+  /* Only whole alignment units can be handed out. */
+  cap = (cap / align) * align;
+  if (0 == cap) {
+    printf("Cannot initialize the range allocator, the capacity is smaller than the alignment.\n");
+    return -3;
+  }
+
+  for (uint32_t i = 0; i < RANGE_FL_COUNT; ++i) {
+    sl_bitmaps[i] = 0;
+    for (uint32_t j = 0; j < RANGE_SL_COUNT; ++j) {
+      free_lists[i][j] = RANGE_NONE;
+    }
+  }
+
+  blocks.clear();
+  unused_blocks = RANGE_NONE;
+  fl_bitmap = 0;
+  capacity = cap;
+  alignment = align;
+  used = 0;
+  num_allocations = 0;
+  num_free_blocks = 0;
+
+  first_block = create_block();
+  blocks[first_block].offset = 0;
+  blocks[first_block].size = capacity;
+  insert_free(first_block);
+
+  return 0;
+}
+
+int RangeAllocator::shutdown() {
+
+  blocks.clear();
+  unused_blocks = RANGE_NONE;
+  first_block = RANGE_NONE;
+  fl_bitmap = 0;
+  capacity = 0;
+  alignment = 0;
+  used = 0;
+  num_allocations = 0;
+  num_free_blocks = 0;
+
+  return 0;
+}
+
+int RangeAllocator::alloc(uint64_t size, RangeAllocation& result) {
+
+  if (0 == capacity) {
+    printf("Cannot allocate, the range allocator isn't initialized.\n");
+    return -1;
+  }
+
+  if (0 == size || size > capacity) {
+    return -2;
+  }
+
+  uint64_t units = (size + alignment - 1) / alignment;
+  uint32_t dx = find_free(units);
+  if (RANGE_NONE == dx) {
+    return -3;
+  }
+
+  remove_free(dx);
+
+  uint64_t needed = units * alignment;
+
+  if (blocks[dx].size > needed) {
+
+    /* Split; note that `create_block()` may reallocate `blocks`. */
+    uint32_t rest = create_block();
+    uint32_t next = blocks[dx].next_phys;
+
+    blocks[rest].offset = blocks[dx].offset + needed;
+    blocks[rest].size = blocks[dx].size - needed;
+    blocks[rest].prev_phys = dx;
+    blocks[rest].next_phys = next;
+
+    if (RANGE_NONE != next) {
+      blocks[next].prev_phys = rest;
+    }
+
+    blocks[dx].next_phys = rest;
+    blocks[dx].size = needed;
+
+    insert_free(rest);
+  }
+
+  used += blocks[dx].size;
+  num_allocations++;
+
+  result.offset = blocks[dx].offset;
+  result.size = blocks[dx].size;
+  result.block = dx;
+
+  return 0;
+}
+
+int RangeAllocator::free(uint32_t dx) {
+
+  if (dx >= blocks.size()
+      || false == blocks[dx].is_used
+      || true == blocks[dx].is_free)
+    {
+      printf("Cannot free the range, invalid block: %u.\n", dx);
+      return -1;
+    }
+
+  used -= blocks[dx].size;
+  num_allocations--;
+
+  uint32_t prev = blocks[dx].prev_phys;
+  if (RANGE_NONE != prev && true == blocks[prev].is_free) {
+
+    remove_free(prev);
+
+    uint32_t next = blocks[dx].next_phys;
+    blocks[prev].size += blocks[dx].size;
+    blocks[prev].next_phys = next;
+
+    if (RANGE_NONE != next) {
+      blocks[next].prev_phys = prev;
+    }
+
+    destroy_block(dx);
+    dx = prev;
+  }
+
+  uint32_t next = blocks[dx].next_phys;
+  if (RANGE_NONE != next && true == blocks[next].is_free) {
+
+    remove_free(next);
+
+    uint32_t after = blocks[next].next_phys;
+    blocks[dx].size += blocks[next].size;
+    blocks[dx].next_phys = after;
+
+    if (RANGE_NONE != after) {
+      blocks[after].prev_phys = dx;
+    }
+
+    destroy_block(next);
+  }
+
+  insert_free(dx);
+
+  return 0;
+}
+
+/*
+  Because the new allocator only has one free block, every
+  allocation is taken from the start of that block; walking the
+  blocks in offset order packs them without holes.
+*/
+int RangeAllocator::compact(RangeAllocator& result, std::vector<RangeMove>& moves) const {
+
+  moves.clear();
+
+  if (0 != result.init(capacity, alignment)) {
+    printf("Cannot compact, failed to initialize the result.\n");
+    return -1;
+  }
+
+  uint32_t dx = first_block;
+
+  while (RANGE_NONE != dx) {
+
+    const RangeBlock& block = blocks[dx];
+
+    if (false == block.is_free) {
+
+      RangeAllocation allocation;
+      if (0 != result.alloc(block.size, allocation)) {
+        printf("Cannot compact, failed to allocate in the result (this shouldn't happen).\n");
+        return -2;
+      }
+
+      RangeMove move;
+      move.src_block = dx;
+      move.dst_block = allocation.block;
+      move.src_offset = block.offset;
+      move.dst_offset = allocation.offset;
+      move.size = block.size;
+      moves.push_back(move);
+    }
+
+    dx = block.next_phys;
+  }
+
+  return 0;
+}
+
+void RangeAllocator::get_stats(RangeAllocatorStats& stats) const {
+
+  stats.capacity = capacity;
+  stats.used = used;
+  stats.free = capacity - used;
+  stats.largest_free = get_largest_free();
+  stats.num_allocations = num_allocations;
+  stats.num_free_blocks = num_free_blocks;
+  stats.occupancy = (0 == capacity) ? 0.0 : (double)used / capacity;
+  stats.fragmentation = (0 == stats.free) ? 0.0 : 1.0 - (double)stats.largest_free / stats.free;
+}
+
+/* The largest block is in the highest non-empty list; that list can contain a couple of sizes. */
+uint64_t RangeAllocator::get_largest_free() const {
+
+  if (0 == fl_bitmap) {
+    return 0;
+  }
+
+  uint32_t fl = find_last_set(fl_bitmap);
+  uint32_t sl = find_last_set(sl_bitmaps[fl]);
+  uint32_t dx = free_lists[fl][sl];
+  uint64_t largest = 0;
+
+  while (RANGE_NONE != dx) {
+    if (blocks[dx].size > largest) {
+      largest = blocks[dx].size;
+    }
+    dx = blocks[dx].next_free;
+  }
+
+  return largest;
+}
+
+/* ------------------------------------------------------------- */
+
+uint32_t RangeAllocator::create_block() {
+
+  uint32_t dx = RANGE_NONE;
+
+  if (RANGE_NONE != unused_blocks) {
+    dx = unused_blocks;
+    unused_blocks = blocks[dx].next_free;
+    blocks[dx] = RangeBlock();
+  }
+  else {
+    dx = (uint32_t)blocks.size();
+    blocks.push_back(RangeBlock());
+  }
+
+  blocks[dx].is_used = true;
+
+  return dx;
+}
+
+void RangeAllocator::destroy_block(uint32_t dx) {
+  blocks[dx] = RangeBlock();
+  blocks[dx].next_free = unused_blocks;
+  unused_blocks = dx;
+}
+
+void RangeAllocator::insert_free(uint32_t dx) {
+
+  uint32_t fl = 0;
+  uint32_t sl = 0;
+  mapping_insert(blocks[dx].size / alignment, fl, sl);
+
+  uint32_t head = free_lists[fl][sl];
+
+  blocks[dx].is_free = true;
+  blocks[dx].prev_free = RANGE_NONE;
+  blocks[dx].next_free = head;
+
+  if (RANGE_NONE != head) {
+    blocks[head].prev_free = dx;
+  }
+
+  free_lists[fl][sl] = dx;
+  sl_bitmaps[fl] |= (1u << sl);
+  fl_bitmap |= (1ull << fl);
+  num_free_blocks++;
+}
+
+void RangeAllocator::remove_free(uint32_t dx) {
+
+  uint32_t fl = 0;
+  uint32_t sl = 0;
+  mapping_insert(blocks[dx].size / alignment, fl, sl);
+
+  uint32_t prev = blocks[dx].prev_free;
+  uint32_t next = blocks[dx].next_free;
+
+  if (RANGE_NONE != prev) {
+    blocks[prev].next_free = next;
+  }
+
+  if (RANGE_NONE != next) {
+    blocks[next].prev_free = prev;
+  }
+
+  if (free_lists[fl][sl] == dx) {
+    free_lists[fl][sl] = next;
+    if (RANGE_NONE == next) {
+      sl_bitmaps[fl] &= ~(1u << sl);
+      if (0 == sl_bitmaps[fl]) {
+        fl_bitmap &= ~(1ull << fl);
+      }
+    }
+  }
+
+  blocks[dx].is_free = false;
+  blocks[dx].prev_free = RANGE_NONE;
+  blocks[dx].next_free = RANGE_NONE;
+  num_free_blocks--;
+}
+
+/* Returns the first block of the first non-empty list that only has blocks >= `units`. */
+uint32_t RangeAllocator::find_free(uint64_t units) {
+
+  uint32_t fl = 0;
+  uint32_t sl = 0;
+  mapping_search(units, fl, sl);
+
+  if (fl >= RANGE_FL_COUNT) {
+    return RANGE_NONE;
+  }
+
+  uint32_t sl_map = sl_bitmaps[fl] & (0xFFFFFFFFu << sl);
+
+  if (0 == sl_map) {
+
+    uint64_t fl_map = (fl + 1 >= RANGE_FL_COUNT) ? 0 : fl_bitmap & (~0ull << (fl + 1));
+    if (0 == fl_map) {
+      return RANGE_NONE;
+    }
+
+    fl = find_first_set(fl_map);
+    sl_map = sl_bitmaps[fl];
+  }
+
+  sl = find_first_set(sl_map);
+
+  return free_lists[fl][sl];
+}
+
+/* ------------------------------------------------------------- */
+
+static uint32_t find_last_set(uint64_t v) {
+#if defined(_MSC_VER)
+  unsigned long dx = 0;
+  _BitScanReverse64(&dx, v);
+  return (uint32_t)dx;
+#else
+  return 63u - (uint32_t)__builtin_clzll(v);
+#endif
+}
+
+static uint32_t find_first_set(uint64_t v) {
+#if defined(_MSC_VER)
+  unsigned long dx = 0;
+  _BitScanForward64(&dx, v);
+  return (uint32_t)dx;
+#else
+  return (uint32_t)__builtin_ctzll(v);
+#endif
+}
+
+/* Sizes are in alignment units; below RANGE_SL_COUNT every size has its own list. */
+static void mapping_insert(uint64_t units, uint32_t& fl, uint32_t& sl) {
+
+  if (units < RANGE_SL_COUNT) {
+    fl = 0;
+    sl = (uint32_t)units;
+    return;
+  }
+
+  uint32_t msb = find_last_set(units);
+  fl = msb - RANGE_SL_LOG2 + 1;
+  sl = (uint32_t)(units >> (msb - RANGE_SL_LOG2)) - RANGE_SL_COUNT;
+}
+
+/* Rounds up to the next class so every block in the resulting list is large enough. */
+static void mapping_search(uint64_t units, uint32_t& fl, uint32_t& sl) {
+
+  if (units >= RANGE_SL_COUNT) {
+    units += (1ull << (find_last_set(units) - RANGE_SL_LOG2)) - 1;
+  }
+
+  mapping_insert(units, fl, sl);
+}
+
+/* ------------------------------------------------------------- */
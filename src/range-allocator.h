@@ -0,0 +1,119 @@
+/*
+
+  RANGE ALLOCATOR
+  ================
+
+  Hands out ranges `[offset, offset + size)` of something that
+  is `capacity` bytes large; we use it to sub-allocate GL buffers
+  (see `gl-buffer-arena.h`) but it doesn't touch GL itself, so it
+  can be tested and benchmarked on any box.
+
+  This is a TLSF (two level segregated fit) allocator: free
+  blocks are kept in lists indexed by size class. The first
+  level is the power of two of the size, the second level
+  splits that power of two into 32 classes. Two bitmaps tell us
+  which lists are non-empty, so `alloc()` and `free()` are O(1):
+
+    - alloc: round the size up to the next class, find the first
+      non-empty list at or above that class (bit scan), split
+      the block when it's larger than needed.
+
+    - free: merge with the physical neighbours when they are
+      free and put the result back into its list.
+
+  All sizes and offsets are multiples of `alignment`. The block
+  records live in a vector and are recycled; an allocation is
+  identified by the index of its block.
+
+  `compact()` creates a new allocator with all the allocations
+  packed at the start, in offset order, and returns the moves
+  you have to apply to the data.
+
+ */
+#ifndef RANGE_ALLOCATOR_H
+#define RANGE_ALLOCATOR_H
+
+#include <stdint.h>
+#include <vector>
+
+/* ----------------------------------------------------------- */
+
+#define RANGE_SL_LOG2 5
+#define RANGE_SL_COUNT (1 << RANGE_SL_LOG2)
+#define RANGE_FL_COUNT 64
+#define RANGE_NONE 0xFFFFFFFFu
+
+/* ----------------------------------------------------------- */
+
+struct RangeBlock {
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  uint32_t prev_phys = RANGE_NONE;
+  uint32_t next_phys = RANGE_NONE;
+  uint32_t prev_free = RANGE_NONE;             /* Also used to link unused block records. */
+  uint32_t next_free = RANGE_NONE;
+  bool is_free = false;
+  bool is_used = false;                        /* False when the record itself is unused. */
+};
+
+struct RangeAllocation {
+  uint64_t offset = 0;
+  uint64_t size = 0;                           /* Rounded up to the alignment. */
+  uint32_t block = RANGE_NONE;
+};
+
+struct RangeMove {
+  uint32_t src_block = RANGE_NONE;
+  uint32_t dst_block = RANGE_NONE;
+  uint64_t src_offset = 0;
+  uint64_t dst_offset = 0;
+  uint64_t size = 0;
+};
+
+struct RangeAllocatorStats {
+  uint64_t capacity = 0;
+  uint64_t used = 0;
+  uint64_t free = 0;
+  uint64_t largest_free = 0;
+  uint32_t num_allocations = 0;
+  uint32_t num_free_blocks = 0;
+  double occupancy = 0.0;                      /* used / capacity */
+  double fragmentation = 0.0;                  /* 1 - largest_free / free; 0 when all free space is one block. */
+};
+
+/* ----------------------------------------------------------- */
+
+class RangeAllocator {
+public:
+  int init(uint64_t capacity, uint64_t alignment);
+  int shutdown();
+  int alloc(uint64_t size, RangeAllocation& result); /* Returns < 0 when there is no block large enough. */
+  int free(uint32_t block);
+  int compact(RangeAllocator& result, std::vector<RangeMove>& moves) const;
+  void get_stats(RangeAllocatorStats& stats) const;
+  uint64_t get_largest_free() const;
+
+public:
+  std::vector<RangeBlock> blocks;
+  uint32_t unused_blocks = RANGE_NONE;         /* List of block records we can reuse. */
+  uint32_t first_block = RANGE_NONE;           /* The block at offset 0. */
+  uint32_t free_lists[RANGE_FL_COUNT][RANGE_SL_COUNT];
+  uint32_t sl_bitmaps[RANGE_FL_COUNT];
+  uint64_t fl_bitmap = 0;
+  uint64_t capacity = 0;
+  uint64_t alignment = 0;
+  uint64_t used = 0;
+  uint32_t num_allocations = 0;
+  uint32_t num_free_blocks = 0;
+
+private:
+  uint32_t create_block();
+  void destroy_block(uint32_t dx);
+  void insert_free(uint32_t dx);
+  void remove_free(uint32_t dx);
+  uint32_t find_free(uint64_t units);
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,493 @@
+#include <stdio.h>
+#include <string.h>
+#include <new>
+#include <shared-frame-ring.h>
+#include <gl-sync.h>
+
+#if !defined(_WIN32)
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+/* ------------------------------------------------------------- */
+
+#define FRAME_RING_PAGE_SIZE 4096ull
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "The ring shares atomics between processes; they must be lock free.");
+
+/* ------------------------------------------------------------- */
+
+static uint64_t align_up(uint64_t value, uint64_t alignment);
+static int map_memory(SharedFrameRing& ring, const char* name, uint64_t size, bool is_create);
+#if !defined(_WIN32)
+static bool is_ring_closed(const char* name);
+#endif
+
+/* ------------------------------------------------------------- */
+
+SharedFrameRing::~SharedFrameRing() {
+
+  if (nullptr != base) {
+    close();
+  }
+}
+
+int SharedFrameRing::create(const char* ring_name, const FrameRingSettings& cfg) {
+
+  if (nullptr != base) {
+    printf("Cannot create the frame ring, already created or opened.\n");
+    return -1;
+  }
+
+  if (nullptr == ring_name) {
+    printf("Cannot create the frame ring, no name given.\n");
+    return -2;
+  }
+
+  if (0 == cfg.num_slots || cfg.num_slots > FRAME_RING_MAX_SLOTS) {
+    printf("Cannot create the frame ring, the number of slots must be 1 - %u.\n", FRAME_RING_MAX_SLOTS);
+    return -3;
+  }
+
+  if (0 == cfg.width || 0 == cfg.height || 0 == cfg.bytes_per_pixel) {
+    printf("Cannot create the frame ring, invalid frame size.\n");
+    return -4;
+  }
+
+  uint64_t stride = (uint64_t)cfg.width * cfg.bytes_per_pixel;
+  uint64_t slot_size = stride * cfg.height;
+  uint64_t data_offset = align_up(sizeof(FrameRingHeader), FRAME_RING_PAGE_SIZE);
+  uint64_t slot_stride = align_up(slot_size, FRAME_RING_PAGE_SIZE);
+  uint64_t total_size = data_offset + slot_stride * cfg.num_slots;
+
+  int r = map_memory(*this, ring_name, total_size, true);
+  if (-5 == r) {
+    return -6;
+  }
+
+  if (0 != r) {
+    printf("Failed to create the shared memory for the frame ring.\n");
+    return -5;
+  }
+
+  name = ring_name;
+  is_producer = true;
+  next_slot = 0;
+
+  /*
+    We own the memory, so we construct the header (and its
+    atomics) in it. The name is already visible; the consumer
+    only trusts the header once it sees the magic, so that is
+    stored last.
+  */
+  header = new (base) FrameRingHeader();
+  header->num_slots = cfg.num_slots;
+  header->width = cfg.width;
+  header->height = cfg.height;
+  header->stride = (uint32_t)stride;
+  header->format = cfg.format;
+  header->type = cfg.type;
+  header->slot_size = slot_size;
+  header->total_size = total_size;
+
+  for (uint32_t i = 0; i < cfg.num_slots; ++i) {
+    header->slots[i].offset = data_offset + slot_stride * i;
+  }
+
+  header->magic.store(FRAME_RING_MAGIC, std::memory_order_release);
+
+  return 0;
+}
+
+int SharedFrameRing::open(const char* ring_name) {
+
+  if (nullptr != base) {
+    printf("Cannot open the frame ring, already created or opened.\n");
+    return -1;
+  }
+
+  if (nullptr == ring_name) {
+    printf("Cannot open the frame ring, no name given.\n");
+    return -2;
+  }
+
+  /* Map the header first to find the size of the whole ring. */
+  if (0 != map_memory(*this, ring_name, sizeof(FrameRingHeader), false)) {
+    return -3;
+  }
+
+  FrameRingHeader* peek = reinterpret_cast<FrameRingHeader*>(base);
+  uint32_t magic = peek->magic.load(std::memory_order_acquire);
+
+  if (0 == magic) {
+    printf("Cannot open the frame ring `%s`, the producer is still creating it.\n", ring_name);
+    close();
+    return -6;
+  }
+
+  if (FRAME_RING_MAGIC != magic || FRAME_RING_VERSION != peek->version) {
+    printf("Cannot open the frame ring `%s`, it's not a frame ring (or another version).\n", ring_name);
+    close();
+    return -4;
+  }
+
+  uint64_t total_size = peek->total_size;
+  close();
+
+  if (0 != map_memory(*this, ring_name, total_size, false)) {
+    return -5;
+  }
+
+  name = ring_name;
+  is_producer = false;
+  header = reinterpret_cast<FrameRingHeader*>(base);
+
+  return 0;
+}
+
+int SharedFrameRing::close() {
+
+  if (nullptr == base) {
+    return 0;
+  }
+
+  if (true == is_producer && nullptr != header) {
+    header->is_closed.store(1, std::memory_order_release);
+  }
+
+#if defined(_WIN32)
+  UnmapViewOfFile(base);
+  CloseHandle(mapping);
+  mapping = nullptr;
+#else
+  munmap(base, size);
+  ::close(fd);
+  fd = -1;
+
+  /* The consumer keeps its mapping; the name is only needed to open it. */
+  if (true == is_producer) {
+    shm_unlink(name.c_str());
+  }
+#endif
+
+  base = nullptr;
+  header = nullptr;
+  size = 0;
+  is_producer = false;
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+int SharedFrameRing::begin_write(uint32_t& slot) {
+
+  slot = FRAME_RING_NONE;
+
+  if (nullptr == header || false == is_producer) {
+    printf("Cannot begin writing, the ring wasn't created by us.\n");
+    return -1;
+  }
+
+  uint32_t num_slots = header->num_slots;
+
+  for (uint32_t i = 0; i < num_slots; ++i) {
+
+    uint32_t dx = (next_slot + i) % num_slots;
+    uint32_t expected = FRAME_SLOT_FREE;
+
+    if (true == header->slots[dx].state.compare_exchange_strong(expected, FRAME_SLOT_WRITING, std::memory_order_acquire)) {
+      slot = dx;
+      next_slot = (dx + 1) % num_slots;
+      return 0;
+    }
+  }
+
+  header->num_dropped.fetch_add(1, std::memory_order_relaxed);
+
+  return 1;
+}
+
+int SharedFrameRing::publish(uint32_t slot, uint64_t frame) {
+
+  if (nullptr == header || slot >= header->num_slots) {
+    printf("Cannot publish, invalid slot.\n");
+    return -1;
+  }
+
+  FrameRingSlot& s = header->slots[slot];
+
+  if (FRAME_SLOT_WRITING != s.state.load(std::memory_order_relaxed)) {
+    printf("Cannot publish slot %u, it's not being written.\n", slot);
+    return -2;
+  }
+
+  s.frame = frame;
+  s.time_ns = gpu_sync_now_ns();
+
+  /* Release: the data and the fields above are visible before the consumer sees READY. */
+  s.state.store(FRAME_SLOT_READY, std::memory_order_release);
+  header->num_published.fetch_add(1, std::memory_order_relaxed);
+
+  return 0;
+}
+
+int SharedFrameRing::cancel(uint32_t slot) {
+
+  if (nullptr == header || slot >= header->num_slots) {
+    printf("Cannot cancel, invalid slot.\n");
+    return -1;
+  }
+
+  uint32_t expected = FRAME_SLOT_WRITING;
+
+  if (false == header->slots[slot].state.compare_exchange_strong(expected, FRAME_SLOT_FREE, std::memory_order_release)) {
+    printf("Cannot cancel slot %u, it's not being written.\n", slot);
+    return -2;
+  }
+
+  return 0;
+}
+
+uint8_t* SharedFrameRing::get_data(uint32_t slot) {
+
+  if (nullptr == header || slot >= header->num_slots) {
+    return nullptr;
+  }
+
+  return base + header->slots[slot].offset;
+}
+
+/* ------------------------------------------------------------- */
+
+int SharedFrameRing::acquire(FrameView& view) {
+
+  if (nullptr == header) {
+    printf("Cannot acquire, the ring isn't open.\n");
+    return -1;
+  }
+
+  /* The oldest ready frame, so we get them in order. */
+  uint32_t oldest = FRAME_RING_NONE;
+  uint64_t oldest_frame = UINT64_MAX;
+
+  for (uint32_t i = 0; i < header->num_slots; ++i) {
+
+    FrameRingSlot& s = header->slots[i];
+
+    if (FRAME_SLOT_READY == s.state.load(std::memory_order_acquire) && s.frame < oldest_frame) {
+      oldest = i;
+      oldest_frame = s.frame;
+    }
+  }
+
+  if (FRAME_RING_NONE == oldest) {
+    return 1;
+  }
+
+  /* Only we move a READY slot, so this can't fail with one consumer. */
+  uint32_t expected = FRAME_SLOT_READY;
+  FrameRingSlot& s = header->slots[oldest];
+
+  if (false == s.state.compare_exchange_strong(expected, FRAME_SLOT_READING, std::memory_order_acquire)) {
+    printf("Failed to acquire slot %u; is there more than one consumer?\n", oldest);
+    return -2;
+  }
+
+  view.slot = oldest;
+  view.frame = s.frame;
+  view.time_ns = s.time_ns;
+  view.data = base + s.offset;
+  view.size = header->slot_size;
+
+  return 0;
+}
+
+int SharedFrameRing::release(const FrameView& view) {
+
+  if (nullptr == header || view.slot >= header->num_slots) {
+    printf("Cannot release, invalid slot.\n");
+    return -1;
+  }
+
+  uint32_t expected = FRAME_SLOT_READING;
+
+  /* Release: we're done reading before the producer can write into it again. */
+  if (false == header->slots[view.slot].state.compare_exchange_strong(expected, FRAME_SLOT_FREE, std::memory_order_release)) {
+    printf("Cannot release slot %u, it wasn't acquired.\n", view.slot);
+    return -2;
+  }
+
+  header->num_consumed.fetch_add(1, std::memory_order_relaxed);
+
+  return 0;
+}
+
+bool SharedFrameRing::is_closed() {
+
+  if (nullptr == header) {
+    return true;
+  }
+
+  if (0 == header->is_closed.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < header->num_slots; ++i) {
+    if (FRAME_SLOT_READY == header->slots[i].state.load(std::memory_order_acquire)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* ------------------------------------------------------------- */
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+#if defined(_WIN32)
+
+static int map_memory(SharedFrameRing& ring, const char* name, uint64_t size, bool is_create) {
+
+  HANDLE mapping = nullptr;
+
+  if (true == is_create) {
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFFull), name);
+  }
+  else {
+    mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+  }
+
+  if (nullptr == mapping) {
+    printf("Cannot map the frame ring `%s`, failed to %s the file mapping (%lu).\n", name, (true == is_create) ? "create" : "open", GetLastError());
+    return -1;
+  }
+
+  /* We got a handle to a ring that someone still has open; we must not write a new header into it. */
+  if (true == is_create && ERROR_ALREADY_EXISTS == GetLastError()) {
+    printf("Cannot map the frame ring `%s`, it already exists.\n", name);
+    CloseHandle(mapping);
+    return -5;
+  }
+
+  void* ptr = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, (size_t)size);
+  if (nullptr == ptr) {
+    printf("Cannot map the frame ring `%s`, failed to map the view (%lu).\n", name, GetLastError());
+    CloseHandle(mapping);
+    return -2;
+  }
+
+  ring.mapping = mapping;
+  ring.base = (uint8_t*)ptr;
+  ring.size = size;
+
+  return 0;
+}
+
+#else
+
+static int map_memory(SharedFrameRing& ring, const char* name, uint64_t size, bool is_create) {
+
+  int fd = -1;
+
+  if (true == is_create) {
+
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    int err = (fd < 0) ? errno : 0;
+
+    /* Only replace a ring that its producer closed; without that mark it may still be in use. */
+    if (EEXIST == err && true == is_ring_closed(name)) {
+      shm_unlink(name);
+      fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+      err = (fd < 0) ? errno : 0;
+    }
+
+    if (EEXIST == err) {
+      printf("Cannot map the frame ring `%s`, it already exists and wasn't closed; remove `/dev/shm%s` if its producer crashed.\n", name, name);
+      return -5;
+    }
+
+    if (fd < 0) {
+      printf("Cannot map the frame ring `%s`, failed to create the shared memory.\n", name);
+      return -1;
+    }
+
+    if (0 != ftruncate(fd, (off_t)size)) {
+      printf("Cannot map the frame ring `%s`, failed to set the size.\n", name);
+      ::close(fd);
+      shm_unlink(name);
+      return -2;
+    }
+  }
+  else {
+
+    fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+      printf("Cannot map the frame ring `%s`, failed to open the shared memory.\n", name);
+      return -1;
+    }
+
+    /* The producer creates the object before it sets the size; touching a page past the end is a SIGBUS. */
+    struct stat info;
+    if (0 != fstat(fd, &info) || (uint64_t)info.st_size < size) {
+      printf("Cannot map the frame ring `%s`, the shared memory isn't sized yet.\n", name);
+      ::close(fd);
+      return -4;
+    }
+  }
+
+  void* ptr = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (MAP_FAILED == ptr) {
+    printf("Cannot map the frame ring `%s`, mmap failed.\n", name);
+    ::close(fd);
+    if (true == is_create) {
+      shm_unlink(name);
+    }
+    return -3;
+  }
+
+  ring.fd = fd;
+  ring.base = (uint8_t*)ptr;
+  ring.size = size;
+
+  return 0;
+}
+
+/* Peeks at the header of an existing ring; false when it can't be read or isn't a closed ring. */
+static bool is_ring_closed(const char* name) {
+
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (0 != fstat(fd, &info) || (uint64_t)info.st_size < sizeof(FrameRingHeader)) {
+    ::close(fd);
+    return false;
+  }
+
+  void* ptr = mmap(nullptr, sizeof(FrameRingHeader), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+
+  if (MAP_FAILED == ptr) {
+    return false;
+  }
+
+  const FrameRingHeader* peek = reinterpret_cast<const FrameRingHeader*>(ptr);
+  bool is_closed = (FRAME_RING_MAGIC == peek->magic.load(std::memory_order_acquire) && 1 == peek->is_closed.load(std::memory_order_acquire));
+
+  munmap(ptr, sizeof(FrameRingHeader));
+
+  return is_closed;
+}
+
+#endif
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,163 @@
+/*
+
+  SHARED FRAME RING
+  ==================
+
+  A ring of frame slots in shared memory, so a process (e.g. an
+  encoder) can use the frames that another process rendered
+  without sending them through a socket. The producer creates the
+  ring by name, the consumer opens it by that name:
+
+    // producer
+    ring.create("/poly-export", cfg);
+    if (0 == ring.begin_write(slot)) {
+      memcpy(ring.get_data(slot), pixels, ring.header->slot_size);
+      ring.publish(slot, frame);
+    }
+
+    // consumer (another process)
+    ring.open("/poly-export");
+    if (0 == ring.acquire(view)) {
+      encode(view.data, view.size);          // in place, no copy
+      ring.release(view);
+    }
+
+  On Linux the memory is a POSIX shared memory object
+  (`shm_open()`, names start with a slash); on Windows it's a
+  file mapping backed by the page file. The mapping starts with
+  a `FrameRingHeader`; the data of every slot starts at a page
+  aligned offset.
+
+  Every slot has a state in shared memory that only moves
+  forward: FREE -> WRITING (producer) -> READY (producer) ->
+  READING (consumer) -> FREE (consumer). Each side only moves the
+  states it owns, with an atomic compare-exchange, so there are
+  no locks between the processes. The consumer reads the data in
+  place while the slot is READING; the producer never touches it
+  then. When there is no FREE slot, `begin_write()` returns 1 and
+  the producer drops the frame instead of waiting for the
+  consumer. `acquire()` returns the oldest READY slot, so the
+  consumer gets the frames in order.
+
+  `create()` doesn't take over a name that is in use. On Linux it
+  only replaces an existing object whose header says it was
+  closed; a ring left behind by a producer that crashed has to
+  be removed from `/dev/shm` first. On Windows the mapping goes
+  away with its last handle, so an existing one is always in
+  use.
+
+  There is one producer and one consumer per ring. The atomics
+  in the header must be lock free (they are on the platforms we
+  build for) because two processes share them.
+
+ */
+#ifndef SHARED_FRAME_RING_H
+#define SHARED_FRAME_RING_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#endif
+
+/* ----------------------------------------------------------- */
+
+#define FRAME_RING_MAGIC 0x474E4952u             /* "RING" */
+#define FRAME_RING_VERSION 1u
+#define FRAME_RING_MAX_SLOTS 16
+#define FRAME_RING_NONE 0xFFFFFFFFu
+
+/* ----------------------------------------------------------- */
+
+enum FrameSlotState {
+  FRAME_SLOT_FREE = 0,
+  FRAME_SLOT_WRITING,
+  FRAME_SLOT_READY,
+  FRAME_SLOT_READING,
+};
+
+/* Lives in shared memory. */
+struct FrameRingSlot {
+  std::atomic<uint32_t> state{FRAME_SLOT_FREE};
+  uint32_t padding = 0;
+  uint64_t frame = 0;                          /* Set by the producer before the slot becomes READY. */
+  uint64_t time_ns = 0;                        /* When the producer published it. */
+  uint64_t offset = 0;                         /* Of the data, from the start of the mapping. */
+};
+
+/* Lives in shared memory, at the start of the mapping. */
+struct FrameRingHeader {
+  std::atomic<uint32_t> magic{0};              /* Stored last by the producer; the header is complete once it's FRAME_RING_MAGIC. */
+  uint32_t version = FRAME_RING_VERSION;
+  uint32_t num_slots = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t stride = 0;                         /* Bytes per row. */
+  uint32_t format = 0;                         /* E.g. GL_RGBA; the rows are bottom to top, like GL reads them. */
+  uint32_t type = 0;                           /* E.g. GL_UNSIGNED_BYTE */
+  uint64_t slot_size = 0;                      /* Bytes of frame data per slot. */
+  uint64_t total_size = 0;                     /* Of the mapping. */
+  std::atomic<uint32_t> is_closed{0};          /* Set by the producer; the consumer stops after the READY slots. */
+  std::atomic<uint64_t> num_published{0};
+  std::atomic<uint64_t> num_dropped{0};        /* No FREE slot when the producer had a frame. */
+  std::atomic<uint64_t> num_consumed{0};
+  FrameRingSlot slots[FRAME_RING_MAX_SLOTS];
+};
+
+struct FrameRingSettings {
+  uint32_t num_slots = 3;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t bytes_per_pixel = 4;
+  uint32_t format = 0;
+  uint32_t type = 0;
+};
+
+struct FrameView {
+  uint32_t slot = FRAME_RING_NONE;
+  uint64_t frame = 0;
+  uint64_t time_ns = 0;
+  const uint8_t* data = nullptr;               /* Valid until `release()`. */
+  uint64_t size = 0;
+};
+
+/* ----------------------------------------------------------- */
+
+class SharedFrameRing {
+public:
+  SharedFrameRing() = default;
+  SharedFrameRing(const SharedFrameRing&) = delete;
+  SharedFrameRing& operator=(const SharedFrameRing&) = delete;
+  ~SharedFrameRing();
+  int create(const char* name, const FrameRingSettings& cfg); /* Producer; returns -6 when the name is taken by a ring that wasn't closed. */
+  int open(const char* name);                  /* Consumer */
+  int close();                                 /* The producer also marks the ring closed and removes the name. */
+
+  int begin_write(uint32_t& slot);             /* Producer: 0 = got a slot, 1 = none free (drop the frame), < 0 on error. */
+  int publish(uint32_t slot, uint64_t frame);  /* Producer */
+  int cancel(uint32_t slot);                   /* Producer: gives back a slot from `begin_write()` without publishing. */
+  uint8_t* get_data(uint32_t slot);
+
+  int acquire(FrameView& view);                /* Consumer: 0 = got a frame, 1 = none ready, < 0 on error. */
+  int release(const FrameView& view);          /* Consumer */
+  bool is_closed();                            /* Consumer: the producer closed and there is nothing left to acquire. */
+
+public:
+  std::string name;
+  FrameRingHeader* header = nullptr;
+  uint8_t* base = nullptr;                     /* The mapping; same address as `header`. */
+  uint64_t size = 0;
+  uint32_t next_slot = 0;                      /* Producer: where `begin_write()` starts looking. */
+  bool is_producer = false;
+#if defined(_WIN32)
+  HANDLE mapping = nullptr;
+#else
+  int fd = -1;
+#endif
+};
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,179 @@
+/*
+
+  SPSC QUEUE
+  ===========
+
+  Bounded, lock free, single producer / single consumer ring
+  buffer. We use it to hand things (e.g. a texture name + the
+  fence that guards it) from one thread that owns a context to
+  another one, without taking a mutex on the frame path.
+
+  - The capacity is rounded up to a power of two.
+  - `head` (written by the consumer) and `tail` (written by the
+    producer) live on their own cache line. Each side keeps a
+    cached copy of the other side's index so it only touches the
+    other cache line when the queue looks full/empty.
+  - `pop_batch()` pops up to `max` items with one store to `head`.
+
+  `T` must be default constructible and move assignable.
+
+ */
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <utility>
+
+/* ----------------------------------------------------------- */
+
+#ifndef CACHE_LINE_SIZE
+#  define CACHE_LINE_SIZE 64
+#endif
+
+/* ----------------------------------------------------------- */
+
+template<typename T>
+class SpscQueue {
+public:
+  SpscQueue() = default;
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+  ~SpscQueue();
+  int init(size_t capacity);
+  int shutdown();
+  bool push(const T& item);              /* Producer; returns false when full. */
+  bool push(T&& item);                   /* Producer; returns false when full. */
+  bool pop(T& item);                     /* Consumer; returns false when empty. */
+  size_t pop_batch(T* items, size_t max); /* Consumer; returns the number of popped items. */
+  size_t size() const;                   /* Approximate when called while the other side is busy. */
+
+public:
+  T* buffer = nullptr;
+  size_t mask = 0;
+  uint8_t pad0[CACHE_LINE_SIZE];
+  std::atomic<size_t> tail{0};           /* Producer writes. */
+  size_t cached_head = 0;                /* Producer's copy of `head`. */
+  uint8_t pad1[CACHE_LINE_SIZE];
+  std::atomic<size_t> head{0};           /* Consumer writes. */
+  size_t cached_tail = 0;                /* Consumer's copy of `tail`. */
+  uint8_t pad2[CACHE_LINE_SIZE];
+
+private:
+  template<typename U> bool emplace(U&& item);
+};
+
+/* ----------------------------------------------------------- */
+
+template<typename T>
+SpscQueue<T>::~SpscQueue() {
+  shutdown();
+}
+
+template<typename T>
+int SpscQueue<T>::init(size_t capacity) {
+
+  if (nullptr != buffer) {
+    return -1;
+  }
+
+  if (capacity < 2) {
+    return -2;
+  }
+
+  size_t n = 2;
+  while (n < capacity) {
+    n <<= 1;
+  }
+
+  buffer = new T[n];
+  mask = n - 1;
+  head.store(0, std::memory_order_relaxed);
+  tail.store(0, std::memory_order_relaxed);
+  cached_head = 0;
+  cached_tail = 0;
+
+  return 0;
+}
+
+template<typename T>
+int SpscQueue<T>::shutdown() {
+
+  if (nullptr != buffer) {
+    delete[] buffer;
+  }
+
+  buffer = nullptr;
+  mask = 0;
+
+  return 0;
+}
+
+template<typename T>
+bool SpscQueue<T>::push(const T& item) {
+  return emplace(item);
+}
+
+template<typename T>
+bool SpscQueue<T>::push(T&& item) {
+  return emplace(std::move(item));
+}
+
+template<typename T>
+template<typename U>
+bool SpscQueue<T>::emplace(U&& item) {
+
+  size_t t = tail.load(std::memory_order_relaxed);
+
+  if (t - cached_head > mask) {
+    cached_head = head.load(std::memory_order_acquire);
+    if (t - cached_head > mask) {
+      return false;
+    }
+  }
+
+  buffer[t & mask] = std::forward<U>(item);
+  tail.store(t + 1, std::memory_order_release);
+
+  return true;
+}
+
+template<typename T>
+bool SpscQueue<T>::pop(T& item) {
+  return 1 == pop_batch(&item, 1);
+}
+
+template<typename T>
+size_t SpscQueue<T>::pop_batch(T* items, size_t max) {
+
+  size_t h = head.load(std::memory_order_relaxed);
+
+  if (cached_tail - h < max) {
+    cached_tail = tail.load(std::memory_order_acquire);
+  }
+
+  size_t n = cached_tail - h;
+  if (n > max) {
+    n = max;
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    items[i] = std::move(buffer[(h + i) & mask]);
+  }
+
+  if (n > 0) {
+    head.store(h + n, std::memory_order_release);
+  }
+
+  return n;
+}
+
+template<typename T>
+size_t SpscQueue<T>::size() const {
+  return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+}
+
+/* ----------------------------------------------------------- */
+
+#endif
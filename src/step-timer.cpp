@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <step-timer.h>
+#include <gl-sync.h>
+
+/* ------------------------------------------------------------- */
+
+static uint64_t get_percentile(const std::vector<uint64_t>& sorted, double percentile);
+static uint32_t get_bucket(uint64_t ns);
+
+/* ------------------------------------------------------------- */
+
+void StepTimer::begin() {
+  last_ns = gpu_sync_now_ns();
+}
+
+void StepTimer::lap(const char* step) {
+
+  uint64_t now = gpu_sync_now_ns();
+
+  add(step, now - last_ns);
+
+  /* Don't count the time we spent in `add()`. */
+  last_ns = gpu_sync_now_ns();
+}
+
+void StepTimer::add(const char* step, uint64_t ns) {
+
+  if (nullptr == step) {
+    printf("Cannot add a sample, the step is nullptr.\n");
+    return;
+  }
+
+  TimerStep* found = find(step);
+  if (nullptr == found) {
+    steps.emplace_back();
+    found = &steps.back();
+    found->name = step;
+  }
+
+  found->samples.push_back(ns);
+}
+
+void StepTimer::append(const StepTimer& other) {
+
+  for (const TimerStep& step : other.steps) {
+    for (uint64_t ns : step.samples) {
+      add(step.name, ns);
+    }
+  }
+}
+
+void StepTimer::reset() {
+  steps.clear();
+  last_ns = 0;
+}
+
+TimerStep* StepTimer::find(const char* step) {
+
+  for (TimerStep& s : steps) {
+    if (s.name == step || 0 == strcmp(s.name, step)) {
+      return &s;
+    }
+  }
+
+  return nullptr;
+}
+
+void StepTimer::print() {
+
+  TimerStats stats;
+
+  printf("%s\n", (nullptr != name) ? name : "timer");
+  printf("  %-28s %8s %10s %10s %10s %10s %10s\n", "step", "count", "min", "median", "p99", "mean", "max");
+
+  for (const TimerStep& step : steps) {
+
+    step_timer_get_stats(step.samples, stats);
+
+    printf("  %-28s %8zu %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+           step.name,
+           stats.count,
+           stats.min_ns / 1e3,
+           stats.median_ns / 1e3,
+           stats.p99_ns / 1e3,
+           stats.mean_ns / 1e3,
+           stats.max_ns / 1e3);
+  }
+
+  printf("  (all times in us)\n");
+}
+
+void StepTimer::print_histograms() {
+
+  std::vector<uint64_t> buckets;
+
+  for (const TimerStep& step : steps) {
+
+    step_timer_get_histogram(step.samples, buckets);
+    printf("  %s\n", step.name);
+
+    uint64_t max_count = 1;
+    for (uint64_t count : buckets) {
+      max_count = (count > max_count) ? count : max_count;
+    }
+
+    for (uint32_t i = 0; i < buckets.size(); ++i) {
+
+      if (0 == buckets[i]) {
+        continue;
+      }
+
+      char bar[41] = { 0 };
+      uint32_t len = (uint32_t)((buckets[i] * 40 + max_count - 1) / max_count);
+      memset(bar, '#', len);
+
+      printf("    %10.3f us  %8llu  %s\n", (1ull << i) / 1e3, (unsigned long long)buckets[i], bar);
+    }
+  }
+}
+
+/* ------------------------------------------------------------- */
+
+int step_timer_get_stats(const std::vector<uint64_t>& samples, TimerStats& stats) {
+
+  stats = TimerStats();
+
+  if (0 == samples.size()) {
+    return 0;
+  }
+
+  std::vector<uint64_t> sorted = samples;
+  std::sort(sorted.begin(), sorted.end());
+
+  double total = 0.0;
+  for (uint64_t ns : sorted) {
+    total += (double)ns;
+  }
+
+  stats.count = sorted.size();
+  stats.min_ns = sorted.front();
+  stats.max_ns = sorted.back();
+  stats.median_ns = get_percentile(sorted, 0.5);
+  stats.p99_ns = get_percentile(sorted, 0.99);
+  stats.mean_ns = total / (double)sorted.size();
+
+  return 0;
+}
+
+int step_timer_get_histogram(const std::vector<uint64_t>& samples, std::vector<uint64_t>& buckets) {
+
+  buckets.assign(STEP_TIMER_NUM_BUCKETS, 0);
+
+  for (uint64_t ns : samples) {
+    buckets[get_bucket(ns)]++;
+  }
+
+  return 0;
+}
+
+int step_timer_write_json(const char* path, StepTimer** timers, size_t num_timers) {
+
+  if (nullptr == path || nullptr == timers) {
+    printf("Cannot write the timings, invalid arguments.\n");
+    return -1;
+  }
+
+  FILE* fp = fopen(path, "wb");
+  if (nullptr == fp) {
+    printf("Cannot write the timings, failed to open `%s`.\n", path);
+    return -2;
+  }
+
+  TimerStats stats;
+  std::vector<uint64_t> buckets;
+
+  fprintf(fp, "{\"timers\":[");
+
+  for (size_t i = 0; i < num_timers; ++i) {
+
+    const StepTimer* timer = timers[i];
+
+    fprintf(fp, "%s\n  {\"name\":\"%s\",\"steps\":[", (0 == i) ? "" : ",", (nullptr != timer->name) ? timer->name : "timer");
+
+    for (size_t j = 0; j < timer->steps.size(); ++j) {
+
+      const TimerStep& step = timer->steps[j];
+      step_timer_get_stats(step.samples, stats);
+      step_timer_get_histogram(step.samples, buckets);
+
+      fprintf(fp,
+              "%s\n    {\"name\":\"%s\",\"count\":%zu,\"min_ns\":%llu,\"median_ns\":%llu,\"p99_ns\":%llu,\"mean_ns\":%.1f,\"max_ns\":%llu,\"histogram\":[",
+              (0 == j) ? "" : ",",
+              step.name,
+              stats.count,
+              (unsigned long long)stats.min_ns,
+              (unsigned long long)stats.median_ns,
+              (unsigned long long)stats.p99_ns,
+              stats.mean_ns,
+              (unsigned long long)stats.max_ns);
+
+      for (size_t k = 0; k < buckets.size(); ++k) {
+        fprintf(fp, "%s%llu", (0 == k) ? "" : ",", (unsigned long long)buckets[k]);
+      }
+
+      fprintf(fp, "]}");
+    }
+
+    fprintf(fp, "\n  ]}");
+  }
+
+  fprintf(fp, "\n]}\n");
+
+  if (0 != fclose(fp)) {
+    printf("Failed to write the timings to `%s`.\n", path);
+    return -3;
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+/* Nearest rank; `sorted` must not be empty. */
+static uint64_t get_percentile(const std::vector<uint64_t>& sorted, double percentile) {
+
+  size_t rank = (size_t)ceil(percentile * (double)sorted.size());
+  if (0 == rank) {
+    rank = 1;
+  }
+
+  if (rank > sorted.size()) {
+    rank = sorted.size();
+  }
+
+  return sorted[rank - 1];
+}
+
+/* Bucket `i` has the samples in [2^i, 2^(i+1)); 0 ns goes into the first one. */
+static uint32_t get_bucket(uint64_t ns) {
+
+  uint32_t bucket = 0;
+
+  while (ns > 1 && bucket < STEP_TIMER_NUM_BUCKETS - 1) {
+    ns >>= 1;
+    bucket++;
+  }
+
+  return bucket;
+}
+
+/* ------------------------------------------------------------- */
@@ -0,0 +1,98 @@
+/*
+
+  STEP TIMER
+  ===========
+
+  Times the individual steps of something we repeat many times
+  (e.g. creating a context) and reports the min, median, p99,
+  mean and max per step. A step is identified by its name, which
+  is not copied; use string literals.
+
+    StepTimer timer;
+    timer.name = "wgl";
+
+    for (uint32_t i = 0; i < num_iterations; ++i) {
+      timer.begin();
+      step_a();
+      timer.lap("a");
+      step_b();
+      timer.lap("b");
+    }
+
+    timer.print();
+    step_timer_write_json("bench.json", timers, num_timers);
+
+  `lap()` adds the time since `begin()` or the previous `lap()`
+  to the given step, so the code that you time only has to mark
+  where a step ends. Code that can be timed, but usually isn't,
+  takes a `StepTimer*` and calls `step_timer_lap()` which does
+  nothing when the timer is nullptr (see `GlContext::timer`).
+
+  Steps are reported in the order in which they were first seen.
+  Besides the stats we can print and write a histogram of each
+  step with power of two buckets: bucket `i` counts the samples
+  in `[2^i, 2^(i+1))` ns. Threads that time the same thing each
+  use their own timer; `append()` merges them afterwards.
+
+ */
+#ifndef STEP_TIMER_H
+#define STEP_TIMER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/* ----------------------------------------------------------- */
+
+#define STEP_TIMER_NUM_BUCKETS 40                /* Up to ~550 s. */
+
+/* ----------------------------------------------------------- */
+
+struct TimerStep {
+  const char* name = nullptr;                  /* Not copied; use string literals. */
+  std::vector<uint64_t> samples;               /* In ns; one per lap. */
+};
+
+struct TimerStats {
+  size_t count = 0;
+  uint64_t min_ns = 0;
+  uint64_t median_ns = 0;
+  uint64_t p99_ns = 0;
+  uint64_t max_ns = 0;
+  double mean_ns = 0.0;
+};
+
+/* ----------------------------------------------------------- */
+
+class StepTimer {
+public:
+  void begin();                                /* Starts timing the first step. */
+  void lap(const char* step);                  /* Ends the current step and starts the next one. */
+  void add(const char* step, uint64_t ns);     /* Adds a sample that you timed yourself. */
+  void append(const StepTimer& other);         /* Adds the samples of `other`, e.g. of another thread. */
+  void reset();
+  TimerStep* find(const char* step);
+  void print();
+  void print_histograms();
+
+public:
+  const char* name = nullptr;                  /* E.g. the backend; used in the output. */
+  std::vector<TimerStep> steps;
+  uint64_t last_ns = 0;
+};
+
+/* ----------------------------------------------------------- */
+
+static inline void step_timer_lap(StepTimer* timer, const char* step) {
+  if (nullptr != timer) {
+    timer->lap(step);
+  }
+}
+
+int step_timer_get_stats(const std::vector<uint64_t>& samples, TimerStats& stats);
+int step_timer_get_histogram(const std::vector<uint64_t>& samples, std::vector<uint64_t>& buckets); /* Resizes `buckets` to STEP_TIMER_NUM_BUCKETS. */
+int step_timer_write_json(const char* path, StepTimer** timers, size_t num_timers);
+
+/* ----------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,239 @@
+/*
+
+  ARENA TRACE
+  ============
+
+  Replays a synthetic allocation trace against the
+  `RangeAllocator` that `BufferArena` uses to sub-allocate its
+  buffers. This doesn't need a GL context, so it runs on any
+  box.
+
+  The trace simulates mesh streaming: every frame a couple of
+  meshes with a size between 1 KiB and 2 MiB (log uniform) are
+  allocated and each mesh lives for a random number of frames.
+  Every `level_frames` frames we "load a new level" and free
+  half of the live meshes at once. The arrival rate is chosen so
+  the allocator is ~75% full in the steady state.
+
+  We print the occupancy and fragmentation over time, the
+  alloc/free latencies and what a compaction (the CPU side of a
+  defrag) would cost.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <range-allocator.h>
+#include <gl-sync.h>
+#include <step-timer.h>
+
+/* ----------------------------------------------------------- */
+
+struct Mesh {
+  RangeAllocation allocation;
+  uint32_t free_frame = 0;
+};
+
+/* ----------------------------------------------------------- */
+
+static const uint64_t capacity = 256ull * 1024ull * 1024ull;
+static const uint64_t alignment = 256;
+static const uint32_t num_frames = 20000;
+static const uint32_t level_frames = 2500;
+static const uint32_t report_frames = 2000;
+static const double min_size = 1024.0;
+static const double max_size = 2.0 * 1024.0 * 1024.0;
+static const uint32_t min_lifetime = 10;
+static const uint32_t max_lifetime = 590;
+
+/* ----------------------------------------------------------- */
+
+static bool is_valid(const RangeAllocator& allocator);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Replaying a synthetic allocation trace.\n");
+
+  RangeAllocator allocator;
+  if (0 != allocator.init(capacity, alignment)) {
+    printf("Failed to initialize the allocator. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* Average size of a log uniform distribution is (b - a) / ln(b / a). */
+  double avg_size = (max_size - min_size) / log(max_size / min_size);
+  double avg_lifetime = 0.5 * (min_lifetime + max_lifetime);
+  double meshes_per_frame = (0.75 * capacity) / (avg_size * avg_lifetime);
+
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<double> log_size(log(min_size), log(max_size));
+  std::uniform_int_distribution<uint32_t> lifetime(min_lifetime, max_lifetime);
+  std::poisson_distribution<uint32_t> arrivals(meshes_per_frame);
+  std::bernoulli_distribution coin(0.5);
+
+  std::vector<Mesh> meshes;
+  std::vector<uint64_t> alloc_ns;
+  std::vector<uint64_t> free_ns;
+  uint64_t num_failed = 0;
+  uint64_t bytes_failed = 0;
+  double max_fragmentation = 0.0;
+
+  printf("- %.2f meshes per frame, avg size %.1f KiB.\n", meshes_per_frame, avg_size / 1024.0);
+  printf("%8s %8s %10s %10s %12s %14s\n", "frame", "allocs", "occupancy", "fragment", "free blocks", "largest KiB");
+
+  for (uint32_t frame = 0; frame < num_frames; ++frame) {
+
+    bool is_new_level = (0 != frame && 0 == (frame % level_frames));
+
+    /* Free the meshes that expired (or half of them on a new level). */
+    size_t i = 0;
+    while (i < meshes.size()) {
+
+      if (frame < meshes[i].free_frame && (false == is_new_level || false == coin(rng))) {
+        i++;
+        continue;
+      }
+
+      uint64_t start = gpu_sync_now_ns();
+      int r = allocator.free(meshes[i].allocation.block);
+      free_ns.push_back(gpu_sync_now_ns() - start);
+
+      if (0 != r) {
+        printf("Failed to free a mesh. (exiting).\n");
+        exit(EXIT_FAILURE);
+      }
+
+      meshes[i] = meshes.back();
+      meshes.pop_back();
+    }
+
+    uint32_t n = arrivals(rng);
+    for (uint32_t j = 0; j < n; ++j) {
+
+      Mesh mesh;
+      uint64_t size = (uint64_t)exp(log_size(rng));
+
+      uint64_t start = gpu_sync_now_ns();
+      int r = allocator.alloc(size, mesh.allocation);
+      alloc_ns.push_back(gpu_sync_now_ns() - start);
+
+      if (0 != r) {
+        num_failed++;
+        bytes_failed += size;
+        continue;
+      }
+
+      mesh.free_frame = frame + lifetime(rng);
+      meshes.push_back(mesh);
+    }
+
+    RangeAllocatorStats stats;
+    allocator.get_stats(stats);
+    max_fragmentation = std::max(max_fragmentation, stats.fragmentation);
+
+    if (0 == ((frame + 1) % report_frames)) {
+      printf("%8u %8u %9.1f%% %9.1f%% %12u %14.1f\n",
+             frame + 1,
+             stats.num_allocations,
+             stats.occupancy * 100.0,
+             stats.fragmentation * 100.0,
+             stats.num_free_blocks,
+             stats.largest_free / 1024.0);
+    }
+  }
+
+  if (false == is_valid(allocator)) {
+    printf("The allocator is corrupt. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* What would a defrag cost? */
+  RangeAllocator compacted;
+  std::vector<RangeMove> moves;
+  RangeAllocatorStats before;
+  RangeAllocatorStats after;
+  uint64_t bytes_moved = 0;
+
+  uint64_t start = gpu_sync_now_ns();
+  if (0 != allocator.compact(compacted, moves)) {
+    printf("Failed to compact. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+  uint64_t compact_ns = gpu_sync_now_ns() - start;
+
+  for (size_t i = 0; i < moves.size(); ++i) {
+    if (moves[i].src_offset != moves[i].dst_offset) {
+      bytes_moved += moves[i].size;
+    }
+  }
+
+  allocator.get_stats(before);
+  compacted.get_stats(after);
+
+  printf("- Allocations: %llu, failed: %llu (%.1f MiB).\n",
+         (unsigned long long)alloc_ns.size(),
+         (unsigned long long)num_failed,
+         bytes_failed / (1024.0 * 1024.0));
+  TimerStats alloc_stats;
+  TimerStats free_stats;
+  step_timer_get_stats(alloc_ns, alloc_stats);
+  step_timer_get_stats(free_ns, free_stats);
+
+  printf("- Alloc: p50 %llu ns, p99 %llu ns. Free: p50 %llu ns, p99 %llu ns.\n",
+         (unsigned long long)alloc_stats.median_ns,
+         (unsigned long long)alloc_stats.p99_ns,
+         (unsigned long long)free_stats.median_ns,
+         (unsigned long long)free_stats.p99_ns);
+  printf("- Max fragmentation: %.1f%%.\n", max_fragmentation * 100.0);
+  printf("- Compaction: %zu moves, %.1f MiB to copy, %.3f ms of CPU; fragmentation %.1f%% -> %.1f%%.\n",
+         moves.size(),
+         bytes_moved / (1024.0 * 1024.0),
+         compact_ns / 1e6,
+         before.fragmentation * 100.0,
+         after.fragmentation * 100.0);
+
+  if (before.used != after.used || before.num_allocations != after.num_allocations || 0.0 != after.fragmentation) {
+    printf("The compacted allocator doesn't match the original. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+/* The blocks must cover the whole capacity without gaps and no two free blocks may be neighbours. */
+static bool is_valid(const RangeAllocator& allocator) {
+
+  uint64_t offset = 0;
+  uint64_t used = 0;
+  bool was_free = false;
+  uint32_t dx = allocator.first_block;
+
+  while (RANGE_NONE != dx) {
+
+    const RangeBlock& block = allocator.blocks[dx];
+
+    if (block.offset != offset || (true == was_free && true == block.is_free)) {
+      return false;
+    }
+
+    if (false == block.is_free) {
+      used += block.size;
+    }
+
+    offset += block.size;
+    was_free = block.is_free;
+    dx = block.next_phys;
+  }
+
+  return offset == allocator.capacity && used == allocator.used;
+}
+
+/* ----------------------------------------------------------- */
@@ -0,0 +1,226 @@
+/*
+
+  BUFFER ARENA
+  =============
+
+  Allocates a couple of thousand "meshes" from a `BufferArena`,
+  fills each with its own byte pattern, frees a random half and
+  then defragments the arena on a `GlWorker`. While the worker
+  copies, the render thread keeps running frames that use the
+  per frame allocator. Once the defrag has been applied we read
+  back every mesh and check that its data moved along.
+
+  The same worker sweeps the `DeletionQueue` that deletes the
+  old pages.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <random>
+#include <gl-context.h>
+#include <gl-worker.h>
+#include <gl-deletion-queue.h>
+#include <gl-buffer-arena.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_meshes = 2000;
+static const uint64_t min_mesh_size = 256;
+static const uint64_t max_mesh_size = 64 * 1024;
+
+/* ----------------------------------------------------------- */
+
+static void print_stats(const char* name, BufferArena& arena);
+static bool is_mesh_valid(BufferArena& arena, ArenaHandle handle, uint8_t pattern);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the buffer arena.\n");
+
+  GlContext main;
+  if (0 != create_shared_context(nullptr, main)) {
+    printf("Failed to create the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != release_current_context()) {
+    printf("Failed to release the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  DeletionQueue deletions;
+  if (0 != deletions.init(64)) {
+    printf("Failed to initialize the deletion queue. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GlWorker worker;
+  worker.idle_task = [&deletions]() {
+    deletions.sweep();
+  };
+
+  if (0 != worker.start(&main)) {
+    printf("Failed to start the worker. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  BufferArenaSettings settings;
+  settings.page_size = 8 * 1024 * 1024;
+  settings.frame_size = 256 * 1024;
+
+  BufferArena arena;
+  if (0 != arena.init(settings, &deletions)) {
+    printf("Failed to initialize the arena. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* Allocate and fill the meshes. */
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<uint64_t> mesh_size(min_mesh_size, max_mesh_size);
+  std::bernoulli_distribution coin(0.5);
+  std::vector<ArenaHandle> handles(num_meshes, 0);
+  std::vector<uint8_t> data;
+
+  for (uint32_t i = 0; i < num_meshes; ++i) {
+
+    uint64_t size = mesh_size(rng);
+    data.assign(size, (uint8_t)i);
+
+    if (0 != arena.alloc(size, handles[i])
+        || 0 != arena.upload(handles[i], data.data(), size))
+      {
+        printf("Failed to allocate mesh %u. (exiting).\n", i);
+        exit(EXIT_FAILURE);
+      }
+  }
+
+  print_stats("allocated", arena);
+
+  for (uint32_t i = 0; i < num_meshes; ++i) {
+    if (true == coin(rng)) {
+      arena.free(handles[i]);
+      handles[i] = 0;
+    }
+  }
+
+  print_stats("freed", arena);
+
+  /* Keep rendering while the worker copies. */
+  uint32_t num_frames = 0;
+  uint32_t num_defrags = 0;
+
+  while (true) {
+
+    if (0 == num_frames % 10) {
+      int r = arena.defragment(worker, 0.25);
+      if (r < 0) {
+        printf("Failed to start a defrag. (exiting).\n");
+        exit(EXIT_FAILURE);
+      }
+      if (0 == r && 0 == arena.defrag.state.load()) {
+        break;
+      }
+    }
+
+    if (0 != arena.begin_frame()) {
+      printf("Failed to begin a frame. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+    BufferRange range;
+    void* ptr = nullptr;
+    for (uint32_t i = 0; i < 16; ++i) {
+      if (0 == arena.alloc_frame(1024, range, &ptr)) {
+        memset(ptr, (int)i, 1024);
+      }
+    }
+
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    arena.end_frame();
+
+    if (1 == arena.update()) {
+      num_defrags++;
+    }
+
+    num_frames++;
+  }
+
+  printf("- Ran %u frames while defragmenting %u pages.\n", num_frames, num_defrags);
+  print_stats("defragmented", arena);
+
+  uint32_t num_invalid = 0;
+  for (uint32_t i = 0; i < num_meshes; ++i) {
+    if (0 != handles[i] && false == is_mesh_valid(arena, handles[i], (uint8_t)i)) {
+      num_invalid++;
+    }
+  }
+
+  printf("- %u meshes have invalid data.\n", num_invalid);
+
+  arena.shutdown();
+  worker.shutdown();
+  deletions.shutdown();
+
+  printf("- The deletion queue deleted %llu buffers.\n", (unsigned long long)deletions.num_deleted);
+
+  release_current_context();
+  destroy_main_context(main);
+
+  if (0 != num_invalid) {
+    exit(EXIT_FAILURE);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static void print_stats(const char* name, BufferArena& arena) {
+
+  BufferArenaStats stats;
+  arena.get_stats(stats);
+
+  printf("- %-13s pages: %u, allocations: %u, occupancy: %.1f%%, fragmentation: %.1f%%, largest free: %.1f KiB, defrags: %llu, moved: %.1f KiB.\n",
+         name,
+         stats.num_pages,
+         stats.num_allocations,
+         stats.occupancy * 100.0,
+         stats.fragmentation * 100.0,
+         stats.largest_free / 1024.0,
+         (unsigned long long)stats.num_defrags,
+         stats.bytes_moved / 1024.0);
+}
+
+static bool is_mesh_valid(BufferArena& arena, ArenaHandle handle, uint8_t pattern) {
+
+  BufferRange range;
+  if (0 != arena.get(handle, range)) {
+    return false;
+  }
+
+  std::vector<uint8_t> data(range.size, 0);
+
+  glBindBuffer(GL_COPY_READ_BUFFER, range.buffer);
+  glGetBufferSubData(GL_COPY_READ_BUFFER, (GLintptr)range.offset, (GLsizeiptr)range.size, data.data());
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (pattern != data[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* ----------------------------------------------------------- */
@@ -0,0 +1,248 @@
+/*
+
+  COMMAND LISTS
+  ==============
+
+  Records commands on a couple of threads that don't have a GL
+  context and replays them on one thread that owns a context
+  which shares with our main context. See `command-list.h`.
+
+  Every recorder writes its frame number into its own part of a
+  buffer and its own matrix of a uniform array. Buffers and
+  programs are shared, so once the executor stopped we read them
+  back on the main context to check that the lists were
+  replayed, and in submit order.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <thread>
+#include <command-list.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_recorders = 4;
+static const uint32_t num_buffers = 3;
+static const uint32_t num_frames = 500;
+
+static const char* matrix_vs = R"(
+  #version 330
+  uniform mat4 u_m[4];
+  void main() {
+    gl_Position = u_m[0] * u_m[1] * u_m[2] * u_m[3] * vec4(0.0, 0.0, 0.0, 1.0);
+  }
+)";
+
+static const char* matrix_fs = R"(
+  #version 330
+  out vec4 fragcolor;
+  void main() {
+    fragcolor = vec4(1.0);
+  }
+)";
+
+/* ----------------------------------------------------------- */
+
+struct RecordTargets {
+  GLuint buffer = 0;
+  GLuint program = 0;
+  GLint locations[num_recorders] = { };
+};
+
+/* ----------------------------------------------------------- */
+
+static void record_func(CommandQueue* queue, RecordTargets* targets, uint32_t id);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing command lists.\n");
+
+  GlContext main;
+  if (0 != create_shared_context(nullptr, main)) {
+    printf("Failed to create the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  main.print("main");
+
+  RecordTargets targets;
+  targets.program = create_program(matrix_vs, matrix_fs);
+  if (0 == targets.program) {
+    printf("Failed to create the program. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (uint32_t i = 0; i < num_recorders; ++i) {
+    char name[16] = { 0 };
+    snprintf(name, sizeof(name), "u_m[%u]", i);
+    targets.locations[i] = glGetUniformLocation(targets.program, name);
+    if (targets.locations[i] < 0) {
+      printf("Failed to get the location of `%s`. (exiting).\n", name);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  uint32_t zeros[num_recorders] = { };
+  glGenBuffers(1, &targets.buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, targets.buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, sizeof(zeros), zeros, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glFinish();
+
+  /* The executor creates a context that shares with `main`; make sure it's not current. */
+  if (0 != release_current_context()) {
+    printf("Failed to release the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  CommandQueue queue;
+  if (0 != queue.init(num_recorders, num_buffers)) {
+    printf("Failed to initialize the command queue. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  CommandExecutor executor;
+  if (0 != executor.start(&main, &queue)) {
+    printf("Failed to start the command executor. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<std::thread> recorders;
+  for (uint32_t i = 0; i < num_recorders; ++i) {
+    recorders.push_back(std::thread(record_func, &queue, &targets, i));
+  }
+
+  for (size_t i = 0; i < recorders.size(); ++i) {
+    recorders[i].join();
+  }
+
+  /* Make sure the executor context hands its commands to the GPU before we read back. */
+  CommandList* last = queue.acquire();
+  if (nullptr == last) {
+    printf("Failed to acquire the last command list. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  last->flush();
+
+  if (0 != queue.submit(last)) {
+    printf("Failed to submit the last command list. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != executor.stop()) {
+    printf("Failed to stop the command executor. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- Executed %llu lists, %llu commands, %llu bytes.\n",
+         (unsigned long long)executor.num_lists,
+         (unsigned long long)executor.num_commands,
+         (unsigned long long)executor.num_bytes);
+
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  glFinish();
+
+  uint32_t frames[num_recorders] = { };
+  glBindBuffer(GL_COPY_READ_BUFFER, targets.buffer);
+  glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(frames), frames);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+  bool is_buffer_ok = true;
+  bool is_uniform_ok = true;
+
+  for (uint32_t i = 0; i < num_recorders; ++i) {
+
+    if (num_frames != frames[i]) {
+      printf("  recorder %u: buffer holds frame %u, expected %u.\n", i, frames[i], num_frames);
+      is_buffer_ok = false;
+    }
+
+    GLfloat m[16] = { };
+    glGetUniformfv(targets.program, targets.locations[i], m);
+
+    for (uint32_t j = 0; j < 16; ++j) {
+      if ((GLfloat)(num_frames * 16 + j) != m[j]) {
+        printf("  recorder %u: matrix[%u] is %f, expected %u.\n", i, j, m[j], num_frames * 16 + j);
+        is_uniform_ok = false;
+        break;
+      }
+    }
+  }
+
+  bool is_ok = true;
+  is_ok &= check(executor.num_lists == num_recorders * num_frames + 1, "all lists were executed");
+  is_ok &= check(true == is_buffer_ok, "buffer_sub_data() wrote the last frame of every recorder");
+  is_ok &= check(true == is_uniform_ok, "uniform_matrix_4fv() set the last matrix of every recorder");
+  is_ok &= check(GL_NO_ERROR == glGetError(), "no GL errors");
+
+  glDeleteBuffers(1, &targets.buffer);
+  glDeleteProgram(targets.program);
+
+  if (false == is_ok) {
+    printf("The command list test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  release_current_context();
+  destroy_main_context(main);
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static void record_func(CommandQueue* queue, RecordTargets* targets, uint32_t id) {
+
+  for (uint32_t i = 0; i < num_frames; ++i) {
+
+    CommandList* list = queue->acquire();
+    if (nullptr == list) {
+      printf("Failed to acquire a command list.\n");
+      return;
+    }
+
+    GLfloat v = (GLfloat)(i % 255) / 255.0f;
+    list->viewport(0, 0, 1, 1);
+    list->enable(GL_SCISSOR_TEST);
+    list->scissor(0, 0, 1, 1);
+    list->clear_color(v, (GLfloat)id / num_recorders, 1.0f - v, 1.0f);
+    list->clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    list->enable(GL_BLEND);
+    list->blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    list->disable(GL_BLEND);
+    list->disable(GL_SCISSOR_TEST);
+
+    /* The last list of this recorder leaves `num_frames` behind; the data is copied so `frame` and `m` can go out of scope. */
+    uint32_t frame = i + 1;
+    list->bind_buffer(GL_COPY_WRITE_BUFFER, targets->buffer);
+    list->buffer_sub_data(GL_COPY_WRITE_BUFFER, id * sizeof(uint32_t), sizeof(frame), &frame);
+    list->bind_buffer(GL_COPY_WRITE_BUFFER, 0);
+
+    GLfloat m[16];
+    for (uint32_t j = 0; j < 16; ++j) {
+      m[j] = (GLfloat)(frame * 16 + j);
+    }
+
+    list->use_program(targets->program);
+    list->uniform_matrix_4fv(targets->locations[id], 1, GL_FALSE, m);
+    list->use_program(0);
+
+    if (0 != queue->submit(list)) {
+      printf("Failed to submit a command list.\n");
+      return;
+    }
+  }
+}
+
+/* ----------------------------------------------------------- */
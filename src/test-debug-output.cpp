@@ -0,0 +1,299 @@
+/*
+
+  DEBUG OUTPUT
+  =============
+
+  Creates two contexts with a `GlDebugOutput` (see
+  `gl-debug-output.h`) and checks what reaches the sink of the
+  `GlDebugLog`:
+
+  - a real GL error (binding a buffer name that was never
+    generated) is reported;
+  - 5000 identical messages reach the sink only a couple of
+    times, but with the right total count;
+  - a tiny ring overflows without blocking, and every message is
+    either passed to the sink or counted as dropped;
+  - 500 different messages are rate limited, and the sink is
+    told how many were dropped.
+
+  We also print how long `glDebugMessageInsert()` takes with the
+  callback installed. Runs on llvmpipe.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <gl-context.h>
+#include <gl-debug-output.h>
+#include <gl-sync.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_identical = 5000;
+static const uint32_t num_distinct = 500;
+static const uint32_t num_overflow = 1000;
+static const GLuint identical_id = 1;
+static const GLuint overflow_id = 2;
+static const GLuint distinct_first_id = 1000;
+
+/* ----------------------------------------------------------- */
+
+struct SinkEntry {
+  DebugMessage msg;
+  uint64_t count;
+};
+
+/* ----------------------------------------------------------- */
+
+static std::mutex sink_mutex;
+static std::vector<SinkEntry> sink_entries;
+
+/* ----------------------------------------------------------- */
+
+static void insert(GLuint id, const char* text);
+static uint64_t count_sink(GlDebugOutput* output, GLenum type, GLuint id, uint32_t* num_calls);
+static bool has_notice();
+static void wait_for_sink(GlDebugOutput* output);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the debug output.\n");
+
+  GlDebugLog log;
+  log.max_per_second = 50.0;
+  log.max_burst = 20.0;
+
+  if (0 != log.start([](const DebugMessage& msg, uint64_t count) {
+        std::lock_guard<std::mutex> lock(sink_mutex);
+        sink_entries.push_back({ msg, count });
+      }))
+    {
+      printf("Failed to start the debug log. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+  GlDebugOutput output;
+  GlDebugOutput small_output;
+  output.name = "main";
+  small_output.name = "small";
+
+  if (0 != output.init(16 * 1024)
+      || 0 != small_output.init(16))
+    {
+      printf("Failed to initialize the debug outputs. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+  log.add(&output);
+  log.add(&small_output);
+
+  GlContext main;
+  GlContext other;
+  main.debug = &output;
+  other.debug = &small_output;
+
+  if (0 != create_shared_context(nullptr, main)
+      || 0 != create_shared_context(&main, other))
+    {
+      printf("Failed to create the contexts. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (false == output.is_installed) {
+    printf("The debug output wasn't installed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GLint flags = 0;
+  glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+  printf("- GL_CONTEXT_FLAGS: 0x%02X\n", flags);
+
+  /* A real error: core profiles don't allow binding names that weren't generated. */
+  glBindBuffer(GL_ARRAY_BUFFER, 0xBAD);
+  GLenum err = glGetError();
+
+  /* Identical messages. */
+  uint64_t t0 = gpu_sync_now_ns();
+  for (uint32_t i = 0; i < num_identical; ++i) {
+    insert(identical_id, "The same message, over and over again.");
+  }
+  uint64_t t1 = gpu_sync_now_ns();
+
+  printf("- glDebugMessageInsert() with the ring callback: %.3f us.\n", ((t1 - t0) / 1e3) / num_identical);
+
+  /* Overflow the tiny ring of the other context. */
+  if (0 != make_context_current(other)) {
+    printf("Failed to make the other context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (uint32_t i = 0; i < num_overflow; ++i) {
+    insert(overflow_id, "Overflowing the tiny ring.");
+  }
+
+  /* Let the drain thread pass it before we use up all tokens. */
+  wait_for_sink(&small_output);
+
+  /* Distinct messages, way over the rate limit. */
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  char text[64] = { 0 };
+  for (uint32_t i = 0; i < num_distinct; ++i) {
+    snprintf(text, sizeof(text), "Distinct message %u.", i);
+    insert(distinct_first_id + i, text);
+  }
+
+  /* Give the rate limiter time to refill so it sends its notice. */
+  uint64_t deadline = gpu_sync_now_ns() + 2000ull * 1000ull * 1000ull;
+  while (false == has_notice() && gpu_sync_now_ns() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  release_current_context();
+
+  if (0 != destroy_main_context(other)
+      || 0 != destroy_main_context(main))
+    {
+      printf("Failed to destroy the contexts. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+  log.remove(&small_output);
+  log.remove(&output);
+  log.shutdown();
+
+  if (0 != output.shutdown()
+      || 0 != small_output.shutdown())
+    {
+      printf("Failed to shutdown the debug outputs. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+  /* Checks */
+  uint32_t num_error_calls = 0;
+  uint32_t num_identical_calls = 0;
+  uint32_t num_overflow_calls = 0;
+  uint64_t num_errors = 0;
+  uint64_t num_distinct_passed = 0;
+
+  for (const SinkEntry& entry : sink_entries) {
+    if (&output == entry.msg.output
+        && GL_DEBUG_TYPE_ERROR == entry.msg.type
+        && GL_DEBUG_SOURCE_API == entry.msg.source)
+      {
+        num_errors += entry.count;
+        num_error_calls++;
+        printf("- Captured: %s\n", entry.msg.text);
+      }
+
+    if (&output == entry.msg.output && entry.msg.id >= distinct_first_id) {
+      num_distinct_passed += entry.count;
+    }
+  }
+
+  uint64_t identical_total = count_sink(&output, GL_DEBUG_TYPE_OTHER, identical_id, &num_identical_calls);
+  uint64_t overflow_total = count_sink(&small_output, GL_DEBUG_TYPE_OTHER, overflow_id, &num_overflow_calls);
+
+  printf("- Identical: %llu messages in %u sink calls.\n", (unsigned long long)identical_total, num_identical_calls);
+  printf("- Distinct: %llu of %u passed, %llu rate limited.\n",
+         (unsigned long long)num_distinct_passed,
+         num_distinct,
+         (unsigned long long)log.num_rate_limited);
+  printf("- Overflow: received %llu, passed %llu in %u sink calls, dropped %llu.\n",
+         (unsigned long long)small_output.num_received.load(),
+         (unsigned long long)overflow_total,
+         num_overflow_calls,
+         (unsigned long long)small_output.num_dropped.load());
+  printf("- Log: emitted %llu, deduped %llu, rate limited %llu.\n",
+         (unsigned long long)log.num_emitted,
+         (unsigned long long)log.num_deduped,
+         (unsigned long long)log.num_rate_limited);
+
+  bool is_ok = true;
+  is_ok &= check(GL_INVALID_OPERATION == err, "glBindBuffer() with a bad name fails");
+  is_ok &= check(num_errors >= 1, "the error was reported through the debug output");
+  is_ok &= check(num_identical == identical_total, "the identical messages add up");
+  is_ok &= check(num_identical_calls <= 5, "the identical messages were deduplicated");
+  is_ok &= check(num_distinct_passed < num_distinct, "the distinct messages were rate limited");
+  is_ok &= check(num_distinct_passed + log.num_rate_limited >= num_distinct, "every distinct message was passed or counted");
+  is_ok &= check(true == has_notice(), "the sink was told about the dropped messages");
+  is_ok &= check(small_output.num_dropped.load() > 0, "the tiny ring overflowed");
+  is_ok &= check(overflow_total + small_output.num_dropped.load() == small_output.num_received.load(), "every overflow message was passed or dropped");
+
+  if (false == is_ok) {
+    printf("The debug output test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static void insert(GLuint id, const char* text) {
+  glDebugMessageInsert(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_OTHER, id, GL_DEBUG_SEVERITY_HIGH, -1, text);
+}
+
+static uint64_t count_sink(GlDebugOutput* output, GLenum type, GLuint id, uint32_t* num_calls) {
+
+  uint64_t total = 0;
+  *num_calls = 0;
+
+  for (const SinkEntry& entry : sink_entries) {
+    if (output == entry.msg.output && type == entry.msg.type && id == entry.msg.id) {
+      total += entry.count;
+      (*num_calls)++;
+    }
+  }
+
+  return total;
+}
+
+static bool has_notice() {
+
+  std::lock_guard<std::mutex> lock(sink_mutex);
+
+  for (const SinkEntry& entry : sink_entries) {
+    if (nullptr == entry.msg.output && nullptr != strstr(entry.msg.text, "rate limiter")) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void wait_for_sink(GlDebugOutput* output) {
+
+  uint64_t deadline = gpu_sync_now_ns() + 2000ull * 1000ull * 1000ull;
+
+  while (gpu_sync_now_ns() < deadline) {
+    {
+      std::lock_guard<std::mutex> lock(sink_mutex);
+      for (const SinkEntry& entry : sink_entries) {
+        if (output == entry.msg.output) {
+          return;
+        }
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+/* ----------------------------------------------------------- */
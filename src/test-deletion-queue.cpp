@@ -0,0 +1,145 @@
+/*
+
+  DELETION QUEUE
+  ===============
+
+  The render thread creates a couple of textures and buffers
+  every frame, uses them and then, instead of deleting them
+  right away, hands them to a `DeletionQueue`. A `GlWorker`
+  sweeps the queue from its `idle_task` and deletes everything
+  whose fence has been signalled with one `glDelete*()` call per
+  object type.
+
+  At the end we print how many objects were deleted and how many
+  delete calls that took.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <gl-context.h>
+#include <gl-worker.h>
+#include <gl-sync.h>
+#include <gl-deletion-queue.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_frames = 300;
+static const uint32_t textures_per_frame = 8;
+static const uint32_t buffers_per_frame = 4;
+static const GLsizei tex_size = 32;
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the deletion queue.\n");
+
+  GlContext main;
+  if (0 != create_shared_context(nullptr, main)) {
+    printf("Failed to create the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != release_current_context()) {
+    printf("Failed to release the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  DeletionQueue deletions;
+  if (0 != deletions.init(64)) {
+    printf("Failed to initialize the deletion queue. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GlWorker sweeper;
+  sweeper.idle_interval_ns = 2ull * 1000ull * 1000ull;
+  sweeper.idle_task = [&deletions]() {
+    if (deletions.sweep() < 0) {
+      printf("Failed to sweep the deletion queue.\n");
+    }
+  };
+
+  if (0 != sweeper.start(&main)) {
+    printf("Failed to start the sweeper. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<uint8_t> pixels(tex_size * tex_size * 4, 0xFF);
+  GLuint textures[textures_per_frame] = { 0 };
+  GLuint buffers[buffers_per_frame] = { 0 };
+  DeletionBatch batch;
+  uint64_t num_created = 0;
+  uint64_t max_submit_ns = 0;
+  uint32_t num_full = 0;
+
+  for (uint32_t i = 0; i < num_frames; ++i) {
+
+    glGenTextures(textures_per_frame, textures);
+    glGenBuffers(buffers_per_frame, buffers);
+
+    for (uint32_t j = 0; j < textures_per_frame; ++j) {
+      glBindTexture(GL_TEXTURE_2D, textures[j]);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, tex_size, tex_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    }
+
+    for (uint32_t j = 0; j < buffers_per_frame; ++j) {
+      glBindBuffer(GL_ARRAY_BUFFER, buffers[j]);
+      glBufferData(GL_ARRAY_BUFFER, 4096, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    num_created += textures_per_frame + buffers_per_frame;
+
+    /* When the queue was full the names stay in `batch` and go with the next frame. */
+    batch.add(DELETE_TEXTURE, textures, textures_per_frame);
+    batch.add(DELETE_BUFFER, buffers, buffers_per_frame);
+
+    uint64_t start = gpu_sync_now_ns();
+    if (0 != deletions.submit(batch)) {
+      num_full++;
+    }
+    uint64_t submit_ns = gpu_sync_now_ns() - start;
+
+    if (submit_ns > max_submit_ns) {
+      max_submit_ns = submit_ns;
+    }
+  }
+
+  if (false == batch.empty()) {
+    while (0 != deletions.submit(batch)) {
+      std::this_thread::yield();
+    }
+  }
+
+  /* Once the sweeper is gone we're the only consumer; delete whatever is left. */
+  sweeper.shutdown();
+  deletions.shutdown();
+
+  printf("- Created %llu objects.\n", (unsigned long long)num_created);
+  printf("- Deleted %llu objects with %llu delete calls in %llu sweeps.\n",
+         (unsigned long long)deletions.num_deleted,
+         (unsigned long long)deletions.num_delete_calls,
+         (unsigned long long)deletions.num_sweeps);
+  printf("- Max submit time: %.3f ms, the queue was full %u times.\n", max_submit_ns / 1e6, num_full);
+
+  release_current_context();
+  destroy_main_context(main);
+
+  if (num_created != deletions.num_deleted) {
+    printf("Not all objects were deleted. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
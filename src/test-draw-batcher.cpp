@@ -0,0 +1,435 @@
+/*
+
+  DRAW BATCHER
+  =============
+
+  Renders a grid of 20.000 small quads with 4 different programs
+  into an offscreen framebuffer, twice:
+
+  - the "naive" way: for every quad we call `glUseProgram()`,
+    `glBindVertexArray()`, set two uniforms and call
+    `glDrawElements()`;
+
+  - with the `DrawBatcher`: every quad is added with its per draw
+    data (offset/scale + color) and `flush()` issues one
+    `glMultiDrawElementsIndirect()` per program. The vertex
+    shader reads the per draw data with `gl_DrawIDARB`.
+
+  The quads are added in program order 0, 1, 2, 3, 0, 1, ... so
+  the naive loop changes the program for every draw. The quads
+  don't overlap, so the order in which they are drawn doesn't
+  matter and both images must be the same; we compare them.
+
+  We print the CPU time it takes to submit a frame and the time
+  until `glFinish()` returns.
+
+  Then we overflow a small batcher, once with more state groups
+  than `max_groups` (-2) and once with a per draw data region
+  that is too small (-3), and check that the groups which fit
+  were drawn and counted while the rest was dropped. `add()` and
+  the padding that `init()` reserves per group keep the data
+  region from overflowing on its own, so for -3 we shrink
+  `data_region_size` after `init()`.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <gl-context.h>
+#include <gl-draw-batcher.h>
+#include <gl-sync.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+struct QuadData {
+  float offset_scale[4];
+  float color[4];
+};
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t grid_width = 160;
+static const uint32_t grid_height = 125;
+static const uint32_t num_quads = grid_width * grid_height;
+static const uint32_t num_programs = 4;
+static const uint32_t num_frames = 10;
+static const GLsizei fb_width = 640;
+static const GLsizei fb_height = 500;
+
+/* ----------------------------------------------------------- */
+
+static const char* naive_vs = ""
+  "#version 330\n"
+  "layout(location = 0) in vec2 a_pos;\n"
+  "uniform vec4 u_offset_scale;\n"
+  "uniform vec4 u_color;\n"
+  "out vec4 v_color;\n"
+  "void main() {\n"
+  "  gl_Position = vec4(a_pos * u_offset_scale.zw + u_offset_scale.xy, 0.0, 1.0);\n"
+  "  v_color = u_color;\n"
+  "}\n";
+
+static const char* batched_vs = ""
+  "#version 430\n"
+  "#extension GL_ARB_shader_draw_parameters : require\n"
+  "layout(location = 0) in vec2 a_pos;\n"
+  "struct Quad { vec4 offset_scale; vec4 color; };\n"
+  "layout(std430, binding = 0) readonly buffer Quads { Quad quads[]; };\n"
+  "out vec4 v_color;\n"
+  "void main() {\n"
+  "  Quad quad = quads[gl_DrawIDARB];\n"
+  "  gl_Position = vec4(a_pos * quad.offset_scale.zw + quad.offset_scale.xy, 0.0, 1.0);\n"
+  "  v_color = quad.color;\n"
+  "}\n";
+
+static const char* fs = ""
+  "#version 330\n"
+  "in vec4 v_color;\n"
+  "layout(location = 0) out vec4 fragcolor;\n"
+  "void main() {\n"
+  "  fragcolor = v_color;\n"
+  "}\n";
+
+/* ----------------------------------------------------------- */
+
+static void fill_quads(std::vector<QuadData>& quads);
+static uint64_t read_checksum();
+static bool test_overflow(const GLuint* programs, GLuint vao, const std::vector<QuadData>& quads, bool is_data_overflow);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the draw batcher.\n");
+
+  GlContext main;
+  if (0 != create_shared_context(nullptr, main)) {
+    printf("Failed to create the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  DrawBatcherSettings settings;
+  settings.max_draws = 32768;
+  settings.draw_data_size = sizeof(QuadData);
+
+  DrawBatcher batcher;
+  if (0 != batcher.init(settings)) {
+    printf("Failed to initialize the draw batcher. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* Programs */
+  GLuint naive_programs[num_programs] = { 0 };
+  GLuint batched_programs[num_programs] = { 0 };
+  GLint u_offset_scale[num_programs] = { 0 };
+  GLint u_color[num_programs] = { 0 };
+
+  for (uint32_t i = 0; i < num_programs; ++i) {
+
+    naive_programs[i] = create_program(naive_vs, fs);
+    batched_programs[i] = create_program(batched_vs, fs);
+
+    if (0 == naive_programs[i] || 0 == batched_programs[i]) {
+      printf("Failed to create the programs. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+    u_offset_scale[i] = glGetUniformLocation(naive_programs[i], "u_offset_scale");
+    u_color[i] = glGetUniformLocation(naive_programs[i], "u_color");
+  }
+
+  /* One quad that every draw uses. */
+  const float vertices[] = { 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f };
+  const GLuint indices[] = { 0, 1, 2, 0, 2, 3 };
+  GLuint vao = 0;
+  GLuint vbo = 0;
+  GLuint ibo = 0;
+
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+  glGenBuffers(1, &ibo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+  glBindVertexArray(0);
+
+  /* Render target */
+  GLuint tex = 0;
+  GLuint fbo = 0;
+
+  glGenTextures(1, &tex);
+  glBindTexture(GL_TEXTURE_2D, tex);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, fb_width, fb_height);
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+
+  if (GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus(GL_FRAMEBUFFER)) {
+    printf("The framebuffer is not complete. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  glViewport(0, 0, fb_width, fb_height);
+
+  std::vector<QuadData> quads;
+  fill_quads(quads);
+
+  DrawElementsIndirectCommand command;
+  command.count = 6;
+
+  /* Naive */
+  uint64_t naive_submit_ns = 0;
+  uint64_t naive_total_ns = 0;
+  uint64_t naive_checksum = 0;
+
+  for (uint32_t frame = 0; frame < num_frames; ++frame) {
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glFinish();
+
+    uint64_t t0 = gpu_sync_now_ns();
+
+    for (uint32_t i = 0; i < num_quads; ++i) {
+      uint32_t p = i % num_programs;
+      glUseProgram(naive_programs[p]);
+      glBindVertexArray(vao);
+      glUniform4fv(u_offset_scale[p], 1, quads[i].offset_scale);
+      glUniform4fv(u_color[p], 1, quads[i].color);
+      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    }
+
+    uint64_t t1 = gpu_sync_now_ns();
+    glFinish();
+    uint64_t t2 = gpu_sync_now_ns();
+
+    naive_submit_ns += t1 - t0;
+    naive_total_ns += t2 - t0;
+  }
+
+  naive_checksum = read_checksum();
+
+  /* Batched */
+  uint64_t batched_submit_ns = 0;
+  uint64_t batched_total_ns = 0;
+  uint64_t batched_checksum = 0;
+  int num_groups = 0;
+
+  for (uint32_t frame = 0; frame < num_frames; ++frame) {
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glFinish();
+
+    uint64_t t0 = gpu_sync_now_ns();
+
+    if (0 != batcher.begin_frame()) {
+      printf("Failed to begin the batcher frame. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+    BatchState state;
+    state.vertex_array = vao;
+
+    for (uint32_t i = 0; i < num_quads; ++i) {
+      state.program = batched_programs[i % num_programs];
+      batcher.add(state, command, &quads[i]);
+    }
+
+    num_groups = batcher.flush();
+    if (num_groups < 0) {
+      printf("Failed to flush the batcher. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+    if (0 != batcher.end_frame()) {
+      printf("Failed to end the batcher frame. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+    uint64_t t1 = gpu_sync_now_ns();
+    glFinish();
+    uint64_t t2 = gpu_sync_now_ns();
+
+    batched_submit_ns += t1 - t0;
+    batched_total_ns += t2 - t0;
+  }
+
+  batched_checksum = read_checksum();
+
+  printf("- Naive:   %u draw calls, submit %.3f ms, total %.3f ms per frame.\n",
+         num_quads,
+         naive_submit_ns / (num_frames * 1e6),
+         naive_total_ns / (num_frames * 1e6));
+
+  printf("- Batched: %d multi draws, submit %.3f ms, total %.3f ms per frame.\n",
+         num_groups,
+         batched_submit_ns / (num_frames * 1e6),
+         batched_total_ns / (num_frames * 1e6));
+
+  printf("- Checksums: naive %016llx, batched %016llx.\n",
+         (unsigned long long)naive_checksum,
+         (unsigned long long)batched_checksum);
+
+  if (GL_NO_ERROR != glGetError()) {
+    printf("A GL error occurred. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (naive_checksum != batched_checksum || num_programs != (uint32_t)num_groups) {
+    printf("The batched image is not the same as the naive one. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- The images are the same.\n");
+
+  bool is_ok = true;
+  is_ok &= test_overflow(batched_programs, vao, quads, false);
+  is_ok &= test_overflow(batched_programs, vao, quads, true);
+  is_ok &= check(GL_NO_ERROR == glGetError(), "no GL errors");
+
+  if (false == is_ok) {
+    printf("The draw batcher overflow test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* Cleanup */
+  batcher.shutdown();
+
+  for (uint32_t i = 0; i < num_programs; ++i) {
+    glDeleteProgram(naive_programs[i]);
+    glDeleteProgram(batched_programs[i]);
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteTextures(1, &tex);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteBuffers(1, &ibo);
+
+  if (0 != destroy_main_context(main)) {
+    printf("Failed to destroy the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+/* Adds `draws_per_group` draws for each program; only the first two groups fit. */
+static bool test_overflow(const GLuint* programs, GLuint vao, const std::vector<QuadData>& quads, bool is_data_overflow) {
+
+  const uint32_t draws_per_group = 10;
+  const uint32_t groups_that_fit = 2;
+
+  DrawBatcherSettings settings;
+  settings.max_draws = 1024;
+  settings.draw_data_size = sizeof(QuadData);
+  settings.max_groups = (true == is_data_overflow) ? 16 : groups_that_fit;
+
+  DrawBatcher batcher;
+  if (0 != batcher.init(settings)) {
+    printf("Failed to initialize the overflow batcher.\n");
+    return false;
+  }
+
+  if (true == is_data_overflow) {
+    uint64_t align = (uint64_t)batcher.data_alignment;
+    uint64_t group_bytes = ((draws_per_group * sizeof(QuadData) + align - 1) / align) * align;
+    batcher.data_region_size = groups_that_fit * group_bytes;
+  }
+
+  DrawElementsIndirectCommand command;
+  command.count = 6;
+
+  BatchState state;
+  state.vertex_array = vao;
+
+  batcher.begin_frame();
+
+  for (uint32_t i = 0; i < num_programs; ++i) {
+    state.program = programs[i];
+    for (uint32_t j = 0; j < draws_per_group; ++j) {
+      batcher.add(state, command, &quads[i * draws_per_group + j]);
+    }
+  }
+
+  int r = batcher.flush();
+  int end_result = batcher.end_frame();
+  glFinish();
+
+  bool is_ok = true;
+
+  if (false == is_data_overflow) {
+    is_ok &= check(-2 == r, "flush() returns -2 when there are more state groups than `max_groups`");
+  }
+  else {
+    is_ok &= check(-3 == r, "flush() returns -3 when the per draw data region is full");
+  }
+
+  is_ok &= check(groups_that_fit * draws_per_group == batcher.num_draws, "the draws of the submitted groups are counted, the dropped ones aren't");
+  is_ok &= check(groups_that_fit == batcher.num_multi_draws, "the submitted groups are counted as multi draws");
+  is_ok &= check(true == batcher.draws.empty(), "the dropped draws are cleared");
+  is_ok &= check(0 == end_result, "the frame can be ended after an overflow");
+
+  batcher.shutdown();
+
+  return is_ok;
+}
+
+/* Each quad covers 3x3 of the 4x4 pixels of its cell, so quads never overlap. */
+static void fill_quads(std::vector<QuadData>& quads) {
+
+  quads.resize(num_quads);
+
+  float cell_w = 2.0f / grid_width;
+  float cell_h = 2.0f / grid_height;
+
+  for (uint32_t i = 0; i < num_quads; ++i) {
+
+    uint32_t x = i % grid_width;
+    uint32_t y = i / grid_width;
+    uint32_t hash = i * 2654435761u;
+
+    QuadData& quad = quads[i];
+    quad.offset_scale[0] = -1.0f + x * cell_w;
+    quad.offset_scale[1] = -1.0f + y * cell_h;
+    quad.offset_scale[2] = cell_w * 0.75f;
+    quad.offset_scale[3] = cell_h * 0.75f;
+    quad.color[0] = ((hash >> 0) & 0xFF) / 255.0f;
+    quad.color[1] = ((hash >> 8) & 0xFF) / 255.0f;
+    quad.color[2] = ((hash >> 16) & 0xFF) / 255.0f;
+    quad.color[3] = 1.0f;
+  }
+}
+
+/* FNV-1a over the pixels of the bound framebuffer. */
+static uint64_t read_checksum() {
+
+  std::vector<uint8_t> pixels(fb_width * fb_height * 4);
+  glReadPixels(0, 0, fb_width, fb_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    hash ^= pixels[i];
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+/* ----------------------------------------------------------- */
@@ -0,0 +1,383 @@
+/*
+
+  FRAME EXPORT
+  =============
+
+  Tests the `GlFrameExport` (see `gl-frame-export.h`) end to end
+  with a consumer in another process. The test starts itself a
+  second time with `--consumer <name>`; that process is a stand-in
+  for an encoder: it opens the ring, takes the frames in order,
+  checks every pixel in place and gives the slots back.
+
+  The producer clears a framebuffer to a color derived from the
+  frame number and exports it. During the first `num_slow_frames`
+  frames the consumer holds every frame for a while, so the ring
+  fills up. This runs with pinned memory (when the driver has
+  `GL_AMD_pinned_memory`) and with the pack buffer. The test
+  checks that:
+
+  - the producer dropped frames instead of waiting for the
+    consumer;
+
+  - every frame was either published or dropped;
+
+  - a second producer can't create a ring with the same name
+    while the first one uses it;
+
+  - the consumer got the published frames in order, with the
+    right pixels, and gave all of them back (its exit code).
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <gl-context.h>
+#include <gl-resource.h>
+#include <gl-frame-export.h>
+#include <gl-sync.h>
+#include <test-utils.h>
+
+#if !defined(_WIN32)
+#  include <spawn.h>
+#  include <unistd.h>
+#  include <sys/wait.h>
+extern char** environ;
+#endif
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t width = 320;
+static const uint32_t height = 240;
+static const uint32_t num_frames = 150;
+static const uint32_t num_slow_frames = 30;
+
+/* ----------------------------------------------------------- */
+
+static bool run_export(const char* exe, bool use_pinned_memory);
+static void get_color(uint64_t frame, uint8_t* rgba);
+static int run_consumer(const char* name);
+static int start_consumer(const char* exe, const std::string& name);
+static int wait_for_consumer();
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  if (3 == narg && 0 == strcmp(arg[1], "--consumer")) {
+    return run_consumer(arg[2]);
+  }
+
+  printf("! Testing the frame export.\n");
+
+  GlContext ctx;
+
+  if (0 != create_shared_context(nullptr, ctx)) {
+    printf("Failed to create the context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != make_context_current(ctx)) {
+    printf("Failed to make the context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GLuint tex = 0;
+  GLuint fbo = 0;
+
+  if (0 != gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, width, height, 0, tex)
+      || 0 != gl_create_framebuffer(fbo)
+      || 0 != gl_attach_texture(fbo, GL_COLOR_ATTACHMENT0, tex, 0)
+      || 0 != gl_check_framebuffer(fbo))
+  {
+    printf("Failed to create the framebuffer. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+  bool is_ok = true;
+
+  /* With pinned memory when the driver has it, then always with the pack buffer. */
+  if (0 != GLAD_GL_AMD_pinned_memory) {
+    is_ok &= run_export(arg[0], true);
+  }
+
+  is_ok &= run_export(arg[0], false);
+  is_ok &= check(GL_NO_ERROR == glGetError(), "no GL errors");
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteTextures(1, &tex);
+
+  release_current_context();
+
+  if (0 != destroy_main_context(ctx)) {
+    printf("Failed to destroy the context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (false == is_ok) {
+    printf("The frame export test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static bool run_export(const char* exe, bool use_pinned_memory) {
+
+  FrameExportSettings cfg;
+  cfg.width = width;
+  cfg.height = height;
+  cfg.num_slots = 3;
+  cfg.use_pinned_memory = use_pinned_memory;
+
+#if defined(_WIN32)
+  cfg.name = "poly-frame-export-" + std::to_string(GetCurrentProcessId());
+#else
+  cfg.name = "/poly-frame-export-" + std::to_string(getpid());
+#endif
+
+  GlFrameExport exporter;
+
+  if (0 != exporter.init(cfg)) {
+    printf("Failed to initialize the frame export. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- Pack buffer: %s.\n", (true == exporter.is_pinned) ? "pinned shared memory" : "persistently mapped, one copy per frame");
+  fflush(stdout);
+
+  /* A second producer must not take over the ring while it's in use. */
+  FrameRingSettings other_cfg;
+  other_cfg.width = width;
+  other_cfg.height = height;
+
+  SharedFrameRing other;
+  int other_result = other.create(cfg.name.c_str(), other_cfg);
+
+  if (0 != start_consumer(exe, cfg.name)) {
+    printf("Failed to start the consumer. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  bool are_captures_ok = true;
+
+  for (uint32_t frame = 0; frame < num_frames; ++frame) {
+
+    uint8_t rgba[4] = {};
+    get_color(frame, rgba);
+
+    glClearColor(rgba[0] / 255.0f, rgba[1] / 255.0f, rgba[2] / 255.0f, rgba[3] / 255.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    are_captures_ok &= (0 <= exporter.capture(frame));
+    are_captures_ok &= (0 <= exporter.poll());
+
+    /* After the slow part the consumer keeps up with us. */
+    if (frame >= num_slow_frames) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  }
+
+  FrameExportStats stats = exporter.stats;
+  bool is_pinned = exporter.is_pinned;
+
+  if (0 != exporter.shutdown()) {
+    printf("Failed to shutdown the frame export. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  int consumer_result = wait_for_consumer();
+
+  exporter.print();
+
+  bool is_ok = true;
+  is_ok &= check(is_pinned == use_pinned_memory, "the export used the pack buffer we asked for");
+  is_ok &= check(-6 == other_result, "a second producer couldn't take over the ring");
+  is_ok &= check(true == are_captures_ok, "every capture and poll succeeded");
+  is_ok &= check(stats.num_dropped > 0, "the producer dropped frames while the consumer held the slots");
+  is_ok &= check(stats.num_published + stats.num_dropped == num_frames, "every frame was published or dropped");
+  is_ok &= check(stats.num_published >= (num_frames - num_slow_frames) / 2, "most frames after the slow part were published");
+  is_ok &= check(0 == consumer_result, "the consumer got every published frame in order with the right pixels");
+
+  return is_ok;
+}
+
+/*
+  The consumer stub; runs in its own process. Returns
+  EXIT_SUCCESS when it got every published frame in order and
+  every pixel was right.
+*/
+static int run_consumer(const char* name) {
+
+  SharedFrameRing ring;
+  uint64_t deadline_ns = gpu_sync_now_ns() + 2000ull * 1000ull * 1000ull;
+
+  while (0 != ring.open(name)) {
+
+    if (gpu_sync_now_ns() > deadline_ns) {
+      printf("Consumer: failed to open the ring `%s`. (exiting).\n", name);
+      return EXIT_FAILURE;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  uint64_t num_consumed = 0;
+  uint64_t num_bad_frames = 0;
+  uint64_t num_out_of_order = 0;
+  uint64_t prev_frame = 0;
+  FrameView view;
+
+  deadline_ns = gpu_sync_now_ns() + 20ull * 1000ull * 1000ull * 1000ull;
+
+  while (false == ring.is_closed() && gpu_sync_now_ns() < deadline_ns) {
+
+    int r = ring.acquire(view);
+
+    if (r < 0) {
+      printf("Consumer: failed to acquire. (exiting).\n");
+      return EXIT_FAILURE;
+    }
+
+    if (1 == r) {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      continue;
+    }
+
+    /* Check every pixel in place; this is where an encoder would read them. */
+    uint8_t expected[4] = {};
+    get_color(view.frame, expected);
+
+    bool is_frame_ok = (view.size == (uint64_t)ring.header->stride * ring.header->height);
+
+    for (uint64_t i = 0; i < view.size && true == is_frame_ok; i += 4) {
+      is_frame_ok = (0 == memcmp(view.data + i, expected, 4));
+    }
+
+    num_bad_frames += (true == is_frame_ok) ? 0 : 1;
+    num_out_of_order += (num_consumed > 0 && view.frame <= prev_frame) ? 1 : 0;
+    prev_frame = view.frame;
+
+    /* A slow encoder; the producer has to drop frames. */
+    if (view.frame < num_slow_frames) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(8));
+    }
+
+    ring.release(view);
+    num_consumed++;
+  }
+
+  uint64_t num_published = ring.header->num_published.load();
+  bool is_closed = ring.is_closed();
+
+  ring.close();
+
+  printf("- Consumer: %llu frames of %llu published, last frame %llu, %llu bad, %llu out of order.\n",
+         (unsigned long long)num_consumed,
+         (unsigned long long)num_published,
+         (unsigned long long)prev_frame,
+         (unsigned long long)num_bad_frames,
+         (unsigned long long)num_out_of_order);
+
+  if (false == is_closed
+      || 0 == num_consumed
+      || num_consumed != num_published
+      || 0 != num_bad_frames
+      || 0 != num_out_of_order)
+  {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static void get_color(uint64_t frame, uint8_t* rgba) {
+  rgba[0] = (uint8_t)(frame & 0xFF);
+  rgba[1] = (uint8_t)((frame * 7 + 1) & 0xFF);
+  rgba[2] = (uint8_t)((frame * 13 + 2) & 0xFF);
+  rgba[3] = 255;
+}
+
+#if defined(_WIN32)
+
+static PROCESS_INFORMATION consumer_process = {};
+
+static int start_consumer(const char* exe, const std::string& name) {
+
+  char path[MAX_PATH] = { 0 };
+  GetModuleFileNameA(nullptr, path, MAX_PATH);
+
+  std::string cmd = std::string("\"") + path + "\" --consumer " + name;
+  STARTUPINFOA startup = {};
+  startup.cb = sizeof(startup);
+
+  if (FALSE == CreateProcessA(nullptr, &cmd[0], nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup, &consumer_process)) {
+    printf("Failed to start the consumer process (%lu).\n", GetLastError());
+    return -1;
+  }
+
+  return 0;
+}
+
+static int wait_for_consumer() {
+
+  DWORD code = EXIT_FAILURE;
+
+  WaitForSingleObject(consumer_process.hProcess, INFINITE);
+  GetExitCodeProcess(consumer_process.hProcess, &code);
+  CloseHandle(consumer_process.hThread);
+  CloseHandle(consumer_process.hProcess);
+
+  return (int)code;
+}
+
+#else
+
+static pid_t consumer_pid = -1;
+
+/* We run the same binary; `/proc/self/exe` works when we're started without a path. */
+static int start_consumer(const char* exe, const std::string& name) {
+
+  char consumer_arg[] = "--consumer";
+  char* argv[] = { (char*)exe, consumer_arg, (char*)name.c_str(), nullptr };
+
+  if (0 != posix_spawn(&consumer_pid, "/proc/self/exe", nullptr, nullptr, argv, environ)) {
+    printf("Failed to start the consumer process.\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+static int wait_for_consumer() {
+
+  int status = 0;
+
+  if (consumer_pid < 0 || consumer_pid != waitpid(consumer_pid, &status, 0)) {
+    printf("Failed to wait for the consumer process.\n");
+    return -1;
+  }
+
+  if (false == WIFEXITED(status)) {
+    printf("The consumer process didn't exit normally.\n");
+    return -2;
+  }
+
+  return WEXITSTATUS(status);
+}
+
+#endif
+
+/* ----------------------------------------------------------- */
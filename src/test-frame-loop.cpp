@@ -0,0 +1,199 @@
+/*
+
+  FRAME LOOP
+  ===========
+
+  Tests the `GlFrameLoop` (see `gl-frame-loop.h`): a render
+  thread renders frames with the context while this thread acts
+  as the window thread. The test checks that:
+
+  - while the window thread is stuck in a (simulated) window
+    drag that posts thousands of resizes, the render thread
+    keeps rendering; the resizes are coalesced, the last size
+    arrives and the key presses in between arrive in order;
+
+  - `pump()` stays within its time budget when the queue is
+    flooded, leaves the rest for the next call and returns 1
+    once it dispatched the close event;
+
+  - the render thread released the context when it stopped.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gl-context.h>
+#include <gl-frame-loop.h>
+#include <gl-sync.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint64_t drag_ns = 300ull * 1000ull * 1000ull;
+static const uint32_t resizes_per_key = 500;
+static const uint32_t num_flood_messages = 200000;
+static const uint64_t pump_budget_ns = 1000000;
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the frame loop.\n");
+
+  GlContext ctx;
+
+  if (0 != create_shared_context(nullptr, ctx)) {
+    printf("Failed to create the context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<LoopEvent> delivered;            /* Render thread; read after `shutdown()`. */
+  std::atomic<uint64_t> num_frames{0};
+  std::atomic<bool> is_closed{false};
+
+  GlFrameLoop loop;
+  loop.min_frame_ns = 2000000;
+  loop.pump_budget_ns = pump_budget_ns;
+
+  loop.on_events = [&](const std::vector<LoopEvent>& events) {
+    for (const LoopEvent& ev : events) {
+      delivered.push_back(ev);
+      if (LOOP_EVENT_CLOSE == ev.type) {
+        is_closed = true;
+      }
+    }
+  };
+
+  loop.on_frame = [&](uint64_t frame) {
+    glClearColor(0.0f, 0.0f, (frame % 2) ? 1.0f : 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glFinish();
+    num_frames++;
+    return 0;
+  };
+
+  if (0 != loop.start(&ctx)) {
+    printf("Failed to start the frame loop. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* Phase 1: a drag; the window procedure posts directly, we never get back to `pump()`. */
+  uint64_t frames_before_drag = num_frames.load();
+  uint64_t drag_end_ns = gpu_sync_now_ns() + drag_ns;
+  uint32_t num_resizes = 0;
+  uint32_t num_keys = 0;
+  LoopEvent ev;
+
+  while (gpu_sync_now_ns() < drag_end_ns) {
+
+    ev.type = LOOP_EVENT_RESIZE;
+    ev.x = (int32_t)(640 + num_resizes);
+    ev.y = 480;
+    loop.post_event(ev);
+    num_resizes++;
+
+    if (0 == (num_resizes % resizes_per_key)) {
+      ev.type = LOOP_EVENT_KEY_DOWN;
+      ev.key = num_keys++;
+      loop.post_event(ev);
+    }
+  }
+
+  int32_t last_width = ev.x;
+  uint64_t frames_during_drag = num_frames.load() - frames_before_drag;
+
+  /* Phase 2: a flooded queue and a close at the end. */
+  for (uint32_t i = 0; i < num_flood_messages; ++i) {
+    ev.type = LOOP_EVENT_MOUSE_MOVE;
+    ev.x = (int32_t)i;
+    ev.y = (int32_t)i;
+    loop.inject(ev);
+  }
+
+  ev.type = LOOP_EVENT_CLOSE;
+  loop.inject(ev);
+
+  uint32_t num_pumps = 0;
+  int r = 0;
+
+  while (0 == (r = loop.pump())) {
+    num_pumps++;
+    loop.wait_for_messages(1000000);
+  }
+
+  uint64_t deadline = gpu_sync_now_ns() + 2000ull * 1000ull * 1000ull;
+  while (false == is_closed.load() && gpu_sync_now_ns() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  if (0 != loop.shutdown()) {
+    printf("Failed to shutdown the frame loop. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  loop.print();
+
+  /* Check what the render thread got. */
+  bool are_keys_in_order = true;
+  uint32_t num_delivered_keys = 0;
+  uint32_t num_delivered_resizes = 0;
+  int32_t delivered_width = 0;
+  int32_t last_mouse_x = -1;
+
+  for (const LoopEvent& e : delivered) {
+
+    if (LOOP_EVENT_KEY_DOWN == e.type) {
+      are_keys_in_order &= (e.key == num_delivered_keys);
+      num_delivered_keys++;
+    }
+    else if (LOOP_EVENT_RESIZE == e.type) {
+      delivered_width = e.x;
+      num_delivered_resizes++;
+    }
+    else if (LOOP_EVENT_MOUSE_MOVE == e.type) {
+      last_mouse_x = e.x;
+    }
+  }
+
+  printf("- Drag: %u resizes and %u keys posted, %u resizes delivered, %llu frames rendered during the drag.\n",
+         num_resizes,
+         num_keys,
+         num_delivered_resizes,
+         (unsigned long long)frames_during_drag);
+
+  printf("- Flood: %u messages dispatched in %u pumps.\n", num_flood_messages + 1, num_pumps + 1);
+
+  bool is_ok = true;
+  is_ok &= check(frames_during_drag >= 30, "the render thread kept rendering during the drag");
+  is_ok &= check(loop.stats.max_frame_gap_ns < 50ull * 1000ull * 1000ull, "no frame waited longer than 50 ms");
+  is_ok &= check(loop.stats.num_coalesced > 0 && num_delivered_resizes < num_resizes, "the resizes were coalesced");
+  is_ok &= check(delivered_width == last_width, "the last size was delivered");
+  is_ok &= check(num_delivered_keys == num_keys && true == are_keys_in_order, "all keys were delivered in order");
+  is_ok &= check(last_mouse_x == (int32_t)(num_flood_messages - 1), "the last mouse position was delivered");
+  is_ok &= check(1 == r, "`pump()` returned 1 after the close");
+  is_ok &= check(true == is_closed.load(), "the close was delivered");
+  is_ok &= check(loop.stats.num_pump_budget_hits > 0 && num_pumps > 0, "`pump()` left messages for the next call");
+  is_ok &= check(loop.stats.max_pump_ns < pump_budget_ns + 5000000, "`pump()` stayed within its budget");
+  is_ok &= check(0 == make_context_current(ctx), "the render thread released the context");
+
+  release_current_context();
+
+  if (0 != destroy_main_context(ctx)) {
+    printf("Failed to destroy the context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (false == is_ok) {
+    printf("The frame loop test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
@@ -0,0 +1,293 @@
+/*
+
+  GL PROFILER
+  ============
+
+  Profiles a couple of frames on the render thread and on a
+  `GlWorker` at the same time, and writes both into one Chrome
+  trace (`gl-profiler-trace.json`, open it in chrome://tracing
+  or https://ui.perfetto.dev).
+
+  A render frame has a "shadows" pass that draws a few fullscreen
+  triangles and an "opaque" pass that draws a lot more, with a
+  nested "sky" and "meshes" scope and a CPU only "cull" scope. The
+  worker uploads textures, one profiled frame per task.
+
+  We check that:
+
+  - every frame was either collected or dropped;
+  - the GPU time of a nested scope lies within its parent;
+  - the trace was written.
+
+  We only warn when the "opaque" pass, which draws more, doesn't
+  take more GPU time than the "shadows" pass; that depends on
+  the driver and on what else the GPU is doing.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <gl-context.h>
+#include <gl-worker.h>
+#include <gl-resource.h>
+#include <gl-profiler.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_frames = 60;
+static const uint32_t num_uploads = 30;
+static const uint32_t num_warmup_frames = 5;
+static const GLsizei fb_size = 512;
+static const char* trace_path = "gl-profiler-trace.json";
+
+/* ----------------------------------------------------------- */
+
+static void draw(GLint u_color, uint32_t count);
+static uint32_t check_nesting(const GlProfiler& profiler);
+static double get_average_gpu_ms(const GlProfiler& profiler, const char* name);
+static void wait_and_collect(GlProfiler& profiler);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the GL profiler.\n");
+
+  GlContext main;
+  if (0 != create_shared_context(nullptr, main)) {
+    printf("Failed to create the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GlWorker worker;
+  if (0 != worker.start(&main)) {
+    printf("Failed to start the worker. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* The worker's profiler must be used on the worker thread. */
+  GlProfiler upload_profiler;
+  worker.post([&upload_profiler]() {
+
+    upload_profiler.init("upload");
+
+    std::vector<uint8_t> pixels(256 * 256 * 4, 0x7F);
+
+    for (uint32_t i = 0; i < num_uploads; ++i) {
+
+      upload_profiler.begin_frame();
+      upload_profiler.begin_scope("texture");
+
+      GLuint tex = 0;
+      gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, 256, 256, 0, tex);
+      gl_upload_texture(GL_TEXTURE_2D, tex, 0, 0, 0, 0, 256, 256, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+      glDeleteTextures(1, &tex);
+
+      upload_profiler.end_scope();
+      upload_profiler.end_frame();
+    }
+
+    wait_and_collect(upload_profiler);
+    upload_profiler.shutdown();
+  });
+
+  GlProfiler profiler;
+  if (0 != profiler.init("render")) {
+    printf("Failed to initialize the profiler. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GLuint prog = create_program(fullscreen_vs, color_fs);
+  if (0 == prog) {
+    printf("Failed to create the program. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GLint u_color = glGetUniformLocation(prog, "u_color");
+  GLuint tex = 0;
+  GLuint fbo = 0;
+  GLuint vao = 0;
+
+  gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, fb_size, fb_size, 0, tex);
+  gl_create_framebuffer(fbo);
+  gl_attach_texture(fbo, GL_COLOR_ATTACHMENT0, tex, 0);
+
+  if (0 != gl_check_framebuffer(fbo)) {
+    printf("The framebuffer is not complete. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glViewport(0, 0, fb_size, fb_size);
+  glUseProgram(prog);
+
+  for (uint32_t frame = 0; frame < num_frames; ++frame) {
+
+    profiler.begin_frame();
+
+    profiler.begin_scope("shadows");
+    draw(u_color, 2);
+    profiler.end_scope();
+
+    profiler.begin_scope("opaque");
+    {
+      profiler.begin_cpu_scope("cull");
+      volatile uint64_t sum = 0;
+      for (uint32_t i = 0; i < 100000; ++i) {
+        sum += i;
+      }
+      profiler.end_scope();
+
+      profiler.begin_scope("sky");
+      draw(u_color, 2);
+      profiler.end_scope();
+
+      profiler.begin_scope("meshes");
+      draw(u_color, 16);
+      profiler.end_scope();
+    }
+    profiler.end_scope();
+
+    profiler.end_frame();
+    glFlush();
+  }
+
+  wait_and_collect(profiler);
+
+  if (0 != worker.shutdown()) {
+    printf("Failed to shutdown the worker. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  profiler.print();
+  upload_profiler.print();
+
+  /* Checks */
+  uint32_t num_bad_render = check_nesting(profiler);
+  uint32_t num_bad_upload = check_nesting(upload_profiler);
+  double shadows_ms = get_average_gpu_ms(profiler, "shadows");
+  double opaque_ms = get_average_gpu_ms(profiler, "opaque");
+
+  printf("- render: collected %llu, dropped %llu of %u frames.\n",
+         (unsigned long long)profiler.num_collected,
+         (unsigned long long)profiler.num_dropped,
+         num_frames);
+
+  printf("- upload: collected %llu, dropped %llu of %u frames.\n",
+         (unsigned long long)upload_profiler.num_collected,
+         (unsigned long long)upload_profiler.num_dropped,
+         num_uploads);
+
+  printf("- Average GPU time: shadows %.3f ms, opaque %.3f ms.\n", shadows_ms, opaque_ms);
+  printf("- Scopes outside their parent: render %u, upload %u.\n", num_bad_render, num_bad_upload);
+
+  GlProfiler* profilers[] = { &profiler, &upload_profiler };
+  int r = gl_profiler_write_trace(trace_path, profilers, 2);
+
+  bool is_ok = true;
+  is_ok &= check(0 == r, "wrote the trace");
+  is_ok &= check(num_frames == profiler.num_collected + profiler.num_dropped, "every render frame was collected or dropped");
+  is_ok &= check(num_uploads == upload_profiler.num_collected + upload_profiler.num_dropped, "every upload was collected or dropped");
+  is_ok &= check(0 != profiler.num_collected, "render frames were collected");
+  is_ok &= check(0 == num_bad_render, "the render scopes are inside their parent");
+  is_ok &= check(0 == num_bad_upload, "the upload scopes are inside their parent");
+
+  if (opaque_ms <= shadows_ms) {
+    printf("- Warning: the opaque pass (%.3f ms) wasn't slower than the shadow pass (%.3f ms).\n", opaque_ms, shadows_ms);
+  }
+
+  /* Cleanup */
+  profiler.shutdown();
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteTextures(1, &tex);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteProgram(prog);
+
+  if (0 != destroy_main_context(main)) {
+    printf("Failed to destroy the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (false == is_ok) {
+    printf("The GL profiler test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- Wrote `%s`.\n", trace_path);
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static void draw(GLint u_color, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    glUniform4f(u_color, i / (float)count, 0.5f, 0.25f, 1.0f);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+  }
+}
+
+/* Waits for the GPU so the results of the last frames are available. */
+static void wait_and_collect(GlProfiler& profiler) {
+  glFinish();
+  profiler.collect();
+}
+
+/* The `trace` has the scopes of each frame in order; a scope with depth 0 starts a frame. */
+static uint32_t check_nesting(const GlProfiler& profiler) {
+
+  uint32_t num_bad = 0;
+  size_t first = 0;
+
+  for (size_t i = 0; i < profiler.trace.size(); ++i) {
+
+    const ProfileScope& scope = profiler.trace[i];
+    if (0 == scope.depth) {
+      first = i;
+      continue;
+    }
+
+    if (PROFILER_NONE == scope.begin_query) {
+      continue;
+    }
+
+    const ProfileScope& parent = profiler.trace[first + scope.parent];
+    if (scope.gpu_begin_ns < parent.gpu_begin_ns
+        || scope.gpu_end_ns > parent.gpu_end_ns
+        || scope.gpu_end_ns < scope.gpu_begin_ns)
+      {
+        num_bad++;
+      }
+  }
+
+  return num_bad;
+}
+
+/* Skips the first frames; drivers compile the shaders on the first draws. */
+static double get_average_gpu_ms(const GlProfiler& profiler, const char* name) {
+
+  uint64_t total = 0;
+  uint64_t count = 0;
+
+  for (const ProfileScope& scope : profiler.trace) {
+    if (scope.frame >= num_warmup_frames && 0 == strcmp(scope.name, name)) {
+      total += scope.gpu_end_ns - scope.gpu_begin_ns;
+      count++;
+    }
+  }
+
+  return (0 == count) ? 0.0 : (total / (double)count) / 1e6;
+}
+
+/* ----------------------------------------------------------- */
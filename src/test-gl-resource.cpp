@@ -0,0 +1,244 @@
+/*
+
+  GL RESOURCE
+  ============
+
+  Runs the same work twice, once with direct state access and
+  once with the bind-to-edit fallback (forced with
+  `gl_resource_set_dsa_enabled(false)`):
+
+  - create a buffer, upload to a range of it, copy it into a
+    second buffer and read that back;
+  - create textures, upload a pattern, set their parameters,
+    attach them to a framebuffer and read the pixels back;
+  - map a persistent buffer and check what we wrote through
+    the pointer.
+
+  Both paths must produce the same data and leave the texture
+  and buffer bindings of the caller alone. We also print how long
+  it takes to create and upload a couple of hundred textures
+  and buffers with each path.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <gl-context.h>
+#include <gl-resource.h>
+#include <gl-sync.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_textures = 256;
+static const uint32_t num_buffers = 256;
+static const GLsizei tex_size = 64;
+static const GLsizeiptr buffer_size = 64 * 1024;
+
+/* ----------------------------------------------------------- */
+
+static bool run(const char* name);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the GL resource functions.\n");
+
+  GlContext main;
+  if (0 != create_shared_context(nullptr, main)) {
+    printf("Failed to create the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  bool is_ok = true;
+
+  if (true == gl_resource_has_dsa()) {
+    is_ok &= run("DSA");
+  }
+  else {
+    printf("- The driver doesn't support direct state access; only testing the fallback.\n");
+  }
+
+  gl_resource_set_dsa_enabled(false);
+  is_ok &= run("Bind-to-edit");
+  gl_resource_set_dsa_enabled(true);
+
+  if (0 != destroy_main_context(main)) {
+    printf("Failed to destroy the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (false == is_ok) {
+    printf("The GL resource test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static bool run(const char* name) {
+
+  printf("- %s\n", name);
+
+  bool is_ok = true;
+
+  while (GL_NO_ERROR != glGetError()) {
+  }
+
+  /* What the caller has bound; the functions must leave these alone. */
+  GLuint bound_tex = 0;
+  GLuint bound_buffers[2] = { 0 };
+  glGenTextures(1, &bound_tex);
+  glGenBuffers(2, bound_buffers);
+  glBindTexture(GL_TEXTURE_2D, bound_tex);
+  glBindBuffer(GL_COPY_READ_BUFFER, bound_buffers[0]);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, bound_buffers[1]);
+
+  /* Buffers: upload, copy, download. */
+  std::vector<uint8_t> data(buffer_size);
+  std::vector<uint8_t> result(buffer_size, 0);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = (uint8_t)(i * 7);
+  }
+
+  GLuint src = 0;
+  GLuint dst = 0;
+  gl_create_buffer(buffer_size, nullptr, GL_DYNAMIC_STORAGE_BIT, src);
+  gl_create_buffer(buffer_size, nullptr, GL_DYNAMIC_STORAGE_BIT, dst);
+  gl_upload_buffer(src, 0, buffer_size, data.data());
+  gl_copy_buffer(src, dst, 1024, 0, buffer_size - 1024);
+  gl_download_buffer(dst, 0, buffer_size - 1024, result.data());
+
+  is_ok &= check(0 == memcmp(result.data(), data.data() + 1024, buffer_size - 1024), "upload, copy and download a buffer");
+
+  glDeleteBuffers(1, &src);
+  glDeleteBuffers(1, &dst);
+
+  /* Persistent mapping. */
+  GLuint mapped = 0;
+  uint8_t* ptr = nullptr;
+  GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+  if (0 == gl_create_buffer(buffer_size, nullptr, flags, mapped)
+      && 0 == gl_map_buffer(mapped, 0, buffer_size, flags, (void**)&ptr))
+    {
+      memcpy(ptr, data.data(), buffer_size);
+      gl_unmap_buffer(mapped);
+      memset(result.data(), 0, result.size());
+      gl_download_buffer(mapped, 0, buffer_size, result.data());
+      is_ok &= check(0 == memcmp(result.data(), data.data(), buffer_size), "write through a persistent mapping");
+    }
+  else {
+    is_ok &= check(false, "create and map a persistent buffer");
+  }
+
+  glDeleteBuffers(1, &mapped);
+
+  /* Texture + framebuffer: upload a pattern and read it back through the framebuffer. */
+  std::vector<uint32_t> pixels(tex_size * tex_size);
+  std::vector<uint32_t> read(tex_size * tex_size, 0);
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    pixels[i] = 0xFF000000u | (uint32_t)(i * 2654435761u >> 8);
+  }
+
+  GLuint tex = 0;
+  GLuint fbo = 0;
+  gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, tex_size, tex_size, 0, tex);
+  gl_upload_texture(GL_TEXTURE_2D, tex, 0, 0, 0, 0, tex_size, tex_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  gl_set_texture_parameter(GL_TEXTURE_2D, tex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  gl_create_framebuffer(fbo);
+  gl_attach_texture(fbo, GL_COLOR_ATTACHMENT0, tex, 0);
+
+  is_ok &= check(0 == gl_check_framebuffer(fbo), "the framebuffer is complete");
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+  glReadPixels(0, 0, tex_size, tex_size, GL_RGBA, GL_UNSIGNED_BYTE, read.data());
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+  is_ok &= check(0 == memcmp(read.data(), pixels.data(), pixels.size() * sizeof(uint32_t)), "upload a texture and read it back");
+
+  GLint min_filter = 0;
+  glBindTexture(GL_TEXTURE_2D, tex);
+  glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &min_filter);
+  glBindTexture(GL_TEXTURE_2D, bound_tex);
+
+  is_ok &= check(GL_NEAREST == min_filter, "set a texture parameter");
+
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteTextures(1, &tex);
+
+  /* Array textures and mipmaps. */
+  GLuint array = 0;
+  gl_create_texture(GL_TEXTURE_2D_ARRAY, 3, GL_RGBA8, tex_size, tex_size, 4, array);
+  for (GLint layer = 0; layer < 4; ++layer) {
+    gl_upload_texture(GL_TEXTURE_2D_ARRAY, array, 0, 0, 0, layer, tex_size, tex_size, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  }
+  gl_generate_mipmaps(GL_TEXTURE_2D_ARRAY, array);
+  glDeleteTextures(1, &array);
+
+  GLint tex_binding = 0;
+  GLint read_binding = 0;
+  GLint write_binding = 0;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &tex_binding);
+  glGetIntegerv(GL_COPY_READ_BUFFER_BINDING, &read_binding);
+  glGetIntegerv(GL_COPY_WRITE_BUFFER_BINDING, &write_binding);
+
+  is_ok &= check((GLuint)tex_binding == bound_tex
+                 && (GLuint)read_binding == bound_buffers[0]
+                 && (GLuint)write_binding == bound_buffers[1],
+                 "the bindings of the caller are restored");
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glDeleteTextures(1, &bound_tex);
+  glDeleteBuffers(2, bound_buffers);
+
+  is_ok &= check(GL_NO_ERROR == glGetError(), "no GL errors");
+
+  /* Timing */
+  std::vector<GLuint> textures(num_textures, 0);
+  std::vector<GLuint> buffers(num_buffers, 0);
+
+  glFinish();
+  uint64_t t0 = gpu_sync_now_ns();
+
+  for (uint32_t i = 0; i < num_textures; ++i) {
+    gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, tex_size, tex_size, 0, textures[i]);
+    gl_upload_texture(GL_TEXTURE_2D, textures[i], 0, 0, 0, 0, tex_size, tex_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    gl_set_texture_parameter(GL_TEXTURE_2D, textures[i], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl_set_texture_parameter(GL_TEXTURE_2D, textures[i], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  }
+
+  for (uint32_t i = 0; i < num_buffers; ++i) {
+    gl_create_buffer(buffer_size, nullptr, GL_DYNAMIC_STORAGE_BIT, buffers[i]);
+    gl_upload_buffer(buffers[i], 0, buffer_size, data.data());
+  }
+
+  glFinish();
+  uint64_t t1 = gpu_sync_now_ns();
+
+  printf("  %u textures and %u buffers created and uploaded in %.3f ms.\n",
+         num_textures,
+         num_buffers,
+         (t1 - t0) / 1e6);
+
+  glDeleteTextures(num_textures, textures.data());
+  glDeleteBuffers(num_buffers, buffers.data());
+
+  return is_ok;
+}
+
+/* ----------------------------------------------------------- */
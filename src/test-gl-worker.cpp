@@ -0,0 +1,100 @@
+/*
+
+  GL WORKER
+  ==========
+
+  Starts and stops a couple of `GlWorker`s over and over again,
+  like we do when the config is reloaded. Each worker creates a
+  context that shares with `main`, runs some tasks and deletes
+  its context when it's shut down. We print the shutdown latency
+  so we can see it stays bounded.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <gl-context.h>
+#include <gl-worker.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_workers = 4;
+static const uint32_t num_restarts = 25;
+static const uint32_t num_tasks = 100;
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the GL worker lifecycle.\n");
+
+  GlContext main;
+  if (0 != create_shared_context(nullptr, main)) {
+    printf("Failed to create the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  main.print("main");
+
+  if (0 != release_current_context()) {
+    printf("Failed to release the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  uint64_t min_ns = UINT64_MAX;
+  uint64_t max_ns = 0;
+  uint64_t total_ns = 0;
+  uint64_t num_executed = 0;
+
+  for (uint32_t i = 0; i < num_restarts; ++i) {
+
+    GlWorker workers[num_workers];
+
+    for (uint32_t j = 0; j < num_workers; ++j) {
+
+      workers[j].max_shutdown_ns = 50ull * 1000ull * 1000ull;
+      
+      if (0 != workers[j].start(&main)) {
+        printf("Failed to start worker %u. (exiting).\n", j);
+        exit(EXIT_FAILURE);
+      }
+
+      for (uint32_t k = 0; k < num_tasks; ++k) {
+        workers[j].post([]() {
+          glClearColor(0.0f, 1.0f, 0.0f, 1.0f);
+          glClear(GL_COLOR_BUFFER_BIT);
+        });
+      }
+    }
+
+    for (uint32_t j = 0; j < num_workers; ++j) {
+
+      if (0 != workers[j].shutdown()) {
+        printf("Failed to shutdown worker %u. (exiting).\n", j);
+        exit(EXIT_FAILURE);
+      }
+
+      if (nullptr != workers[j].ctx.gl) {
+        printf("Worker %u didn't delete its context. (exiting).\n", j);
+        exit(EXIT_FAILURE);
+      }
+
+      uint64_t ns = workers[j].shutdown_ns;
+      min_ns = (ns < min_ns) ? ns : min_ns;
+      max_ns = (ns > max_ns) ? ns : max_ns;
+      total_ns += ns;
+      num_executed += workers[j].num_executed;
+    }
+  }
+
+  printf("- Restarted %u workers %u times, executed %llu tasks.\n", num_workers, num_restarts, (unsigned long long)num_executed);
+  printf("- Shutdown latency: min %.3f ms, avg %.3f ms, max %.3f ms.\n",
+         min_ns / 1e6,
+         (total_ns / (double)(num_workers * num_restarts)) / 1e6,
+         max_ns / 1e6);
+
+  destroy_main_context(main);
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
@@ -0,0 +1,174 @@
+/*
+
+  HANDLE POOL
+  ============
+
+  Creates and destroys a lot of texture handles (see
+  `gl-handle-pool.h`) and checks that:
+
+  - handles of destroyed textures are detected as stale, also
+    when their slot has been reused;
+  - the metadata arrays stay dense and in sync.
+
+  Then we compare the time of a handle lookup with looking up
+  the metadata of a raw `GLuint` in a `std::unordered_map`,
+  which is what you'd do without handles.
+
+  The pools don't call GL, so this runs on any box; the names
+  are fake.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <unordered_map>
+#include <gl-handle-pool.h>
+#include <gl-sync.h>
+
+/* ----------------------------------------------------------- */
+
+struct TextureInfo {
+  GLenum target = 0;
+  GLenum internal_format = 0;
+  GLsizei width = 0;
+  GLsizei height = 0;
+};
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_textures = 100000;
+static const uint32_t num_lookups = 10000000;
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the handle pool.\n");
+
+  TexturePool textures;
+  std::vector<TextureHandle> handles(num_textures);
+  std::unordered_map<GLuint, TextureInfo> infos;
+  std::mt19937 rng(1234);
+  GLuint next_name = 1;
+  GLuint name = 0;
+
+  for (uint32_t i = 0; i < num_textures; ++i) {
+    GLsizei size = 16 << (i % 8);
+    if (0 != textures.create(next_name, GL_TEXTURE_2D, GL_RGBA8, size, size, nullptr, handles[i])) {
+      printf("Failed to create a texture handle. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+    TextureInfo& info = infos[next_name];
+    info.target = GL_TEXTURE_2D;
+    info.internal_format = GL_RGBA8;
+    info.width = size;
+    info.height = size;
+    next_name++;
+  }
+
+  /* Destroy every other texture and create new ones that reuse the slots. */
+  std::vector<TextureHandle> stale;
+  for (uint32_t i = 0; i < num_textures; i += 2) {
+    if (0 != textures.destroy(handles[i], name)) {
+      printf("Failed to destroy a texture handle. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+    infos.erase(name);
+    stale.push_back(handles[i]);
+    if (0 != textures.create(next_name, GL_TEXTURE_2D, GL_RGBA8, 64, 64, nullptr, handles[i])) {
+      printf("Failed to recreate a texture handle. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+    infos[next_name] = TextureInfo();
+    next_name++;
+  }
+
+  /* The stale handles point to reused slots; each lookup must fail (and is logged in debug builds). */
+  uint32_t num_detected = 0;
+  for (size_t i = 0; i < 3; ++i) {
+    if (0 == textures.get_name(stale[i])) {
+      num_detected++;
+    }
+  }
+
+  uint32_t num_alive = 0;
+  for (size_t i = 0; i < stale.size(); ++i) {
+    if (true == textures.is_alive(stale[i])) {
+      num_alive++;
+    }
+  }
+
+  printf("- Detected %u of 3 stale lookups, %u of %zu stale handles are alive, %llu stale uses counted.\n",
+         num_detected,
+         num_alive,
+         stale.size(),
+         (unsigned long long)textures.num_stale);
+
+  if (3 != num_detected || 0 != num_alive) {
+    printf("Stale handles weren't detected. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* The dense arrays must match the handles. */
+  if (textures.size() != num_textures || textures.names.size() != num_textures || textures.widths.size() != num_textures) {
+    printf("The pool isn't dense. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (uint32_t i = 0; i < textures.size(); ++i) {
+    if (textures.lookup(textures.get_handle(i)) != i) {
+      printf("The sparse and dense arrays are out of sync. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* Lookup latency. */
+  std::vector<uint32_t> order(num_lookups);
+  std::uniform_int_distribution<uint32_t> pick(0, num_textures - 1);
+  for (uint32_t i = 0; i < num_lookups; ++i) {
+    order[i] = pick(rng);
+  }
+
+  std::vector<GLuint> raw_names(num_textures);
+  for (uint32_t i = 0; i < num_textures; ++i) {
+    raw_names[i] = textures.get_name(handles[i]);
+  }
+
+  uint64_t checksum = 0;
+  uint64_t start = gpu_sync_now_ns();
+  for (uint32_t i = 0; i < num_lookups; ++i) {
+    uint32_t dense = textures.lookup(handles[order[i]]);
+    checksum += (uint64_t)textures.widths[dense];
+  }
+  uint64_t handle_ns = gpu_sync_now_ns() - start;
+
+  start = gpu_sync_now_ns();
+  for (uint32_t i = 0; i < num_lookups; ++i) {
+    checksum += (uint64_t)infos[raw_names[order[i]]].width;
+  }
+  uint64_t map_ns = gpu_sync_now_ns() - start;
+
+  /* Iterating over all live textures walks one dense array. */
+  uint64_t total_pixels = 0;
+  start = gpu_sync_now_ns();
+  for (uint32_t i = 0; i < textures.size(); ++i) {
+    total_pixels += (uint64_t)textures.widths[i] * (uint64_t)textures.heights[i];
+  }
+  uint64_t iterate_ns = gpu_sync_now_ns() - start;
+
+  printf("- Handle lookup: %.2f ns, unordered_map lookup: %.2f ns (checksum %llu).\n",
+         (double)handle_ns / num_lookups,
+         (double)map_ns / num_lookups,
+         (unsigned long long)checksum);
+  printf("- Iterated %u textures (%llu pixels) in %.3f ms.\n",
+         textures.size(),
+         (unsigned long long)total_pixels,
+         iterate_ns / 1e6);
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
@@ -0,0 +1,295 @@
+/*
+
+  MEMORY MONITOR
+  ===============
+
+  Checks the budget pressure callbacks of the `GlMemoryMonitor`
+  (see `gl-memory-monitor.h`) with a small texture cache:
+
+  - the cache creates 1 MB textures, more than the budget allows,
+    and evicts the oldest ones when the monitor asks for it; the
+    tracked usage must stay below the budget and the current,
+    peak and evicted bytes must add up. We call `poll()` ourselves
+    before every texture so this doesn't depend on timing.
+
+  - the driver reports that another process uses almost all
+    memory; we must get a critical pressure event although our
+    own usage is low, and an event when it's back to normal. This
+    part runs on the monitor thread (`start()`).
+
+  - removing more than is tracked fails and leaves the totals
+    alone, and RGB float formats are counted with their real
+    texel size.
+
+  llvmpipe has no `GL_NVX_gpu_memory_info`, so we use a stand-in
+  layer: after glad has been loaded we mark the extension as
+  supported and replace `glad_glGetIntegerv` with a function that
+  answers the NVX queries and passes everything else to the
+  driver.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <gl-context.h>
+#include <gl-memory-monitor.h>
+#include <gl-resource.h>
+#include <gl-sync.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const GLint fake_dedicated_kb = 1024 * 1024;
+static const uint64_t budget_bytes = 64ull * 1024ull * 1024ull;
+static const GLsizei texture_size = 512;
+static const uint32_t num_textures = 200;
+
+/* ----------------------------------------------------------- */
+
+static std::atomic<GLint> fake_other_kb{0};        /* What "other processes" use. */
+static PFNGLGETINTEGERVPROC driver_glGetIntegerv = nullptr;
+
+/* ----------------------------------------------------------- */
+
+static int install_fake_nvx_layer();
+static bool wait_for_pressure(std::atomic<int>& pressure, MemoryPressure expected);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the memory monitor.\n");
+
+  if (0 != install_fake_nvx_layer()) {
+    printf("Failed to install the fake NVX layer. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  std::atomic<uint64_t> requested_bytes{0};
+  std::atomic<uint32_t> num_warnings{0};
+  std::atomic<uint32_t> num_criticals{0};
+  std::atomic<int> last_pressure{MEMORY_PRESSURE_NONE};
+
+  GlMemoryMonitor monitor;
+  monitor.budget_bytes = budget_bytes;
+  monitor.poll_interval_ns = 2ull * 1000ull * 1000ull;
+  monitor.on_pressure = [&](const MemoryPressureEvent& ev) {
+
+    if (MEMORY_PRESSURE_WARNING == ev.pressure) {
+      num_warnings++;
+    }
+    else if (MEMORY_PRESSURE_CRITICAL == ev.pressure) {
+      num_criticals++;
+    }
+
+    last_pressure = ev.pressure;
+
+    /* The cache evicts on its own thread. */
+    uint64_t prev = requested_bytes.load();
+    while (ev.bytes_to_free > prev && false == requested_bytes.compare_exchange_weak(prev, ev.bytes_to_free)) {
+    }
+  };
+
+  GlContext main;
+
+  if (0 != create_shared_context(nullptr, main)) {
+    printf("Failed to create the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* Phase 1: the texture cache fills up and evicts when asked; we poll ourselves, so `on_pressure` runs on this thread. */
+  std::deque<GLuint> cache;
+  uint64_t texture_bytes = memory_texture_bytes(GL_RGBA8, texture_size, texture_size, 1, 1);
+  uint64_t num_evicted = 0;
+
+  auto evict = [&]() {
+
+    int64_t to_free = (int64_t)requested_bytes.exchange(0);
+
+    while (to_free > 0 && false == cache.empty()) {
+      GLuint tex = cache.front();
+      cache.pop_front();
+      glDeleteTextures(1, &tex);
+      monitor.evict(MEMORY_TEXTURE, texture_bytes);
+      to_free -= (int64_t)texture_bytes;
+      num_evicted++;
+    }
+  };
+
+  for (uint32_t i = 0; i < num_textures; ++i) {
+
+    monitor.poll();
+    evict();
+
+    GLuint tex = 0;
+    if (0 != gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, texture_size, texture_size, 0, tex)) {
+      printf("Failed to create texture %u. (exiting).\n", i);
+      exit(EXIT_FAILURE);
+    }
+
+    cache.push_back(tex);
+    monitor.add(MEMORY_TEXTURE, texture_bytes);
+  }
+
+  /* Let the monitor see that we're back below the warning level. */
+  monitor.poll();
+  evict();
+  monitor.poll();
+
+  GpuMemoryStats cache_stats;
+  monitor.get_stats(cache_stats);
+  uint64_t cache_bytes = cache.size() * texture_bytes;
+  uint32_t num_cache_criticals = num_criticals.load();
+
+  /* Removing more than is tracked (e.g. a texture that was already removed) must not wrap the totals around. */
+  bool is_over_remove_rejected = (0 != monitor.remove(MEMORY_BUFFER, texture_bytes));
+  GpuMemoryStats over_remove_stats;
+  monitor.get_stats(over_remove_stats);
+
+  /* Phase 2: the monitor thread polls; its context shares with `main`, which may not be current while it starts. */
+  if (0 != release_current_context()) {
+    printf("Failed to release the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != monitor.start(&main)) {
+    printf("Failed to start the memory monitor. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* Another process uses 97% of the memory, then frees it again. */
+  fake_other_kb = (GLint)(fake_dedicated_kb * 0.97);
+  bool is_critical = wait_for_pressure(last_pressure, MEMORY_PRESSURE_CRITICAL);
+
+  GpuMemoryStats driver_stats;
+  monitor.get_stats(driver_stats);
+
+  fake_other_kb = 0;
+  bool is_relieved = wait_for_pressure(last_pressure, MEMORY_PRESSURE_NONE);
+
+  if (0 != monitor.shutdown()) {
+    printf("Failed to shutdown the memory monitor. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  monitor.print();
+
+  while (false == cache.empty()) {
+    GLuint tex = cache.front();
+    cache.pop_front();
+    glDeleteTextures(1, &tex);
+    monitor.remove(MEMORY_TEXTURE, texture_bytes);
+  }
+
+  GpuMemoryStats end_stats;
+  monitor.get_stats(end_stats);
+
+  printf("- Cache: created %u, evicted %llu, %u warnings, %u critical.\n",
+         num_textures,
+         (unsigned long long)num_evicted,
+         num_warnings.load(),
+         num_cache_criticals);
+
+  bool is_ok = true;
+  is_ok &= check(MEMORY_SOURCE_NVX == cache_stats.source, "the (fake) NVX extension was used");
+  is_ok &= check(num_warnings.load() > 0, "the cache got warnings");
+  is_ok &= check(num_evicted > 0, "the cache evicted textures");
+  is_ok &= check(cache_stats.total_peak_bytes <= budget_bytes, "the tracked usage stayed within the budget");
+  is_ok &= check(cache_stats.total_current_bytes == cache_bytes, "the tracked usage matches the textures in the cache");
+  is_ok &= check(cache_stats.evicted_bytes[MEMORY_TEXTURE] == num_evicted * texture_bytes, "the evicted bytes add up");
+  is_ok &= check(MEMORY_PRESSURE_NONE == cache_stats.pressure, "the pressure was relieved by evicting");
+  is_ok &= check(true == is_over_remove_rejected, "removing more than is tracked fails");
+  is_ok &= check(over_remove_stats.total_current_bytes == cache_bytes, "a rejected remove leaves the totals alone");
+  is_ok &= check(12ull * 16 * 16 == memory_texture_bytes(GL_RGB32F, 16, 16, 1, 1), "GL_RGB32F is 12 bytes per texel");
+  is_ok &= check(6ull * 16 * 16 == memory_texture_bytes(GL_RGB16F, 16, 16, 1, 1), "GL_RGB16F is 6 bytes per texel");
+  is_ok &= check(true == is_critical, "the driver pressure raised a critical event");
+  is_ok &= check(driver_stats.driver_total_bytes == (uint64_t)fake_dedicated_kb * 1024ull, "the driver total was read");
+  is_ok &= check(driver_stats.ratio >= 0.95, "the driver usage sets the ratio");
+  is_ok &= check(true == is_relieved, "an event was raised when the pressure was gone");
+  is_ok &= check(0 == end_stats.total_current_bytes, "everything was removed");
+
+  if (0 != destroy_main_context(main)) {
+    printf("Failed to destroy the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (false == is_ok) {
+    printf("The memory monitor test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static void APIENTRY fake_glGetIntegerv(GLenum pname, GLint* data) {
+
+  switch (pname) {
+    case GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX:         { *data = fake_dedicated_kb;                        return; }
+    case GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX:   { *data = fake_dedicated_kb;                        return; }
+    case GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX: { *data = fake_dedicated_kb - fake_other_kb.load(); return; }
+    case GL_GPU_MEMORY_INFO_EVICTION_COUNT_NVX:           { *data = 0;                                        return; }
+    case GL_GPU_MEMORY_INFO_EVICTED_MEMORY_NVX:           { *data = 0;                                        return; }
+  }
+
+  driver_glGetIntegerv(pname, data);
+}
+
+/* glad is loaded once; see _test-share-group.cpp_. */
+static int install_fake_nvx_layer() {
+
+  GlContext loader;
+
+  if (0 != create_shared_context(nullptr, loader)
+      || 0 != make_context_current(loader))
+    {
+      printf("Failed to create the context that loads the GL functions.\n");
+      destroy_main_context(loader);
+      return -1;
+    }
+
+  driver_glGetIntegerv = glad_glGetIntegerv;
+  glad_glGetIntegerv = fake_glGetIntegerv;
+  GLAD_GL_NVX_gpu_memory_info = 1;
+
+  if (0 != destroy_main_context(loader)) {
+    printf("Failed to destroy the context that loaded the GL functions.\n");
+    return -2;
+  }
+
+  return 0;
+}
+
+/* ----------------------------------------------------------- */
+
+static bool wait_for_pressure(std::atomic<int>& pressure, MemoryPressure expected) {
+
+  uint64_t deadline = gpu_sync_now_ns() + 2000ull * 1000ull * 1000ull;
+
+  while (gpu_sync_now_ns() < deadline) {
+    if (expected == pressure.load()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  return false;
+}
+
+/* ----------------------------------------------------------- */
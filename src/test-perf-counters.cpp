@@ -0,0 +1,231 @@
+/*
+
+  PERF COUNTERS
+  ==============
+
+  Tests the collection of the `GlPerfCounters` (see
+  `gl-perf-counters.h`) with the mock backend, so it runs without
+  a GPU and without a context (llvmpipe has neither
+  `GL_INTEL_performance_query` nor `GL_AMD_performance_monitor`).
+  The test checks that:
+
+  - only existing counters can be selected, and only before the
+    first frame; with INTEL, a name that is in several queries
+    selects the counter of the query that is already selected;
+  - scopes need a name, can't be nested and must be closed
+    before the frame ends;
+  - every frame is reported once, in order, without blocking,
+    with the values of the selected counters per scope;
+  - frames are dropped (not waited for) when the results arrive
+    later than we have frames in flight.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <gl-perf-counters.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_frames = 100;
+static const char* scope_names[] = { "shadows", "opaque", "post" };
+static const uint32_t num_scopes = 3;
+
+/* ----------------------------------------------------------- */
+
+static int run_frames(GlPerfCounters& counters, uint32_t num);
+static bool check_report(GlPerfCounters& counters, const PerfReport& report);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the perf counters.\n");
+
+  bool is_ok = true;
+
+  /* Phase 1: results arrive one frame later; nothing is dropped. */
+  GlPerfCounters counters;
+  std::vector<uint64_t> reported;
+  bool is_report_ok = true;
+
+  counters.on_report = [&](const PerfReport& report) {
+    reported.push_back(report.frame);
+    is_report_ok &= check_report(counters, report);
+  };
+
+  if (0 != counters.init(PERF_BACKEND_MOCK)) {
+    printf("Failed to initialize the perf counters. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- The mock backend offers %zu counters.\n", counters.counters.size());
+
+  is_ok &= check(0 != counters.select("Not A Counter"), "an unknown counter can't be selected");
+  is_ok &= check(0 != counters.begin_frame(), "a frame can't begin without counters");
+  is_ok &= check(0 == counters.select("Vertices Shaded"), "selected `Vertices Shaded`");
+  is_ok &= check(0 == counters.select("GPU Busy"), "selected `GPU Busy`");
+  is_ok &= check(0 == counters.select("GPU Busy"), "selecting a counter twice is fine");
+  is_ok &= check(2 == counters.selected.size(), "two counters are selected");
+
+  if (0 != counters.begin_frame()) {
+    printf("Failed to begin the first frame. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  is_ok &= check(0 != counters.select("Texture Reads"), "counters can't be selected once the frame began");
+  is_ok &= check(0 == counters.begin_scope("outer"), "began a scope");
+  is_ok &= check(0 != counters.begin_scope("inner"), "scopes can't be nested");
+  is_ok &= check(0 != counters.end_frame(), "a frame can't end with an open scope");
+  is_ok &= check(0 == counters.end_scope(), "ended the scope");
+  is_ok &= check(0 != counters.end_scope(), "a scope can't be ended twice");
+  is_ok &= check(0 != counters.begin_scope(nullptr), "a scope needs a name");
+  is_ok &= check(0 == counters.end_frame(), "ended the first frame");
+
+  /* The first frame had one scope; its report is checked with the rest. */
+  if (0 != run_frames(counters, num_frames - 1)) {
+    printf("Failed to run the frames. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* Both pools are in flight; the next two frames collect them. */
+  uint64_t num_in_flight = counters.frame_number - counters.num_collected;
+  run_frames(counters, 2);
+
+  counters.print();
+
+  bool is_in_order = true;
+  for (size_t i = 0; i < reported.size(); ++i) {
+    is_in_order &= (reported[i] == i);
+  }
+
+  is_ok &= check(2 == num_in_flight, "two frames were in flight");
+  is_ok &= check(num_frames == reported.size(), "every frame was reported");
+  is_ok &= check(true == is_in_order, "the frames were reported in order");
+  is_ok &= check(true == is_report_ok, "the reported values match the scopes and counters");
+  is_ok &= check(0 == counters.num_dropped, "no frames were dropped");
+  is_ok &= check(num_frames - 1 == counters.last_report.frame, "the last report is the last recorded frame");
+
+  counters.shutdown();
+
+  /* Phase 2: results arrive later than we have frames in flight. */
+  GlPerfCounters slow;
+  slow.mock_latency_frames = 2;
+
+  if (0 != slow.init(PERF_BACKEND_MOCK, 2)
+      || 0 != slow.select("GPU Time"))
+    {
+      printf("Failed to initialize the slow perf counters. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+  if (0 != run_frames(slow, num_frames)) {
+    printf("Failed to run the slow frames. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- Slow counters: collected %llu, dropped %llu.\n",
+         (unsigned long long)slow.num_collected,
+         (unsigned long long)slow.num_dropped);
+
+  is_ok &= check(slow.num_dropped > 0, "frames were dropped instead of waited for");
+  is_ok &= check(0 == slow.num_collected, "no frame was collected when all were too late");
+
+  slow.shutdown();
+
+  is_ok &= check(0 != slow.init(PERF_BACKEND_MOCK, 1), "at least two frames are needed");
+
+  /* Phase 3: INTEL counters with the same name in two queries; `select()` doesn't call GL, so we fill the counters ourselves. */
+  GlPerfCounters intel;
+  intel.backend = PERF_BACKEND_INTEL;
+  intel.counters.resize(4);
+  intel.counters[0].name = "GPU Time";
+  intel.counters[0].group = "Render Basic";
+  intel.counters[0].group_id = 1;
+  intel.counters[1].name = "EU Active";
+  intel.counters[1].group = "Render Basic";
+  intel.counters[1].group_id = 1;
+  intel.counters[2].name = "GPU Time";
+  intel.counters[2].group = "Compute Basic";
+  intel.counters[2].group_id = 2;
+  intel.counters[3].name = "EU Stall";
+  intel.counters[3].group = "Compute Basic";
+  intel.counters[3].group_id = 2;
+
+  is_ok &= check(0 == intel.select("EU Stall"), "selected `EU Stall` of the second query");
+  is_ok &= check(0 == intel.select("GPU Time"), "a counter that is also in another query can be selected");
+  is_ok &= check(2 == intel.selected.size() && 2 == intel.selected[1], "the counter of the selected query was picked");
+  is_ok &= check(-3 == intel.select("EU Active"), "a counter of another query can't be selected");
+
+  if (false == is_ok) {
+    printf("The perf counters test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static int run_frames(GlPerfCounters& counters, uint32_t num) {
+
+  for (uint32_t i = 0; i < num; ++i) {
+
+    if (0 != counters.begin_frame()) {
+      return -1;
+    }
+
+    for (uint32_t s = 0; s < num_scopes; ++s) {
+      if (0 != counters.begin_scope(scope_names[s])
+          || 0 != counters.end_scope())
+        {
+          return -2;
+        }
+    }
+
+    if (0 != counters.end_frame()) {
+      return -3;
+    }
+  }
+
+  return 0;
+}
+
+/* The first frame has one scope; the others have `num_scopes`. */
+static bool check_report(GlPerfCounters& counters, const PerfReport& report) {
+
+  size_t expected_scopes = (0 == report.frame) ? 1 : num_scopes;
+  size_t num_counters = counters.selected.size();
+
+  if (expected_scopes != report.scopes.size()
+      || num_counters != report.counters.size()
+      || expected_scopes * num_counters != report.values.size())
+    {
+      printf("Frame %llu has an unexpected number of scopes or values.\n", (unsigned long long)report.frame);
+      return false;
+    }
+
+  for (size_t s = 0; s < report.scopes.size(); ++s) {
+    for (size_t c = 0; c < num_counters; ++c) {
+
+      double expected = (double)(report.frame * 1000 + s * 10 + counters.selected[c]);
+      if (expected != report.values[s * num_counters + c]) {
+        printf("Frame %llu, scope `%s`, counter `%s` has %f, expected %f.\n",
+               (unsigned long long)report.frame,
+               report.scopes[s],
+               report.counters[c],
+               report.values[s * num_counters + c],
+               expected);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/* ----------------------------------------------------------- */
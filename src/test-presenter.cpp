@@ -0,0 +1,325 @@
+/*
+
+  PRESENTER
+  ==========
+
+  Tests the frame pacing of the `GlPresenter` (see
+  `gl-presenter.h`) against a simulated 60 Hz display whose
+  vblanks are 5 ms off from where the presenter first expects
+  them. Every frame takes 4 ms on the CPU and 4 ms on the GPU.
+  The test checks that:
+
+  - with vsync the frames are shown one refresh apart, none are
+    missed once the presenter locked onto the vblanks;
+  - the just in time start (`is_low_latency`) cuts the latency
+    without missing vblanks;
+  - `wait_before_swap()` returns `margin_ns` before the vblank;
+  - an interval of 2 shows a frame every other refresh;
+  - immediate swaps don't wait for the vblanks and tear;
+  - a slow frame (every 10th takes 14 ms on the GPU) is held
+    until the next vblank with vsync; with adaptive vsync it
+    tears instead, so it's shown earlier.
+
+  Then it presents a couple of frames with the driver to check
+  that the swap and the GPU timestamps are recorded.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <gl-context.h>
+#include <gl-presenter.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint64_t refresh_ns = 16666667;
+static const uint64_t phase_ns = 5000000;
+static const uint64_t cpu_ns = 4000000;
+static const uint64_t gpu_ns = 4000000;
+static const uint64_t slow_gpu_ns = 14000000;
+static const uint32_t num_frames = 120;
+static const uint32_t num_warmup_frames = 8;
+static const uint32_t slow_every = 10;
+
+/* ----------------------------------------------------------- */
+
+struct SimOptions {
+  PresentMode mode = PRESENT_MODE_VSYNC;
+  uint32_t interval = 1;
+  bool is_low_latency = false;
+  bool has_slow_frames = false;                /* Every `slow_every` frame takes `slow_gpu_ns` on the GPU. */
+  bool use_wait = false;                       /* Call `wait_before_swap()`. */
+  uint64_t margin_ns = 2000000;
+};
+
+struct SimResult {
+  std::vector<PresentTimings> frames;
+  uint64_t num_missed = 0;                     /* After the warmup. */
+  uint64_t num_torn = 0;
+  uint64_t total_latency_ns = 0;
+  uint64_t total_slow_latency_ns = 0;
+  uint64_t min_display_delta_ns = UINT64_MAX;
+  uint64_t max_display_delta_ns = 0;
+  uint64_t wait_error_ns = 0;                  /* The largest distance between `wait_before_swap()` and `target - margin`. */
+};
+
+/* ----------------------------------------------------------- */
+
+static int simulate(const SimOptions& opt, SimResult& result);
+static int present_with_driver();
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the presenter.\n");
+
+  SimOptions vsync_opt;
+
+  SimOptions low_latency_opt;
+  low_latency_opt.is_low_latency = true;
+
+  SimOptions late_latch_opt;
+  late_latch_opt.is_low_latency = true;
+  late_latch_opt.use_wait = true;
+  late_latch_opt.margin_ns = 6000000;
+
+  SimOptions interval2_opt;
+  interval2_opt.interval = 2;
+
+  SimOptions immediate_opt;
+  immediate_opt.mode = PRESENT_MODE_IMMEDIATE;
+  immediate_opt.interval = 0;
+
+  SimOptions slow_vsync_opt;
+  slow_vsync_opt.has_slow_frames = true;
+
+  SimOptions slow_adaptive_opt;
+  slow_adaptive_opt.mode = PRESENT_MODE_ADAPTIVE;
+  slow_adaptive_opt.has_slow_frames = true;
+
+  SimResult vsync;
+  SimResult low_latency;
+  SimResult late_latch;
+  SimResult interval2;
+  SimResult immediate;
+  SimResult slow_vsync;
+  SimResult slow_adaptive;
+
+  if (0 != simulate(vsync_opt, vsync)
+      || 0 != simulate(low_latency_opt, low_latency)
+      || 0 != simulate(late_latch_opt, late_latch)
+      || 0 != simulate(interval2_opt, interval2)
+      || 0 != simulate(immediate_opt, immediate)
+      || 0 != simulate(slow_vsync_opt, slow_vsync)
+      || 0 != simulate(slow_adaptive_opt, slow_adaptive))
+    {
+      printf("Failed to simulate the frames. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+  uint64_t num_measured = num_frames - num_warmup_frames;
+  uint64_t num_slow = num_measured / slow_every;
+  uint64_t tolerance_ns = 1000;
+
+  printf("- Latency: vsync %.2f ms, low latency %.2f ms, late latch %.2f ms.\n",
+         vsync.total_latency_ns / num_measured / 1e6,
+         low_latency.total_latency_ns / num_measured / 1e6,
+         late_latch.total_latency_ns / num_measured / 1e6);
+
+  printf("- Latency of the slow frames: vsync %.2f ms, adaptive %.2f ms.\n",
+         slow_vsync.total_slow_latency_ns / num_slow / 1e6,
+         slow_adaptive.total_slow_latency_ns / num_slow / 1e6);
+
+  bool is_ok = true;
+  is_ok &= check(0 == vsync.num_missed, "vsync: no missed frames");
+  is_ok &= check(0 == vsync.num_torn, "vsync: no torn frames");
+  is_ok &= check(vsync.min_display_delta_ns + tolerance_ns >= refresh_ns && vsync.max_display_delta_ns <= refresh_ns + tolerance_ns, "vsync: shown one refresh apart");
+  is_ok &= check(0 == low_latency.num_missed, "low latency: no missed frames");
+  is_ok &= check(low_latency.max_display_delta_ns <= refresh_ns + tolerance_ns, "low latency: shown one refresh apart");
+  is_ok &= check(low_latency.total_latency_ns + num_measured * refresh_ns / 4 < vsync.total_latency_ns, "low latency: the latency is lower");
+  is_ok &= check(0 == late_latch.num_missed, "late latch: no missed frames");
+  is_ok &= check(late_latch.max_display_delta_ns <= refresh_ns + tolerance_ns, "late latch: shown one refresh apart");
+  is_ok &= check(late_latch.wait_error_ns <= tolerance_ns, "late latch: `wait_before_swap()` returned `margin_ns` before the vblank");
+  is_ok &= check(0 == interval2.num_missed, "interval 2: no missed frames");
+  is_ok &= check(interval2.min_display_delta_ns + tolerance_ns >= 2 * refresh_ns && interval2.max_display_delta_ns <= 2 * refresh_ns + tolerance_ns, "interval 2: shown two refreshes apart");
+  is_ok &= check(immediate.max_display_delta_ns < refresh_ns, "immediate: doesn't wait for the vblank");
+  is_ok &= check(immediate.num_torn > 0, "immediate: tears");
+  is_ok &= check(slow_vsync.max_display_delta_ns + tolerance_ns >= 2 * refresh_ns && 0 == slow_vsync.num_torn, "vsync: slow frames are held until the next vblank");
+  is_ok &= check(num_slow == slow_adaptive.num_torn, "adaptive: only the slow frames tear");
+  is_ok &= check(slow_adaptive.total_slow_latency_ns < slow_vsync.total_slow_latency_ns, "adaptive: slow frames are shown earlier than with vsync");
+  is_ok &= check(0 == present_with_driver(), "presented with the driver");
+
+  if (false == is_ok) {
+    printf("The presenter test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static int simulate(const SimOptions& opt, SimResult& result) {
+
+  GlPresenter presenter;
+  presenter.sim.refresh_ns = refresh_ns;
+  presenter.sim.phase_ns = phase_ns;
+  presenter.is_low_latency = opt.is_low_latency;
+  presenter.margin_ns = opt.margin_ns;
+  presenter.on_frame = [&](const PresentTimings& timings) {
+    result.frames.push_back(timings);
+  };
+
+  if (0 != presenter.init(nullptr, PRESENT_BACKEND_SIMULATED)
+      || 0 != presenter.set_swap(opt.mode, opt.interval))
+    {
+      printf("Failed to initialize the simulated presenter.\n");
+      return -1;
+    }
+
+  for (uint32_t i = 0; i < num_frames; ++i) {
+
+    presenter.sim.gpu_ns = gpu_ns;
+    if (true == opt.has_slow_frames && 0 == (i % slow_every)) {
+      presenter.sim.gpu_ns = slow_gpu_ns;
+    }
+
+    if (0 != presenter.begin_frame()) {
+      return -2;
+    }
+
+    presenter.sim.now_ns += cpu_ns;
+
+    if (true == opt.use_wait) {
+
+      if (0 != presenter.wait_before_swap()) {
+        return -3;
+      }
+
+      uint64_t expected_ns = presenter.current.target_ns - presenter.margin_ns;
+      uint64_t error_ns = (presenter.sim.now_ns > expected_ns) ? presenter.sim.now_ns - expected_ns : expected_ns - presenter.sim.now_ns;
+
+      if (i >= num_warmup_frames && error_ns > result.wait_error_ns) {
+        result.wait_error_ns = error_ns;
+      }
+    }
+
+    if (0 != presenter.present()) {
+      return -4;
+    }
+  }
+
+  presenter.print();
+  presenter.shutdown();
+
+  for (uint32_t i = num_warmup_frames; i < result.frames.size(); ++i) {
+
+    const PresentTimings& timings = result.frames[i];
+    uint64_t latency_ns = timings.display_ns - timings.begin_ns;
+    uint64_t delta_ns = timings.display_ns - result.frames[i - 1].display_ns;
+
+    if (true == opt.has_slow_frames && 0 == (i % slow_every)) {
+      result.total_slow_latency_ns += latency_ns;
+    }
+
+    result.num_missed += (true == timings.is_missed) ? 1 : 0;
+    result.num_torn += (true == timings.is_torn) ? 1 : 0;
+    result.total_latency_ns += latency_ns;
+    result.min_display_delta_ns = (delta_ns < result.min_display_delta_ns) ? delta_ns : result.min_display_delta_ns;
+    result.max_display_delta_ns = (delta_ns > result.max_display_delta_ns) ? delta_ns : result.max_display_delta_ns;
+  }
+
+  return 0;
+}
+
+/* ----------------------------------------------------------- */
+
+/* On llvmpipe the swap of the 1x1 pbuffer doesn't wait for anything; we check the timestamps. */
+static int present_with_driver() {
+
+  GlContext ctx;
+  GlPresenter presenter;
+  std::vector<PresentTimings> frames;
+  int r = 0;
+
+  presenter.on_frame = [&](const PresentTimings& timings) {
+    frames.push_back(timings);
+  };
+
+  if (0 != create_shared_context(nullptr, ctx)
+      || 0 != make_context_current(ctx))
+    {
+      printf("Failed to create the context for the presenter.\n");
+      destroy_main_context(ctx);
+      return -1;
+    }
+
+  if (0 != presenter.init(&ctx)
+      || 0 != presenter.set_swap(PRESENT_MODE_IMMEDIATE))
+    {
+      printf("Failed to initialize the presenter.\n");
+      r = -2;
+      goto error;
+    }
+
+  for (uint32_t i = 0; i < 60; ++i) {
+
+    if (0 != presenter.begin_frame()) {
+      r = -3;
+      goto error;
+    }
+
+    glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (0 != presenter.present()) {
+      r = -4;
+      goto error;
+    }
+  }
+
+  glFinish();
+  presenter.collect();
+  presenter.print();
+
+  if (frames.size() != 60) {
+    printf("Expected 60 finished frames, got %zu.\n", frames.size());
+    r = -5;
+    goto error;
+  }
+
+  for (const PresentTimings& timings : frames) {
+    if (timings.begin_ns > timings.submit_ns
+        || timings.submit_ns > timings.swap_ns
+        || (0 != timings.gpu_ns && 0 == timings.display_ns))
+      {
+        printf("Frame %llu has timestamps out of order.\n", (unsigned long long)timings.frame);
+        r = -6;
+        goto error;
+      }
+  }
+
+  if (presenter.num_dropped >= 60) {
+    printf("None of the GPU timestamps were collected.\n");
+    r = -7;
+    goto error;
+  }
+
+ error:
+
+  presenter.shutdown();
+
+  if (0 != destroy_main_context(ctx)) {
+    printf("Failed to destroy the context of the presenter.\n");
+    r = -8;
+  }
+
+  return r;
+}
+
+/* ----------------------------------------------------------- */
@@ -0,0 +1,193 @@
+/*
+
+  QUEUE CONTENTION
+  =================
+
+  Measures the latency of our lock free queues (see
+  `spsc-queue.h` and `mpsc-queue.h`) with 1 - 16 producers and
+  one consumer. This doesn't need a GL context, so it runs on
+  any box.
+
+  For each run we print:
+
+  - enqueue: the time a `push()` takes, including the retries
+    when the queue was full.
+
+  - dequeue: the time between the start of the `push()` and the
+    moment the consumer popped the item.
+
+  The consumer also checks that every producer's items arrive in
+  order and that nothing got lost.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <spsc-queue.h>
+#include <mpsc-queue.h>
+#include <gl-sync.h>
+#include <step-timer.h>
+
+/* ----------------------------------------------------------- */
+
+struct Item {
+  uint64_t enqueue_ns = 0;
+  uint32_t producer = 0;
+  uint32_t seq = 0;
+};
+
+struct Result {
+  uint64_t total_ns = 0;
+  std::vector<uint64_t> enqueue_ns;
+  std::vector<uint64_t> dequeue_ns;
+  bool is_valid = true;
+};
+
+/* ----------------------------------------------------------- */
+
+static const size_t queue_capacity = 4096;
+static const uint32_t items_per_producer = 50000;
+static const size_t batch_size = 64;
+
+/* ----------------------------------------------------------- */
+
+static void print_result(const char* name, uint32_t num_producers, Result& result);
+template<typename Q> static Result run(Q& queue, uint32_t num_producers);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing queue contention.\n");
+  printf("%-6s %10s %10s %12s %12s %12s %12s\n", "queue", "producers", "Mitems/s", "enq p50 ns", "enq p99 ns", "deq p50 ns", "deq p99 ns");
+
+  {
+    SpscQueue<Item> queue;
+    if (0 != queue.init(queue_capacity)) {
+      printf("Failed to initialize the spsc queue. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+    Result result = run(queue, 1);
+    print_result("spsc", 1, result);
+    if (false == result.is_valid) {
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  const uint32_t producers[] = { 1, 2, 4, 8, 16 };
+  for (size_t i = 0; i < sizeof(producers) / sizeof(producers[0]); ++i) {
+    MpscQueue<Item> queue;
+    if (0 != queue.init(queue_capacity)) {
+      printf("Failed to initialize the mpsc queue. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+    Result result = run(queue, producers[i]);
+    print_result("mpsc", producers[i], result);
+    if (false == result.is_valid) {
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+template<typename Q>
+static Result run(Q& queue, uint32_t num_producers) {
+
+  Result result;
+  std::atomic<bool> go{false};
+  std::vector<std::thread> threads;
+  std::vector<std::vector<uint64_t>> enqueue_ns(num_producers);
+
+  uint64_t num_items = (uint64_t)items_per_producer * num_producers;
+  result.dequeue_ns.reserve(num_items);
+
+  for (uint32_t i = 0; i < num_producers; ++i) {
+    enqueue_ns[i].reserve(items_per_producer);
+    threads.push_back(std::thread([&queue, &go, &enqueue_ns, i]() {
+      while (false == go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      for (uint32_t j = 0; j < items_per_producer; ++j) {
+        Item item;
+        item.producer = i;
+        item.seq = j;
+        item.enqueue_ns = gpu_sync_now_ns();
+        while (false == queue.push(item)) {
+          std::this_thread::yield();
+        }
+        enqueue_ns[i].push_back(gpu_sync_now_ns() - item.enqueue_ns);
+      }
+    }));
+  }
+
+  std::vector<uint32_t> next_seq(num_producers, 0);
+  Item items[batch_size];
+  uint64_t num_popped = 0;
+  uint64_t start = gpu_sync_now_ns();
+
+  go.store(true, std::memory_order_release);
+
+  while (num_popped < num_items) {
+
+    size_t n = queue.pop_batch(items, batch_size);
+    if (0 == n) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    uint64_t now = gpu_sync_now_ns();
+    for (size_t i = 0; i < n; ++i) {
+      Item& item = items[i];
+      if (item.producer >= num_producers || item.seq != next_seq[item.producer]) {
+        printf("Invalid item; producer: %u, seq: %u.\n", item.producer, item.seq);
+        result.is_valid = false;
+      }
+      else {
+        next_seq[item.producer]++;
+      }
+      result.dequeue_ns.push_back(now - item.enqueue_ns);
+    }
+
+    num_popped += n;
+  }
+
+  result.total_ns = gpu_sync_now_ns() - start;
+
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].join();
+    result.enqueue_ns.insert(result.enqueue_ns.end(), enqueue_ns[i].begin(), enqueue_ns[i].end());
+  }
+
+  return result;
+}
+
+/* ----------------------------------------------------------- */
+
+static void print_result(const char* name, uint32_t num_producers, Result& result) {
+
+  double seconds = result.total_ns / 1e9;
+  double mitems = (0.0 == seconds) ? 0.0 : (result.dequeue_ns.size() / seconds) / 1e6;
+  TimerStats enqueue_stats;
+  TimerStats dequeue_stats;
+
+  step_timer_get_stats(result.enqueue_ns, enqueue_stats);
+  step_timer_get_stats(result.dequeue_ns, dequeue_stats);
+
+  printf("%-6s %10u %10.2f %12llu %12llu %12llu %12llu%s\n",
+         name,
+         num_producers,
+         mitems,
+         (unsigned long long)enqueue_stats.median_ns,
+         (unsigned long long)enqueue_stats.p99_ns,
+         (unsigned long long)dequeue_stats.median_ns,
+         (unsigned long long)dequeue_stats.p99_ns,
+         (true == result.is_valid) ? "" : " (INVALID)");
+}
+
+/* ----------------------------------------------------------- */
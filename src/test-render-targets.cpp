@@ -0,0 +1,288 @@
+/*
+
+  RENDER TARGETS
+  ===============
+
+  Tests the `GlRenderTargets` (see `gl-render-targets.h`) with the
+  passes of a batch renderer:
+
+    scene    -> 4x MSAA color + depth/stencil
+    resolve  -> blits the MSAA color into `color`
+    blur_h   -> reads `color`, writes `blur_h`
+    blur_v   -> reads `blur_h`, writes `blur_v`
+    tonemap  -> reads `blur_v`, writes the imported output
+
+  Each pass after the resolve adds a value to another channel so
+  the output shows that every pass read what the pass before
+  wrote. The test checks that:
+
+  - `blur_v` got the texture of `color` (it starts after `color`
+    ended), so 5 transient targets use 4 textures and less
+    memory than they would without aliasing;
+
+  - the output has the expected color;
+
+  - the next frames create no textures or framebuffers;
+
+  - after a resize the textures of the old size are deleted once
+    they weren't used for `max_unused_frames` frames.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <gl-context.h>
+#include <gl-resource.h>
+#include <gl-render-targets.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_frames = 10;
+
+static const char* fs = ""
+  "#version 330\n"
+  "uniform sampler2D u_src;\n"
+  "uniform vec4 u_add;\n"
+  "layout(location = 0) out vec4 fragcolor;\n"
+  "void main() {\n"
+  "  fragcolor = texelFetch(u_src, ivec2(gl_FragCoord.xy), 0) + u_add;\n"
+  "}\n";
+
+/* ----------------------------------------------------------- */
+
+struct FrameResult {
+  GLuint color_texture = 0;
+  GLuint blur_v_texture = 0;
+  uint8_t pixel[4] = { 0 };
+};
+
+struct TestState {
+  GlRenderTargets targets;
+  GLuint prog = 0;
+  GLuint vao = 0;
+  GLint u_add = -1;
+};
+
+/* ----------------------------------------------------------- */
+
+static int render_frame(TestState& state, GLuint output, GLsizei size, FrameResult& result);
+static void draw(TestState& state, GLuint src, float r, float g, float b);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the render targets.\n");
+
+  GlContext ctx;
+
+  if (0 != create_shared_context(nullptr, ctx)) {
+    printf("Failed to create the context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != make_context_current(ctx)) {
+    printf("Failed to make the context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  TestState state;
+
+  state.prog = create_program(fullscreen_vs, fs);
+  if (0 == state.prog) {
+    printf("Failed to create the program. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  state.u_add = glGetUniformLocation(state.prog, "u_add");
+  glGenVertexArrays(1, &state.vao);
+
+  if (0 != state.targets.init()) {
+    printf("Failed to initialize the render targets. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GLuint outputs[2] = { 0 };
+  gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, 256, 256, 0, outputs[0]);
+  gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, 128, 128, 0, outputs[1]);
+
+  /* The first frame creates everything. */
+  FrameResult first;
+
+  if (0 != render_frame(state, outputs[0], 256, first)) {
+    printf("Failed to render the first frame. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  RenderTargetStats first_stats = state.targets.stats;
+  state.targets.print();
+
+  printf("- Output: %u %u %u.\n", first.pixel[0], first.pixel[1], first.pixel[2]);
+
+  /* The same passes again. */
+  FrameResult next;
+  bool are_frames_ok = true;
+
+  for (uint32_t i = 1; i < num_frames; ++i) {
+    are_frames_ok &= (0 == render_frame(state, outputs[0], 256, next));
+    are_frames_ok &= (next.blur_v_texture == first.blur_v_texture);
+  }
+
+  RenderTargetStats steady_stats = state.targets.stats;
+
+  /* Resize; the textures of the old size live until they weren't used for `max_unused_frames` frames. */
+  FrameResult resized;
+  uint64_t pool_after_resize = 0;
+
+  for (uint32_t i = 0; i <= state.targets.max_unused_frames; ++i) {
+
+    are_frames_ok &= (0 == render_frame(state, outputs[1], 128, resized));
+
+    if (0 == i) {
+      pool_after_resize = state.targets.stats.pool_bytes;
+    }
+  }
+
+  state.targets.print();
+
+  RenderTargetStats resized_stats = state.targets.stats;
+
+  bool is_pixel_ok = true;
+  const int expected[3] = { 51, 102, 153 };
+
+  for (int c = 0; c < 3; ++c) {
+    is_pixel_ok &= (abs((int)first.pixel[c] - expected[c]) <= 1);
+    is_pixel_ok &= (abs((int)resized.pixel[c] - expected[c]) <= 1);
+  }
+
+  bool is_ok = true;
+  is_ok &= check(true == are_frames_ok, "every frame was rendered");
+  is_ok &= check(first.blur_v_texture == first.color_texture, "`blur_v` aliases `color`");
+  is_ok &= check(5 == first_stats.num_targets && 4 == first_stats.num_resources, "5 transient targets use 4 textures");
+  is_ok &= check(first_stats.used_bytes < first_stats.requested_bytes, "aliasing uses less memory than one texture per target");
+  is_ok &= check(true == is_pixel_ok, "the output has the expected color");
+  is_ok &= check(steady_stats.num_created == first_stats.num_created, "the next frames created no textures");
+  is_ok &= check(steady_stats.num_framebuffers_created == first_stats.num_framebuffers_created, "the next frames created no framebuffers");
+  is_ok &= check(pool_after_resize > resized_stats.pool_bytes, "the pool kept the old textures right after the resize");
+  is_ok &= check(resized_stats.num_deleted == first_stats.num_created, "the old textures were deleted afterwards");
+  is_ok &= check(resized_stats.pool_bytes == resized_stats.used_bytes, "the pool only has what the frame uses");
+  is_ok &= check(GL_NO_ERROR == glGetError(), "no GL errors");
+
+  state.targets.shutdown();
+  glDeleteTextures(2, outputs);
+  glDeleteVertexArrays(1, &state.vao);
+  glDeleteProgram(state.prog);
+
+  release_current_context();
+
+  if (0 != destroy_main_context(ctx)) {
+    printf("Failed to destroy the context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (false == is_ok) {
+    printf("The render targets test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static int render_frame(TestState& state, GLuint output, GLsizei size, FrameResult& result) {
+
+  GlRenderTargets& rt = state.targets;
+
+  RenderTargetDesc msaa_color;
+  msaa_color.internal_format = GL_RGBA8;
+  msaa_color.width = size;
+  msaa_color.height = size;
+  msaa_color.samples = 4;
+
+  RenderTargetDesc msaa_depth = msaa_color;
+  msaa_depth.internal_format = GL_DEPTH24_STENCIL8;
+
+  RenderTargetDesc color_desc = msaa_color;
+  color_desc.samples = 0;
+
+  rt.begin_frame();
+
+  uint32_t scene = rt.add_pass("scene");
+  uint32_t resolve = rt.add_pass("resolve");
+  uint32_t blur_h = rt.add_pass("blur_h");
+  uint32_t blur_v = rt.add_pass("blur_v");
+  uint32_t tonemap = rt.add_pass("tonemap");
+
+  uint32_t scene_color = rt.create(msaa_color, "scene color");
+  uint32_t scene_depth = rt.create(msaa_depth, "scene depth");
+  uint32_t color = rt.create(color_desc, "color");
+  uint32_t blur_h_color = rt.create(color_desc, "blur_h");
+  uint32_t blur_v_color = rt.create(color_desc, "blur_v");
+  uint32_t out = rt.import(output, color_desc, "output");
+
+  int r = 0;
+  r |= rt.write(scene, scene_color, GL_COLOR_ATTACHMENT0);
+  r |= rt.write(scene, scene_depth, GL_DEPTH_STENCIL_ATTACHMENT);
+  r |= rt.read(resolve, scene_color);
+  r |= rt.write(resolve, color, GL_COLOR_ATTACHMENT0);
+  r |= rt.read(blur_h, color);
+  r |= rt.write(blur_h, blur_h_color, GL_COLOR_ATTACHMENT0);
+  r |= rt.read(blur_v, blur_h_color);
+  r |= rt.write(blur_v, blur_v_color, GL_COLOR_ATTACHMENT0);
+  r |= rt.read(tonemap, blur_v_color);
+  r |= rt.write(tonemap, out, GL_COLOR_ATTACHMENT0);
+
+  if (0 != r || 0 != rt.compile()) {
+    printf("Failed to declare the passes.\n");
+    return -1;
+  }
+
+  /* Scene */
+  rt.begin_pass(scene);
+  glClearColor(0.2f, 0.0f, 0.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  rt.end_pass(scene);
+
+  /* Resolve */
+  rt.begin_pass(resolve);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, rt.passes[scene].framebuffer);
+  glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  rt.end_pass(resolve);
+
+  /* Blurs and tonemap; they only add so we can check the result. */
+  rt.begin_pass(blur_h);
+  draw(state, rt.get_texture(color), 0.0f, 0.4f, 0.0f);
+  rt.end_pass(blur_h);
+
+  rt.begin_pass(blur_v);
+  draw(state, rt.get_texture(blur_h_color), 0.0f, 0.0f, 0.6f);
+  rt.end_pass(blur_v);
+
+  rt.begin_pass(tonemap);
+  draw(state, rt.get_texture(blur_v_color), 0.0f, 0.0f, 0.0f);
+  rt.end_pass(tonemap);
+
+  result.color_texture = rt.get_texture(color);
+  result.blur_v_texture = rt.get_texture(blur_v_color);
+
+  /* The output is still bound. */
+  glReadPixels(size / 2, size / 2, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, result.pixel);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  return rt.end_frame();
+}
+
+static void draw(TestState& state, GLuint src, float r, float g, float b) {
+  glUseProgram(state.prog);
+  glUniform4f(state.u_add, r, g, b, 0.0f);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, src);
+  glBindVertexArray(state.vao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+/* ----------------------------------------------------------- */
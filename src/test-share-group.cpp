@@ -0,0 +1,317 @@
+/*
+
+  SHARE GROUP
+  ============
+
+  Injects GPU resets into a `GlShareGroup` (see
+  `gl-share-group.h`) and measures how long it takes to notice
+  and recover from them, so we can track the recovery time in CI.
+
+  We can't make a driver reset on demand, so we use a stand-in
+  layer: after glad has been loaded we replace
+  `glad_glGetGraphicsResetStatus` with a function that returns the
+  status that we inject (once) and otherwise asks the driver. To
+  make sure the resources are really recreated from their CPU
+  copies we overwrite them before we inject the reset. After
+  each recovery we check that:
+
+  - the watchdog saw the status that we injected;
+  - the buffer and texture have the contents of their CPU copies;
+  - the second context of the group shares with the root.
+
+  Usage: test-share-group [num_iterations]
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gl-context.h>
+#include <gl-share-group.h>
+#include <gl-resource.h>
+#include <gl-sync.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const GLsizeiptr buffer_size = 64 * 1024;
+static const GLsizei texture_size = 256;
+static const uint64_t max_detect_ns = 2000ull * 1000ull * 1000ull;
+
+/* ----------------------------------------------------------- */
+
+static std::atomic<GLenum> injected_status{GL_NO_ERROR};
+static PFNGLGETGRAPHICSRESETSTATUSPROC driver_glGetGraphicsResetStatus = nullptr;
+
+/* ----------------------------------------------------------- */
+
+static int install_fake_reset_layer();
+static bool is_buffer_restored(GLuint buffer, const std::vector<uint8_t>& expected);
+static bool is_texture_restored(GLuint texture, const std::vector<uint8_t>& expected);
+static bool is_shared(GlContext& ctx, GLuint buffer, GLuint texture);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing GPU reset recovery of a share group.\n");
+
+  uint32_t num_iterations = (narg > 1) ? (uint32_t)atoi(arg[1]) : 20;
+  if (0 == num_iterations) {
+    num_iterations = 20;
+  }
+
+  if (0 != install_fake_reset_layer()) {
+    printf("Failed to install the fake reset layer. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<uint8_t> vertices(buffer_size);
+  std::vector<uint8_t> pixels(texture_size * texture_size * 4);
+  std::vector<uint8_t> zeros(buffer_size, 0);
+
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    vertices[i] = (uint8_t)(i * 7);
+  }
+
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    pixels[i] = (uint8_t)(i * 13 + 5);
+  }
+
+  StepTimer timer;
+  timer.name = "recover";
+
+  std::atomic<uint32_t> num_callbacks{0};
+
+  GlContext main;
+  GlContext other;
+  main.reset = CONTEXT_RESET_LOSE_CONTEXT;
+
+  GlShareGroup group;
+  group.poll_interval_ns = 1000ull * 1000ull;
+  group.timer = &timer;
+  std::atomic<GLenum> callback_status{GL_NO_ERROR};
+
+  group.on_reset = [&num_callbacks, &callback_status](GLenum status) {
+    callback_status = status;
+    num_callbacks++;
+  };
+
+  group.add_context(&main);
+  group.add_context(&other);
+
+  if (0 != group.create()) {
+    printf("Failed to create the share group. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GLint strategy = 0;
+  glGetIntegerv(GL_RESET_NOTIFICATION_STRATEGY, &strategy);
+  printf("- GL_RESET_NOTIFICATION_STRATEGY: 0x%04X (%s)\n",
+         strategy,
+         (GL_LOSE_CONTEXT_ON_RESET == strategy) ? "lose context on reset" : "no reset notification");
+
+  GLuint vbo = 0;
+  GLuint tex = 0;
+
+  if (0 != group.create_buffer(buffer_size, vertices.data(), GL_DYNAMIC_STORAGE_BIT, vbo)
+      || 0 != group.create_texture(GL_RGBA8, texture_size, texture_size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data(), tex))
+    {
+      printf("Failed to create the resources of the share group. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+  /* Nothing was injected yet, so nothing may be reported. */
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  bool is_ok = true;
+  is_ok &= check(false == group.is_lost(), "no reset without injection");
+  is_ok &= check(true == is_shared(other, vbo, tex), "the second context shares with the root");
+
+  const GLenum statuses[] = { GL_GUILTY_CONTEXT_RESET, GL_INNOCENT_CONTEXT_RESET, GL_UNKNOWN_CONTEXT_RESET };
+  uint32_t num_detected = 0;
+  uint32_t num_reported = 0;
+  uint32_t num_restored = 0;
+  uint32_t num_shared = 0;
+
+  for (uint32_t i = 0; i < num_iterations; ++i) {
+
+    /* What a reset would do to our data. */
+    gl_upload_buffer(vbo, 0, buffer_size, zeros.data());
+    glFinish();
+
+    GLenum status = statuses[i % 3];
+    uint64_t inject_ns = gpu_sync_now_ns();
+    injected_status = status;
+
+    while (false == group.is_lost() && gpu_sync_now_ns() - inject_ns < max_detect_ns) {
+      std::this_thread::yield();
+    }
+
+    if (false == group.is_lost()) {
+      printf("The watchdog didn't see the reset of iteration %u.\n", i);
+      break;
+    }
+
+    if (status == group.reset_status.load()) {
+      num_detected++;
+    }
+
+    timer.add("detect", group.lost_ns.load() - inject_ns);
+
+    if (0 != group.recover()) {
+      printf("Failed to recover the share group. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+    /* `recover()` joined the watchdog, so the callback has returned. */
+    if (status == callback_status.exchange(GL_NO_ERROR)) {
+      num_reported++;
+    }
+
+    if (true == is_buffer_restored(vbo, vertices)
+        && true == is_texture_restored(tex, pixels))
+      {
+        num_restored++;
+      }
+
+    if (true == is_shared(other, vbo, tex)) {
+      num_shared++;
+    }
+  }
+
+  printf("- Detected %u, restored %u and shared %u of %u resets, %u callbacks.\n",
+         num_detected,
+         num_restored,
+         num_shared,
+         num_iterations,
+         num_callbacks.load());
+
+  timer.print();
+
+  is_ok &= check(num_iterations == num_detected, "the watchdog saw every injected status");
+  is_ok &= check(num_iterations == num_callbacks.load(), "`on_reset` was called for every reset");
+  is_ok &= check(num_iterations == num_reported, "`on_reset` got the injected status");
+  is_ok &= check(num_iterations == group.num_recoveries, "every reset was recovered");
+  is_ok &= check(num_iterations == num_restored, "the resources were recreated from their CPU copies");
+  is_ok &= check(num_iterations == num_shared, "the recreated contexts share");
+  is_ok &= check(false == group.is_lost(), "the group isn't lost after recovering");
+
+  if (0 != group.destroy_resource(vbo)
+      || 0 != group.destroy_resource(tex)
+      || 0 != group.destroy())
+    {
+      printf("Failed to cleanly destroy the share group. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+  if (false == is_ok) {
+    printf("The share group test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static GLenum APIENTRY fake_glGetGraphicsResetStatus() {
+
+  GLenum status = injected_status.exchange(GL_NO_ERROR);
+  if (GL_NO_ERROR != status) {
+    return status;
+  }
+
+  if (nullptr != driver_glGetGraphicsResetStatus) {
+    return driver_glGetGraphicsResetStatus();
+  }
+
+  return GL_NO_ERROR;
+}
+
+/*
+  glad is loaded once, the first time a context is made current,
+  so we use a throwaway context to load it and replace the
+  pointer before the watchdog thread exists.
+*/
+static int install_fake_reset_layer() {
+
+  GlContext loader;
+
+  if (0 != create_shared_context(nullptr, loader)
+      || 0 != make_context_current(loader))
+    {
+      printf("Failed to create the context that loads the GL functions.\n");
+      destroy_main_context(loader);
+      return -1;
+    }
+
+  driver_glGetGraphicsResetStatus = glad_glGetGraphicsResetStatus;
+  glad_glGetGraphicsResetStatus = fake_glGetGraphicsResetStatus;
+
+  if (0 != destroy_main_context(loader)) {
+    printf("Failed to destroy the context that loaded the GL functions.\n");
+    return -2;
+  }
+
+  return 0;
+}
+
+/* ----------------------------------------------------------- */
+
+static bool is_buffer_restored(GLuint buffer, const std::vector<uint8_t>& expected) {
+
+  std::vector<uint8_t> data(expected.size(), 0);
+
+  if (0 == buffer
+      || 0 != gl_download_buffer(buffer, 0, (GLsizeiptr)data.size(), data.data()))
+    {
+      return false;
+    }
+
+  return 0 == memcmp(data.data(), expected.data(), data.size());
+}
+
+static bool is_texture_restored(GLuint texture, const std::vector<uint8_t>& expected) {
+
+  std::vector<uint8_t> data(expected.size(), 0);
+
+  if (0 == texture) {
+    return false;
+  }
+
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  return 0 == memcmp(data.data(), expected.data(), data.size());
+}
+
+/* Checks on another thread that `ctx` sees the objects of the root. */
+static bool is_shared(GlContext& ctx, GLuint buffer, GLuint texture) {
+
+  bool result = false;
+
+  std::thread thread([&]() {
+
+    if (0 != make_context_current(ctx)) {
+      return;
+    }
+
+    result = (GL_TRUE == glIsBuffer(buffer) && GL_TRUE == glIsTexture(texture));
+
+    release_current_context();
+  });
+
+  thread.join();
+
+  return result;
+}
+
+/* ----------------------------------------------------------- */
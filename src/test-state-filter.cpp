@@ -0,0 +1,292 @@
+/*
+
+  STATE FILTER
+  =============
+
+  Tests the redundant state change filter (see
+  `gl-state-filter.h`) without a GPU: we replace the glad
+  function pointers with functions that record the state of a
+  fake driver context. The test checks that:
+
+  - redundant calls are dropped and the others reach the driver;
+  - the fake driver always ends up in the state that the app
+    asked for;
+  - each context has its own shadow;
+  - the shadow is invalidated when the context is made current
+    on another thread, or when we invalidate it by hand after
+    somebody called the driver behind the filter's back;
+  - a delete on another context of the share group makes the
+    bindings unknown, so a reused name reaches the driver.
+
+  It also prints how many calls of a typical sorted draw loop
+  were filtered.
+
+ */
+#define GL_STATE_FILTER 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <gl-state-filter.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+struct FakeDriver {
+  GLuint program = 0;
+  GLuint vertex_array = 0;
+  GLuint array_buffer = 0;
+  GLuint active_texture = 0;
+  GLuint textures[STATE_MAX_TEXTURE_UNITS] = { 0 };
+  bool is_depth_test_enabled = false;
+  GLenum blend_src = GL_ONE;
+  GLenum blend_dst = GL_ZERO;
+  GLint viewport[4] = { 0 };
+  uint64_t num_calls = 0;
+};
+
+struct FakeContext {
+  GlStateShadow state;
+  FakeDriver driver;
+};
+
+/* ----------------------------------------------------------- */
+
+static thread_local FakeDriver* driver = nullptr;
+
+/* ----------------------------------------------------------- */
+
+static void make_fake_current(FakeContext* ctx);
+static void install_fake_driver();
+static void render(uint32_t num_draws);
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_draws = 10000;
+static const uint32_t num_programs = 8;
+static const uint32_t draws_per_texture = 25;
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the state filter.\n");
+
+  install_fake_driver();
+
+  FakeContext a;
+  FakeContext b;
+  bool is_ok = true;
+
+  /* A sorted draw loop. */
+  make_fake_current(&a);
+  render(num_draws);
+
+  GlStateFilterStats stats = a.state.stats;
+  printf("- Draw loop: %llu calls, %llu filtered (%.1f%%), %llu reached the driver.\n",
+         (unsigned long long)stats.num_calls,
+         (unsigned long long)stats.num_filtered,
+         (0 == stats.num_calls) ? 0.0 : (100.0 * stats.num_filtered) / stats.num_calls,
+         (unsigned long long)a.driver.num_calls);
+
+  is_ok &= check(stats.num_filtered > 0, "redundant calls are filtered");
+  is_ok &= check(a.driver.num_calls == stats.num_calls - stats.num_filtered, "unfiltered calls reach the driver");
+  is_ok &= check(a.driver.program == (num_draws - 1) * num_programs / num_draws + 1, "the driver has the last program");
+
+  /* Each context has its own shadow; binding the same program in `b` must reach b's driver. */
+  glUseProgram(42);
+  make_fake_current(&b);
+  glUseProgram(42);
+  is_ok &= check(42 == b.driver.program, "each context has its own shadow");
+  make_fake_current(&a);
+  glUseProgram(42);
+  is_ok &= check(1 == a.state.stats.num_invalidations, "switching contexts on the same thread keeps the shadow");
+
+  /* Somebody calls the driver behind our back; invalidating by hand fixes it. */
+  glad_glUseProgram(7);
+  glUseProgram(42);
+  is_ok &= check(7 == a.driver.program, "a call behind the filter's back is not noticed");
+  gl_state_filter_invalidate();
+  glUseProgram(42);
+  is_ok &= check(42 == a.driver.program, "an invalidated shadow passes the call");
+
+  /* Migrate `a` to another thread. */
+  make_fake_current(nullptr);
+
+  uint64_t num_driver_calls = a.driver.num_calls;
+  uint64_t num_invalidations = a.state.stats.num_invalidations;
+
+  std::thread thread([&a]() {
+    make_fake_current(&a);
+    glUseProgram(42);
+    glEnable(GL_DEPTH_TEST);
+    make_fake_current(nullptr);
+  });
+  thread.join();
+
+  is_ok &= check(a.state.stats.num_invalidations == num_invalidations + 1, "making current on another thread invalidates");
+  is_ok &= check(a.driver.num_calls == num_driver_calls + 2, "the first calls after migrating reach the driver");
+
+  /* Deleting a bound object resets the binding. */
+  make_fake_current(&a);
+  glBindBuffer(GL_ARRAY_BUFFER, 3);
+  GLuint deleted = 3;
+  glDeleteBuffers(1, &deleted);
+  glBindBuffer(GL_ARRAY_BUFFER, 3);
+  is_ok &= check(3 == a.driver.array_buffer, "deleting a bound buffer resets the shadow");
+
+  /* `c` shares with `a` (like `create_main_context()` links them); `a` keeps the deleted buffer bound, so binding its reused name must reach a's driver. */
+  FakeContext c;
+  gl_state_filter_share(&c.state, &a.state);
+
+  glUseProgram(42);
+  glBindBuffer(GL_ARRAY_BUFFER, 5);
+  make_fake_current(&c);
+  deleted = 5;
+  glDeleteBuffers(1, &deleted);
+  make_fake_current(&a);
+
+  num_driver_calls = a.driver.num_calls;
+  glBindBuffer(GL_ARRAY_BUFFER, 5);
+  is_ok &= check(a.driver.num_calls == num_driver_calls + 1, "a name deleted on another context of the share group reaches the driver");
+  is_ok &= check(1 == a.state.stats.num_delete_resets, "a delete on another context resets the bindings once");
+
+  glUseProgram(42);
+  is_ok &= check(a.driver.num_calls == num_driver_calls + 1, "a delete on another context keeps the other state");
+
+  glBindBuffer(GL_ARRAY_BUFFER, 5);
+  is_ok &= check(a.driver.num_calls == num_driver_calls + 1, "after the reset the bindings are filtered again");
+
+  make_fake_current(&b);
+  glBindBuffer(GL_ARRAY_BUFFER, 5);
+  is_ok &= check(0 == b.state.stats.num_delete_resets, "a delete in another share group is ignored");
+  make_fake_current(nullptr);
+
+  if (false == is_ok) {
+    printf("The state filter test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+/* Draws are sorted by program and then by texture; the rest of the state is the same for every draw. */
+static void render(uint32_t n) {
+
+  for (uint32_t i = 0; i < n; ++i) {
+
+    GLuint program = i * num_programs / n + 1;
+    GLuint texture = i / draws_per_texture + 1;
+
+    glViewport(0, 0, 1280, 720);
+    glEnable(GL_DEPTH_TEST);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(program);
+    glBindVertexArray(1);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindBuffer(GL_ARRAY_BUFFER, 1);
+
+    if (program != driver->program
+        || texture != driver->textures[0]
+        || false == driver->is_depth_test_enabled
+        || 1280 != driver->viewport[2])
+      {
+        printf("The fake driver isn't in the state we asked for (draw %u).\n", i);
+        exit(EXIT_FAILURE);
+      }
+  }
+}
+
+/* Mirrors what `make_context_current()` does for a real context. */
+static void make_fake_current(FakeContext* ctx) {
+  driver = (nullptr == ctx) ? nullptr : &ctx->driver;
+  gl_state_filter_make_current((nullptr == ctx) ? nullptr : &ctx->state);
+}
+
+/* ----------------------------------------------------------- */
+
+static void APIENTRY fake_glUseProgram(GLuint program) {
+  driver->program = program;
+  driver->num_calls++;
+}
+
+static void APIENTRY fake_glBindVertexArray(GLuint array) {
+  driver->vertex_array = array;
+  driver->num_calls++;
+}
+
+static void APIENTRY fake_glBindBuffer(GLenum target, GLuint buffer) {
+  if (GL_ARRAY_BUFFER == target) {
+    driver->array_buffer = buffer;
+  }
+  driver->num_calls++;
+}
+
+static void APIENTRY fake_glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+  for (GLsizei i = 0; i < n; ++i) {
+    if (driver->array_buffer == buffers[i]) {
+      driver->array_buffer = 0;
+    }
+  }
+  driver->num_calls++;
+}
+
+static void APIENTRY fake_glActiveTexture(GLenum texture) {
+  driver->active_texture = texture - GL_TEXTURE0;
+  driver->num_calls++;
+}
+
+static void APIENTRY fake_glBindTexture(GLenum, GLuint texture) {
+  driver->textures[driver->active_texture] = texture;
+  driver->num_calls++;
+}
+
+static void APIENTRY fake_glEnable(GLenum cap) {
+  if (GL_DEPTH_TEST == cap) {
+    driver->is_depth_test_enabled = true;
+  }
+  driver->num_calls++;
+}
+
+static void APIENTRY fake_glDisable(GLenum cap) {
+  if (GL_DEPTH_TEST == cap) {
+    driver->is_depth_test_enabled = false;
+  }
+  driver->num_calls++;
+}
+
+static void APIENTRY fake_glBlendFunc(GLenum sfactor, GLenum dfactor) {
+  driver->blend_src = sfactor;
+  driver->blend_dst = dfactor;
+  driver->num_calls++;
+}
+
+static void APIENTRY fake_glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  driver->viewport[0] = x;
+  driver->viewport[1] = y;
+  driver->viewport[2] = width;
+  driver->viewport[3] = height;
+  driver->num_calls++;
+}
+
+static void install_fake_driver() {
+  glad_glUseProgram = fake_glUseProgram;
+  glad_glBindVertexArray = fake_glBindVertexArray;
+  glad_glBindBuffer = fake_glBindBuffer;
+  glad_glDeleteBuffers = fake_glDeleteBuffers;
+  glad_glActiveTexture = fake_glActiveTexture;
+  glad_glBindTexture = fake_glBindTexture;
+  glad_glEnable = fake_glEnable;
+  glad_glDisable = fake_glDisable;
+  glad_glBlendFunc = fake_glBlendFunc;
+  glad_glViewport = fake_glViewport;
+}
+
+/* ----------------------------------------------------------- */
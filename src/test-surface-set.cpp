@@ -0,0 +1,244 @@
+/*
+
+  SURFACE SET
+  ============
+
+  Tests the `GlSurfaceSet` (see `gl-surface-set.h`): one context
+  renders into four surfaces of different sizes (pbuffers on
+  Linux, windows on Windows). The program and the vertex array
+  are created once and used for all surfaces; vertex arrays
+  can't be shared between contexts, so this only works because
+  it's the same context. The test checks that:
+
+  - every surface got its own color, in the center and in the
+    corner (the viewport was set per surface);
+
+  - every surface was swapped every frame and the context was
+    only switched when the surface changed;
+
+  - after `shutdown()` the context is current on its own surface
+    again.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <gl-context.h>
+#include <gl-surface-set.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_surfaces = 4;
+static const uint32_t num_frames = 30;
+
+/* ----------------------------------------------------------- */
+
+static void get_color(uint32_t index, uint8_t* rgb);
+
+#if defined(_WIN32)
+static HWND create_window(int x, int width, int height);
+#endif
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the surface set.\n");
+
+  GlContext ctx;
+
+  if (0 != create_shared_context(nullptr, ctx)) {
+    printf("Failed to create the context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != make_context_current(ctx)) {
+    printf("Failed to make the context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GlSurfaceSet surfaces;
+
+  if (0 != surfaces.init(&ctx)) {
+    printf("Failed to initialize the surface set. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+#if defined(_WIN32)
+  std::vector<HWND> windows;
+  int x = 0;
+#endif
+
+  for (uint32_t i = 0; i < num_surfaces; ++i) {
+
+    int size = 32 * (int)(i + 1);
+    int r = 0;
+
+#if defined(_WIN32)
+    HWND hwnd = create_window(x, size, size);
+    windows.push_back(hwnd);
+    x += size + 8;
+    r = surfaces.add_window(hwnd);
+#else
+    r = surfaces.add_pbuffer(size, size);
+#endif
+
+    if (0 != r) {
+      printf("Failed to add surface %u. (exiting).\n", i);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* Created once, used for all surfaces. */
+  GLuint prog = create_program(fullscreen_vs, color_fs);
+  if (0 == prog) {
+    printf("Failed to create the program. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GLint u_color = glGetUniformLocation(prog, "u_color");
+  GLuint vao = 0;
+  glGenVertexArrays(1, &vao);
+
+  for (uint32_t frame = 0; frame < num_frames; ++frame) {
+
+    for (uint32_t i = 0; i < num_surfaces; ++i) {
+
+      if (0 != surfaces.make_current(i)) {
+        printf("Failed to make surface %u current. (exiting).\n", i);
+        exit(EXIT_FAILURE);
+      }
+
+      const GlSurface& surf = surfaces.surfaces[i];
+      uint8_t rgb[3] = {};
+      get_color(i, rgb);
+
+      glViewport(0, 0, surf.width, surf.height);
+      glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT);
+      glUseProgram(prog);
+      glUniform4f(u_color, rgb[0] / 255.0f, rgb[1] / 255.0f, rgb[2] / 255.0f, 1.0f);
+      glBindVertexArray(vao);
+      glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    if (0 != surfaces.swap_all()) {
+      printf("Failed to swap the surfaces. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* Read back the center and the top right corner of every surface. */
+  bool are_colors_ok = true;
+
+  for (uint32_t i = 0; i < num_surfaces; ++i) {
+
+    surfaces.make_current(i);
+
+    const GlSurface& surf = surfaces.surfaces[i];
+    uint8_t expected[3] = {};
+    uint8_t center[4] = {};
+    uint8_t corner[4] = {};
+
+    get_color(i, expected);
+    glReadPixels(surf.width / 2, surf.height / 2, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, center);
+    glReadPixels(surf.width - 1, surf.height - 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, corner);
+
+    for (int c = 0; c < 3; ++c) {
+      are_colors_ok &= (center[c] == expected[c]);
+      are_colors_ok &= (corner[c] == expected[c]);
+    }
+
+    printf("- Surface %u: %d x %d, center %u %u %u, corner %u %u %u, %llu swaps.\n",
+           i,
+           surf.width,
+           surf.height,
+           center[0], center[1], center[2],
+           corner[0], corner[1], corner[2],
+           (unsigned long long)surf.num_swaps);
+  }
+
+  surfaces.print();
+
+  bool are_swaps_ok = true;
+  for (const GlSurface& surf : surfaces.surfaces) {
+    are_swaps_ok &= (num_frames == surf.num_swaps);
+  }
+
+  /* On EGL `swap_all()` switches too, but it starts with the surface that is current. */
+#if defined(_WIN32)
+  uint64_t max_switches = (uint64_t)num_frames * num_surfaces + num_surfaces;
+  uint64_t max_batches = (uint64_t)num_frames * ((num_surfaces + WGL_SWAPMULTIPLE_MAX - 1) / WGL_SWAPMULTIPLE_MAX);
+#else
+  uint64_t max_switches = (uint64_t)num_frames * (2 * num_surfaces - 1) + num_surfaces;
+  uint64_t max_batches = (uint64_t)num_frames * num_surfaces;
+#endif
+
+  bool is_ok = true;
+  is_ok &= check(true == are_colors_ok, "every surface has its own color in the center and the corner");
+  is_ok &= check(true == are_swaps_ok, "every surface was swapped every frame");
+  is_ok &= check(num_frames == surfaces.stats.num_frames, "`swap_all()` was counted once per frame");
+  is_ok &= check(surfaces.stats.num_batches <= max_batches, "the swaps were batched");
+  is_ok &= check(surfaces.stats.num_switches <= max_switches, "the context only switched when the surface changed");
+  is_ok &= check(GL_NO_ERROR == glGetError(), "no GL errors");
+
+  glDeleteVertexArrays(1, &vao);
+  glDeleteProgram(prog);
+
+  if (0 != surfaces.shutdown()) {
+    printf("Failed to shutdown the surface set. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+#if defined(_WIN32)
+  is_ok &= check(wglGetCurrentDC() == ctx.dc, "the context is current on its own surface again");
+  for (HWND hwnd : windows) {
+    DestroyWindow(hwnd);
+  }
+#else
+  is_ok &= check(eglGetCurrentSurface(EGL_DRAW) == ctx.surface, "the context is current on its own surface again");
+#endif
+
+  release_current_context();
+
+  if (0 != destroy_main_context(ctx)) {
+    printf("Failed to destroy the context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (false == is_ok) {
+    printf("The surface set test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+static void get_color(uint32_t index, uint8_t* rgb) {
+  rgb[0] = (0 == (index % 2)) ? 255 : 0;
+  rgb[1] = (index >= 2) ? 255 : 0;
+  rgb[2] = (1 == (index % 3)) ? 255 : 51;
+}
+
+#if defined(_WIN32)
+
+static HWND create_window(int x, int width, int height) {
+
+  HWND hwnd = CreateWindowA("STATIC", "surface", WS_POPUP | WS_VISIBLE, x, 0, width, height, nullptr, nullptr, GetModuleHandle(nullptr), nullptr);
+  if (nullptr == hwnd) {
+    printf("Failed to create a window. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  return hwnd;
+}
+
+#endif
+
+/* ----------------------------------------------------------- */
@@ -0,0 +1,168 @@
+/*
+
+  TEXTURE HANDOFF
+  ================
+
+  A couple of `GlWorker`s upload textures in their own shared
+  context. When a texture is ready, the worker creates a fence
+  and pushes the texture name + fence into a `MpscQueue`. The
+  render thread pops the textures in batches, makes its GPU wait
+  for the fence (`glWaitSync()`) and reads the texture back to
+  check the uploaded texels. There is no mutex between the
+  workers and the render thread.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include <gl-context.h>
+#include <gl-worker.h>
+#include <gl-resource.h>
+#include <mpsc-queue.h>
+
+/* ----------------------------------------------------------- */
+
+struct TextureHandoff {
+  GLuint texture = 0;
+  GLsync fence = nullptr;
+  uint32_t worker = 0;
+  uint8_t value = 0;                           /* Of every texel. */
+};
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_workers = 2;
+static const uint32_t num_textures = 200;
+static const GLsizei tex_size = 64;
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing texture handoff between contexts.\n");
+
+  GlContext main;
+  if (0 != create_shared_context(nullptr, main)) {
+    printf("Failed to create the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != release_current_context()) {
+    printf("Failed to release the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  MpscQueue<TextureHandoff> queue;
+  if (0 != queue.init(64)) {
+    printf("Failed to initialize the handoff queue. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GlWorker workers[num_workers];
+  for (uint32_t i = 0; i < num_workers; ++i) {
+    if (0 != workers[i].start(&main)) {
+      printf("Failed to start worker %u. (exiting).\n", i);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (uint32_t i = 0; i < num_workers; ++i) {
+    for (uint32_t j = 0; j < num_textures; ++j) {
+      workers[i].post([&queue, i, j]() {
+
+        std::vector<uint8_t> pixels(tex_size * tex_size * 4, (uint8_t)j);
+        TextureHandoff handoff;
+        handoff.worker = i;
+        handoff.value = (uint8_t)j;
+
+        /* With DSA the upload doesn't touch the bindings of the worker's context. */
+        gl_create_texture(GL_TEXTURE_2D, 1, GL_RGBA8, tex_size, tex_size, 0, handoff.texture);
+        gl_upload_texture(GL_TEXTURE_2D, handoff.texture, 0, 0, 0, 0, tex_size, tex_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        gl_set_texture_parameter(GL_TEXTURE_2D, handoff.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+        /* The fence must reach the GPU before another context waits for it. */
+        handoff.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+
+        while (false == queue.push(handoff)) {
+          std::this_thread::yield();
+        }
+      });
+    }
+  }
+
+  /* The render thread; reads every texture back to check that the upload finished before we used it. */
+  GLuint fbo = 0;
+  if (0 != gl_create_framebuffer(fbo)) {
+    printf("Failed to create the readback framebuffer. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+
+  std::vector<uint8_t> readback(tex_size * tex_size * 4);
+  TextureHandoff batch[16];
+  uint32_t num_received = 0;
+  uint32_t num_batches = 0;
+  uint32_t num_bad_textures = 0;
+
+  while (num_received < num_workers * num_textures) {
+
+    size_t n = queue.pop_batch(batch, 16);
+    if (0 == n) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      glWaitSync(batch[i].fence, 0, GL_TIMEOUT_IGNORED);
+      glDeleteSync(batch[i].fence);
+
+      /* Something else than the expected value, so a failed read is caught too. */
+      std::fill(readback.begin(), readback.end(), (uint8_t)(batch[i].value + 1));
+
+      if (0 == gl_attach_texture(fbo, GL_COLOR_ATTACHMENT0, batch[i].texture, 0)) {
+        glReadPixels(0, 0, tex_size, tex_size, GL_RGBA, GL_UNSIGNED_BYTE, readback.data());
+      }
+
+      for (uint8_t texel : readback) {
+        if (texel != batch[i].value) {
+          num_bad_textures++;
+          break;
+        }
+      }
+
+      glDeleteTextures(1, &batch[i].texture);
+    }
+
+    num_received += (uint32_t)n;
+    num_batches++;
+  }
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &fbo);
+
+  printf("- Received %u textures in %u batches, %u with wrong texels.\n", num_received, num_batches, num_bad_textures);
+
+  for (uint32_t i = 0; i < num_workers; ++i) {
+    workers[i].shutdown();
+  }
+
+  release_current_context();
+  destroy_main_context(main);
+
+  if (0 != num_bad_textures) {
+    printf("Some textures didn't have the texels the worker uploaded. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
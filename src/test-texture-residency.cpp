@@ -0,0 +1,248 @@
+/*
+
+  TEXTURE RESIDENCY
+  ==================
+
+  Creates 64 small textures, each with its own color, and adds
+  them to a `TextureResidency` that may keep 16 of them
+  resident. Every frame we draw 8 quads into an 8x1 framebuffer,
+  one pixel each; the quads use a window of 8 textures that
+  slides over all 64, so textures keep getting evicted and made
+  resident again.
+
+  The fragment shader samples through the handle table (no
+  `glBindTexture()`). We read back the pixels and check that
+  every quad got the color of its texture, that the number of
+  resident textures stays within the budget, and that the
+  manager agrees with `glIsTextureHandleResidentARB()`.
+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <gl-context.h>
+#include <gl-texture-residency.h>
+#include <test-utils.h>
+
+/* ----------------------------------------------------------- */
+
+static const uint32_t num_textures = 64;
+static const uint32_t num_draws = 8;
+static const uint32_t num_frames = 200;
+
+/* ----------------------------------------------------------- */
+
+static const char* vs = ""
+  "#version 430\n"
+  "uniform int u_index;\n"
+  "void main() {\n"
+  "  vec2 pos = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+  "  float x = -1.0 + (float(u_index) + pos.x) * (2.0 / 8.0);\n"
+  "  gl_Position = vec4(x, pos.y * 2.0 - 1.0, 0.0, 1.0);\n"
+  "}\n";
+
+static const char* fs = ""
+  "#version 430\n"
+  "#extension GL_ARB_bindless_texture : require\n"
+  "layout(std430, binding = 1) readonly buffer Textures { uvec2 textures[]; };\n"
+  "uniform uint u_slot;\n"
+  "layout(location = 0) out vec4 fragcolor;\n"
+  "void main() {\n"
+  "  fragcolor = texture(sampler2D(textures[u_slot]), vec2(0.5));\n"
+  "}\n";
+
+/* ----------------------------------------------------------- */
+
+static uint32_t get_color(uint32_t index);
+
+/* ----------------------------------------------------------- */
+
+int main(int narg, char* arg[]) {
+
+  printf("! Testing the texture residency.\n");
+
+  GlContext main;
+  if (0 != create_shared_context(nullptr, main)) {
+    printf("Failed to create the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != make_context_current(main)) {
+    printf("Failed to make the main context current. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  TextureResidencySettings settings;
+  settings.max_textures = 128;
+  settings.max_resident = 16;
+  settings.keep_frames = 4;
+
+  TextureResidency residency;
+  if (0 != residency.init(settings)) {
+    printf("Failed to initialize the texture residency. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GLuint prog = create_program(vs, fs);
+  if (0 == prog) {
+    printf("Failed to create the program. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  GLint u_index = glGetUniformLocation(prog, "u_index");
+  GLint u_slot = glGetUniformLocation(prog, "u_slot");
+
+  /* Textures; the parameters must be set before we get the handle. */
+  GLuint textures[num_textures] = { 0 };
+  uint32_t slots[num_textures] = { 0 };
+
+  glGenTextures(num_textures, textures);
+
+  for (uint32_t i = 0; i < num_textures; ++i) {
+
+    uint32_t pixels[16];
+    for (uint32_t j = 0; j < 16; ++j) {
+      pixels[j] = get_color(i);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, textures[i]);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 4, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 4, 4, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    if (0 != residency.add(textures[i], 0, slots[i])) {
+      printf("Failed to add texture %u. (exiting).\n", i);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  /* Render target */
+  GLuint target = 0;
+  GLuint fbo = 0;
+  GLuint vao = 0;
+
+  glGenTextures(1, &target);
+  glBindTexture(GL_TEXTURE_2D, target);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, num_draws, 1);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+  glGenVertexArrays(1, &vao);
+
+  if (GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus(GL_FRAMEBUFFER)) {
+    printf("The framebuffer is not complete. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  glViewport(0, 0, num_draws, 1);
+  glUseProgram(prog);
+  glBindVertexArray(vao);
+
+  uint32_t num_wrong_pixels = 0;
+  uint32_t num_over_budget = 0;
+  uint32_t num_mismatches = 0;
+
+  for (uint32_t frame = 0; frame < num_frames; ++frame) {
+
+    if (0 != residency.begin_frame()) {
+      printf("Failed to begin the frame. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+    uint32_t first = (frame * 3) % num_textures;
+
+    for (uint32_t i = 0; i < num_draws; ++i) {
+      residency.use(slots[(first + i) % num_textures]);
+    }
+
+    if (0 != residency.update()) {
+      printf("Failed to update the texture residency. (exiting).\n");
+      exit(EXIT_FAILURE);
+    }
+
+    residency.bind(1);
+
+    for (uint32_t i = 0; i < num_draws; ++i) {
+      glUniform1i(u_index, (GLint)i);
+      glUniform1ui(u_slot, slots[(first + i) % num_textures]);
+      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+
+    uint32_t pixels[num_draws] = { 0 };
+    glReadPixels(0, 0, num_draws, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    for (uint32_t i = 0; i < num_draws; ++i) {
+      if (get_color((first + i) % num_textures) != pixels[i]) {
+        num_wrong_pixels++;
+      }
+    }
+
+    if (residency.resident.size() > settings.max_resident) {
+      num_over_budget++;
+    }
+
+    for (uint32_t i = 0; i < num_textures; ++i) {
+      const ResidentTexture& tex = residency.textures[slots[i]];
+      if ((GL_TRUE == glIsTextureHandleResidentARB(tex.handle)) != tex.is_resident) {
+        num_mismatches++;
+      }
+    }
+
+    residency.end_frame();
+  }
+
+  TextureResidencyStats stats;
+  residency.get_stats(stats);
+
+  printf("- Frames: %u, textures: %u, resident: %u.\n", num_frames, stats.num_textures, stats.num_resident);
+  printf("- Made resident: %llu, made non-resident: %llu, table writes: %llu.\n",
+         (unsigned long long)stats.num_made_resident,
+         (unsigned long long)stats.num_made_non_resident,
+         (unsigned long long)stats.num_table_writes);
+  printf("- Wrong pixels: %u, frames over budget: %u, residency mismatches: %u.\n",
+         num_wrong_pixels,
+         num_over_budget,
+         num_mismatches);
+
+  if (GL_NO_ERROR != glGetError()) {
+    printf("A GL error occurred. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (0 != num_wrong_pixels || 0 != num_over_budget || 0 != num_mismatches) {
+    printf("The texture residency test failed. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("- All checks passed.\n");
+
+  /* Cleanup; the residency deletes the textures we added. */
+  residency.shutdown();
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteTextures(1, &target);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteProgram(prog);
+
+  if (0 != destroy_main_context(main)) {
+    printf("Failed to destroy the main context. (exiting).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ----------------------------------------------------------- */
+
+/* RGBA8 as read back on a little endian machine; alpha is 255. */
+static uint32_t get_color(uint32_t index) {
+  uint32_t hash = (index + 1) * 2654435761u;
+  return 0xFF000000u | (hash & 0x00FFFFFFu);
+}
+
+/* ----------------------------------------------------------- */
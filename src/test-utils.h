@@ -0,0 +1,105 @@
+/*
+
+  TEST UTILS
+  ===========
+
+  Helpers that the tests share. Only include this from a test or
+  a benchmark; everything is `static inline` so each test gets
+  its own copy and nothing has to be added to the poly library.
+
+    bool is_ok = true;
+    is_ok &= check(0 == num_errors, "no GL errors");
+
+  `check()` prints one line per check and returns the condition,
+  so a test can run all its checks and fail at the end.
+
+  `create_program()` compiles and links a vertex and fragment
+  shader and returns 0 (after printing the log) when that fails;
+  it needs a current context. `fullscreen_vs` draws a triangle
+  that covers the viewport with `glDrawArrays(GL_TRIANGLES, 0,
+  3)` and no vertex attributes (an empty vertex array is enough);
+  `color_fs` fills it with the `u_color` uniform. Use
+  `gpu_sync_now_ns()` (see `gl-sync.h`) to time things.
+
+ */
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+#include <stdio.h>
+#include <glad/glad.h>
+#include <gl-state-filter.h>
+
+/* ----------------------------------------------------------- */
+
+static const char* const fullscreen_vs = ""
+  "#version 330\n"
+  "void main() {\n"
+  "  vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+  "  gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);\n"
+  "}\n";
+
+static const char* const color_fs = ""
+  "#version 330\n"
+  "uniform vec4 u_color;\n"
+  "layout(location = 0) out vec4 fragcolor;\n"
+  "void main() {\n"
+  "  fragcolor = u_color;\n"
+  "}\n";
+
+/* ----------------------------------------------------------- */
+
+static inline bool check(bool condition, const char* what) {
+  printf("  %s: %s\n", (true == condition) ? "ok    " : "FAILED", what);
+  return condition;
+}
+
+static inline GLuint create_shader(GLenum type, const char* source) {
+
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, nullptr);
+  glCompileShader(shader);
+
+  GLint status = GL_FALSE;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (GL_FALSE == status) {
+    char log[1024] = { 0 };
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    printf("Failed to compile the shader: %s\n", log);
+    glDeleteShader(shader);
+    return 0;
+  }
+
+  return shader;
+}
+
+static inline GLuint create_program(const char* vs, const char* fs) {
+
+  GLuint vert = create_shader(GL_VERTEX_SHADER, vs);
+  GLuint frag = create_shader(GL_FRAGMENT_SHADER, fs);
+  if (0 == vert || 0 == frag) {
+    return 0;
+  }
+
+  GLuint prog = glCreateProgram();
+  glAttachShader(prog, vert);
+  glAttachShader(prog, frag);
+  glLinkProgram(prog);
+  glDeleteShader(vert);
+  glDeleteShader(frag);
+
+  GLint status = GL_FALSE;
+  glGetProgramiv(prog, GL_LINK_STATUS, &status);
+  if (GL_FALSE == status) {
+    char log[1024] = { 0 };
+    glGetProgramInfoLog(prog, sizeof(log), nullptr, log);
+    printf("Failed to link the program: %s\n", log);
+    glDeleteProgram(prog);
+    return 0;
+  }
+
+  return prog;
+}
+
+/* ----------------------------------------------------------- */
+
+#endif